@@ -0,0 +1,193 @@
+#include "AssetCache.h"
+#include "WICTextureLoader.h"
+
+#include <cwctype>
+#include <vector>
+
+
+// Is the cache's reference the only one left?
+static bool IsUnused(const std::shared_ptr<Mesh>& asset) { return asset.use_count() == 1; }
+static bool IsUnused(const std::shared_ptr<SimpleVertexShader>& asset) { return asset.use_count() == 1; }
+static bool IsUnused(const std::shared_ptr<SimplePixelShader>& asset) { return asset.use_count() == 1; }
+static bool IsUnused(const Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>& asset)
+{
+	// The view holds the texture itself, so only the view's count matters
+	asset->AddRef();
+	return asset->Release() == 1;
+}
+
+// Mesh paths are narrow, but keys are all wide
+static std::wstring Widen(const std::string& text)
+{
+	return std::wstring(text.begin(), text.end());
+}
+
+
+AssetCache::AssetCache(Microsoft::WRL::ComPtr<ID3D11Device> device, Microsoft::WRL::ComPtr<ID3D11DeviceContext> context) :
+	device(device),
+	context(context),
+	loadCount(0),
+	hitCount(0)
+{
+}
+
+std::shared_ptr<Mesh> AssetCache::GetMesh(const std::string& meshFile, unsigned int flags)
+{
+	// The same file with different flags is a different mesh
+	std::wstring key = NormalizePath(Widen(meshFile)) + L"|" + std::to_wstring(flags);
+	return Acquire<std::shared_ptr<Mesh>>(meshes, key, [&]()
+	{
+		std::shared_ptr<Mesh> mesh = std::make_shared<Mesh>(meshFile.c_str(), device, flags);
+		return mesh->GetIndexCount() > 0 ? mesh : 0;
+	});
+}
+
+Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> AssetCache::GetTexture(const std::wstring& textureFile)
+{
+	return Acquire<Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>>(textures, NormalizePath(textureFile), [&]()
+	{
+		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv;
+		DirectX::CreateWICTextureFromFile(device.Get(), context.Get(), textureFile.c_str(), 0, srv.GetAddressOf());
+		return srv;
+	});
+}
+
+std::shared_ptr<SimpleVertexShader> AssetCache::GetSimpleVertexShader(const std::wstring& shaderFile)
+{
+	return Acquire<std::shared_ptr<SimpleVertexShader>>(vertexShaders, NormalizePath(shaderFile), [&]()
+	{
+		std::shared_ptr<SimpleVertexShader> shader = std::make_shared<SimpleVertexShader>(device, context, shaderFile.c_str());
+		return shader->IsShaderValid() ? shader : 0;
+	});
+}
+
+std::shared_ptr<SimplePixelShader> AssetCache::GetSimplePixelShader(const std::wstring& shaderFile)
+{
+	return Acquire<std::shared_ptr<SimplePixelShader>>(pixelShaders, NormalizePath(shaderFile), [&]()
+	{
+		std::shared_ptr<SimplePixelShader> shader = std::make_shared<SimplePixelShader>(device, context, shaderFile.c_str());
+		return shader->IsShaderValid() ? shader : 0;
+	});
+}
+
+int AssetCache::ReleaseUnused()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return
+		ReleaseUnused(meshes) +
+		ReleaseUnused(textures) +
+		ReleaseUnused(vertexShaders) +
+		ReleaseUnused(pixelShaders);
+}
+
+unsigned int AssetCache::GetLoadCount()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return loadCount;
+}
+
+unsigned int AssetCache::GetHitCount()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return hitCount;
+}
+
+
+std::wstring AssetCache::NormalizePath(const std::wstring& path)
+{
+	std::wstring lower = path;
+	for (auto& c : lower)
+		c = (c == L'\\') ? L'/' : (wchar_t)towlower(c);
+
+	// Rebuild the path a part at a time, where ".." removes the
+	// part before it (and does nothing at the root of a drive)
+	std::vector<std::wstring> parts;
+	size_t start = 0;
+	while (start <= lower.size())
+	{
+		size_t end = lower.find(L'/', start);
+		if (end == std::wstring::npos)
+			end = lower.size();
+
+		std::wstring part = lower.substr(start, end - start);
+		start = end + 1;
+
+		bool drive = !parts.empty() && parts.back().back() == L':';
+		if (part.empty() || part == L"." || (part == L".." && drive))
+			continue;
+		if (part == L".." && !parts.empty() && parts.back() != L"..")
+			parts.pop_back();
+		else
+			parts.push_back(part);
+	}
+
+	std::wstring result = (!lower.empty() && lower[0] == L'/') ? L"/" : L"";
+	for (size_t i = 0; i < parts.size(); i++)
+	{
+		if (i > 0) result += L'/';
+		result += parts[i];
+	}
+	return result;
+}
+
+
+template<typename T>
+T AssetCache::Acquire(std::map<std::wstring, CacheEntry<T>>& entries, const std::wstring& key, const std::function<T()>& load)
+{
+	std::promise<T> promise;
+	std::shared_future<T> loading;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		auto found = entries.find(key);
+		if (found != entries.end())
+		{
+			hitCount++;
+			if (found->second.Asset)
+				return found->second.Asset;
+			loading = found->second.Loading;
+		}
+		else
+		{
+			// Anyone else asking for this now waits on this load
+			entries[key].Loading = promise.get_future().share();
+		}
+	}
+	if (loading.valid())
+		return loading.get();
+
+	T asset = load();
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		loadCount++;
+
+		// Failures aren't kept, so the next request tries again
+		auto found = entries.find(key);
+		if (asset)
+		{
+			found->second.Asset = asset;
+			found->second.Loading = std::shared_future<T>();
+		}
+		else
+			entries.erase(found);
+	}
+	promise.set_value(asset);
+	return asset;
+}
+
+template<typename T>
+int AssetCache::ReleaseUnused(std::map<std::wstring, CacheEntry<T>>& entries)
+{
+	int released = 0;
+	for (auto it = entries.begin(); it != entries.end();)
+	{
+		// Entries still loading have no asset yet
+		if (it->second.Asset && IsUnused(it->second.Asset))
+		{
+			it = entries.erase(it);
+			released++;
+		}
+		else
+			++it;
+	}
+	return released;
+}
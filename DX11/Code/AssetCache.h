@@ -0,0 +1,77 @@
+#pragma once
+
+#include <d3d11.h>
+#include <wrl/client.h>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "Mesh.h"
+#include "SimpleShader.h"
+
+// --------------------------------------------------------
+// Hands out shared meshes, textures and shaders, keyed on
+// their normalized full path (plus any load options), so
+// no file is loaded twice while anything still uses it
+//
+// A request for an asset that's already loading on another
+// thread waits for that load instead of starting its own.
+// Textures generate their mips on the immediate context,
+// though, so only request those from the main thread.
+//
+// The cache holds its own reference to every asset, and
+// ReleaseUnused() drops any that nothing else is using
+// anymore, which frees their GPU memory.
+// --------------------------------------------------------
+class AssetCache
+{
+public:
+	AssetCache(Microsoft::WRL::ComPtr<ID3D11Device> device, Microsoft::WRL::ComPtr<ID3D11DeviceContext> context);
+
+	// All of these return null if the file couldn't be loaded (and a
+	// later request tries again)
+	std::shared_ptr<Mesh> GetMesh(const std::string& meshFile, unsigned int flags = MeshFlags_None);
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> GetTexture(const std::wstring& textureFile);
+	std::shared_ptr<SimpleVertexShader> GetSimpleVertexShader(const std::wstring& shaderFile);
+	std::shared_ptr<SimplePixelShader> GetSimplePixelShader(const std::wstring& shaderFile);
+
+	// Returns how many assets were released
+	int ReleaseUnused();
+
+	// Loads actually done, and requests answered without one
+	unsigned int GetLoadCount();
+	unsigned int GetHitCount();
+
+	// Lower case, forward slashes and no "." or ".." parts, so
+	// different spellings of the same path match
+	static std::wstring NormalizePath(const std::wstring& path);
+
+private:
+	template<typename T>
+	struct CacheEntry
+	{
+		T Asset;							// Null while loading
+		std::shared_future<T> Loading;
+	};
+
+	Microsoft::WRL::ComPtr<ID3D11Device> device;
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context;
+
+	std::mutex mutex;
+	std::map<std::wstring, CacheEntry<std::shared_ptr<Mesh>>> meshes;
+	std::map<std::wstring, CacheEntry<Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>>> textures;
+	std::map<std::wstring, CacheEntry<std::shared_ptr<SimpleVertexShader>>> vertexShaders;
+	std::map<std::wstring, CacheEntry<std::shared_ptr<SimplePixelShader>>> pixelShaders;
+	unsigned int loadCount;
+	unsigned int hitCount;
+
+	// Finds the asset, waits for it or loads it
+	template<typename T>
+	T Acquire(std::map<std::wstring, CacheEntry<T>>& entries, const std::wstring& key, const std::function<T()>& load);
+
+	template<typename T>
+	int ReleaseUnused(std::map<std::wstring, CacheEntry<T>>& entries);
+};
@@ -0,0 +1,1400 @@
+#include "Benchmarks.h"
+#include "ObjParser.h"
+#include "JobSystem.h"
+#include "MeshBinary.h"
+#include "GlbFile.h"
+#include "MeshCodec.h"
+#include "MeshOptimizer.h"
+#include "Mesh.h"
+#include "Meshlets.h"
+#include "MeshSimplifier.h"
+#include "MeshBvh.h"
+#include "MeshGenerator.h"
+#include "Bounds.h"
+#include "StaticBatch.h"
+#include "Transform.h"
+#include "VertexPacking.h"
+
+#include <chrono>
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+
+using namespace DirectX;
+
+// Helper for timing a piece of code, in milliseconds
+template<typename Func>
+static double TimeMilliseconds(Func func)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+	func();
+	auto end = std::chrono::high_resolution_clock::now();
+	return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+// Strips the directory from a path, for more readable output
+static std::string FileName(const std::string& path)
+{
+	size_t slash = path.find_last_of("\\/");
+	return slash == std::string::npos ? path : path.substr(slash + 1);
+}
+
+
+// --------------------------------------------------------
+// The original Mesh OBJ loader, kept as the baseline for
+// comparison: line-by-line reads into a 100 character
+// buffer and sscanf_s for every line
+// --------------------------------------------------------
+static bool LegacyParseObj(const char* objFile, ObjMeshData& output)
+{
+	std::ifstream obj(objFile);
+	if (!obj.is_open())
+		return false;
+
+	std::vector<XMFLOAT3> positions;
+	std::vector<XMFLOAT3> normals;
+	std::vector<XMFLOAT2> uvs;
+	unsigned int vertCounter = 0;
+	char chars[100];
+
+	while (obj.good())
+	{
+		obj.getline(chars, 100);
+
+		if (chars[0] == 'v' && chars[1] == 'n')
+		{
+			XMFLOAT3 norm;
+			sscanf_s(chars, "vn %f %f %f", &norm.x, &norm.y, &norm.z);
+			normals.push_back(norm);
+		}
+		else if (chars[0] == 'v' && chars[1] == 't')
+		{
+			XMFLOAT2 uv;
+			sscanf_s(chars, "vt %f %f", &uv.x, &uv.y);
+			uvs.push_back(uv);
+		}
+		else if (chars[0] == 'v')
+		{
+			XMFLOAT3 pos;
+			sscanf_s(chars, "v %f %f %f", &pos.x, &pos.y, &pos.z);
+			positions.push_back(pos);
+		}
+		else if (chars[0] == 'f')
+		{
+			unsigned int i[12];
+			int facesRead = sscanf_s(
+				chars,
+				"f %d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d",
+				&i[0], &i[1], &i[2],
+				&i[3], &i[4], &i[5],
+				&i[6], &i[7], &i[8],
+				&i[9], &i[10], &i[11]);
+
+			Vertex v[4] = {};
+			for (int c = 0; c < facesRead / 3; c++)
+			{
+				v[c].Position = positions[i[c * 3] - 1];
+				v[c].UV = uvs[i[c * 3 + 1] - 1];
+				v[c].Normal = normals[i[c * 3 + 2] - 1];
+				v[c].UV.y = 1.0f - v[c].UV.y;
+				v[c].Position.z *= -1.0f;
+				v[c].Normal.z *= -1.0f;
+			}
+
+			output.Vertices.push_back(v[0]);
+			output.Vertices.push_back(v[2]);
+			output.Vertices.push_back(v[1]);
+			for (int k = 0; k < 3; k++) output.Indices.push_back(vertCounter++);
+
+			if (facesRead == 12)
+			{
+				output.Vertices.push_back(v[0]);
+				output.Vertices.push_back(v[3]);
+				output.Vertices.push_back(v[2]);
+				for (int k = 0; k < 3; k++) output.Indices.push_back(vertCounter++);
+			}
+		}
+	}
+
+	return vertCounter > 0;
+}
+
+
+// --------------------------------------------------------
+// The original Mesh::CalculateTangents, kept as the baseline
+// for comparison: one triangle at a time, adding straight
+// into each of its vertices, then Gram-Schmidt per vertex
+// --------------------------------------------------------
+static void LegacyCalculateTangents(Vertex* verts, int numVerts, unsigned int* indices, int numIndices)
+{
+	for (int i = 0; i < numVerts; i++)
+		verts[i].Tangent = XMFLOAT3(0, 0, 0);
+
+	for (int i = 0; i < numIndices;)
+	{
+		Vertex* v1 = &verts[indices[i++]];
+		Vertex* v2 = &verts[indices[i++]];
+		Vertex* v3 = &verts[indices[i++]];
+
+		float x1 = v2->Position.x - v1->Position.x;
+		float y1 = v2->Position.y - v1->Position.y;
+		float z1 = v2->Position.z - v1->Position.z;
+
+		float x2 = v3->Position.x - v1->Position.x;
+		float y2 = v3->Position.y - v1->Position.y;
+		float z2 = v3->Position.z - v1->Position.z;
+
+		float s1 = v2->UV.x - v1->UV.x;
+		float t1 = v2->UV.y - v1->UV.y;
+
+		float s2 = v3->UV.x - v1->UV.x;
+		float t2 = v3->UV.y - v1->UV.y;
+
+		float det = s1 * t2 - s2 * t1;
+		if (det == 0.0f)
+			continue;
+		float r = 1.0f / det;
+
+		float tx = (t2 * x1 - t1 * x2) * r;
+		float ty = (t2 * y1 - t1 * y2) * r;
+		float tz = (t2 * z1 - t1 * z2) * r;
+
+		v1->Tangent.x += tx; v1->Tangent.y += ty; v1->Tangent.z += tz;
+		v2->Tangent.x += tx; v2->Tangent.y += ty; v2->Tangent.z += tz;
+		v3->Tangent.x += tx; v3->Tangent.y += ty; v3->Tangent.z += tz;
+	}
+
+	for (int i = 0; i < numVerts; i++)
+	{
+		XMVECTOR normal = XMLoadFloat3(&verts[i].Normal);
+		XMVECTOR tangent = XMLoadFloat3(&verts[i].Tangent);
+		tangent = XMVector3Normalize(tangent - normal * XMVector3Dot(normal, tangent));
+		XMStoreFloat3(&verts[i].Tangent, tangent);
+	}
+}
+
+// --------------------------------------------------------
+// Tests a ray against every triangle of a mesh, as the
+// reference the BVH's answers are checked against.  Returns
+// the closest hit distance, or FLT_MAX for a miss.
+// --------------------------------------------------------
+static float BruteForceRaycast(const ObjMeshData& data, XMFLOAT3 origin, XMFLOAT3 direction)
+{
+	XMVECTOR o = XMLoadFloat3(&origin);
+	XMVECTOR d = XMLoadFloat3(&direction);
+	float closest = FLT_MAX;
+	for (size_t i = 0; i + 2 < data.Indices.size(); i += 3)
+	{
+		XMVECTOR p0 = XMLoadFloat3(&data.Vertices[data.Indices[i]].Position);
+		XMVECTOR e1 = XMLoadFloat3(&data.Vertices[data.Indices[i + 1]].Position) - p0;
+		XMVECTOR e2 = XMLoadFloat3(&data.Vertices[data.Indices[i + 2]].Position) - p0;
+
+		XMVECTOR p = XMVector3Cross(d, e2);
+		float det = XMVectorGetX(XMVector3Dot(e1, p));
+		if (det == 0.0f)
+			continue;
+
+		XMVECTOR s = o - p0;
+		float u = XMVectorGetX(XMVector3Dot(s, p)) / det;
+		XMVECTOR q = XMVector3Cross(s, e1);
+		float v = XMVectorGetX(XMVector3Dot(d, q)) / det;
+		float t = XMVectorGetX(XMVector3Dot(e2, q)) / det;
+		if (u >= 0.0f && v >= 0.0f && u + v <= 1.0f && t > 0.0f && t < closest)
+			closest = t;
+	}
+	return closest;
+}
+
+// --------------------------------------------------------
+// Writes a subdivided plane as an OBJ, with positions, uvs
+// and normals all present and printed with full precision.
+// The file is roughly 200 bytes per grid cell.
+// --------------------------------------------------------
+bool Benchmarks::WriteSyntheticObj(const std::string& path, int gridSize)
+{
+	FILE* file = 0;
+	if (fopen_s(&file, path.c_str(), "w") != 0 || !file)
+		return false;
+
+	int side = gridSize + 1;
+	for (int z = 0; z < side; z++)
+		for (int x = 0; x < side; x++)
+		{
+			float fx = (float)x / gridSize;
+			float fz = (float)z / gridSize;
+			fprintf(file, "v %.6f %.6f %.6f\n", fx * 100.0f - 50.0f, sinf(fx * 20.0f) * cosf(fz * 20.0f), fz * 100.0f - 50.0f);
+		}
+	for (int z = 0; z < side; z++)
+		for (int x = 0; x < side; x++)
+			fprintf(file, "vt %.6f %.6f\n", (float)x / gridSize, (float)z / gridSize);
+	fprintf(file, "vn 0.000000 1.000000 0.000000\n");
+
+	for (int z = 0; z < gridSize; z++)
+		for (int x = 0; x < gridSize; x++)
+		{
+			int i0 = z * side + x + 1;
+			int i1 = i0 + 1;
+			int i2 = i0 + side + 1;
+			int i3 = i0 + side;
+			fprintf(file, "f %d/%d/1 %d/%d/1 %d/%d/1 %d/%d/1\n", i0, i0, i1, i1, i2, i2, i3, i3);
+		}
+
+	fclose(file);
+	return true;
+}
+
+
+void Benchmarks::ObjParsing(const std::vector<std::string>& objFiles, const std::string& syntheticObjFile)
+{
+	printf("\n=== OBJ parsing: original loader vs. ObjParser (%u threads) ===\n", JobSystem::GetInstance().GetThreadCount());
+	printf("%-28s %10s %12s %12s %12s %9s %s\n", "File", "Verts", "Legacy (ms)", "Serial (ms)", "Parallel (ms)", "Speedup", "Output");
+
+	// Real assets plus one big generated file
+	std::vector<std::string> files = objFiles;
+	bool haveSynthetic = WriteSyntheticObj(syntheticObjFile, 1000);
+	if (haveSynthetic)
+		files.push_back(syntheticObjFile);
+
+	for (auto& path : files)
+	{
+		ObjMeshData legacy;
+		ObjMeshData serial;
+		ObjMeshData fast;
+		bool legacyOk = false, serialOk = false, fastOk = false;
+
+		double legacyMs = TimeMilliseconds([&]() { legacyOk = LegacyParseObj(path.c_str(), legacy); });
+		double serialMs = TimeMilliseconds([&]() { serialOk = ObjParser::ParseFile(path.c_str(), serial, false, false); });
+		double fastMs = TimeMilliseconds([&]() { fastOk = ObjParser::ParseFile(path.c_str(), fast, true, false); });
+
+		if (!legacyOk || !serialOk || !fastOk)
+		{
+			printf("%-28s failed to load\n", FileName(path).c_str());
+			continue;
+		}
+
+		// Verify the outputs agree, allowing for last-bit rounding
+		// differences between sscanf and our float parser
+		bool match = legacy.Vertices.size() == fast.Vertices.size();
+		for (size_t i = 0; match && i < fast.Vertices.size(); i++)
+		{
+			const float* a = &legacy.Vertices[i].Position.x;
+			const float* b = &fast.Vertices[i].Position.x;
+			for (int f = 0; f < 8; f++)
+				if (fabsf(a[f] - b[f]) > 1e-6f * (1.0f + fabsf(a[f])))
+					match = false;
+		}
+
+		// The parallel parse must be bit-for-bit the same as the serial one
+		bool bitIdentical =
+			serial.Vertices.size() == fast.Vertices.size() &&
+			memcmp(&serial.Vertices[0], &fast.Vertices[0], sizeof(Vertex) * fast.Vertices.size()) == 0 &&
+			serial.Indices == fast.Indices;
+
+		printf("%-28s %10zu %12.2f %12.2f %12.2f %8.1fx %s\n",
+			FileName(path).c_str(),
+			fast.Vertices.size(),
+			legacyMs,
+			serialMs,
+			fastMs,
+			legacyMs / fastMs,
+			!match ? "MISMATCH vs legacy" : bitIdentical ? "identical" : "MISMATCH serial vs parallel");
+	}
+
+	if (haveSynthetic)
+		remove(syntheticObjFile.c_str());
+}
+
+
+void Benchmarks::VertexWelding(const std::vector<std::string>& objFiles)
+{
+	printf("\n=== OBJ vertex welding ===\n");
+	printf("%-28s %10s %10s %10s %12s %12s %10s\n", "File", "Indices", "Unwelded", "Welded", "Before (KB)", "After (KB)", "Reduction");
+
+	for (auto& path : objFiles)
+	{
+		ObjMeshData unwelded;
+		ObjMeshData welded;
+		if (!ObjParser::ParseFile(path.c_str(), unwelded, true, false) ||
+			!ObjParser::ParseFile(path.c_str(), welded, true, true))
+		{
+			printf("%-28s failed to load\n", FileName(path).c_str());
+			continue;
+		}
+
+		// Same triangles, fewer vertices
+		size_t before = unwelded.Vertices.size() * sizeof(Vertex) + unwelded.Indices.size() * sizeof(unsigned int);
+		size_t after = welded.Vertices.size() * sizeof(Vertex) + welded.Indices.size() * sizeof(unsigned int);
+		printf("%-28s %10zu %10zu %10zu %12.1f %12.1f %9.2fx\n",
+			FileName(path).c_str(),
+			welded.Indices.size(),
+			unwelded.Vertices.size(),
+			welded.Vertices.size(),
+			before / 1024.0,
+			after / 1024.0,
+			(double)unwelded.Vertices.size() / welded.Vertices.size());
+	}
+}
+
+
+void Benchmarks::MeshCacheLoading(const std::vector<std::string>& objFiles)
+{
+	printf("\n=== Mesh loading: OBJ parse vs. uncompressed binary cache ===\n");
+	printf("%-28s %10s %12s %12s %12s %9s %s\n", "File", "Verts", "OBJ (KB)", "Parse (ms)", "Cache (ms)", "Speedup", "Output");
+
+	for (auto& path : objFiles)
+	{
+		ObjMeshData data;
+		if (!ObjParser::ParseFile(path.c_str(), data))
+		{
+			printf("%-28s failed to load\n", FileName(path).c_str());
+			continue;
+		}
+
+		// Use a separate name, so the real cache (which also has tangents) is left alone
+		std::string binFile = MeshBinary::PathFor(path.c_str()) + ".benchmark";
+		if (!MeshBinary::Write(binFile.c_str(), path.c_str(), &data.Vertices[0], (int)data.Vertices.size(), &data.Indices[0], (int)data.Indices.size(), false))
+		{
+			printf("%-28s failed to write cache\n", FileName(path).c_str());
+			continue;
+		}
+
+		double parseMs = TimeMilliseconds([&]() { ObjMeshData parsed; ObjParser::ParseFile(path.c_str(), parsed); });
+
+		// Loading includes validating against the source and reading every
+		// byte once, which is what creating the GPU buffers would do
+		bool match = false;
+		double cacheMs = TimeMilliseconds([&]()
+		{
+			MeshBinary cache(binFile.c_str());
+			if (!cache.IsValid() || !cache.MatchesSource(path.c_str()) || !cache.Load())
+				return;
+			match =
+				cache.GetVertexCount() == (int)data.Vertices.size() &&
+				cache.GetIndexCount() == (int)data.Indices.size() &&
+				memcmp(cache.GetVertices(), &data.Vertices[0], sizeof(Vertex) * data.Vertices.size()) == 0 &&
+				memcmp(cache.GetIndices(), &data.Indices[0], sizeof(unsigned int) * data.Indices.size()) == 0;
+		});
+
+		// A cache with an index past the end of the vertices must be
+		// rejected, even though it isn't compressed
+		bool rejected = false;
+		std::vector<unsigned int> badIndices = data.Indices;
+		badIndices.back() = (unsigned int)data.Vertices.size();
+		if (MeshBinary::Write(binFile.c_str(), path.c_str(), &data.Vertices[0], (int)data.Vertices.size(), &badIndices[0], (int)badIndices.size(), false))
+		{
+			MeshBinary cache(binFile.c_str());
+			rejected = cache.IsValid() && !cache.Load() && !cache.GetIndices();
+		}
+
+		// Hashing is only needed when the source's time stamp changes
+		MappedFile source(path.c_str());
+		unsigned long long hash = 0;
+		double hashMs = TimeMilliseconds([&]() { hash = MeshBinary::HashBytes(source.GetData(), source.GetSize()); });
+
+		printf("%-28s %10zu %12.1f %12.2f %12.3f %8.1fx %s, %s (hash %.3f ms)\n",
+			FileName(path).c_str(),
+			data.Vertices.size(),
+			source.GetSize() / 1024.0,
+			parseMs,
+			cacheMs,
+			parseMs / cacheMs,
+			match ? "identical" : "MISMATCH",
+			rejected ? "bad index rejected" : "BAD INDEX ACCEPTED",
+			hashMs);
+
+		remove(binFile.c_str());
+	}
+}
+
+
+void Benchmarks::MeshCompression(const std::vector<std::string>& objFiles)
+{
+	printf("\n=== Mesh compression (vertices include tangents) ===\n");
+	printf("%-28s %10s %10s %7s %12s %12s %12s %s\n", "File", "Raw (KB)", "Packed (KB)", "Ratio", "Encode MB/s", "Vert GB/s", "Index GB/s", "Round trip");
+
+	for (auto& path : objFiles)
+	{
+		ObjMeshData data;
+		if (!ObjParser::ParseFile(path.c_str(), data))
+		{
+			printf("%-28s failed to load\n", FileName(path).c_str());
+			continue;
+		}
+		Mesh::CalculateTangents(&data.Vertices[0], (int)data.Vertices.size(), &data.Indices[0], (int)data.Indices.size());
+
+		size_t vertexBytes = sizeof(Vertex) * data.Vertices.size();
+		size_t indexBytes = sizeof(unsigned int) * data.Indices.size();
+
+		std::vector<unsigned char> packedVertices;
+		std::vector<unsigned char> packedIndices;
+		double encodeMs = TimeMilliseconds([&]()
+		{
+			MeshCodec::EncodeVertices(&data.Vertices[0], data.Vertices.size(), sizeof(Vertex), packedVertices);
+			MeshCodec::EncodeIndices(&data.Indices[0], data.Indices.size(), packedIndices);
+		});
+
+		// These meshes are small, so decode repeatedly for a stable timing
+		const int repeats = 200;
+		std::vector<Vertex> vertices(data.Vertices.size());
+		std::vector<unsigned int> indices(data.Indices.size());
+		bool ok = true;
+		double vertexMs = TimeMilliseconds([&]()
+		{
+			for (int r = 0; r < repeats; r++)
+				ok &= MeshCodec::DecodeVertices(&vertices[0], vertices.size(), sizeof(Vertex), &packedVertices[0], packedVertices.size());
+		});
+		double indexMs = TimeMilliseconds([&]()
+		{
+			for (int r = 0; r < repeats; r++)
+				ok &= MeshCodec::DecodeIndices(&indices[0], indices.size(), &packedIndices[0], packedIndices.size());
+		});
+
+		// The decoded data must match exactly
+		ok = ok &&
+			memcmp(&vertices[0], &data.Vertices[0], vertexBytes) == 0 &&
+			indices == data.Indices;
+
+		size_t rawBytes = vertexBytes + indexBytes;
+		size_t packedBytes = packedVertices.size() + packedIndices.size();
+		printf("%-28s %10.1f %10.1f %6.2fx %12.1f %12.2f %12.2f %s\n",
+			FileName(path).c_str(),
+			rawBytes / 1024.0,
+			packedBytes / 1024.0,
+			(double)rawBytes / packedBytes,
+			rawBytes / (encodeMs * 1000.0),
+			vertexBytes * repeats / (vertexMs * 1e6),
+			indexBytes * repeats / (indexMs * 1e6),
+			ok ? "PASS" : "FAIL");
+
+		// Reading packed data and decoding it wins whenever the
+		// time saved reading is more than the time spent decoding
+		double decodeSeconds = (vertexMs + indexMs) / repeats / 1000.0;
+		printf("%-28s packed loads are faster on drives slower than %.0f MB/s\n", "", (rawBytes - packedBytes) / decodeSeconds / 1e6);
+	}
+}
+
+
+void Benchmarks::VertexCacheOptimization(const std::vector<std::string>& objFiles)
+{
+	printf("\n=== Vertex cache optimization (ACMR, with ATVR in brackets) ===\n");
+	printf("%-28s %10s %22s %22s %22s %10s\n", "File", "Triangles", "FIFO 16", "FIFO 32", "LRU 32", "Time (ms)");
+
+	for (auto& path : objFiles)
+	{
+		ObjMeshData data;
+		if (!ObjParser::ParseFile(path.c_str(), data))
+		{
+			printf("%-28s failed to load\n", FileName(path).c_str());
+			continue;
+		}
+
+		std::vector<unsigned int> optimized = data.Indices;
+		double optimizeMs = TimeMilliseconds([&]() { MeshOptimizer::OptimizeVertexCache(&optimized[0], optimized.size(), data.Vertices.size()); });
+
+		// Before -> after for each cache model
+		char columns[3][64];
+		for (int model = 0; model < 3; model++)
+		{
+			VertexCacheStats before, after;
+			if (model == 2)
+			{
+				before = MeshOptimizer::AnalyzeVertexCacheLRU(&data.Indices[0], data.Indices.size(), data.Vertices.size(), 32);
+				after = MeshOptimizer::AnalyzeVertexCacheLRU(&optimized[0], optimized.size(), data.Vertices.size(), 32);
+			}
+			else
+			{
+				unsigned int size = model == 0 ? 16 : 32;
+				before = MeshOptimizer::AnalyzeVertexCacheFIFO(&data.Indices[0], data.Indices.size(), data.Vertices.size(), size);
+				after = MeshOptimizer::AnalyzeVertexCacheFIFO(&optimized[0], optimized.size(), data.Vertices.size(), size);
+			}
+			snprintf(columns[model], sizeof(columns[model]), "%.2f(%.2f)->%.2f(%.2f)", before.ACMR, before.ATVR, after.ACMR, after.ATVR);
+		}
+
+		printf("%-28s %10zu %22s %22s %22s %10.2f\n",
+			FileName(path).c_str(),
+			data.Indices.size() / 3,
+			columns[0],
+			columns[1],
+			columns[2],
+			optimizeMs);
+	}
+}
+
+
+void Benchmarks::OverdrawOptimization(const std::vector<std::string>& objFiles)
+{
+	printf("\n=== Overdraw and vertex fetch optimization (cache optimized -> fully optimized) ===\n");
+	printf("%-28s %10s %16s %16s %16s %10s\n", "File", "Triangles", "Overdraw", "ACMR (FIFO 16)", "Overfetch", "Time (ms)");
+
+	for (auto& path : objFiles)
+	{
+		ObjMeshData data;
+		if (!ObjParser::ParseFile(path.c_str(), data))
+		{
+			printf("%-28s failed to load\n", FileName(path).c_str());
+			continue;
+		}
+		MeshOptimizer::OptimizeVertexCache(&data.Indices[0], data.Indices.size(), data.Vertices.size());
+
+		OverdrawStats overdrawBefore = MeshOptimizer::AnalyzeOverdraw(&data.Indices[0], data.Indices.size(), &data.Vertices[0], data.Vertices.size());
+		VertexCacheStats cacheBefore = MeshOptimizer::AnalyzeVertexCacheFIFO(&data.Indices[0], data.Indices.size(), data.Vertices.size(), 16);
+		VertexFetchStats fetchBefore = MeshOptimizer::AnalyzeVertexFetch(&data.Indices[0], data.Indices.size(), data.Vertices.size(), sizeof(Vertex));
+
+		double optimizeMs = TimeMilliseconds([&]()
+		{
+			MeshOptimizer::OptimizeOverdraw(&data.Indices[0], data.Indices.size(), &data.Vertices[0], data.Vertices.size());
+			data.Vertices.resize(MeshOptimizer::OptimizeVertexFetch(&data.Vertices[0], data.Vertices.size(), &data.Indices[0], data.Indices.size()));
+		});
+
+		OverdrawStats overdrawAfter = MeshOptimizer::AnalyzeOverdraw(&data.Indices[0], data.Indices.size(), &data.Vertices[0], data.Vertices.size());
+		VertexCacheStats cacheAfter = MeshOptimizer::AnalyzeVertexCacheFIFO(&data.Indices[0], data.Indices.size(), data.Vertices.size(), 16);
+		VertexFetchStats fetchAfter = MeshOptimizer::AnalyzeVertexFetch(&data.Indices[0], data.Indices.size(), data.Vertices.size(), sizeof(Vertex));
+
+		char overdraw[32], cache[32], fetch[32];
+		snprintf(overdraw, sizeof(overdraw), "%.3f->%.3f", overdrawBefore.Overdraw, overdrawAfter.Overdraw);
+		snprintf(cache, sizeof(cache), "%.3f->%.3f", cacheBefore.ACMR, cacheAfter.ACMR);
+		snprintf(fetch, sizeof(fetch), "%.3f->%.3f", fetchBefore.Overfetch, fetchAfter.Overfetch);
+		printf("%-28s %10zu %16s %16s %16s %10.2f\n",
+			FileName(path).c_str(),
+			data.Indices.size() / 3,
+			overdraw,
+			cache,
+			fetch,
+			optimizeMs);
+	}
+}
+
+
+void Benchmarks::MeshletCulling(const std::vector<std::string>& objFiles)
+{
+	const unsigned int views = 4096;
+
+	printf("\n=== Meshlet culling (%u views per file, culled %% of triangles) ===\n", views);
+	printf("%-28s %10s %10s %12s %10s %10s %10s %14s\n", "File", "Triangles", "Meshlets", "Verts/Tris", "Build (ms)", "Frustum", "Cone", "Meshlets/sec");
+
+	for (auto& path : objFiles)
+	{
+		ObjMeshData data;
+		if (!ObjParser::ParseFile(path.c_str(), data))
+		{
+			printf("%-28s failed to load\n", FileName(path).c_str());
+			continue;
+		}
+
+		// Same processing as Mesh, so the meshlets match
+		MeshOptimizer::OptimizeVertexCache(&data.Indices[0], data.Indices.size(), data.Vertices.size());
+		MeshOptimizer::OptimizeOverdraw(&data.Indices[0], data.Indices.size(), &data.Vertices[0], data.Vertices.size());
+		data.Vertices.resize(MeshOptimizer::OptimizeVertexFetch(&data.Vertices[0], data.Vertices.size(), &data.Indices[0], data.Indices.size()));
+
+		std::vector<Meshlet> meshlets;
+		double buildMs = TimeMilliseconds([&]() { Meshlets::Build(&data.Indices[0], data.Indices.size(), &data.Vertices[0], data.Vertices.size(), meshlets); });
+
+		unsigned long long totalVerts = 0;
+		for (auto& m : meshlets)
+			totalVerts += m.VertexCount;
+
+		// Camera setup for each view, made ahead of time so only culling is timed
+		XMVECTOR boundsMin = XMLoadFloat3(&data.Vertices[0].Position);
+		XMVECTOR boundsMax = boundsMin;
+		for (auto& v : data.Vertices)
+		{
+			boundsMin = XMVectorMin(boundsMin, XMLoadFloat3(&v.Position));
+			boundsMax = XMVectorMax(boundsMax, XMLoadFloat3(&v.Position));
+		}
+		XMVECTOR center = (boundsMin + boundsMax) * 0.5f;
+		float radius = XMVectorGetX(XMVector3Length(boundsMax - center));
+
+		XMFLOAT4X4 world, projection;
+		XMStoreFloat4x4(&world, XMMatrixIdentity());
+		XMStoreFloat4x4(&projection, XMMatrixPerspectiveFovLH(1.0f, 16.0f / 9.0f, 0.01f, 100.0f * radius));
+
+		std::vector<MeshletCullInfo> cullInfo(views);
+		for (unsigned int d = 0; d < views; d++)
+		{
+			// Directions spread evenly over a sphere (a Fibonacci lattice), at a
+			// range of distances (some inside the bounds), with every other view
+			// looking well off to one side
+			float y = 1.0f - (d + 0.5f) * 2.0f / views;
+			float ring = sqrtf(1.0f - y * y);
+			float angle = d * 2.39996323f;
+			XMVECTOR direction = XMVectorSet(cosf(angle) * ring, y, sinf(angle) * ring, 0.0f);
+			XMVECTOR eye = center + direction * (radius * (0.75f + (d % 4)));
+
+			XMVECTOR upHint = fabsf(y) > 0.99f ? XMVectorSet(1, 0, 0, 0) : XMVectorSet(0, 1, 0, 0);
+			XMVECTOR right = XMVector3Normalize(XMVector3Cross(upHint, direction));
+			XMVECTOR target = (d % 2) ? center + right * radius * 2.0f : center;
+
+			XMFLOAT4X4 view;
+			XMFLOAT3 eyePosition;
+			XMStoreFloat4x4(&view, XMMatrixLookToLH(eye, target - eye, upHint));
+			XMStoreFloat3(&eyePosition, eye);
+			cullInfo[d] = Meshlets::MakeCullInfo(world, view, projection, eyePosition);
+		}
+
+		// Tally up what each test rejected
+		unsigned long long frustumCulled = 0;
+		unsigned long long coneCulled = 0;
+		double cullMs = TimeMilliseconds([&]()
+		{
+			for (unsigned int d = 0; d < views; d++)
+			{
+				for (auto& m : meshlets)
+				{
+					switch (Meshlets::Test(m, cullInfo[d]))
+					{
+					case MeshletVisibility_OutsideFrustum: frustumCulled += m.TriangleCount; break;
+					case MeshletVisibility_BackFacing: coneCulled += m.TriangleCount; break;
+					default: break;
+					}
+				}
+			}
+		});
+
+		double totalTris = (double)(data.Indices.size() / 3) * views;
+		char sizes[32];
+		snprintf(sizes, sizeof(sizes), "%.1f/%.1f", (double)totalVerts / meshlets.size(), (double)(data.Indices.size() / 3) / meshlets.size());
+		printf("%-28s %10zu %10zu %12s %10.3f %9.1f%% %9.1f%% %14.0f\n",
+			FileName(path).c_str(),
+			data.Indices.size() / 3,
+			meshlets.size(),
+			sizes,
+			buildMs,
+			100.0 * frustumCulled / totalTris,
+			100.0 * coneCulled / totalTris,
+			(double)meshlets.size() * views / (cullMs / 1000.0));
+	}
+}
+
+void Benchmarks::VertexPackingAccuracy(const std::vector<std::string>& objFiles)
+{
+	printf("\n=== Vertex packing (%zu -> %zu bytes per vertex, max error with average in brackets) ===\n", sizeof(Vertex), sizeof(PackedVertex));
+	printf("%-28s %10s %20s %20s %20s %20s %10s\n", "File", "Vertices", "Position (% size)", "UV", "Normal (deg)", "Tangent (deg)", "Time (ms)");
+
+	for (auto& path : objFiles)
+	{
+		ObjMeshData data;
+		if (!ObjParser::ParseFile(path.c_str(), data))
+		{
+			printf("%-28s failed to load\n", FileName(path).c_str());
+			continue;
+		}
+		Mesh::CalculateTangents(&data.Vertices[0], (int)data.Vertices.size(), &data.Indices[0], (int)data.Indices.size());
+
+		std::vector<PackedVertex> packed(data.Vertices.size());
+		XMFLOAT3 scale, offset;
+		double packMs = TimeMilliseconds([&]() { VertexPacking::Pack(&data.Vertices[0], data.Vertices.size(), &packed[0], scale, offset); });
+		VertexPackingError error = VertexPacking::MeasureError(&data.Vertices[0], &packed[0], packed.size(), scale, offset);
+
+		// Position error is relative to the size of the mesh
+		float size = sqrtf(scale.x * scale.x + scale.y * scale.y + scale.z * scale.z);
+		float percent = size > 0.0f ? 100.0f / size : 0.0f;
+
+		char position[32], uv[32], normal[32], tangent[32];
+		snprintf(position, sizeof(position), "%.4f(%.4f)", error.MaxPosition * percent, error.AvgPosition * percent);
+		snprintf(uv, sizeof(uv), "%.5f(%.5f)", error.MaxUV, error.AvgUV);
+		snprintf(normal, sizeof(normal), "%.3f(%.3f)", error.MaxNormalDegrees, error.AvgNormalDegrees);
+		snprintf(tangent, sizeof(tangent), "%.3f(%.3f)", error.MaxTangentDegrees, error.AvgTangentDegrees);
+		printf("%-28s %10zu %20s %20s %20s %20s %10.2f\n",
+			FileName(path).c_str(),
+			data.Vertices.size(),
+			position,
+			uv,
+			normal,
+			tangent,
+			packMs);
+	}
+}
+
+void Benchmarks::LodGeneration(const std::vector<std::string>& objFiles)
+{
+	const float errors[] = { 0.005f, 0.01f, 0.025f, 0.05f, 0.1f };
+	const int errorCount = sizeof(errors) / sizeof(errors[0]);
+
+	printf("\n=== LOD generation (triangles left at each error limit, with the error reached as %% of size) ===\n");
+	printf("%-28s %10s", "File", "Triangles");
+	for (int e = 0; e < errorCount; e++)
+	{
+		char header[32];
+		snprintf(header, sizeof(header), "%.1f%%", errors[e] * 100.0f);
+		printf(" %16s", header);
+	}
+	printf(" %10s\n", "Time (ms)");
+
+	for (auto& path : objFiles)
+	{
+		ObjMeshData data;
+		if (!ObjParser::ParseFile(path.c_str(), data))
+		{
+			printf("%-28s failed to load\n", FileName(path).c_str());
+			continue;
+		}
+
+		printf("%-28s %10zu", FileName(path).c_str(), data.Indices.size() / 3);
+
+		std::vector<unsigned int> simplified(data.Indices.size());
+		double totalMs = 0.0;
+		for (int e = 0; e < errorCount; e++)
+		{
+			size_t count = 0;
+			float error = 0.0f;
+			totalMs += TimeMilliseconds([&]() {
+				count = MeshSimplifier::Simplify(&simplified[0], &data.Indices[0], data.Indices.size(), &data.Vertices[0], data.Vertices.size(), 0, errors[e], &error);
+			});
+
+			char result[32];
+			snprintf(result, sizeof(result), "%zu(%.2f%%)", count / 3, error * 100.0f);
+			printf(" %16s", result);
+		}
+		printf(" %10.2f\n", totalMs);
+	}
+}
+
+void Benchmarks::TangentGeneration(const std::vector<std::string>& objFiles, const std::string& syntheticObjFile)
+{
+	printf("\n=== Tangent generation: original vs. SIMD (serial and %u threads) ===\n", JobSystem::GetInstance().GetThreadCount());
+	printf("%-28s %10s %12s %12s %12s %9s %s\n", "File", "Triangles", "Legacy (ms)", "Serial (ms)", "Parallel (ms)", "Speedup", "Output");
+
+	// Real assets plus one big generated file
+	std::vector<std::string> files = objFiles;
+	bool haveSynthetic = WriteSyntheticObj(syntheticObjFile, 1000);
+	if (haveSynthetic)
+		files.push_back(syntheticObjFile);
+
+	for (auto& path : files)
+	{
+		ObjMeshData data;
+		if (!ObjParser::ParseFile(path.c_str(), data))
+		{
+			printf("%-28s failed to load\n", FileName(path).c_str());
+			continue;
+		}
+
+		std::vector<Vertex> legacy = data.Vertices;
+		std::vector<Vertex> serial = data.Vertices;
+		std::vector<Vertex> parallel = data.Vertices;
+		int vertCount = (int)data.Vertices.size();
+		int indexCount = (int)data.Indices.size();
+
+		double legacyMs = TimeMilliseconds([&]() { LegacyCalculateTangents(&legacy[0], vertCount, &data.Indices[0], indexCount); });
+		double serialMs = TimeMilliseconds([&]() { Mesh::CalculateTangents(&serial[0], vertCount, &data.Indices[0], indexCount, false); });
+		double parallelMs = TimeMilliseconds([&]() { Mesh::CalculateTangents(&parallel[0], vertCount, &data.Indices[0], indexCount, true); });
+
+		// Same additions in the same order, so all three must match exactly
+		bool matchesLegacy = memcmp(&legacy[0], &serial[0], sizeof(Vertex) * vertCount) == 0;
+		bool matchesSerial = memcmp(&serial[0], &parallel[0], sizeof(Vertex) * vertCount) == 0;
+
+		printf("%-28s %10d %12.2f %12.2f %12.2f %8.1fx %s\n",
+			FileName(path).c_str(),
+			indexCount / 3,
+			legacyMs,
+			serialMs,
+			parallelMs,
+			legacyMs / parallelMs,
+			!matchesLegacy ? "MISMATCH vs legacy" : matchesSerial ? "identical" : "MISMATCH serial vs parallel");
+	}
+
+	if (haveSynthetic)
+		remove(syntheticObjFile.c_str());
+}
+
+void Benchmarks::Raycasting(const std::vector<std::string>& objFiles, const std::string& syntheticObjFile)
+{
+	printf("\n=== BVH ray casting (%u threads for building) ===\n", JobSystem::GetInstance().GetThreadCount());
+	printf("%-28s %10s %10s %8s %6s %12s %12s %12s %s\n", "File", "Triangles", "Build (ms)", "Nodes", "Depth", "Hit rate", "Mrays/s", "Mrays/s (x4)", "Output");
+
+	// Real assets plus one big generated file
+	std::vector<std::string> files = objFiles;
+	bool haveSynthetic = WriteSyntheticObj(syntheticObjFile, 1000);
+	if (haveSynthetic)
+		files.push_back(syntheticObjFile);
+
+	for (auto& path : files)
+	{
+		ObjMeshData data;
+		if (!ObjParser::ParseFile(path.c_str(), data))
+		{
+			printf("%-28s failed to load\n", FileName(path).c_str());
+			continue;
+		}
+
+		MeshBvh bvh;
+		double buildMs = TimeMilliseconds([&]() { bvh.Build(&data.Vertices[0], data.Vertices.size(), &data.Indices[0], data.Indices.size()); });
+
+		// A grid of rays, like a camera's pixels, from each of several
+		// views around the mesh (so neighboring rays are coherent)
+		const int gridSize = 256;
+		const int views = 8;
+		AxisAlignedBox box = Bounds::BoxFromVertices(&data.Vertices[0], data.Vertices.size());
+		float radius = sqrtf(box.Extents.x * box.Extents.x + box.Extents.y * box.Extents.y + box.Extents.z * box.Extents.z);
+		std::vector<XMFLOAT3> origins, directions;
+		for (int v = 0; v < views; v++)
+		{
+			float angle = XM_2PI * v / views;
+			XMVECTOR center = XMLoadFloat3(&box.Center);
+			XMVECTOR eye = center + XMVectorSet(cosf(angle), 0.5f, sinf(angle), 0) * radius * 2.0f;
+			XMVECTOR forward = XMVector3Normalize(center - eye);
+			XMVECTOR right = XMVector3Normalize(XMVector3Cross(XMVectorSet(0, 1, 0, 0), forward));
+			XMVECTOR up = XMVector3Cross(forward, right);
+			for (int y = 0; y < gridSize; y++)
+				for (int x = 0; x < gridSize; x++)
+				{
+					float px = (x + 0.5f) / gridSize * 2.0f - 1.0f;
+					float py = (y + 0.5f) / gridSize * 2.0f - 1.0f;
+					XMFLOAT3 o, d;
+					XMStoreFloat3(&o, eye);
+					XMStoreFloat3(&d, XMVector3Normalize(forward + right * (px * 0.5f) + up * (py * 0.5f)));
+					origins.push_back(o);
+					directions.push_back(d);
+				}
+		}
+		size_t rayCount = origins.size();
+
+		std::vector<RayHit> single(rayCount), packet(rayCount);
+		std::vector<char> singleHit(rayCount), packetHit(rayCount);
+		double singleMs = TimeMilliseconds([&]()
+		{
+			for (size_t r = 0; r < rayCount; r++)
+				singleHit[r] = bvh.Raycast(origins[r], directions[r], FLT_MAX, single[r]);
+		});
+		double packetMs = TimeMilliseconds([&]()
+		{
+			for (size_t r = 0; r < rayCount; r += 4)
+			{
+				int mask = bvh.Raycast4(&origins[r], &directions[r], FLT_MAX, &packet[r]);
+				for (int i = 0; i < 4; i++)
+					packetHit[r + i] = (mask >> i) & 1;
+			}
+		});
+
+		// Both should find the same hits, and a brute force check of
+		// every triangle (on a sample of the rays) should agree
+		size_t hitCount = 0;
+		bool match = true;
+		for (size_t r = 0; r < rayCount; r++)
+		{
+			hitCount += singleHit[r];
+			if (singleHit[r] != packetHit[r] || (singleHit[r] && fabsf(single[r].Distance - packet[r].Distance) > 1e-4f * (1.0f + single[r].Distance)))
+				match = false;
+		}
+
+		size_t triCount = data.Indices.size() / 3;
+		size_t bruteStep = (std::max)((size_t)1, rayCount * triCount / 20000000);
+		for (size_t r = 0; r < rayCount && match; r += bruteStep)
+		{
+			float closest = BruteForceRaycast(data, origins[r], directions[r]);
+			bool bruteHit = closest < FLT_MAX;
+			if (bruteHit != (singleHit[r] != 0) || (bruteHit && fabsf(closest - single[r].Distance) > 1e-4f * (1.0f + closest)))
+				match = false;
+		}
+
+		printf("%-28s %10zu %10.2f %8zu %6u %11.1f%% %12.2f %12.2f %s\n",
+			FileName(path).c_str(),
+			triCount,
+			buildMs,
+			bvh.GetNodeCount(),
+			bvh.GetDepth(),
+			100.0 * hitCount / rayCount,
+			rayCount / (singleMs * 1000.0),
+			rayCount / (packetMs * 1000.0),
+			match ? "matches brute force" : "MISMATCH");
+	}
+
+	if (haveSynthetic)
+		remove(syntheticObjFile.c_str());
+}
+
+void Benchmarks::PrimitiveGeneration(const std::vector<std::string>& objFiles)
+{
+	printf("\n=== Procedural shapes vs. OBJ files ===\n");
+	printf("%-14s %10s %10s %10s %10s %20s %s\n", "Shape", "Triangles", "OBJ tris", "Gen (ms)", "OBJ (ms)", "Tangent err (deg)", "Output");
+
+	typedef void(*Generator)(std::vector<Vertex>&, std::vector<unsigned int>&);
+	struct Shape { const char* Name; Generator Generate; };
+	const Shape shapes[] =
+	{
+		{ "sphere", [](std::vector<Vertex>& v, std::vector<unsigned int>& i) { MeshGenerator::Sphere(v, i); } },
+		{ "cube", [](std::vector<Vertex>& v, std::vector<unsigned int>& i) { MeshGenerator::Cube(v, i); } },
+		{ "cylinder", [](std::vector<Vertex>& v, std::vector<unsigned int>& i) { MeshGenerator::Cylinder(v, i); } },
+		{ "cone", [](std::vector<Vertex>& v, std::vector<unsigned int>& i) { MeshGenerator::Cone(v, i); } },
+		{ "torus", [](std::vector<Vertex>& v, std::vector<unsigned int>& i) { MeshGenerator::Torus(v, i); } },
+		{ "sphere (1M)", [](std::vector<Vertex>& v, std::vector<unsigned int>& i) { MeshGenerator::Sphere(v, i, 1.0f, 1024, 512); } },
+	};
+
+	for (const Shape& shape : shapes)
+	{
+		std::vector<Vertex> vertices;
+		std::vector<unsigned int> indices;
+		double genMs = TimeMilliseconds([&]() { shape.Generate(vertices, indices); });
+
+		// Same shape from disk, if there is one
+		double objMs = 0.0;
+		size_t objTriangles = 0;
+		for (auto& path : objFiles)
+		{
+			if (FileName(path) != std::string(shape.Name) + ".obj")
+				continue;
+
+			ObjMeshData data;
+			objMs = TimeMilliseconds([&]()
+			{
+				// Everything the Mesh constructor does to an OBJ file
+				if (!ObjParser::ParseFile(path.c_str(), data))
+					return;
+				MeshOptimizer::OptimizeVertexCache(&data.Indices[0], data.Indices.size(), data.Vertices.size());
+				MeshOptimizer::OptimizeOverdraw(&data.Indices[0], data.Indices.size(), &data.Vertices[0], data.Vertices.size());
+				data.Vertices.resize(MeshOptimizer::OptimizeVertexFetch(&data.Vertices[0], data.Vertices.size(), &data.Indices[0], data.Indices.size()));
+				Mesh::CalculateTangents(&data.Vertices[0], (int)data.Vertices.size(), &data.Indices[0], (int)data.Indices.size());
+			});
+			objTriangles = data.Indices.size() / 3;
+		}
+
+		// Every triangle should wind clockwise from the side its
+		// vertices' normals are on
+		bool outward = true;
+		for (size_t i = 0; i + 2 < indices.size(); i += 3)
+		{
+			XMVECTOR p0 = XMLoadFloat3(&vertices[indices[i]].Position);
+			XMVECTOR p1 = XMLoadFloat3(&vertices[indices[i + 1]].Position);
+			XMVECTOR p2 = XMLoadFloat3(&vertices[indices[i + 2]].Position);
+			XMVECTOR faceNormal = XMVector3Cross(p1 - p0, p2 - p0);
+			for (int c = 0; c < 3; c++)
+				if (XMVectorGetX(XMVector3Dot(faceNormal, XMLoadFloat3(&vertices[indices[i + c]].Normal))) <= 0.0f)
+					outward = false;
+		}
+
+		// Average angle between the generated tangents and the ones
+		// CalculateTangents() finds from the UVs
+		std::vector<Vertex> calculated = vertices;
+		Mesh::CalculateTangents(&calculated[0], (int)calculated.size(), &indices[0], (int)indices.size());
+		double totalAngle = 0.0;
+		for (size_t v = 0; v < vertices.size(); v++)
+		{
+			float cosAngle = XMVectorGetX(XMVector3Dot(XMLoadFloat3(&vertices[v].Tangent), XMLoadFloat3(&calculated[v].Tangent)));
+			totalAngle += acosf((std::max)(-1.0f, (std::min)(1.0f, cosAngle)));
+		}
+		double averageDegrees = XMConvertToDegrees((float)(totalAngle / vertices.size()));
+
+		// Shapes without an OBJ file just get dashes
+		char objTrianglesText[32] = "-";
+		char objMsText[32] = "-";
+		if (objTriangles > 0)
+		{
+			snprintf(objTrianglesText, sizeof(objTrianglesText), "%zu", objTriangles);
+			snprintf(objMsText, sizeof(objMsText), "%.3f", objMs);
+		}
+
+		printf("%-14s %10zu %10s %10.3f %10s %20.2f %s\n",
+			shape.Name,
+			indices.size() / 3,
+			objTrianglesText,
+			genMs,
+			objMsText,
+			averageDegrees,
+			outward ? "faces outward" : "INWARD FACES");
+	}
+}
+
+
+void Benchmarks::GlbLoading(const std::vector<std::string>& objFiles, const std::string& syntheticObjFile)
+{
+	printf("\n=== OBJ vs. GLB import ===\n");
+	printf("%-28s %10s %10s %12s %12s %12s %12s %s\n", "File", "Vertices", "GLB (KB)", "OBJ (ms)", "GLB (ms)", "In place (ms)", "Read (ms)", "Output");
+
+	std::vector<std::string> files = objFiles;
+	bool haveSynthetic = WriteSyntheticObj(syntheticObjFile, 1000);
+	if (haveSynthetic)
+		files.push_back(syntheticObjFile);
+
+	for (auto& path : files)
+	{
+		// Full OBJ import, as the Mesh constructor does it
+		ObjMeshData data;
+		bool parsed = false;
+		double objMs = TimeMilliseconds([&]()
+		{
+			parsed = ObjParser::ParseFile(path.c_str(), data);
+			if (!parsed)
+				return;
+			MeshOptimizer::OptimizeVertexCache(&data.Indices[0], data.Indices.size(), data.Vertices.size());
+			MeshOptimizer::OptimizeOverdraw(&data.Indices[0], data.Indices.size(), &data.Vertices[0], data.Vertices.size());
+			data.Vertices.resize(MeshOptimizer::OptimizeVertexFetch(&data.Vertices[0], data.Vertices.size(), &data.Indices[0], data.Indices.size()));
+			Mesh::CalculateTangents(&data.Vertices[0], (int)data.Vertices.size(), &data.Indices[0], (int)data.Indices.size());
+		});
+		if (!parsed)
+		{
+			printf("%-28s failed to load\n", FileName(path).c_str());
+			continue;
+		}
+
+		// The same mesh as both kinds of .glb
+		std::string standardFile = path + ".standard.glb";
+		std::string inPlaceFile = path + ".inplace.glb";
+		if (!GlbFile::Write(standardFile.c_str(), &data.Vertices[0], (int)data.Vertices.size(), &data.Indices[0], (int)data.Indices.size(), false) ||
+			!GlbFile::Write(inPlaceFile.c_str(), &data.Vertices[0], (int)data.Vertices.size(), &data.Indices[0], (int)data.Indices.size(), true))
+		{
+			printf("%-28s failed to write .glb files\n", FileName(path).c_str());
+			remove(standardFile.c_str());
+			remove(inPlaceFile.c_str());
+			continue;
+		}
+
+		// Both should give back exactly what was written, and the
+		// in place one shouldn't copy anything
+		bool match = true;
+		double standardMs = 0.0;
+		double inPlaceMs = 0.0;
+		double readMs = 0.0;
+		size_t glbBytes = 0;
+		for (int inPlace = 0; inPlace < 2; inPlace++)
+		{
+			std::unique_ptr<GlbFile> glb;
+			bool loaded = false;
+			double ms = TimeMilliseconds([&]()
+			{
+				glb = std::make_unique<GlbFile>((inPlace ? inPlaceFile : standardFile).c_str());
+				loaded = glb->Load();
+			});
+			(inPlace ? inPlaceMs : standardMs) = ms;
+
+			match = match && loaded &&
+				glb->GetVertexCount() == (int)data.Vertices.size() &&
+				glb->GetIndexCount() == (int)data.Indices.size() &&
+				memcmp(glb->GetVertices(), &data.Vertices[0], sizeof(Vertex) * data.Vertices.size()) == 0 &&
+				memcmp(glb->GetIndices(), &data.Indices[0], sizeof(unsigned int) * data.Indices.size()) == 0 &&
+				glb->VerticesInPlace() == (inPlace != 0) &&
+				glb->IndicesInPlace() == (inPlace != 0);
+		}
+
+		// The least any import could do: touch every byte of the file
+		readMs = TimeMilliseconds([&]()
+		{
+			MappedFile file(inPlaceFile.c_str());
+			glbBytes = file.GetSize();
+			volatile unsigned long long hash = MeshBinary::HashBytes(file.GetData(), file.GetSize());
+			(void)hash;
+		});
+
+		printf("%-28s %10zu %10zu %12.2f %12.2f %12.2f %12.2f %s\n",
+			FileName(path).c_str(),
+			data.Vertices.size(),
+			glbBytes / 1024,
+			objMs,
+			standardMs,
+			inPlaceMs,
+			readMs,
+			match ? "matches OBJ" : "MISMATCH");
+
+		remove(standardFile.c_str());
+		remove(inPlaceFile.c_str());
+	}
+
+	if (haveSynthetic)
+		remove(syntheticObjFile.c_str());
+}
+
+
+void Benchmarks::StaticBatching()
+{
+	const int propCount = 2000;
+	const int materialCount = 8;
+	const float fieldSize = 200.0f;
+	const unsigned int views = 64;
+
+	printf("\n=== Static batching (%d props, %d materials, %u views) ===\n", propCount, materialCount, views);
+	printf("%-12s %10s %12s %12s %14s %18s %s\n", "Cell size", "Draws", "Verts/draw", "Merge (ms)", "Visible draws", "Tris drawn", "Output");
+
+	// A few basic shapes to scatter around
+	std::vector<Vertex> shapeVertices[3];
+	std::vector<unsigned int> shapeIndices[3];
+	MeshGenerator::Cube(shapeVertices[0], shapeIndices[0]);
+	MeshGenerator::Sphere(shapeVertices[1], shapeIndices[1], 0.5f, 16, 8);
+	MeshGenerator::Cone(shapeVertices[2], shapeIndices[2]);
+	AxisAlignedBox shapeBounds[3];
+	for (int i = 0; i < 3; i++)
+		shapeBounds[i] = Bounds::BoxFromVertices(&shapeVertices[i][0], shapeVertices[i].size());
+
+	// Random placement, rotation and size, with every tenth
+	// prop mirrored
+	srand(1234);
+	auto unit = []() { return rand() / (float)RAND_MAX; };
+	std::vector<StaticBatchSource> sources(propCount);
+	for (int i = 0; i < propCount; i++)
+	{
+		int shape = i % 3;
+		float scale = 0.5f + unit() * 1.5f;
+		XMMATRIX world =
+			XMMatrixScaling(i % 10 == 0 ? -scale : scale, scale, scale) *
+			XMMatrixRotationRollPitchYaw(0.0f, unit() * XM_2PI, 0.0f) *
+			XMMatrixTranslation(unit() * fieldSize, scale * 0.5f, unit() * fieldSize);
+
+		StaticBatchSource& s = sources[i];
+		s.Vertices = &shapeVertices[shape][0];
+		s.VertexCount = (int)shapeVertices[shape].size();
+		s.Indices = &shapeIndices[shape][0];
+		s.IndexCount = (int)shapeIndices[shape].size();
+		XMStoreFloat4x4(&s.World, world);
+		s.WorldBounds = Bounds::Transform(shapeBounds[shape], s.World);
+		s.Group = rand() % materialCount;
+	}
+
+	// Views from eye height inside the field, looking every which way
+	XMFLOAT4X4 identity, projection;
+	XMStoreFloat4x4(&identity, XMMatrixIdentity());
+	XMStoreFloat4x4(&projection, XMMatrixPerspectiveFovLH(XM_PIDIV4, 16.0f / 9.0f, 0.1f, 100.0f));
+	std::vector<MeshletCullInfo> cullInfo(views);
+	for (unsigned int d = 0; d < views; d++)
+	{
+		XMVECTOR eye = XMVectorSet(unit() * fieldSize, 2.0f, unit() * fieldSize, 0.0f);
+		float angle = unit() * XM_2PI;
+		XMFLOAT4X4 view;
+		XMFLOAT3 eyePosition;
+		XMStoreFloat4x4(&view, XMMatrixLookToLH(eye, XMVectorSet(cosf(angle), -0.1f, sinf(angle), 0.0f), XMVectorSet(0, 1, 0, 0)));
+		XMStoreFloat3(&eyePosition, eye);
+		cullInfo[d] = Meshlets::MakeCullInfo(identity, view, projection, eyePosition);
+	}
+
+	// Unbatched, each prop is its own draw, culled on its own bounds
+	unsigned long long totalVertices = 0;
+	unsigned long long visibleDraws = 0;
+	unsigned long long visibleTris = 0;
+	for (auto& s : sources)
+	{
+		totalVertices += s.VertexCount;
+		for (unsigned int d = 0; d < views; d++)
+		{
+			if (Bounds::InFrustum(s.WorldBounds, cullInfo[d].FrustumPlanes))
+			{
+				visibleDraws++;
+				visibleTris += s.IndexCount / 3;
+			}
+		}
+	}
+	printf("%-12s %10d %12.1f %12s %14.1f %18.1f %s\n",
+		"unbatched",
+		propCount,
+		(double)totalVertices / propCount,
+		"-",
+		(double)visibleDraws / views,
+		(double)visibleTris / views,
+		"-");
+	double unbatchedTris = (double)visibleTris;
+
+	const float cellSizes[] = { 10.0f, 25.0f, 50.0f, 100.0f, 1000.0f };
+	for (float cellSize : cellSizes)
+	{
+		std::vector<StaticBatchData> batches;
+		double mergeMs = TimeMilliseconds([&]() { StaticBatch::Merge(sources, cellSize, batches); });
+
+		// Every prop should be in exactly one batch, with each of its
+		// triangles transformed on its own and wound clockwise from
+		// the side its normals are on
+		bool match = true;
+		bool outward = true;
+		int merged = 0;
+		for (auto& b : batches)
+		{
+			size_t firstIndex = 0;
+			for (int i : b.Sources)
+			{
+				const StaticBatchSource& s = sources[i];
+				XMMATRIX world = XMLoadFloat4x4(&s.World);
+				bool mirrored = XMVectorGetX(XMMatrixDeterminant(world)) < 0.0f;
+				merged++;
+				match = match && s.Group == b.Group;
+
+				for (int t = 0; t < s.IndexCount; t += 3)
+				{
+					const unsigned int* tri = &b.Indices[firstIndex + t];
+					int corners[3] = { 0, mirrored ? 2 : 1, mirrored ? 1 : 2 };
+					for (int c = 0; c < 3; c++)
+					{
+						XMVECTOR expected = XMVector3TransformCoord(XMLoadFloat3(&s.Vertices[s.Indices[t + corners[c]]].Position), world);
+						XMVECTOR actual = XMLoadFloat3(&b.Vertices[tri[c]].Position);
+						if (XMVectorGetX(XMVector3Length(expected - actual)) > 1e-4f)
+							match = false;
+					}
+
+					XMVECTOR p0 = XMLoadFloat3(&b.Vertices[tri[0]].Position);
+					XMVECTOR p1 = XMLoadFloat3(&b.Vertices[tri[1]].Position);
+					XMVECTOR p2 = XMLoadFloat3(&b.Vertices[tri[2]].Position);
+					XMVECTOR faceNormal = XMVector3Cross(p1 - p0, p2 - p0);
+					for (int c = 0; c < 3; c++)
+						if (XMVectorGetX(XMVector3Dot(faceNormal, XMLoadFloat3(&b.Vertices[tri[c]].Normal))) <= 0.0f)
+							outward = false;
+				}
+				firstIndex += s.IndexCount;
+			}
+			match = match && firstIndex == b.Indices.size();
+		}
+		match = match && merged == propCount;
+
+		// Batches are culled as a whole
+		visibleDraws = 0;
+		visibleTris = 0;
+		for (auto& b : batches)
+		{
+			AxisAlignedBox bounds = Bounds::BoxFromVertices(&b.Vertices[0], b.Vertices.size());
+			for (unsigned int d = 0; d < views; d++)
+			{
+				if (Bounds::InFrustum(bounds, cullInfo[d].FrustumPlanes))
+				{
+					visibleDraws++;
+					visibleTris += b.Indices.size() / 3;
+				}
+			}
+		}
+
+		char cellText[32];
+		char trisText[32];
+		snprintf(cellText, sizeof(cellText), "%.0f", cellSize);
+		snprintf(trisText, sizeof(trisText), "%.1f (x%.2f)", (double)visibleTris / views, visibleTris / unbatchedTris);
+		printf("%-12s %10zu %12.1f %12.3f %14.1f %18s %s\n",
+			cellText,
+			batches.size(),
+			(double)totalVertices / batches.size(),
+			mergeMs,
+			(double)visibleDraws / views,
+			trisText,
+			!match ? "MISMATCH" : outward ? "match" : "INWARD FACES");
+	}
+}
+
+
+void Benchmarks::PositionStreams(const std::vector<std::string>& objFiles)
+{
+	printf("\n=== Position only streams for depth passes (KB fetched, and vertices shaded per triangle) ===\n");
+	printf("%-28s %10s %10s %10s %10s %10s %10s %10s %10s %s\n", "File", "Vertices", "Positions", "Full", "Packed", "Positions", "Saving", "ACMR", "Pos. ACMR", "Output");
+
+	for (auto& path : objFiles)
+	{
+		ObjMeshData data;
+		if (!ObjParser::ParseFile(path.c_str(), data))
+		{
+			printf("%-28s failed to load\n", FileName(path).c_str());
+			continue;
+		}
+
+		// Same processing as Mesh
+		MeshOptimizer::OptimizeVertexCache(&data.Indices[0], data.Indices.size(), data.Vertices.size());
+		MeshOptimizer::OptimizeOverdraw(&data.Indices[0], data.Indices.size(), &data.Vertices[0], data.Vertices.size());
+		data.Vertices.resize(MeshOptimizer::OptimizeVertexFetch(&data.Vertices[0], data.Vertices.size(), &data.Indices[0], data.Indices.size()));
+
+		std::vector<XMFLOAT3> positions(data.Vertices.size());
+		for (size_t i = 0; i < data.Vertices.size(); i++)
+			positions[i] = data.Vertices[i].Position;
+
+		std::vector<XMFLOAT3> uniquePositions(positions.size());
+		std::vector<unsigned int> positionIndices(data.Indices.size());
+		size_t positionCount = MeshOptimizer::WeldPositions(&positions[0], positions.size(), &data.Indices[0], data.Indices.size(), &uniquePositions[0], &positionIndices[0]);
+
+		// Every corner should land on exactly the same position
+		bool match = positionCount <= data.Vertices.size();
+		for (size_t i = 0; i < data.Indices.size() && match; i++)
+			match = memcmp(&positions[data.Indices[i]], &uniquePositions[positionIndices[i]], sizeof(XMFLOAT3)) == 0;
+
+		VertexFetchStats full = MeshOptimizer::AnalyzeVertexFetch(&data.Indices[0], data.Indices.size(), data.Vertices.size(), sizeof(Vertex));
+		VertexFetchStats packed = MeshOptimizer::AnalyzeVertexFetch(&data.Indices[0], data.Indices.size(), data.Vertices.size(), sizeof(PackedVertex));
+		VertexFetchStats welded = MeshOptimizer::AnalyzeVertexFetch(&positionIndices[0], positionIndices.size(), positionCount, sizeof(XMFLOAT3));
+		VertexCacheStats fullCache = MeshOptimizer::AnalyzeVertexCacheFIFO(&data.Indices[0], data.Indices.size(), data.Vertices.size(), 16);
+		VertexCacheStats weldedCache = MeshOptimizer::AnalyzeVertexCacheFIFO(&positionIndices[0], positionIndices.size(), positionCount, 16);
+
+		char saving[32];
+		snprintf(saving, sizeof(saving), "%.2fx", (double)full.BytesFetched / welded.BytesFetched);
+		printf("%-28s %10zu %10zu %10.1f %10.1f %10.1f %10s %10.3f %10.3f %s\n",
+			FileName(path).c_str(),
+			data.Vertices.size(),
+			positionCount,
+			full.BytesFetched / 1024.0,
+			packed.BytesFetched / 1024.0,
+			welded.BytesFetched / 1024.0,
+			saving,
+			fullCache.ACMR,
+			weldedCache.ACMR,
+			match ? "match" : "MISMATCH");
+	}
+}
+
+
+void Benchmarks::TransformUpdates()
+{
+	const int transformCount = 50000;
+	const int dirtyPercents[] = { 100, 10, 1 };
+
+	printf("\n=== Transform updates (%d transforms, %d threads) ===\n", transformCount, JobSystem::GetInstance().GetThreadCount());
+	printf("%-10s %10s %16s %19s %10s %14s %s\n", "Dirty", "Updated", "One by one (ms)", "Parallel sweep (ms)", "Speedup", "Max error", "Output");
+
+	// Random placement, rotation and (not always uniform) size
+	srand(1234);
+	auto unit = []() { return rand() / (float)RAND_MAX; };
+	std::vector<Transform> transforms(transformCount);
+	std::vector<XMFLOAT3> positions(transformCount), rotations(transformCount), scales(transformCount);
+	for (int i = 0; i < transformCount; i++)
+	{
+		positions[i] = XMFLOAT3(unit() * 200.0f - 100.0f, unit() * 20.0f, unit() * 200.0f - 100.0f);
+		rotations[i] = XMFLOAT3(unit() * XM_2PI, unit() * XM_2PI, unit() * XM_2PI);
+		scales[i] = XMFLOAT3(0.5f + unit() * 2.0f, 0.5f + unit() * 2.0f, 0.5f + unit() * 2.0f);
+	}
+
+	TransformStore& store = TransformStore::GetInstance();
+	std::vector<XMFLOAT4X4> world(transformCount), invTrans(transformCount);
+	for (int percent : dirtyPercents)
+	{
+		// Every n-th transform has moved
+		int step = 100 / percent;
+		int updated = 0;
+		for (int i = 0; i < transformCount; i += step)
+		{
+			transforms[i].SetPosition(positions[i].x, positions[i].y, positions[i].z);
+			transforms[i].SetRotation(rotations[i].x, rotations[i].y, rotations[i].z);
+			transforms[i].SetScale(scales[i].x, scales[i].y, scales[i].z);
+			updated++;
+		}
+
+		// The original per object update, with a general inverse
+		double oneByOneMs = TimeMilliseconds([&]()
+		{
+			for (int i = 0; i < transformCount; i += step)
+			{
+				XMMATRIX wm =
+					XMMatrixScalingFromVector(XMLoadFloat3(&scales[i])) *
+					XMMatrixRotationRollPitchYawFromVector(XMLoadFloat3(&rotations[i])) *
+					XMMatrixTranslationFromVector(XMLoadFloat3(&positions[i]));
+				XMStoreFloat4x4(&world[i], wm);
+				XMStoreFloat4x4(&invTrans[i], XMMatrixInverse(0, XMMatrixTranspose(wm)));
+			}
+		});
+
+		unsigned int swept = 0;
+		double sweepMs = TimeMilliseconds([&]() { swept = store.UpdateMatrices(); });
+
+		// Relative to the matrices' own size, so large scales don't dominate
+		float maxError = 0.0f;
+		for (int i = 0; i < transformCount; i += step)
+		{
+			XMFLOAT4X4 w = transforms[i].GetWorldMatrix();
+			XMFLOAT4X4 it = transforms[i].GetWorldInverseTransposeMatrix();
+			for (int e = 0; e < 16; e++)
+			{
+				const float* a[2] = { &w.m[0][0], &it.m[0][0] };
+				const float* b[2] = { &world[i].m[0][0], &invTrans[i].m[0][0] };
+				for (int m = 0; m < 2; m++)
+					maxError = (std::max)(maxError, fabsf(a[m][e] - b[m][e]) / (std::max)(1.0f, fabsf(b[m][e])));
+			}
+		}
+
+		char dirtyText[16];
+		snprintf(dirtyText, sizeof(dirtyText), "%d%%", percent);
+		printf("%-10s %10d %16.3f %19.3f %9.2fx %14g %s\n",
+			dirtyText,
+			updated,
+			oneByOneMs,
+			sweepMs,
+			oneByOneMs / sweepMs,
+			maxError,
+			swept < (unsigned int)updated ? "MISSED" : maxError < 1e-4f ? "match" : "MISMATCH");
+	}
+}
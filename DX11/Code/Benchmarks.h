@@ -0,0 +1,89 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// --------------------------------------------------------
+// CPU-side performance checks for the asset pipeline
+//
+// Each one prints its results to the console, so these
+// are best run from a Release build (see Game::Update
+// for the key that triggers them).
+// --------------------------------------------------------
+class Benchmarks
+{
+public:
+	// Compares the OBJ parser (serial and parallel) against the original
+	// getline/sscanf_s loader on each given file, plus a large synthetic
+	// file that is written to (and later deleted from) the given path
+	static void ObjParsing(const std::vector<std::string>& objFiles, const std::string& syntheticObjFile);
+
+	// Reports how many vertices (and bytes) welding saves per file
+	static void VertexWelding(const std::vector<std::string>& objFiles);
+
+	// Compares parsing each file against loading it from a binary cache
+	// (the cache files are written next to each source and then deleted)
+	static void MeshCacheLoading(const std::vector<std::string>& objFiles);
+
+	// Round trips each file's vertices and indices through MeshCodec,
+	// reporting compression ratios and decode throughput
+	static void MeshCompression(const std::vector<std::string>& objFiles);
+
+	// Simulated vertex cache efficiency before and after optimizing each file
+	static void VertexCacheOptimization(const std::vector<std::string>& objFiles);
+
+	// Software rasterized overdraw, vertex cache and vertex fetch efficiency
+	// of each file with just the vertex cache optimized, then fully optimized
+	static void OverdrawOptimization(const std::vector<std::string>& objFiles);
+
+	// Meshlet sizes for each file, and how quickly (and how much) they
+	// can be culled from many views around and partly inside the mesh
+	static void MeshletCulling(const std::vector<std::string>& objFiles);
+
+	// Size savings and decoding error of PackedVertex for each file
+	static void VertexPackingAccuracy(const std::vector<std::string>& objFiles);
+
+	// Triangles left (and error reached) when simplifying each file
+	// as far as a series of increasing error limits allow
+	static void LodGeneration(const std::vector<std::string>& objFiles);
+
+	// Compares the original tangent calculation against Mesh's SIMD
+	// version (serial and parallel), checking all three agree exactly,
+	// on each file plus a large synthetic one (as in ObjParsing)
+	static void TangentGeneration(const std::vector<std::string>& objFiles, const std::string& syntheticObjFile);
+
+	// BVH build time for each file (plus a large synthetic one), and
+	// rays per second cast at it from a surrounding camera, one at a
+	// time and four at a time, checked against brute force
+	static void Raycasting(const std::vector<std::string>& objFiles, const std::string& syntheticObjFile);
+
+	// Generating each basic shape vs. loading its OBJ file (and
+	// calculating tangents), plus a check that the generated
+	// faces point outward and the tangents agree with the
+	// calculated ones
+	static void PrimitiveGeneration(const std::vector<std::string>& objFiles);
+
+	// Importing each file (plus a large synthetic one) from OBJ vs.
+	// from .glb files written from it, both standard and laid out
+	// for loading in place, compared to just reading the file
+	static void GlbLoading(const std::vector<std::string>& objFiles, const std::string& syntheticObjFile);
+
+	// Draw calls, merge time and culling efficiency of a field of
+	// static props batched at several cell sizes, plus a check that
+	// the merged triangles match each prop's own (and still face out)
+	static void StaticBatching();
+
+	// Vertex fetch and shading for a depth only pass over each file
+	// using the full, packed and position only (welded) streams
+	static void PositionStreams(const std::vector<std::string>& objFiles);
+
+	// Rebuilding the matrices of many transforms one at a time (as
+	// Transform used to, from Euler angles and with a general inverse)
+	// vs. TransformStore's sweep, from quaternions, with different
+	// fractions of them dirty, checked against each other
+	static void TransformUpdates();
+
+private:
+	static bool WriteSyntheticObj(const std::string& path, int gridSize);
+};
+
@@ -0,0 +1,101 @@
+#include "Bounds.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace DirectX;
+
+AxisAlignedBox Bounds::BoxFromVertices(const Vertex* vertices, size_t vertexCount)
+{
+	AxisAlignedBox box = {};
+	if (vertexCount == 0)
+		return box;
+
+	XMVECTOR boxMin = XMLoadFloat3(&vertices[0].Position);
+	XMVECTOR boxMax = boxMin;
+	for (size_t v = 1; v < vertexCount; v++)
+	{
+		XMVECTOR p = XMLoadFloat3(&vertices[v].Position);
+		boxMin = XMVectorMin(boxMin, p);
+		boxMax = XMVectorMax(boxMax, p);
+	}
+
+	XMStoreFloat3(&box.Center, (boxMin + boxMax) * 0.5f);
+	XMStoreFloat3(&box.Extents, (boxMax - boxMin) * 0.5f);
+	return box;
+}
+
+BoundingSphere Bounds::SphereFromVertices(const Vertex* vertices, size_t vertexCount, XMFLOAT3 center)
+{
+	// Furthest vertex from the center (compared squared, rooted once)
+	XMVECTOR c = XMLoadFloat3(&center);
+	XMVECTOR maxLengthSq = XMVectorZero();
+	for (size_t v = 0; v < vertexCount; v++)
+		maxLengthSq = XMVectorMax(maxLengthSq, XMVector3LengthSq(XMLoadFloat3(&vertices[v].Position) - c));
+
+	BoundingSphere sphere;
+	sphere.Center = center;
+	sphere.Radius = sqrtf(XMVectorGetX(maxLengthSq));
+	return sphere;
+}
+
+AxisAlignedBox Bounds::Transform(const AxisAlignedBox& box, const XMFLOAT4X4& matrix)
+{
+	XMMATRIX m = XMLoadFloat4x4(&matrix);
+	XMVECTOR center = XMLoadFloat3(&box.Center);
+	XMVECTOR extents = XMLoadFloat3(&box.Extents);
+
+	// Row vectors, so each output axis sums the rows' contributions
+	XMVECTOR newExtents =
+		XMVectorAbs(m.r[0]) * XMVectorSplatX(extents) +
+		XMVectorAbs(m.r[1]) * XMVectorSplatY(extents) +
+		XMVectorAbs(m.r[2]) * XMVectorSplatZ(extents);
+
+	AxisAlignedBox result;
+	XMStoreFloat3(&result.Center, XMVector3Transform(center, m));
+	XMStoreFloat3(&result.Extents, newExtents);
+	return result;
+}
+
+bool Bounds::RayIntersects(const AxisAlignedBox& box, XMFLOAT3 origin, XMFLOAT3 direction, float maxDistance)
+{
+	// Slab test: where the ray crosses each pair of planes
+	XMVECTOR center = XMLoadFloat3(&box.Center);
+	XMVECTOR extents = XMLoadFloat3(&box.Extents);
+	XMVECTOR o = XMLoadFloat3(&origin);
+	XMVECTOR invDir = XMVectorReciprocal(XMLoadFloat3(&direction));
+	XMVECTOR t1 = (center - extents - o) * invDir;
+	XMVECTOR t2 = (center + extents - o) * invDir;
+
+	XMFLOAT3 tMin, tMax;
+	XMStoreFloat3(&tMin, XMVectorMin(t1, t2));
+	XMStoreFloat3(&tMax, XMVectorMax(t1, t2));
+	float tNear = (std::max)(tMin.x, (std::max)(tMin.y, tMin.z));
+	float tFar = (std::min)(tMax.x, (std::min)(tMax.y, tMax.z));
+	return tFar >= (std::max)(tNear, 0.0f) && tNear < maxDistance;
+}
+
+bool Bounds::InFrustum(const AxisAlignedBox& box, const XMFLOAT4 planes[6])
+{
+	// The box reaches extents . |normal| toward each plane
+	const XMFLOAT3& c = box.Center;
+	const XMFLOAT3& e = box.Extents;
+	for (int i = 0; i < 6; i++)
+	{
+		const XMFLOAT4& p = planes[i];
+		float radius = e.x * fabsf(p.x) + e.y * fabsf(p.y) + e.z * fabsf(p.z);
+		if (p.x * c.x + p.y * c.y + p.z * c.z + p.w < -radius)
+			return false;
+	}
+	return true;
+}
+
+XMFLOAT3 Bounds::GetMin(const AxisAlignedBox& box)
+{
+	return XMFLOAT3(box.Center.x - box.Extents.x, box.Center.y - box.Extents.y, box.Center.z - box.Extents.z);
+}
+
+XMFLOAT3 Bounds::GetMax(const AxisAlignedBox& box)
+{
+	return XMFLOAT3(box.Center.x + box.Extents.x, box.Center.y + box.Extents.y, box.Center.z + box.Extents.z);
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <DirectXMath.h>
+
+#include "Vertex.h"
+
+// --------------------------------------------------------
+// An axis aligned box, as its center and its half size
+// along each axis
+// --------------------------------------------------------
+struct AxisAlignedBox
+{
+	DirectX::XMFLOAT3 Center;
+	DirectX::XMFLOAT3 Extents;
+};
+
+struct BoundingSphere
+{
+	DirectX::XMFLOAT3 Center;
+	float Radius;
+};
+
+// --------------------------------------------------------
+// Builds and transforms bounding volumes
+// --------------------------------------------------------
+class Bounds
+{
+public:
+	// Tight box around the vertices, and a sphere (centered on the
+	// box) around them too.  Both are empty when there are no vertices.
+	static AxisAlignedBox BoxFromVertices(const Vertex* vertices, size_t vertexCount);
+	static BoundingSphere SphereFromVertices(const Vertex* vertices, size_t vertexCount, DirectX::XMFLOAT3 center);
+
+	// Box around a transformed box, using Arvo's method ("Transforming
+	// Axis-Aligned Bounding Boxes", Graphics Gems): the new extents are
+	// the old ones through the absolute value of the matrix, so no
+	// corners are needed
+	static AxisAlignedBox Transform(const AxisAlignedBox& box, const DirectX::XMFLOAT4X4& matrix);
+
+	// Does the ray enter the box before maxDistance (in multiples of
+	// its direction)?  Rays starting inside the box always do.
+	static bool RayIntersects(const AxisAlignedBox& box, DirectX::XMFLOAT3 origin, DirectX::XMFLOAT3 direction, float maxDistance);
+
+	// Is any of the box inside (or possibly inside) all six planes?
+	// Plane normals point inward and are normalized, as in
+	// MeshletCullInfo.  Boxes near a frustum's corners can pass
+	// without being visible, but visible boxes never fail.
+	static bool InFrustum(const AxisAlignedBox& box, const DirectX::XMFLOAT4 planes[6]);
+
+	static DirectX::XMFLOAT3 GetMin(const AxisAlignedBox& box);
+	static DirectX::XMFLOAT3 GetMax(const AxisAlignedBox& box);
+};
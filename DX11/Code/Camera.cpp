@@ -86,3 +86,17 @@ Transform* Camera::GetTransform()
 {
 	return &transform;
 }
+
+void Camera::GetScreenRay(float screenX, float screenY, float screenWidth, float screenHeight, XMFLOAT3& origin, XMFLOAT3& direction)
+{
+	// Point on the screen in normalized device coordinates, then
+	// undo the projection's scaling to get a view space direction
+	float ndcX = screenX / screenWidth * 2.0f - 1.0f;
+	float ndcY = 1.0f - screenY / screenHeight * 2.0f;
+	XMVECTOR viewDir = XMVectorSet(ndcX / projMatrix._11, ndcY / projMatrix._22, 1.0f, 0.0f);
+
+	// Rotate into world space with the inverse view matrix
+	XMMATRIX invView = XMMatrixInverse(0, XMLoadFloat4x4(&viewMatrix));
+	XMStoreFloat3(&direction, XMVector3Normalize(XMVector3TransformNormal(viewDir, invView)));
+	origin = transform.GetPosition();
+}
@@ -21,6 +21,10 @@ public:
 
 	Transform* GetTransform();
 
+	// World space ray from the camera through a point on the screen
+	// (in pixels, from the top left), with a normalized direction
+	void GetScreenRay(float screenX, float screenY, float screenWidth, float screenHeight, DirectX::XMFLOAT3& origin, DirectX::XMFLOAT3& direction);
+
 private:
 	// Camera matrices
 	DirectX::XMFLOAT4X4 viewMatrix;
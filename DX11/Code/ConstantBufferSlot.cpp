@@ -0,0 +1,32 @@
+#include "ConstantBufferSlot.h"
+
+unsigned long long ConstantBufferSlot::uploadedBytes = 0;
+
+
+ConstantBufferSlot::ConstantBufferSlot() :
+	version(0),
+	valid(false)
+{
+}
+
+void ConstantBufferSlot::Write(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, const void* data, unsigned int size, unsigned int version)
+{
+	if (!buffer)
+	{
+		Microsoft::WRL::ComPtr<ID3D11Device> device;
+		context->GetDevice(device.GetAddressOf());
+
+		// Default usage, since most slots are written rarely
+		D3D11_BUFFER_DESC desc = {};
+		desc.ByteWidth = size;
+		desc.Usage = D3D11_USAGE_DEFAULT;
+		desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+		device->CreateBuffer(&desc, 0, buffer.GetAddressOf());
+	}
+
+	context->UpdateSubresource(buffer.Get(), 0, 0, data, 0, 0);
+	uploadedBytes += size;
+
+	this->version = version;
+	valid = true;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <d3d11.h>
+#include <wrl/client.h>
+
+// --------------------------------------------------------
+// A constant buffer that belongs to a single object (or
+// material) and keeps its contents between frames
+//
+// The owner hands over a version along with the data, and
+// the data is only uploaded when that version has changed
+// since the last write - so on most frames, most objects
+// send nothing at all.
+// --------------------------------------------------------
+class ConstantBufferSlot
+{
+public:
+	ConstantBufferSlot();
+
+	// Whether the buffer already holds the data for this version
+	bool IsCurrent(unsigned int version) { return buffer && valid && version == this->version; }
+
+	// Forces the next write, for changes the version doesn't cover
+	void Invalidate() { valid = false; }
+
+	// Creates the buffer on the first write (size must be a
+	// multiple of 16 and stay the same), then uploads the data
+	void Write(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, const void* data, unsigned int size, unsigned int version);
+
+	ID3D11Buffer* const* GetAddressOf() { return buffer.GetAddressOf(); }
+
+	// Bytes written by every slot since the last reset
+	static unsigned long long GetUploadedBytes() { return uploadedBytes; }
+	static void ResetUploadedBytes() { uploadedBytes = 0; }
+
+private:
+	Microsoft::WRL::ComPtr<ID3D11Buffer> buffer;
+	unsigned int version;
+	bool valid;
+
+	static unsigned long long uploadedBytes;
+};
@@ -0,0 +1,30 @@
+
+// Data that only changes once per frame
+cbuffer perFrame : register(b0)
+{
+	matrix view;
+	matrix projection;
+};
+
+// The start of the same per object buffer VertexShader.hlsl uses
+cbuffer perObject : register(b1)
+{
+	matrix world;
+};
+
+// Just the position - meshes bind their position only
+// stream (see MeshFlags_BuildPositionStream) for this
+struct VertexShaderInput
+{
+	float3 position		: POSITION;
+};
+
+// --------------------------------------------------------
+// Depth only vertex shader, with no pixel shader after it.
+// The position is calculated exactly as in VertexShader.hlsl.
+// --------------------------------------------------------
+float4 main(VertexShaderInput input) : SV_POSITION
+{
+	matrix worldViewProj = mul(projection, mul(view, world));
+	return mul(worldViewProj, float4(input.position, 1.0f));
+}
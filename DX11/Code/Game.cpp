@@ -1,18 +1,23 @@
 
 #include <stdlib.h>     // For seeding random and rand()
 #include <time.h>       // For grabbing time (to seed random)
+#include <float.h>      // For FLT_MAX
+#include <algorithm>
+#include <chrono>
 
 #include "Game.h"
 #include "Vertex.h"
 #include "Input.h"
 #include "Renderer.h"
+#include "Benchmarks.h"
+#include "MeshGenerator.h"
+#include "JobSystem.h"
+#include "Bounds.h"
 
 #include "Imgui\imgui.h"
 #include "Imgui\imgui_impl_dx11.h"
 #include "Imgui\imgui_impl_win32.h"
 
-#include "WICTextureLoader.h"
-
 
 // Needed for a helper function to read compiled shader files from the hard drive
 #pragma comment(lib, "d3dcompiler.lib")
@@ -25,8 +30,9 @@ using namespace DirectX;
 #define RandomRange(min, max) (float)rand() / RAND_MAX * (max - min) + min
 
 // Helper macros for making texture and shader loading code more succinct
-#define LoadTexture(file, srv) CreateWICTextureFromFile(device.Get(), context.Get(), GetFullPathTo_Wide(file).c_str(), 0, srv.GetAddressOf())
-#define LoadShader(type, file) std::make_shared<type>(device.Get(), context.Get(), GetFullPathTo_Wide(file).c_str())
+// - Both go through the asset cache, so each file is only loaded once
+#define LoadTexture(file, srv) srv = assets->GetTexture(GetFullPathTo_Wide(file))
+#define LoadShader(type, file) assets->Get##type(GetFullPathTo_Wide(file))
 
 
 // --------------------------------------------------------
@@ -77,6 +83,9 @@ Game::~Game()
 	ImGui_ImplDX11_Shutdown();
 	ImGui_ImplWin32_Shutdown();
 	ImGui::DestroyContext();
+
+	// Stop the worker threads
+	JobSystem::Shutdown();
 }
 
 // --------------------------------------------------------
@@ -132,7 +141,18 @@ void Game::Init()
 		ssaoCombinePS,
 		randomSRV,
 		samplerOptions,
-		clampSamplerOptions);
+		clampSamplerOptions,
+		depthVS);
+
+	// Merge any static entities that share a material and are near
+	// each other (within the same 25 unit cell), so they're drawn together
+	std::vector<std::shared_ptr<StaticBatch>> staticBatches;
+	StaticBatch::Build(entities, 25.0f, device, staticBatches);
+	renderer->SetStaticBatches(staticBatches);
+	renderer->SetMeshStreamer(meshStreamer);
+
+	transformStats = std::make_shared<TransformUpdateStats>();
+	renderer->SetTransformUpdateStats(transformStats);
 }
 
 
@@ -141,8 +161,12 @@ void Game::Init()
 // --------------------------------------------------------
 void Game::LoadAssetsAndCreateEntities()
 {
+	assets = std::make_shared<AssetCache>(device, context);
+
 	// Load shaders using our succinct LoadShader() macro
 	std::shared_ptr<SimpleVertexShader> vertexShader	= LoadShader(SimpleVertexShader, L"VertexShader.cso");
+	std::shared_ptr<SimpleVertexShader> vertexShaderPacked	= LoadShader(SimpleVertexShader, L"VertexShaderPacked.cso");
+	depthVS				= LoadShader(SimpleVertexShader, L"DepthVS.cso");
 	std::shared_ptr<SimplePixelShader> pixelShader		= LoadShader(SimplePixelShader, L"PixelShader.cso");
 	std::shared_ptr<SimplePixelShader> pixelShaderPBR	= LoadShader(SimplePixelShader, L"PixelShaderPBR.cso");
 	std::shared_ptr<SimplePixelShader> solidColorPS		= LoadShader(SimplePixelShader, L"SolidColorPS.cso");
@@ -163,10 +187,48 @@ void Game::LoadAssetsAndCreateEntities()
 	arial = std::make_shared<SpriteFont>(device.Get(), GetFullPathTo_Wide(L"../../Assets/Textures/arial.spritefont").c_str());
 
 	// Make the meshes
-	std::shared_ptr<Mesh> sphereMesh = std::make_shared<Mesh>(GetFullPathTo("../../Assets/Models/sphere.obj").c_str(), device);
-	std::shared_ptr<Mesh> helixMesh = std::make_shared<Mesh>(GetFullPathTo("../../Assets/Models/helix.obj").c_str(), device);
-	std::shared_ptr<Mesh> cubeMesh = std::make_shared<Mesh>(GetFullPathTo("../../Assets/Models/cube.obj").c_str(), device);
-	std::shared_ptr<Mesh> coneMesh = std::make_shared<Mesh>(GetFullPathTo("../../Assets/Models/cone.obj").c_str(), device);
+	// - The basic shapes are generated rather than loaded, since
+	//    that's faster than reading them and comes with tangents
+	// - The sphere is drawn the most, so it uses the compact
+	//    PackedVertex format, and is split into meshlets so
+	//    entities can skip their back facing clusters, gets
+	//    simplified LODs for when it's far away, and keeps a
+	//    BVH so entities can be picked with the mouse
+	// - Everything drawn in the depth pre-pass gets a position only
+	//    vertex stream for it
+	std::vector<Vertex> shapeVerts;
+	std::vector<unsigned int> shapeIndices;
+	MeshGenerator::Sphere(shapeVerts, shapeIndices);
+	std::shared_ptr<Mesh> sphereMesh = std::make_shared<Mesh>(&shapeVerts[0], (int)shapeVerts.size(), &shapeIndices[0], (int)shapeIndices.size(), device, MeshFlags_KeepTangents | MeshFlags_PackVertices | MeshFlags_BuildMeshlets | MeshFlags_BuildLods | MeshFlags_KeepCpuData | MeshFlags_BuildPositionStream);
+	MeshGenerator::Cube(shapeVerts, shapeIndices);
+	std::shared_ptr<Mesh> cubeMesh = std::make_shared<Mesh>(&shapeVerts[0], (int)shapeVerts.size(), &shapeIndices[0], (int)shapeIndices.size(), device, MeshFlags_KeepTangents | MeshFlags_BuildPositionStream);
+	MeshGenerator::Cone(shapeVerts, shapeIndices);
+	std::shared_ptr<Mesh> coneMesh = std::make_shared<Mesh>(&shapeVerts[0], (int)shapeVerts.size(), &shapeIndices[0], (int)shapeIndices.size(), device, MeshFlags_KeepTangents | MeshFlags_BuildPositionStream);
+	MeshGenerator::Torus(shapeVerts, shapeIndices);
+	std::shared_ptr<Mesh> torusMesh = std::make_shared<Mesh>(&shapeVerts[0], (int)shapeVerts.size(), &shapeIndices[0], (int)shapeIndices.size(), device, MeshFlags_KeepTangents | MeshFlags_BuildPositionStream);
+
+	// - Point lights are small solid spheres, so far fewer triangles will do
+	MeshGenerator::Sphere(shapeVerts, shapeIndices, 1.0f, 12, 6);
+	lightMesh = std::make_shared<Mesh>(&shapeVerts[0], (int)shapeVerts.size(), &shapeIndices[0], (int)shapeIndices.size(), device, MeshFlags_KeepTangents | MeshFlags_PackVertices);
+
+	// - Meshes from files load in the background, starting out as
+	//    a placeholder cube
+	// - The helix is streamed in once it's visible or nearby (within a
+	//    64 MB budget), with a small simplified copy drawn until then
+	//    (which itself is made in the background)
+	meshLoader = std::make_shared<MeshLoader>(device, assets);
+	meshStreamer = std::make_shared<MeshStreamer>(assets, 64 * 1024 * 1024);
+
+	std::string helixFile = GetFullPathTo("../../Assets/Models/helix.obj");
+	int helixId = meshStreamer->Register(helixFile, MeshFlags_BuildPositionStream, meshLoader->GetPlaceholder());
+	{
+		Microsoft::WRL::ComPtr<ID3D11Device> loadDevice = device;
+		std::shared_ptr<AssetCache> loadAssets = assets;
+		std::shared_ptr<MeshStreamer> streamer = meshStreamer;
+		meshLoader->Load(
+			[helixFile, loadAssets, loadDevice]() { return MeshStreamer::MakeStandIn(helixFile, loadAssets, loadDevice, MeshFlags_BuildPositionStream, 256); },
+			[streamer, helixId](std::shared_ptr<Mesh> standIn) { streamer->SetStandIn(helixId, standIn); });
+	}
 	
 	// Declare the textures we'll need
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> cobbleA,  cobbleN,  cobbleR,  cobbleM;
@@ -443,6 +505,13 @@ void Game::LoadAssetsAndCreateEntities()
 	std::shared_ptr<GameEntity> shinyMetalSpherePBR = std::make_shared<GameEntity>(sphereMesh, iblTestMat_shinyMetal);
 	shinyMetalSpherePBR->GetTransform()->SetPosition(6, 4, 0);
 
+	std::shared_ptr<GameEntity> bronzeHelixPBR = std::make_shared<GameEntity>(meshStreamer->Get(helixId), bronzeMatPBR);
+	bronzeHelixPBR->GetTransform()->SetPosition(-6, 4, 0);
+	streamedEntities.push_back(std::make_pair(bronzeHelixPBR, helixId));
+
+	std::shared_ptr<GameEntity> woodTorusPBR = std::make_shared<GameEntity>(torusMesh, woodMatPBR);
+	woodTorusPBR->GetTransform()->SetPosition(-3, 4, 0);
+
 	entities.push_back(cobSpherePBR);
 	entities.push_back(floorSpherePBR);
 	entities.push_back(paintSpherePBR);
@@ -451,6 +520,8 @@ void Game::LoadAssetsAndCreateEntities()
 	entities.push_back(roughSpherePBR);
 	entities.push_back(woodSpherePBR);
 	entities.push_back(shinyMetalSpherePBR);
+	entities.push_back(bronzeHelixPBR);
+	entities.push_back(woodTorusPBR);
 
 	// Create the non-PBR entities ==============================
 	std::shared_ptr<GameEntity> cobSphere = std::make_shared<GameEntity>(sphereMesh, cobbleMat2x);
@@ -482,10 +553,13 @@ void Game::LoadAssetsAndCreateEntities()
 	entities.push_back(roughSphere);
 	entities.push_back(woodSphere);
 
+	// Every material needs to be able to draw packed meshes
+	for (auto& e : entities)
+		e->GetMaterial()->SetPackedVertexShader(vertexShaderPacked);
+
 
 	// Save assets needed for drawing point lights
-	lightMesh = sphereMesh;
-	lightVS = vertexShader;
+	lightVS = lightMesh->HasPackedVertices() ? vertexShaderPacked : vertexShader;
 	lightPS = solidColorPS;
 }
 
@@ -541,6 +615,45 @@ void Game::GenerateLights()
 
 
 
+// --------------------------------------------------------
+// Runs the CPU-side asset benchmarks.  Results go to the
+// console, which only exists by default in debug builds,
+// so make one if necessary (timings from a release build
+// are the ones that matter).
+// --------------------------------------------------------
+void Game::RunBenchmarks()
+{
+	if (!GetConsoleWindow())
+		CreateConsoleWindow(500, 120, 32, 120);
+
+	std::vector<std::string> objFiles = {
+		GetFullPathTo("../../Assets/Models/cone.obj"),
+		GetFullPathTo("../../Assets/Models/cube.obj"),
+		GetFullPathTo("../../Assets/Models/cylinder.obj"),
+		GetFullPathTo("../../Assets/Models/helix.obj"),
+		GetFullPathTo("../../Assets/Models/sphere.obj"),
+		GetFullPathTo("../../Assets/Models/torus.obj")
+	};
+
+	Benchmarks::ObjParsing(objFiles, GetFullPathTo("benchmark_synthetic.obj"));
+	Benchmarks::VertexWelding(objFiles);
+	Benchmarks::MeshCacheLoading(objFiles);
+	Benchmarks::MeshCompression(objFiles);
+	Benchmarks::VertexCacheOptimization(objFiles);
+	Benchmarks::OverdrawOptimization(objFiles);
+	Benchmarks::MeshletCulling(objFiles);
+	Benchmarks::VertexPackingAccuracy(objFiles);
+	Benchmarks::LodGeneration(objFiles);
+	Benchmarks::TangentGeneration(objFiles, GetFullPathTo("benchmark_synthetic.obj"));
+	Benchmarks::Raycasting(objFiles, GetFullPathTo("benchmark_synthetic.obj"));
+	Benchmarks::PrimitiveGeneration(objFiles);
+	Benchmarks::GlbLoading(objFiles, GetFullPathTo("benchmark_synthetic.obj"));
+	Benchmarks::StaticBatching();
+	Benchmarks::PositionStreams(objFiles);
+	Benchmarks::TransformUpdates();
+}
+
+
 // --------------------------------------------------------
 // Handle resizing DirectX "stuff" to match the new window size.
 // For instance, updating our projection matrix's aspect ratio.
@@ -571,9 +684,96 @@ void Game::Update(float deltaTime, float totalTime)
 	// Update the camera
 	camera->Update(deltaTime);
 
+	// Pick the entity under the mouse
+	if (input.MouseRightPress())
+	{
+		XMFLOAT3 origin, direction;
+		camera->GetScreenRay((float)input.GetMouseX(), (float)input.GetMouseY(), (float)width, (float)height, origin, direction);
+
+		RayHit hit;
+		renderer->SetSelectedEntity(GameEntity::Raycast(entities, origin, direction, FLT_MAX, hit));
+	}
+
+	// Swap in any meshes that finished loading
+	meshLoader->Update();
+
+	// Bring matrices and bounds up to date before anything needs them
+	UpdateTransforms();
+	StreamMeshes();
+
+	// Free anything loaded that's no longer used
+	assets->ReleaseUnused();
+
 	// Check individual input
 	if (input.KeyDown(VK_ESCAPE)) Quit();
 	if (input.KeyPress(VK_TAB)) GenerateLights();
+	if (input.KeyPress('B')) RunBenchmarks();
+}
+
+// --------------------------------------------------------
+// Dirty transforms are swept a cache line's worth of dirty bits per
+// job, then the entities' bounds are refit in chunks of a
+// whole number of cache lines' worth of entity pointers.  There's
+// no transform hierarchy here, so each pass is a single wave
+// and ParallelFor() returning is the barrier between them.
+// --------------------------------------------------------
+void Game::UpdateTransforms()
+{
+	const unsigned int entitiesPerChunk = 64;
+
+	JobSystem& jobSystem = JobSystem::GetInstance();
+	TransformUpdateStats& stats = *transformStats;
+	stats.Threads.assign(jobSystem.GetThreadCount(), TransformUpdateThreadStats());
+
+	auto start = std::chrono::high_resolution_clock::now();
+	TransformStore::GetInstance().UpdateMatrices(&stats);
+
+	// Nothing is dirty now, so bounds only read the matrices
+	stats.Entities = (unsigned int)entities.size();
+	stats.BoundsChunks = (stats.Entities + entitiesPerChunk - 1) / entitiesPerChunk;
+	jobSystem.ParallelFor(stats.BoundsChunks, [&](unsigned int chunk)
+	{
+		auto chunkStart = std::chrono::high_resolution_clock::now();
+		unsigned int end = (std::min)((chunk + 1) * entitiesPerChunk, stats.Entities);
+		for (unsigned int i = chunk * entitiesPerChunk; i < end; i++)
+			entities[i]->GetWorldBounds();
+
+		unsigned int thread = JobSystem::GetThreadIndex();
+		auto chunkEnd = std::chrono::high_resolution_clock::now();
+		stats.Threads[thread].Milliseconds += std::chrono::duration<double, std::milli>(chunkEnd - chunkStart).count();
+		stats.Threads[thread].Chunks++;
+	});
+
+	auto end = std::chrono::high_resolution_clock::now();
+	stats.TotalMs = std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+// --------------------------------------------------------
+// Visible meshes are wanted most, then the closest ones.
+// Anything further than the streaming radius and out of
+// view isn't requested at all, so it can be evicted.
+// --------------------------------------------------------
+void Game::StreamMeshes()
+{
+	const float streamingRadius = 30.0f;
+
+	XMFLOAT4X4 identity;
+	XMStoreFloat4x4(&identity, XMMatrixIdentity());
+	XMFLOAT3 cameraPos = camera->GetTransform()->GetPosition();
+	MeshletCullInfo cull = Meshlets::MakeCullInfo(identity, camera->GetView(), camera->GetProjection(), cameraPos);
+
+	for (auto& s : streamedEntities)
+	{
+		const AxisAlignedBox& bounds = s.first->GetWorldBounds();
+		float distance = XMVectorGetX(XMVector3Length(XMLoadFloat3(&bounds.Center) - XMLoadFloat3(&cameraPos)));
+		bool visible = Bounds::InFrustum(bounds, cull.FrustumPlanes);
+		if (visible || distance < streamingRadius)
+			meshStreamer->Request(s.second, (visible ? 2.0f : 1.0f) / (std::max)(distance, 0.1f));
+	}
+
+	meshStreamer->Update();
+	for (auto& s : streamedEntities)
+		s.first->SetMesh(meshStreamer->Get(s.second));
 }
 
 // --------------------------------------------------------
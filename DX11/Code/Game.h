@@ -10,6 +10,9 @@
 #include "Lights.h"
 #include "Sky.h"
 #include "Renderer.h"
+#include "MeshStreamer.h"
+#include "MeshLoader.h"
+#include "AssetCache.h"
 
 #include <DirectXMath.h>
 #include <wrl/client.h> // Used for ComPtr - a smart pointer for COM objects
@@ -38,10 +41,21 @@ private:
 	std::vector<std::shared_ptr<GameEntity>> entities;
 	std::shared_ptr<Camera> camera;
 
+	// Entities whose meshes stream in and out, and their streamer ids
+	std::shared_ptr<MeshStreamer> meshStreamer;
+	std::vector<std::pair<std::shared_ptr<GameEntity>, int>> streamedEntities;
+
+	// How the last transform and bounds update was spread across threads
+	std::shared_ptr<TransformUpdateStats> transformStats;
+
 	// Lights
 	std::vector<Light> lights;
 	int lightCount;
 
+	// Every mesh, texture and shader loaded from a file
+	std::shared_ptr<AssetCache> assets;
+	std::shared_ptr<MeshLoader> meshLoader;
+
 	// These will be loaded along with other assets and
 	// saved to these variables for ease of access
 	std::shared_ptr<Mesh> lightMesh;
@@ -52,6 +66,7 @@ private:
 	std::shared_ptr<SimplePixelShader> ssaoCombinePS;
 
 	std::shared_ptr<SimpleVertexShader> fullscreenVS;
+	std::shared_ptr<SimpleVertexShader> depthVS;
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> randomSRV;
 
 	// Text & ui
@@ -70,5 +85,16 @@ private:
 
 	// Initialization helper method
 	void LoadAssetsAndCreateEntities();
+
+	// Rebuilds the matrices of everything that moved, then the
+	// entities' world bounds, both in chunks across the job system
+	void UpdateTransforms();
+
+	// Requests meshes for the streamed entities that are visible or
+	// nearby, and hands each entity whatever's resident
+	void StreamMeshes();
+
+	// Runs the asset pipeline benchmarks, printing to the console
+	void RunBenchmarks();
 };
 
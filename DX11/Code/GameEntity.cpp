@@ -1,5 +1,7 @@
 #include "GameEntity.h"
 
+#include <algorithm>
+
 using namespace DirectX;
 
 GameEntity::GameEntity(std::shared_ptr<Mesh> mesh, std::shared_ptr<Material> material)
@@ -7,18 +9,136 @@ GameEntity::GameEntity(std::shared_ptr<Mesh> mesh, std::shared_ptr<Material> mat
 	// Save the data
 	this->mesh = mesh;
 	this->material = material;
+	isStatic = false;
+
+	// Bounds start out of date (no version can match this one yet)
+	worldBounds = mesh->GetBoundingBox();
+	worldBoundsVersion = transform.GetMatrixVersion() - 1;
 }
 
 std::shared_ptr<Mesh> GameEntity::GetMesh() { return mesh; }
 std::shared_ptr<Material> GameEntity::GetMaterial() { return material; }
 Transform* GameEntity::GetTransform() { return &transform; }
 
+void GameEntity::SetMesh(std::shared_ptr<Mesh> mesh)
+{
+	if (mesh == this->mesh)
+		return;
+
+	// The world bounds need to be recalculated around the new mesh,
+	// and its decode values (if packed) sent to the GPU
+	this->mesh = mesh;
+	worldBoundsVersion = transform.GetMatrixVersion() - 1;
+	objectConstants.Invalidate();
+}
+
+const AxisAlignedBox& GameEntity::GetWorldBounds()
+{
+	unsigned int version = transform.GetMatrixVersion();
+	if (version != worldBoundsVersion)
+	{
+		worldBounds = Bounds::Transform(mesh->GetBoundingBox(), transform.GetWorldMatrix());
+		worldBoundsVersion = version;
+	}
+	return worldBounds;
+}
+
+bool GameEntity::Raycast(XMFLOAT3 origin, XMFLOAT3 direction, float maxDistance, RayHit& hit)
+{
+	if (mesh->GetBvh().IsEmpty() || !Bounds::RayIntersects(GetWorldBounds(), origin, direction, maxDistance))
+		return false;
+
+	// Bring the ray into model space - its direction isn't normalized
+	// afterwards, so distances along it still match world space
+	XMFLOAT4X4 world = transform.GetWorldMatrix();
+	XMMATRIX invWorld = XMMatrixInverse(0, XMLoadFloat4x4(&world));
+	XMFLOAT3 localOrigin, localDirection;
+	XMStoreFloat3(&localOrigin, XMVector3TransformCoord(XMLoadFloat3(&origin), invWorld));
+	XMStoreFloat3(&localDirection, XMVector3TransformNormal(XMLoadFloat3(&direction), invWorld));
+
+	return mesh->Raycast(localOrigin, localDirection, maxDistance, hit);
+}
 
-void GameEntity::Draw(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, std::shared_ptr<Camera> camera)
+int GameEntity::Raycast(const std::vector<std::shared_ptr<GameEntity>>& entities, XMFLOAT3 origin, XMFLOAT3 direction, float maxDistance, RayHit& hit)
+{
+	// Each hit shortens the ray for the rest
+	int closest = -1;
+	for (size_t i = 0; i < entities.size(); i++)
+	{
+		if (entities[i]->Raycast(origin, direction, maxDistance, hit))
+		{
+			closest = (int)i;
+			maxDistance = hit.Distance;
+		}
+	}
+	return closest;
+}
+
+
+void GameEntity::Draw(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, std::shared_ptr<Camera> camera, float screenHeight)
 {
 	// Tell the material to prepare for a draw
-	material->PrepareMaterial(&transform, camera);
+	Material::UpdateObjectConstants(context, objectConstants, transform, mesh);
+	material->PrepareMaterial(context, objectConstants, mesh);
+
+	// Draw the mesh, skipping any meshlets that can't be seen
+	// (meshlets are only built for the full detail level)
+	int lod = SelectLod(camera, screenHeight);
+	if (lod == 0 && mesh->HasMeshlets())
+	{
+		MeshletCullInfo cull = Meshlets::MakeCullInfo(
+			transform.GetWorldMatrix(),
+			camera->GetView(),
+			camera->GetProjection(),
+			camera->GetTransform()->GetPosition());
+		mesh->SetBuffersAndDrawVisible(context, cull);
+	}
+	else
+	{
+		mesh->SetBuffersAndDraw(context, lod);
+	}
+}
+
+void GameEntity::DrawDepth(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, std::shared_ptr<Camera> camera, std::shared_ptr<SimpleVertexShader> depthVS, float screenHeight)
+{
+	if (!mesh->HasPositionStream())
+		return;
+
+	// The depth shader reads the world matrix from the same constants
+	Material::UpdateObjectConstants(context, objectConstants, transform, mesh);
+	context->VSSetConstantBuffers(1, 1, objectConstants.GetAddressOf());
+
+	// Same level of detail and meshlets as Draw(), so the depths match
+	int lod = SelectLod(camera, screenHeight);
+	if (lod == 0 && mesh->HasMeshlets())
+	{
+		MeshletCullInfo cull = Meshlets::MakeCullInfo(
+			transform.GetWorldMatrix(),
+			camera->GetView(),
+			camera->GetProjection(),
+			camera->GetTransform()->GetPosition());
+		mesh->SetPositionBuffersAndDrawVisible(context, cull);
+	}
+	else
+	{
+		mesh->SetPositionBuffersAndDraw(context, lod);
+	}
+}
+
+// --------------------------------------------------------
+// Picks the simplest level of detail that's within a pixel
+// of the full mesh, based on how far away (and how large)
+// this entity is
+// --------------------------------------------------------
+int GameEntity::SelectLod(std::shared_ptr<Camera> camera, float screenHeight)
+{
+	if (mesh->GetLodCount() <= 1)
+		return 0;
 
-	// Draw the mesh
-	mesh->SetBuffersAndDraw(context);
+	XMFLOAT3 pos = transform.GetPosition();
+	XMFLOAT3 camPos = camera->GetTransform()->GetPosition();
+	XMFLOAT3 scale = transform.GetScale();
+	float distance = XMVectorGetX(XMVector3Length(XMLoadFloat3(&pos) - XMLoadFloat3(&camPos)));
+	float worldScale = (std::max)(fabsf(scale.x), (std::max)(fabsf(scale.y), fabsf(scale.z)));
+	return mesh->SelectLod(distance, worldScale, camera->GetProjection()._22, screenHeight);
 }
@@ -2,6 +2,8 @@
 
 #include <wrl/client.h>
 #include <DirectXMath.h>
+#include <memory>
+#include <vector>
 #include "Mesh.h"
 #include "Material.h"
 #include "Transform.h"
@@ -14,15 +16,47 @@ public:
 	GameEntity(std::shared_ptr<Mesh> mesh, std::shared_ptr<Material> material);
 
 	std::shared_ptr<Mesh> GetMesh();
+	void SetMesh(std::shared_ptr<Mesh> mesh);
 	std::shared_ptr<Material> GetMaterial();
 	Transform* GetTransform();
 
-	void Draw(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, std::shared_ptr<Camera> camera);
+	// Static entities are drawn as part of a StaticBatch rather than
+	// on their own, so they shouldn't move once it's built
+	bool IsStatic() { return isStatic; }
+	void SetStatic(bool isStatic) { this->isStatic = isStatic; }
+
+	// World space box around the mesh, only recalculated after
+	// the transform changes
+	const AxisAlignedBox& GetWorldBounds();
+
+	// Closest hit of a world space ray on this entity's mesh, which
+	// needs MeshFlags_KeepCpuData.  Distances stay in multiples of the
+	// world space direction.
+	bool Raycast(DirectX::XMFLOAT3 origin, DirectX::XMFLOAT3 direction, float maxDistance, RayHit& hit);
+
+	// Index of the entity with the closest hit, or -1 for none
+	static int Raycast(const std::vector<std::shared_ptr<GameEntity>>& entities, DirectX::XMFLOAT3 origin, DirectX::XMFLOAT3 direction, float maxDistance, RayHit& hit);
+
+	// The screen height picks the mesh's level of detail, if it has several
+	void Draw(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, std::shared_ptr<Camera> camera, float screenHeight);
+
+	// Draws just the mesh's position stream, with the given (already
+	// active) depth only shader.  Meshes without one draw nothing.
+	void DrawDepth(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, std::shared_ptr<Camera> camera, std::shared_ptr<SimpleVertexShader> depthVS, float screenHeight);
 
 private:
+	int SelectLod(std::shared_ptr<Camera> camera, float screenHeight);
 
 	std::shared_ptr<Mesh> mesh;
 	std::shared_ptr<Material> material;
 	Transform transform;
+	bool isStatic;
+
+	AxisAlignedBox worldBounds;
+	unsigned int worldBoundsVersion;
+
+	// World matrices (and such) on the GPU, only rewritten
+	// after the transform or mesh changes
+	ConstantBufferSlot objectConstants;
 };
 
@@ -0,0 +1,724 @@
+#include "GlbFile.h"
+#include "Mesh.h"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <utility>
+
+using namespace DirectX;
+
+// GLB container identifiers
+static const unsigned int GlbMagic = 0x46546C67;		// "glTF"
+static const unsigned int GlbChunkJson = 0x4E4F534A;	// "JSON"
+static const unsigned int GlbChunkBin = 0x004E4942;		// "BIN\0"
+
+// glTF component types (the matching GL enums)
+static const unsigned int ComponentUnsignedByte = 5121;
+static const unsigned int ComponentUnsignedShort = 5123;
+static const unsigned int ComponentUnsignedInt = 5125;
+static const unsigned int ComponentFloat = 5126;
+
+// Nesting deeper than this is rejected rather than recursed into
+static const int MaxJsonDepth = 64;
+
+// --------------------------------------------------------
+// Just enough of a JSON document model to read glTF: values
+// are parsed into a tree, and looking up a missing member
+// or element gives a null value instead of failing, so
+// optional properties can be chained freely.
+// --------------------------------------------------------
+enum JsonType
+{
+	JsonType_Null,
+	JsonType_Bool,
+	JsonType_Number,
+	JsonType_String,
+	JsonType_Array,
+	JsonType_Object
+};
+
+struct JsonValue
+{
+	JsonType Type = JsonType_Null;
+	bool Bool = false;
+	double Number = 0.0;
+	std::string String;
+	std::vector<JsonValue> Elements;
+	std::vector<std::pair<std::string, JsonValue>> Members;
+
+	const JsonValue& operator[](const char* key) const;
+	const JsonValue& operator[](size_t index) const;
+	size_t Size() const { return Type == JsonType_Array ? Elements.size() : 0; }
+	bool IsNumber() const { return Type == JsonType_Number; }
+
+	// For counts, offsets and indices: anything present that isn't a
+	// whole number in range gives SIZE_MAX, which fails later checks
+	size_t UIntOr(size_t fallback) const
+	{
+		if (Type == JsonType_Null)
+			return fallback;
+		if (Type != JsonType_Number || !(Number >= 0.0 && Number <= 4294967295.0) || Number != floor(Number))
+			return SIZE_MAX;
+		return (size_t)Number;
+	}
+};
+
+static const JsonValue JsonNull;
+
+const JsonValue& JsonValue::operator[](const char* key) const
+{
+	if (Type == JsonType_Object)
+		for (auto& member : Members)
+			if (member.first == key)
+				return member.second;
+	return JsonNull;
+}
+
+const JsonValue& JsonValue::operator[](size_t index) const
+{
+	return Type == JsonType_Array && index < Elements.size() ? Elements[index] : JsonNull;
+}
+
+static const char* SkipJsonWhitespace(const char* p, const char* end)
+{
+	while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r'))
+		p++;
+	return p;
+}
+
+// Parses a string starting at its opening quote, and returns a pointer
+// just past the closing quote, or 0 on failure
+static const char* ParseJsonString(const char* p, const char* end, std::string& out)
+{
+	if (p >= end || *p != '"')
+		return 0;
+	p++;
+
+	out.clear();
+	while (p < end && *p != '"')
+	{
+		if (*p != '\\')
+		{
+			out += *p++;
+			continue;
+		}
+
+		if (++p >= end)
+			return 0;
+		switch (*p++)
+		{
+		case '"': out += '"'; break;
+		case '\\': out += '\\'; break;
+		case '/': out += '/'; break;
+		case 'b': out += '\b'; break;
+		case 'f': out += '\f'; break;
+		case 'n': out += '\n'; break;
+		case 'r': out += '\r'; break;
+		case 't': out += '\t'; break;
+		case 'u':
+		{
+			// Code points are written as UTF-8 (surrogate pairs aren't
+			// combined, as nothing we look up needs them)
+			if (end - p < 4)
+				return 0;
+			unsigned int code = 0;
+			for (int i = 0; i < 4; i++, p++)
+			{
+				char c = *p;
+				unsigned int digit =
+					c >= '0' && c <= '9' ? c - '0' :
+					c >= 'a' && c <= 'f' ? c - 'a' + 10 :
+					c >= 'A' && c <= 'F' ? c - 'A' + 10 : 16;
+				if (digit == 16)
+					return 0;
+				code = code * 16 + digit;
+			}
+			if (code < 0x80)
+				out += (char)code;
+			else if (code < 0x800)
+			{
+				out += (char)(0xC0 | (code >> 6));
+				out += (char)(0x80 | (code & 0x3F));
+			}
+			else
+			{
+				out += (char)(0xE0 | (code >> 12));
+				out += (char)(0x80 | ((code >> 6) & 0x3F));
+				out += (char)(0x80 | (code & 0x3F));
+			}
+			break;
+		}
+		default:
+			return 0;
+		}
+	}
+	return p < end ? p + 1 : 0;
+}
+
+// Numbers are parsed by hand (like the OBJ parser does) so the
+// result doesn't depend on the locale
+static const char* ParseJsonNumber(const char* p, const char* end, double& out)
+{
+	const char* start = p;
+	bool negative = p < end && *p == '-';
+	if (negative)
+		p++;
+
+	double mantissa = 0.0;
+	int exponent = 0;
+	bool anyDigits = false;
+	for (; p < end && *p >= '0' && *p <= '9'; p++, anyDigits = true)
+		mantissa = mantissa * 10.0 + (*p - '0');
+	if (p < end && *p == '.')
+	{
+		for (p++; p < end && *p >= '0' && *p <= '9'; p++, anyDigits = true)
+		{
+			mantissa = mantissa * 10.0 + (*p - '0');
+			exponent--;
+		}
+	}
+	if (!anyDigits)
+		return 0;
+
+	if (p < end && (*p == 'e' || *p == 'E'))
+	{
+		p++;
+		bool negativeExponent = p < end && *p == '-';
+		if (p < end && (*p == '-' || *p == '+'))
+			p++;
+		int value = 0;
+		bool exponentDigits = false;
+		for (; p < end && *p >= '0' && *p <= '9'; p++, exponentDigits = true)
+			value = (std::min)(value * 10 + (*p - '0'), 10000);
+		if (!exponentDigits)
+			return 0;
+		exponent += negativeExponent ? -value : value;
+	}
+
+	out = mantissa * pow(10.0, exponent);
+	if (negative)
+		out = -out;
+	return p > start ? p : 0;
+}
+
+// Parses any value, returning a pointer just past it or 0 on failure
+static const char* ParseJsonValue(const char* p, const char* end, JsonValue& out, int depth)
+{
+	p = SkipJsonWhitespace(p, end);
+	if (p >= end || depth > MaxJsonDepth)
+		return 0;
+
+	switch (*p)
+	{
+	case '{':
+		out.Type = JsonType_Object;
+		p = SkipJsonWhitespace(p + 1, end);
+		if (p < end && *p == '}')
+			return p + 1;
+		while (p)
+		{
+			out.Members.emplace_back();
+			auto& member = out.Members.back();
+			p = ParseJsonString(SkipJsonWhitespace(p, end), end, member.first);
+			if (!p)
+				return 0;
+			p = SkipJsonWhitespace(p, end);
+			if (p >= end || *p != ':')
+				return 0;
+			p = ParseJsonValue(p + 1, end, member.second, depth + 1);
+			if (!p)
+				return 0;
+			p = SkipJsonWhitespace(p, end);
+			if (p < end && *p == '}')
+				return p + 1;
+			if (p >= end || *p != ',')
+				return 0;
+			p++;
+		}
+		return 0;
+
+	case '[':
+		out.Type = JsonType_Array;
+		p = SkipJsonWhitespace(p + 1, end);
+		if (p < end && *p == ']')
+			return p + 1;
+		while (p)
+		{
+			out.Elements.emplace_back();
+			p = ParseJsonValue(p, end, out.Elements.back(), depth + 1);
+			if (!p)
+				return 0;
+			p = SkipJsonWhitespace(p, end);
+			if (p < end && *p == ']')
+				return p + 1;
+			if (p >= end || *p != ',')
+				return 0;
+			p++;
+		}
+		return 0;
+
+	case '"':
+		out.Type = JsonType_String;
+		return ParseJsonString(p, end, out.String);
+
+	case 't':
+	case 'f':
+	case 'n':
+	{
+		const char* word = *p == 't' ? "true" : *p == 'f' ? "false" : "null";
+		size_t length = strlen(word);
+		if ((size_t)(end - p) < length || memcmp(p, word, length) != 0)
+			return 0;
+		out.Type = *p == 'n' ? JsonType_Null : JsonType_Bool;
+		out.Bool = *p == 't';
+		return p + length;
+	}
+
+	default:
+		out.Type = JsonType_Number;
+		return ParseJsonNumber(p, end, out.Number);
+	}
+}
+
+// Little endian 32 bit value at any alignment
+static unsigned int ReadUInt(const unsigned char* p)
+{
+	unsigned int value;
+	memcpy(&value, p, sizeof(value));
+	return value;
+}
+
+static unsigned int ComponentSize(unsigned int componentType)
+{
+	switch (componentType)
+	{
+	case ComponentUnsignedByte: return 1;
+	case ComponentUnsignedShort: return 2;
+	case ComponentUnsignedInt:
+	case ComponentFloat: return 4;
+	default: return 0;
+	}
+}
+
+static unsigned int ComponentCount(const std::string& type)
+{
+	if (type == "SCALAR") return 1;
+	if (type == "VEC2") return 2;
+	if (type == "VEC3") return 3;
+	if (type == "VEC4") return 4;
+	return 0;
+}
+
+// --------------------------------------------------------
+// Follows an accessor (by its index in the document) to its
+// data in the binary chunk, checking every element is in
+// bounds.  Sparse accessors and external buffers aren't
+// supported.
+// --------------------------------------------------------
+static bool ResolveAccessor(const JsonValue& root, const JsonValue& accessorIndex, const unsigned char* bin, size_t binSize, GlbAccessor& out)
+{
+	if (!accessorIndex.IsNumber())
+		return false;
+
+	const JsonValue& accessor = root["accessors"][accessorIndex.UIntOr(SIZE_MAX)];
+	const JsonValue& view = root["bufferViews"][accessor["bufferView"].UIntOr(SIZE_MAX)];
+	if (view.Type != JsonType_Object || accessor["sparse"].Type != JsonType_Null || view["buffer"].UIntOr(SIZE_MAX) != 0 || !bin)
+		return false;
+
+	out.ComponentType = (unsigned int)(std::min)(accessor["componentType"].UIntOr(0), (size_t)UINT_MAX);
+	out.Components = ComponentCount(accessor["type"].String);
+	out.Count = accessor["count"].UIntOr(0);
+	size_t elementSize = ComponentSize(out.ComponentType) * out.Components;
+	out.Stride = view["byteStride"].UIntOr(elementSize);
+	if (elementSize == 0 || out.Count == 0 || out.Stride < elementSize)
+		return false;
+
+	// The view must fit in the chunk, and the last element in the view
+	size_t viewOffset = view["byteOffset"].UIntOr(0);
+	size_t viewLength = view["byteLength"].UIntOr(0);
+	size_t accessorOffset = accessor["byteOffset"].UIntOr(0);
+	if (viewOffset > binSize || viewLength > binSize - viewOffset ||
+		accessorOffset > viewLength ||
+		(out.Count - 1) > (viewLength - accessorOffset) / out.Stride ||
+		accessorOffset + (out.Count - 1) * out.Stride + elementSize > viewLength)
+		return false;
+
+	out.Data = bin + viewOffset + accessorOffset;
+	return true;
+}
+
+
+GlbFile::GlbFile(const char* glbFile) :
+	file(glbFile),
+	valid(false),
+	loaded(false),
+	leftHanded(false),
+	position(),
+	uv(),
+	normal(),
+	tangent(),
+	index()
+{
+	// 12 byte header, then the JSON chunk's 8 byte header
+	const unsigned char* data = (const unsigned char*)file.GetData();
+	size_t size = file.GetSize();
+	if (!file.IsOpen() || size < 20 ||
+		ReadUInt(data) != GlbMagic || ReadUInt(data + 4) != 2 ||
+		ReadUInt(data + 8) > size)
+		return;
+	size = ReadUInt(data + 8);
+
+	size_t jsonSize = ReadUInt(data + 12);
+	if (ReadUInt(data + 16) != GlbChunkJson || jsonSize > size - 20)
+		return;
+	const char* json = (const char*)data + 20;
+
+	// The binary chunk is optional (it's 4 byte aligned, as the
+	// JSON chunk is padded)
+	const unsigned char* bin = 0;
+	size_t binSize = 0;
+	size_t binHeader = 20 + ((jsonSize + 3) & ~(size_t)3);
+	if (binHeader + 8 <= size && ReadUInt(data + binHeader + 4) == GlbChunkBin)
+	{
+		binSize = ReadUInt(data + binHeader);
+		if (binSize > size - binHeader - 8)
+			return;
+		bin = data + binHeader + 8;
+	}
+
+	valid = Parse(json, jsonSize, bin, binSize);
+}
+
+bool GlbFile::Parse(const char* json, size_t jsonSize, const unsigned char* bin, size_t binSize)
+{
+	JsonValue root;
+	if (!ParseJsonValue(json, json + jsonSize, root, 0) || root.Type != JsonType_Object)
+		return false;
+
+	leftHanded = root["asset"]["extras"]["leftHanded"].Bool;
+
+	// First triangle list in the first mesh
+	const JsonValue& primitives = root["meshes"][(size_t)0]["primitives"];
+	const JsonValue* primitive = 0;
+	for (size_t i = 0; i < primitives.Size() && !primitive; i++)
+		if (primitives[i]["mode"].UIntOr(4) == 4)
+			primitive = &primitives[i];
+	if (!primitive)
+		return false;
+
+	// Positions are required, and everything else has to match them
+	const JsonValue& attributes = (*primitive)["attributes"];
+	if (!ResolveAccessor(root, attributes["POSITION"], bin, binSize, position) ||
+		position.ComponentType != ComponentFloat || position.Components != 3)
+		return false;
+
+	struct Optional { const char* Name; GlbAccessor* Accessor; unsigned int MinComponents; unsigned int MaxComponents; };
+	Optional optional[] =
+	{
+		{ "TEXCOORD_0", &uv, 2, 2 },
+		{ "NORMAL", &normal, 3, 3 },
+		{ "TANGENT", &tangent, 3, 4 },	// Only VEC4 is standard, but VEC3 is what Vertex holds
+	};
+	for (auto& o : optional)
+	{
+		const JsonValue& accessorIndex = attributes[o.Name];
+		if (accessorIndex.Type == JsonType_Null)
+			continue;
+		if (!ResolveAccessor(root, accessorIndex, bin, binSize, *o.Accessor) ||
+			o.Accessor->ComponentType != ComponentFloat ||
+			o.Accessor->Components < o.MinComponents || o.Accessor->Components > o.MaxComponents ||
+			o.Accessor->Count != position.Count)
+			return false;
+	}
+
+	if ((*primitive)["indices"].Type != JsonType_Null &&
+		(!ResolveAccessor(root, (*primitive)["indices"], bin, binSize, index) ||
+		index.Components != 1 || index.ComponentType == ComponentFloat))
+		return false;
+
+	return GetIndexCount() % 3 == 0 && GetIndexCount() > 0;
+}
+
+
+bool GlbFile::VerticesInPlace()
+{
+	const unsigned char* base = position.Data;
+	return
+		valid && leftHanded &&
+		((size_t)base % 4) == 0 &&
+		position.Stride == sizeof(Vertex) &&
+		uv.Data == base + offsetof(Vertex, UV) && uv.Stride == sizeof(Vertex) &&
+		normal.Data == base + offsetof(Vertex, Normal) && normal.Stride == sizeof(Vertex) &&
+		tangent.Data == base + offsetof(Vertex, Tangent) && tangent.Stride == sizeof(Vertex) && tangent.Components == 3;
+}
+
+bool GlbFile::IndicesInPlace()
+{
+	return
+		valid && leftHanded &&
+		index.Data && ((size_t)index.Data % 4) == 0 &&
+		index.ComponentType == ComponentUnsignedInt && index.Stride == sizeof(unsigned int);
+}
+
+
+// --------------------------------------------------------
+// Either checks the in place data, or converts the file's
+// data to the engine's layout and coordinate system
+// --------------------------------------------------------
+bool GlbFile::Load()
+{
+	if (!valid)
+		return false;
+	if (loaded)
+		return true;
+
+	// Indices first, as they're needed for any missing normals
+	// or tangents
+	size_t vertexCount = position.Count;
+	size_t indexCount = GetIndexCount();
+	if (!IndicesInPlace())
+	{
+		convertedIndices.resize(indexCount);
+		for (size_t i = 0; i < indexCount; i++)
+		{
+			if (!index.Data)
+				convertedIndices[i] = (unsigned int)i;
+			else if (index.ComponentType == ComponentUnsignedByte)
+				convertedIndices[i] = index.Data[i * index.Stride];
+			else if (index.ComponentType == ComponentUnsignedShort)
+			{
+				unsigned short value;
+				memcpy(&value, index.Data + i * index.Stride, sizeof(value));
+				convertedIndices[i] = value;
+			}
+			else
+				convertedIndices[i] = ReadUInt(index.Data + i * index.Stride);
+		}
+
+		// Mirroring the positions (below) turns the triangles inside out
+		if (!leftHanded)
+			for (size_t i = 0; i < indexCount; i += 3)
+				std::swap(convertedIndices[i + 1], convertedIndices[i + 2]);
+	}
+
+	const unsigned int* indices = convertedIndices.empty() ? (const unsigned int*)index.Data : &convertedIndices[0];
+	for (size_t i = 0; i < indexCount; i++)
+		if (indices[i] >= vertexCount)
+			return false;
+
+	if (!VerticesInPlace())
+	{
+		// Copy each attribute that's there (any alignment)
+		convertedVertices.assign(vertexCount, Vertex());
+		for (size_t v = 0; v < vertexCount; v++)
+		{
+			Vertex& vert = convertedVertices[v];
+			memcpy(&vert.Position, position.Data + v * position.Stride, sizeof(XMFLOAT3));
+			if (uv.Data) memcpy(&vert.UV, uv.Data + v * uv.Stride, sizeof(XMFLOAT2));
+			if (normal.Data) memcpy(&vert.Normal, normal.Data + v * normal.Stride, sizeof(XMFLOAT3));
+			if (tangent.Data) memcpy(&vert.Tangent, tangent.Data + v * tangent.Stride, sizeof(XMFLOAT3));
+
+			// Right-handed to left-handed (glTF's UVs already start at
+			// the top left, like Direct3D's)
+			if (!leftHanded)
+			{
+				vert.Position.z *= -1.0f;
+				vert.Normal.z *= -1.0f;
+				vert.Tangent.z *= -1.0f;
+			}
+		}
+
+		// Smooth normals (weighted by triangle area) if there aren't any
+		if (!normal.Data)
+		{
+			for (size_t i = 0; i < indexCount; i += 3)
+			{
+				Vertex& v0 = convertedVertices[indices[i]];
+				Vertex& v1 = convertedVertices[indices[i + 1]];
+				Vertex& v2 = convertedVertices[indices[i + 2]];
+				XMVECTOR p0 = XMLoadFloat3(&v0.Position);
+				XMVECTOR faceNormal = XMVector3Cross(XMLoadFloat3(&v1.Position) - p0, XMLoadFloat3(&v2.Position) - p0);
+				for (Vertex* vert : { &v0, &v1, &v2 })
+					XMStoreFloat3(&vert->Normal, XMLoadFloat3(&vert->Normal) + faceNormal);
+			}
+			for (auto& vert : convertedVertices)
+				XMStoreFloat3(&vert.Normal, XMVector3Normalize(XMLoadFloat3(&vert.Normal)));
+		}
+
+		// (The indices are only read, even if they're in the file)
+		if (!tangent.Data)
+			Mesh::CalculateTangents(&convertedVertices[0], (int)vertexCount, (unsigned int*)indices, (int)indexCount);
+	}
+
+	return loaded = true;
+}
+
+const Vertex* GlbFile::GetVertices()
+{
+	if (!loaded)
+		return 0;
+	if (!convertedVertices.empty())
+		return &convertedVertices[0];
+	return (const Vertex*)position.Data;
+}
+
+const unsigned int* GlbFile::GetIndices()
+{
+	if (!loaded)
+		return 0;
+	if (!convertedIndices.empty())
+		return &convertedIndices[0];
+	return (const unsigned int*)index.Data;
+}
+
+
+// --------------------------------------------------------
+// Writes a .glb with one mesh of one primitive.  Standard
+// files get their own tightly packed view per attribute,
+// VEC4 tangents, and are converted to right-handed space
+// (with 16 bit indices when they fit).  In place files
+// hold the vertices and indices exactly as given.
+// --------------------------------------------------------
+bool GlbFile::Write(const char* glbFile, const Vertex* vertices, int numVerts, const unsigned int* indices, int numIndices, bool inPlaceLayout)
+{
+	if (numVerts <= 0 || numIndices <= 0 || numIndices % 3 != 0)
+		return false;
+
+	// Binary chunk contents, and the JSON describing them
+	std::vector<unsigned char> bin;
+	std::string views;
+	std::string accessors;
+	auto addView = [&](const void* data, size_t bytes, size_t stride, unsigned int target)
+	{
+		// Views start on 4 byte boundaries
+		bin.resize((bin.size() + 3) & ~(size_t)3);
+		char text[160];
+		snprintf(text, sizeof(text), "%s{\"buffer\":0,\"byteOffset\":%zu,\"byteLength\":%zu%s,\"target\":%u}",
+			views.empty() ? "" : ",", bin.size(), bytes, stride ? (",\"byteStride\":" + std::to_string(stride)).c_str() : "", target);
+		views += text;
+		bin.insert(bin.end(), (const unsigned char*)data, (const unsigned char*)data + bytes);
+	};
+	int viewCount = 0;
+	int accessorCount = 0;
+	auto addAccessor = [&](int view, size_t offset, unsigned int componentType, size_t count, const char* type, const std::string& extra)
+	{
+		char text[256];
+		snprintf(text, sizeof(text), "%s{\"bufferView\":%d,\"byteOffset\":%zu,\"componentType\":%u,\"count\":%zu,\"type\":\"%s\"%s}",
+			accessors.empty() ? "" : ",", view, offset, componentType, count, type, extra.c_str());
+		accessors += text;
+		return accessorCount++;
+	};
+
+	// Positions need their bounds (in the space they're written in)
+	float zSign = inPlaceLayout ? 1.0f : -1.0f;
+	XMFLOAT3 boundsMin(vertices[0].Position.x, vertices[0].Position.y, vertices[0].Position.z * zSign);
+	XMFLOAT3 boundsMax = boundsMin;
+	for (int i = 1; i < numVerts; i++)
+	{
+		XMFLOAT3 p(vertices[i].Position.x, vertices[i].Position.y, vertices[i].Position.z * zSign);
+		boundsMin = XMFLOAT3((std::min)(boundsMin.x, p.x), (std::min)(boundsMin.y, p.y), (std::min)(boundsMin.z, p.z));
+		boundsMax = XMFLOAT3((std::max)(boundsMax.x, p.x), (std::max)(boundsMax.y, p.y), (std::max)(boundsMax.z, p.z));
+	}
+	char bounds[192];
+	snprintf(bounds, sizeof(bounds), ",\"min\":[%.9g,%.9g,%.9g],\"max\":[%.9g,%.9g,%.9g]",
+		boundsMin.x, boundsMin.y, boundsMin.z, boundsMax.x, boundsMax.y, boundsMax.z);
+
+	int positionAccessor, uvAccessor, normalAccessor, tangentAccessor, indexAccessor;
+	if (inPlaceLayout)
+	{
+		// Everything exactly as it is in memory
+		addView(vertices, sizeof(Vertex) * numVerts, sizeof(Vertex), 34962);
+		int view = viewCount++;
+		positionAccessor = addAccessor(view, offsetof(Vertex, Position), ComponentFloat, numVerts, "VEC3", bounds);
+		uvAccessor = addAccessor(view, offsetof(Vertex, UV), ComponentFloat, numVerts, "VEC2", "");
+		normalAccessor = addAccessor(view, offsetof(Vertex, Normal), ComponentFloat, numVerts, "VEC3", "");
+		tangentAccessor = addAccessor(view, offsetof(Vertex, Tangent), ComponentFloat, numVerts, "VEC3", "");
+
+		addView(indices, sizeof(unsigned int) * numIndices, 0, 34963);
+		indexAccessor = addAccessor(viewCount++, 0, ComponentUnsignedInt, numIndices, "SCALAR", "");
+	}
+	else
+	{
+		// Split into separate arrays, mirrored to right-handed
+		std::vector<XMFLOAT3> positions(numVerts), normals(numVerts);
+		std::vector<XMFLOAT2> uvs(numVerts);
+		std::vector<XMFLOAT4> tangents(numVerts);
+		for (int i = 0; i < numVerts; i++)
+		{
+			const Vertex& v = vertices[i];
+			positions[i] = XMFLOAT3(v.Position.x, v.Position.y, -v.Position.z);
+			uvs[i] = v.UV;
+			normals[i] = XMFLOAT3(v.Normal.x, v.Normal.y, -v.Normal.z);
+			tangents[i] = XMFLOAT4(v.Tangent.x, v.Tangent.y, -v.Tangent.z, 1.0f);
+		}
+
+		addView(&positions[0], sizeof(XMFLOAT3) * numVerts, 0, 34962);
+		positionAccessor = addAccessor(viewCount++, 0, ComponentFloat, numVerts, "VEC3", bounds);
+		addView(&uvs[0], sizeof(XMFLOAT2) * numVerts, 0, 34962);
+		uvAccessor = addAccessor(viewCount++, 0, ComponentFloat, numVerts, "VEC2", "");
+		addView(&normals[0], sizeof(XMFLOAT3) * numVerts, 0, 34962);
+		normalAccessor = addAccessor(viewCount++, 0, ComponentFloat, numVerts, "VEC3", "");
+		addView(&tangents[0], sizeof(XMFLOAT4) * numVerts, 0, 34962);
+		tangentAccessor = addAccessor(viewCount++, 0, ComponentFloat, numVerts, "VEC4", "");
+
+		// Counter-clockwise, and as small as possible
+		std::vector<unsigned int> flipped(indices, indices + numIndices);
+		for (int i = 0; i < numIndices; i += 3)
+			std::swap(flipped[i + 1], flipped[i + 2]);
+		if (numVerts <= 65536)
+		{
+			std::vector<unsigned short> shortIndices(flipped.begin(), flipped.end());
+			addView(&shortIndices[0], sizeof(unsigned short) * numIndices, 0, 34963);
+			indexAccessor = addAccessor(viewCount++, 0, ComponentUnsignedShort, numIndices, "SCALAR", "");
+		}
+		else
+		{
+			addView(&flipped[0], sizeof(unsigned int) * numIndices, 0, 34963);
+			indexAccessor = addAccessor(viewCount++, 0, ComponentUnsignedInt, numIndices, "SCALAR", "");
+		}
+	}
+	bin.resize((bin.size() + 3) & ~(size_t)3);
+
+	char mesh[256];
+	snprintf(mesh, sizeof(mesh),
+		"\"meshes\":[{\"primitives\":[{\"attributes\":{\"POSITION\":%d,\"TEXCOORD_0\":%d,\"NORMAL\":%d,\"TANGENT\":%d},\"indices\":%d,\"mode\":4}]}]",
+		positionAccessor, uvAccessor, normalAccessor, tangentAccessor, indexAccessor);
+	std::string json =
+		std::string("{\"asset\":{\"version\":\"2.0\"") + (inPlaceLayout ? ",\"extras\":{\"leftHanded\":true}" : "") + "}," +
+		mesh + "," +
+		"\"accessors\":[" + accessors + "]," +
+		"\"bufferViews\":[" + views + "]," +
+		"\"buffers\":[{\"byteLength\":" + std::to_string(bin.size()) + "}]}";
+
+	// The JSON chunk is padded with spaces
+	json.resize((json.size() + 3) & ~(size_t)3, ' ');
+
+	unsigned int header[5] =
+	{
+		GlbMagic,
+		2,
+		(unsigned int)(12 + 8 + json.size() + 8 + bin.size()),
+		(unsigned int)json.size(),
+		GlbChunkJson
+	};
+	unsigned int binHeader[2] = { (unsigned int)bin.size(), GlbChunkBin };
+
+	FILE* out = 0;
+	if (fopen_s(&out, glbFile, "wb") != 0 || !out)
+		return false;
+	bool ok =
+		fwrite(header, sizeof(header), 1, out) == 1 &&
+		fwrite(json.data(), 1, json.size(), out) == json.size() &&
+		fwrite(binHeader, sizeof(binHeader), 1, out) == 1 &&
+		fwrite(&bin[0], 1, bin.size(), out) == bin.size();
+	ok = (fclose(out) == 0) && ok;
+	if (!ok)
+		remove(glbFile);
+	return ok;
+}
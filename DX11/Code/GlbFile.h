@@ -0,0 +1,90 @@
+#pragma once
+
+#include <vector>
+
+#include "MappedFile.h"
+#include "Vertex.h"
+
+// --------------------------------------------------------
+// Where one glTF accessor's elements are in the binary
+// chunk, after following its buffer view
+// --------------------------------------------------------
+struct GlbAccessor
+{
+	const unsigned char* Data;	// First element, or 0 if there's no such accessor
+	size_t Count;
+	size_t Stride;				// Bytes from one element to the next
+	unsigned int ComponentType;	// GL enum (5126 = float, 5125 = uint, etc.)
+	unsigned int Components;	// 1 for SCALAR, 2 for VEC2, etc.
+};
+
+// --------------------------------------------------------
+// A binary glTF 2.0 (.glb) file, memory mapped
+//
+// Only the JSON chunk is parsed, to find the first triangle
+// primitive of the first mesh.  Its attributes are read
+// straight out of the mapped binary chunk.
+//
+// Standard glTF is right-handed with counter-clockwise front
+// faces, so it's converted the same way as OBJ files (Z is
+// negated and the winding is flipped) into a copy.  Files
+// exported for this engine can skip that - when the asset's
+// "extras" has "leftHanded": true, and the data is already
+// laid out like Vertex (interleaved POSITION, TEXCOORD_0,
+// NORMAL and a VEC3 TANGENT, at the same offsets, 44 bytes
+// apart) and the indices are 32 bit, nothing is copied at
+// all: GetVertices() and GetIndices() point into the file.
+//
+// Missing tangents are calculated (which needs a copy), and
+// missing indices are generated.
+// --------------------------------------------------------
+class GlbFile
+{
+public:
+	// Maps the file and parses its JSON chunk
+	GlbFile(const char* glbFile);
+
+	// Mapped views own OS handles, so they can't be copied
+	GlbFile(const GlbFile&) = delete;
+	GlbFile& operator=(const GlbFile&) = delete;
+
+	bool IsValid() { return valid; }
+
+	// Makes the vertices and indices available, converting them
+	// if necessary.  Fails if any index is out of range.
+	bool Load();
+
+	// Pointers into the mapped file itself (or the converted
+	// copies) - only valid after Load(), while this object lives
+	const Vertex* GetVertices();
+	const unsigned int* GetIndices();
+	int GetVertexCount() { return (int)position.Count; }
+	int GetIndexCount() { return index.Data ? (int)index.Count : (int)position.Count; }
+
+	// Whether Load() could use the file's data without copying it
+	bool VerticesInPlace();
+	bool IndicesInPlace();
+	bool HasTangents() { return tangent.Data != 0; }
+
+	// Writes a single mesh as a .glb, either as standard glTF or
+	// laid out for loading in place
+	static bool Write(const char* glbFile, const Vertex* vertices, int numVerts, const unsigned int* indices, int numIndices, bool inPlaceLayout);
+
+private:
+	MappedFile file;
+	bool valid;
+	bool loaded;
+	bool leftHanded;
+
+	GlbAccessor position;
+	GlbAccessor uv;
+	GlbAccessor normal;
+	GlbAccessor tangent;
+	GlbAccessor index;
+
+	// Only used when the data can't be used in place
+	std::vector<Vertex> convertedVertices;
+	std::vector<unsigned int> convertedIndices;
+
+	bool Parse(const char* json, size_t jsonSize, const unsigned char* bin, size_t binSize);
+};
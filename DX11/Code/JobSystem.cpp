@@ -0,0 +1,156 @@
+#include "JobSystem.h"
+
+#include <algorithm>
+
+// Singleton requirement
+JobSystem* JobSystem::instance;
+
+// Workers number themselves from 1, leaving 0 for everyone else
+static thread_local unsigned int threadIndex = 0;
+
+
+JobSystem::JobSystem() :
+	shuttingDown(false)
+{
+	// Leave one core for the main thread
+	unsigned int cores = std::thread::hardware_concurrency();
+	unsigned int workerCount = cores > 1 ? cores - 1 : 0;
+
+	for (unsigned int i = 0; i < workerCount; i++)
+		workers.push_back(std::thread(&JobSystem::WorkerLoop, this, i + 1));
+}
+
+void JobSystem::Shutdown()
+{
+	// Jobs still running can use the pool until the workers are
+	// joined, and only then is the pointer cleared
+	delete instance;
+	instance = 0;
+}
+
+JobSystem::~JobSystem()
+{
+	// Wake everyone up and wait for them to finish
+	{
+		std::lock_guard<std::mutex> lock(jobMutex);
+		shuttingDown = true;
+	}
+	jobAvailable.notify_all();
+
+	for (auto& w : workers)
+		w.join();
+}
+
+
+void JobSystem::ParallelFor(unsigned int count, const std::function<void(unsigned int)>& func)
+{
+	// Not worth the overhead?
+	if (count == 1 || workers.empty())
+	{
+		for (unsigned int i = 0; i < count; i++)
+			func(i);
+		return;
+	}
+
+	// Queue up the whole batch at once
+	Batch batch;
+	batch.Func = &func;
+	batch.Count = count;
+	batch.Next = 0;
+	batch.Remaining = count;
+	{
+		std::lock_guard<std::mutex> lock(jobMutex);
+		if (threadIndex == 0)
+			batches.push_front(&batch);
+		else
+			batches.push_back(&batch);
+	}
+	jobAvailable.notify_all();
+
+	// Work through our own batch alongside the workers
+	for (unsigned int i = batch.Next++; i < count; i = batch.Next++)
+	{
+		func(i);
+		batch.Remaining--;
+	}
+
+	// Every index is taken, so make sure no one else can find the
+	// batch, then wait for any still running elsewhere
+	{
+		std::lock_guard<std::mutex> lock(jobMutex);
+		auto it = std::find(batches.begin(), batches.end(), &batch);
+		if (it != batches.end())
+			batches.erase(it);
+	}
+	while (batch.Remaining > 0)
+		std::this_thread::yield();
+}
+
+
+void JobSystem::RunInBackground(const std::function<void()>& job)
+{
+	if (workers.empty())
+	{
+		job();
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(jobMutex);
+		backgroundJobs.push_back(job);
+	}
+	jobAvailable.notify_one();
+}
+
+
+unsigned int JobSystem::GetThreadIndex()
+{
+	return threadIndex;
+}
+
+
+void JobSystem::WorkerLoop(unsigned int index)
+{
+	threadIndex = index;
+	while (true)
+	{
+		Batch* batch = 0;
+		unsigned int batchIndex = 0;
+		std::function<void()> job;
+		{
+			// Sleep until there's something to do
+			std::unique_lock<std::mutex> lock(jobMutex);
+			jobAvailable.wait(lock, [this]() { return shuttingDown || !batches.empty() || !backgroundJobs.empty(); });
+			if (shuttingDown && batches.empty())
+				return;
+
+			// Background work waits for every batch to be handed out
+			if (!batches.empty())
+			{
+				// Whoever takes (or finds) the last index removes the
+				// batch, while it's still safe to touch
+				batch = batches.front();
+				batchIndex = batch->Next++;
+				if (batchIndex + 1 >= batch->Count)
+					batches.pop_front();
+				if (batchIndex >= batch->Count)
+					continue;
+			}
+			else
+			{
+				job = std::move(backgroundJobs.front());
+				backgroundJobs.pop_front();
+			}
+		}
+
+		if (batch)
+		{
+			(*batch->Func)(batchIndex);
+			batch->Remaining--;
+		}
+		else
+		{
+			job();
+		}
+	}
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// --------------------------------------------------------
+// A small pool of worker threads (one per extra core) that
+// runs jobs from a shared queue.
+//
+// Each ParallelFor() is queued as one batch, and the calling
+// thread works through its own batch while it waits (never
+// anyone else's), so it's safe to call from inside another
+// job, and a batch started by background work can't end up
+// being run by the main thread mid-frame.  Batches from the
+// main thread go to the front of the queue.
+//
+// Background jobs (long running work like loading files)
+// have their own queue, which only the workers take from,
+// and only when there are no batches - so they never hold
+// up a ParallelFor() on the main thread.
+// --------------------------------------------------------
+class JobSystem
+{
+#pragma region Singleton
+public:
+	// Gets the one and only instance of this class
+	static JobSystem& GetInstance()
+	{
+		if (!instance)
+		{
+			instance = new JobSystem();
+		}
+
+		return *instance;
+	}
+
+	// Remove these functions (C++ 11 version)
+	JobSystem(JobSystem const&) = delete;
+	void operator=(JobSystem const&) = delete;
+
+	// Finishes any running jobs, stops the workers and frees the
+	// instance.  Anything still queued is dropped.
+	static void Shutdown();
+
+private:
+	static JobSystem* instance;
+	JobSystem();
+	~JobSystem();
+#pragma endregion
+
+public:
+
+	// Total threads that can run jobs, including the caller of ParallelFor()
+	unsigned int GetThreadCount() { return (unsigned int)workers.size() + 1; }
+
+	// Which thread this is, from 0 up to GetThreadCount() - 1.  The
+	// main thread (or any other that isn't a worker) is always 0.
+	static unsigned int GetThreadIndex();
+
+	// Runs func(i) for every i in [0, count) and returns once all are done
+	void ParallelFor(unsigned int count, const std::function<void(unsigned int)>& func);
+
+	// Queues a job and returns right away.  Without any workers, the
+	// job is run before returning instead.  Jobs still queued when the
+	// system shuts down are dropped.
+	void RunInBackground(const std::function<void()>& job);
+
+private:
+	// One ParallelFor() call, which lives on its caller's stack.
+	// Indices are handed out in order to whoever asks next.
+	struct Batch
+	{
+		const std::function<void(unsigned int)>* Func;
+		unsigned int Count;
+		std::atomic<unsigned int> Next;
+		std::atomic<unsigned int> Remaining;
+	};
+
+	std::vector<std::thread> workers;
+	std::deque<Batch*> batches;		// Only those with indices left to hand out
+	std::deque<std::function<void()>> backgroundJobs;
+	std::mutex jobMutex;
+	std::condition_variable jobAvailable;
+	bool shuttingDown;
+
+	void WorkerLoop(unsigned int index);
+};
+
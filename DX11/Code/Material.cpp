@@ -11,7 +11,8 @@ Material::Material(
 	vs(vs),
 	colorTint(tint),
 	uvScale(uvScale),
-	uvOffset(uvOffset)
+	uvOffset(uvOffset),
+	version(0)
 {
 
 }
@@ -19,6 +20,7 @@ Material::Material(
 // Getters
 std::shared_ptr<SimplePixelShader> Material::GetPixelShader() { return ps; }
 std::shared_ptr<SimpleVertexShader> Material::GetVertexShader() { return vs; }
+std::shared_ptr<SimpleVertexShader> Material::GetPackedVertexShader() { return packedVS; }
 DirectX::XMFLOAT2 Material::GetUVScale() { return uvScale; }
 DirectX::XMFLOAT2 Material::GetUVOffset() { return uvOffset; }
 DirectX::XMFLOAT3 Material::GetColorTint() { return colorTint; }
@@ -50,55 +52,78 @@ Microsoft::WRL::ComPtr<ID3D11SamplerState> Material::GetSampler(std::string name
 }
 
 // Setters
-void Material::SetPixelShader(std::shared_ptr<SimplePixelShader> ps) { this->ps = ps; }
-void Material::SetVertexShader(std::shared_ptr<SimpleVertexShader> vs) { this->vs = vs; }
-void Material::SetUVScale(DirectX::XMFLOAT2 scale) { uvScale = scale; }
-void Material::SetUVOffset(DirectX::XMFLOAT2 offset) { uvOffset = offset; }
-void Material::SetColorTint(DirectX::XMFLOAT3 tint) { this->colorTint = tint; }
+void Material::SetPixelShader(std::shared_ptr<SimplePixelShader> ps) { this->ps = ps; version++; }
+void Material::SetVertexShader(std::shared_ptr<SimpleVertexShader> vs) { this->vs = vs; version++; }
+void Material::SetPackedVertexShader(std::shared_ptr<SimpleVertexShader> vs) { this->packedVS = vs; version++; }
+void Material::SetUVScale(DirectX::XMFLOAT2 scale) { uvScale = scale; version++; }
+void Material::SetUVOffset(DirectX::XMFLOAT2 offset) { uvOffset = offset; version++; }
+void Material::SetColorTint(DirectX::XMFLOAT3 tint) { this->colorTint = tint; version++; }
 
 
 void Material::AddTextureSRV(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv)
 {
 	textureSRVs.insert({ name, srv });
+	version++;
 }
 
 void Material::AddSampler(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> sampler)
 {
 	samplers.insert({ name, sampler });
+	version++;
 }
 
 void Material::RemoveTextureSRV(std::string name)
 {
 	textureSRVs.erase(name);
+	version++;
 }
 
 void Material::RemoveSampler(std::string name)
 {
 	samplers.erase(name);
+	version++;
 }
 
 
-void Material::PrepareMaterial(Transform* transform, std::shared_ptr<Camera> camera)
+void Material::PrepareMaterial(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, ConstantBufferSlot& objectConstants, std::shared_ptr<Mesh> mesh)
 {
+	// Packed meshes need a vertex shader that can decode them
+	bool packed = mesh->HasPackedVertices() && packedVS;
+	std::shared_ptr<SimpleVertexShader> vs = packed ? packedVS : this->vs;
+
 	// Turn on these shaders
 	vs->SetShader();
 	ps->SetShader();
 
-	// Send data to the vertex shader
-	vs->SetMatrix4x4("world", transform->GetWorldMatrix());
-	vs->SetMatrix4x4("worldInvTrans", transform->GetWorldInverseTransposeMatrix());
-	vs->SetMatrix4x4("view", camera->GetView());
-	vs->SetMatrix4x4("projection", camera->GetProjection());
-	vs->CopyAllBufferData();
-
-	// Send data to the pixel shader
-	ps->SetFloat3("colorTint", colorTint);
-	ps->SetFloat3("cameraPosition", camera->GetTransform()->GetPosition());
-	ps->SetFloat2("uvScale", uvScale);
-	ps->SetFloat2("uvOffset", uvOffset);
-	ps->CopyAllBufferData();
+	// The shaders' own copies of these buffers are replaced
+	// with the object's and the material's, which stay on the
+	// GPU between frames and are only rewritten when they change
+	if (!materialConstants.IsCurrent(version))
+	{
+		MaterialConstants data = {};
+		data.ColorTint = colorTint;
+		data.UVScale = uvScale;
+		data.UVOffset = uvOffset;
+		materialConstants.Write(context, &data, sizeof(MaterialConstants), version);
+	}
+	context->VSSetConstantBuffers(1, 1, objectConstants.GetAddressOf());
+	context->PSSetConstantBuffers(0, 1, materialConstants.GetAddressOf());
 
 	// Loop and set any other resources
 	for (auto& t : textureSRVs) { ps->SetShaderResourceView(t.first.c_str(), t.second.Get()); }
 	for (auto& s : samplers) { ps->SetSamplerState(s.first.c_str(), s.second.Get()); }
 }
+
+void Material::UpdateObjectConstants(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, ConstantBufferSlot& objectConstants, Transform& transform, std::shared_ptr<Mesh> mesh)
+{
+	unsigned int transformVersion = transform.GetMatrixVersion();
+	if (objectConstants.IsCurrent(transformVersion))
+		return;
+
+	ObjectConstants data = {};
+	data.World = transform.GetWorldMatrix();
+	data.WorldInverseTranspose = transform.GetWorldInverseTransposeMatrix();
+	data.PositionScale = mesh->GetPositionScale();
+	data.PositionOffset = mesh->GetPositionOffset();
+	objectConstants.Write(context, &data, sizeof(ObjectConstants), transformVersion);
+}
@@ -9,6 +9,33 @@
 #include "SimpleShader.h"
 #include "Camera.h"
 #include "Transform.h"
+#include "Mesh.h"
+#include "ConstantBufferSlot.h"
+
+// --------------------------------------------------------
+// Matches the perObject buffer in VertexShader.hlsl (and
+// the start of the one in DepthVS.hlsl)
+// --------------------------------------------------------
+struct ObjectConstants
+{
+	DirectX::XMFLOAT4X4 World;
+	DirectX::XMFLOAT4X4 WorldInverseTranspose;
+	DirectX::XMFLOAT3 PositionScale;	// Only read for packed meshes
+	float Padding0;
+	DirectX::XMFLOAT3 PositionOffset;
+	float Padding1;
+};
+
+// --------------------------------------------------------
+// Matches the perMaterial buffer in the pixel shaders
+// --------------------------------------------------------
+struct MaterialConstants
+{
+	DirectX::XMFLOAT3 ColorTint;
+	float Padding;
+	DirectX::XMFLOAT2 UVScale;
+	DirectX::XMFLOAT2 UVOffset;
+};
 
 class Material
 {
@@ -22,14 +49,19 @@ public:
 
 	std::shared_ptr<SimplePixelShader> GetPixelShader();
 	std::shared_ptr<SimpleVertexShader> GetVertexShader();
+	std::shared_ptr<SimpleVertexShader> GetPackedVertexShader();
 	DirectX::XMFLOAT2 GetUVScale();
 	DirectX::XMFLOAT2 GetUVOffset();
 	DirectX::XMFLOAT3 GetColorTint();
+
+	// Changes whenever any of the material's data does
+	unsigned int GetVersion() { return version; }
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> GetTextureSRV(std::string name);
 	Microsoft::WRL::ComPtr<ID3D11SamplerState> GetSampler(std::string name);
 
 	void SetPixelShader(std::shared_ptr<SimplePixelShader> ps);
 	void SetVertexShader(std::shared_ptr<SimpleVertexShader> ps);
+	void SetPackedVertexShader(std::shared_ptr<SimpleVertexShader> vs);
 	void SetUVScale(DirectX::XMFLOAT2 scale);
 	void SetUVOffset(DirectX::XMFLOAT2 offset);
 	void SetColorTint(DirectX::XMFLOAT3 tint);
@@ -40,13 +72,24 @@ public:
 	void RemoveTextureSRV(std::string name);
 	void RemoveSampler(std::string name);
 
-	void PrepareMaterial(Transform* transform, std::shared_ptr<Camera> camera);
+	// The mesh determines which vertex shader is used, as
+	// meshes with packed vertices need the packed version.
+	// The object's constants should already be up to date (see
+	// UpdateObjectConstants), and the view, projection and
+	// lights already set once for the frame by the renderer.
+	void PrepareMaterial(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, ConstantBufferSlot& objectConstants, std::shared_ptr<Mesh> mesh);
+
+	// Rewrites an object's constants, but only if its transform
+	// has changed since they were last written.  Invalidate the
+	// slot when the object's mesh changes.
+	static void UpdateObjectConstants(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, ConstantBufferSlot& objectConstants, Transform& transform, std::shared_ptr<Mesh> mesh);
 
 private:
 
 	// Shaders
 	std::shared_ptr<SimplePixelShader> ps;
 	std::shared_ptr<SimpleVertexShader> vs;
+	std::shared_ptr<SimpleVertexShader> packedVS; // For meshes with PackedVertex data
 
 	// Material properties
 	DirectX::XMFLOAT3 colorTint;
@@ -56,5 +99,9 @@ private:
 	DirectX::XMFLOAT2 uvScale;
 	std::unordered_map<std::string, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>> textureSRVs;
 	std::unordered_map<std::string, Microsoft::WRL::ComPtr<ID3D11SamplerState>> samplers;
+
+	// Only rewritten when the version changes
+	unsigned int version;
+	ConstantBufferSlot materialConstants;
 };
 
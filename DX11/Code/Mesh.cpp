@@ -1,192 +1,97 @@
 #include "Mesh.h"
+#include "ObjParser.h"
+#include "MeshBinary.h"
+#include "GlbFile.h"
+#include "MeshOptimizer.h"
+#include "VertexPacking.h"
+#include "MeshSimplifier.h"
+#include "JobSystem.h"
 #include <DirectXMath.h>
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <string>
 #include <vector>
-#include <fstream>
+
+#include <emmintrin.h>
 
 using namespace DirectX;
 
-Mesh::Mesh(Vertex* vertArray, int numVerts, unsigned int* indexArray, int numIndices, Microsoft::WRL::ComPtr<ID3D11Device> device)
+const float Mesh::LodTargetErrors[Mesh::MaxLods - 1] = { 0.005f, 0.01f, 0.025f, 0.05f };
+const int Mesh::TangentsPerJob;
+
+Mesh::Mesh(Vertex* vertArray, int numVerts, unsigned int* indexArray, int numIndices, Microsoft::WRL::ComPtr<ID3D11Device> device, unsigned int flags) :
+	packed((flags & MeshFlags_PackVertices) != 0),
+	vertexStride(sizeof(Vertex)),
+	positionCount(0),
+	memorySize(0),
+	positionScale(1, 1, 1),
+	positionOffset(0, 0, 0),
+	flags(flags)
 {
+	// Calculate the tangents before copying to buffer, unless
+	// they're already there
+	if (!(flags & MeshFlags_KeepTangents))
+		CalculateTangents(vertArray, numVerts, indexArray, numIndices);
 	CreateBuffers(vertArray, numVerts, indexArray, numIndices, device);
 }
 
-Mesh::Mesh(const char* objFile, Microsoft::WRL::ComPtr<ID3D11Device> device)
+Mesh::Mesh(const char* meshFile, Microsoft::WRL::ComPtr<ID3D11Device> device, unsigned int flags) :
+	numIndices(0),
+	packed((flags & MeshFlags_PackVertices) != 0),
+	vertexStride(sizeof(Vertex)),
+	positionCount(0),
+	memorySize(0),
+	positionScale(1, 1, 1),
+	positionOffset(0, 0, 0),
+	flags(flags)
 {
-	// File input object
-	std::ifstream obj(objFile);
-
-	// Check for successful open
-	if (!obj.is_open())
+	// Binary glTF is used as is, straight out of the file when its
+	// layout allows (see GlbFile) - there's nothing to cache
+	size_t length = strlen(meshFile);
+	if (length >= 4 && _stricmp(meshFile + length - 4, ".glb") == 0)
+	{
+		GlbFile glb(meshFile);
+		if (glb.Load())
+			CreateBuffers(glb.GetVertices(), glb.GetVertexCount(), glb.GetIndices(), glb.GetIndexCount(), device);
 		return;
+	}
 
-	// Variables used while reading the file
-	std::vector<XMFLOAT3> positions;     // Positions from the file
-	std::vector<XMFLOAT3> normals;       // Normals from the file
-	std::vector<XMFLOAT2> uvs;           // UVs from the file
-	std::vector<Vertex> verts;           // Verts we're assembling
-	std::vector<UINT> indices;           // Indices of these verts
-	unsigned int vertCounter = 0;        // Count of vertices/indices
-	char chars[100];                     // String for line reading
-
-	// Still have data left?
-	while (obj.good())
+	// Is there an up to date binary cache of this OBJ file?  If so, the
+	// buffers are created straight from the (decompressed) cache,
+	// with no parsing or tangent calculation at all
+	std::string binFile = MeshBinary::PathFor(meshFile);
 	{
-		// Get the line (100 characters should be more than enough)
-		obj.getline(chars, 100);
-
-		// Check the type of line
-		if (chars[0] == 'v' && chars[1] == 'n')
+		MeshBinary cache(binFile.c_str());
+		if (cache.IsValid() && cache.MatchesSource(meshFile) && cache.Load())
 		{
-			// Read the 3 numbers directly into an XMFLOAT3
-			XMFLOAT3 norm;
-			sscanf_s(
-				chars,
-				"vn %f %f %f",
-				&norm.x, &norm.y, &norm.z);
-
-			// Add to the list of normals
-			normals.push_back(norm);
-		}
-		else if (chars[0] == 'v' && chars[1] == 't')
-		{
-			// Read the 2 numbers directly into an XMFLOAT2
-			XMFLOAT2 uv;
-			sscanf_s(
-				chars,
-				"vt %f %f",
-				&uv.x, &uv.y);
-
-			// Add to the list of uv's
-			uvs.push_back(uv);
-		}
-		else if (chars[0] == 'v')
-		{
-			// Read the 3 numbers directly into an XMFLOAT3
-			XMFLOAT3 pos;
-			sscanf_s(
-				chars,
-				"v %f %f %f",
-				&pos.x, &pos.y, &pos.z);
-
-			// Add to the positions
-			positions.push_back(pos);
-		}
-		else if (chars[0] == 'f')
-		{
-			// Read the face indices into an array
-			// NOTE: This assumes the given obj file contains
-			//  vertex positions, uv coordinates AND normals.
-			//  If the model is missing any of these, this 
-			//  code will not handle the file correctly!
-			unsigned int i[12];
-			int facesRead = sscanf_s(
-				chars,
-				"f %d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d",
-				&i[0], &i[1], &i[2],
-				&i[3], &i[4], &i[5],
-				&i[6], &i[7], &i[8],
-				&i[9], &i[10], &i[11]);
-
-			// - Create the verts by looking up
-			//    corresponding data from vectors
-			// - OBJ File indices are 1-based, so
-			//    they need to be adusted
-			Vertex v1;
-			v1.Position = positions[i[0] - 1];
-			v1.UV = uvs[i[1] - 1];
-			v1.Normal = normals[i[2] - 1];
-
-			Vertex v2;
-			v2.Position = positions[i[3] - 1];
-			v2.UV = uvs[i[4] - 1];
-			v2.Normal = normals[i[5] - 1];
-
-			Vertex v3;
-			v3.Position = positions[i[6] - 1];
-			v3.UV = uvs[i[7] - 1];
-			v3.Normal = normals[i[8] - 1];
-
-			// The model is most likely in a right-handed space,
-			// especially if it came from Maya.  We want to convert
-			// to a left-handed space for DirectX.  This means we 
-			// need to:
-			//  - Invert the Z position
-			//  - Invert the normal's Z
-			//  - Flip the winding order
-			// We also need to flip the UV coordinate since DirectX
-			// defines (0,0) as the top left of the texture, and many
-			// 3D modeling packages use the bottom left as (0,0)
-
-			// Flip the UV's since they're probably "upside down"
-			v1.UV.y = 1.0f - v1.UV.y;
-			v2.UV.y = 1.0f - v2.UV.y;
-			v3.UV.y = 1.0f - v3.UV.y;
-
-			// Flip Z (LH vs. RH)
-			v1.Position.z *= -1.0f;
-			v2.Position.z *= -1.0f;
-			v3.Position.z *= -1.0f;
-
-			// Flip normal Z
-			v1.Normal.z *= -1.0f;
-			v2.Normal.z *= -1.0f;
-			v3.Normal.z *= -1.0f;
-
-			// Add the verts to the vector (flipping the winding order)
-			verts.push_back(v1);
-			verts.push_back(v3);
-			verts.push_back(v2);
-
-			// Add three more indices
-			indices.push_back(vertCounter); vertCounter += 1;
-			indices.push_back(vertCounter); vertCounter += 1;
-			indices.push_back(vertCounter); vertCounter += 1;
-
-			// Was there a 4th face?
-			if (facesRead == 12)
-			{
-				// Make the last vertex
-				Vertex v4;
-				v4.Position = positions[i[9] - 1];
-				v4.UV = uvs[i[10] - 1];
-				v4.Normal = normals[i[11] - 1];
-
-				// Flip the UV, Z pos and normal
-				v4.UV.y = 1.0f - v4.UV.y;
-				v4.Position.z *= -1.0f;
-				v4.Normal.z *= -1.0f;
-
-				// Add a whole triangle (flipping the winding order)
-				verts.push_back(v1);
-				verts.push_back(v4);
-				verts.push_back(v3);
-
-				// Add three more indices
-				indices.push_back(vertCounter); vertCounter += 1;
-				indices.push_back(vertCounter); vertCounter += 1;
-				indices.push_back(vertCounter); vertCounter += 1;
-			}
+			CreateBuffers(cache.GetVertices(), cache.GetVertexCount(), cache.GetIndices(), cache.GetIndexCount(), device);
+			return;
 		}
 	}
 
-	// Close the file and create the actual buffers
-	obj.close();
-
-
-	// - At this point, "verts" is a vector of Vertex structs, and can be used
-	//    directly to create a vertex buffer:  &verts[0] is the address of the first vert
-	//
-	// - The vector "indices" is similar. It's a vector of unsigned ints and
-	//    can be used directly for the index buffer: &indices[0] is the address of the first int
-	//
-	// - "vertCounter" is BOTH the number of vertices and the number of indices
-	// - Yes, the indices are a bit redundant here (one per vertex).  Could you skip using
-	//    an index buffer in this case?  Sure!  Though, if your mesh class assumes you have
-	//    one, you'll need to write some extra code to handle cases when you don't.
-
-	CreateBuffers(&verts[0], vertCounter, &indices[0], vertCounter, device);
-
+	// Parse the whole file into a triangle list
+	// - See ObjParser for details on the format and the
+	//    handedness conversion applied along the way
+	ObjMeshData data;
+	if (!ObjParser::ParseFile(meshFile, data))
+		return;
 
+	// - "data.Vertices" is a vector of Vertex structs, and can be used
+	//    directly to create a vertex buffer
+	// - "data.Indices" is similar, and references each unique
+	//    position/uv/normal combination only once
+	// - Triangles are then reordered for the GPU's vertex cache, then
+	//    in clusters to reduce overdraw, and finally the vertices are
+	//    sorted to match so they're read (mostly) sequentially
+	MeshOptimizer::OptimizeVertexCache(&data.Indices[0], data.Indices.size(), data.Vertices.size());
+	MeshOptimizer::OptimizeOverdraw(&data.Indices[0], data.Indices.size(), &data.Vertices[0], data.Vertices.size());
+	data.Vertices.resize(MeshOptimizer::OptimizeVertexFetch(&data.Vertices[0], data.Vertices.size(), &data.Indices[0], data.Indices.size()));
+	CalculateTangents(&data.Vertices[0], (int)data.Vertices.size(), &data.Indices[0], (int)data.Indices.size());
+	CreateBuffers(&data.Vertices[0], (int)data.Vertices.size(), &data.Indices[0], (int)data.Indices.size(), device);
+
+	// Save the final result for next time (failing to is harmless)
+	MeshBinary::Write(binFile.c_str(), meshFile, &data.Vertices[0], (int)data.Vertices.size(), &data.Indices[0], (int)data.Indices.size());
 }
 
 
@@ -196,28 +101,67 @@ Mesh::~Mesh(void)
 }
 
 
-void Mesh::CreateBuffers(Vertex* vertArray, int numVerts, unsigned int* indexArray, int numIndices, Microsoft::WRL::ComPtr<ID3D11Device> device)
+void Mesh::CreateBuffers(const Vertex* vertArray, int numVerts, const unsigned int* indexArray, int numIndices, Microsoft::WRL::ComPtr<ID3D11Device> device)
 {
-	// Always calculate the tangents before copying to buffer
-	CalculateTangents(vertArray, numVerts, indexArray, numIndices);
+	boundingBox = Bounds::BoxFromVertices(vertArray, numVerts);
+	boundingSphere = Bounds::SphereFromVertices(vertArray, numVerts, boundingBox.Center);
+
+	// Meshlets regroup the triangles and LODs are added after the full
+	// detail triangles, so both happen before the index buffer is made
+	// (they're quick to build, so they aren't cached)
+	std::vector<unsigned int> allIndices;
+	if (flags & (MeshFlags_BuildMeshlets | MeshFlags_BuildLods))
+	{
+		allIndices.assign(indexArray, indexArray + numIndices);
+		if (flags & MeshFlags_BuildMeshlets)
+			Meshlets::Build(allIndices.data(), numIndices, vertArray, numVerts, meshlets);
+		indexArray = allIndices.data();
+	}
 
+	if (flags & MeshFlags_KeepCpuData)
+	{
+		cpuVertices.assign(vertArray, vertArray + numVerts);
+		cpuIndices.assign(indexArray, indexArray + numIndices);
+		bvh.Build(vertArray, numVerts, indexArray, numIndices);
+	}
+
+	lods.clear();
+	lods.push_back({ 0, (unsigned int)numIndices, 0.0f });
+	if (flags & MeshFlags_BuildLods)
+	{
+		BuildLods(vertArray, numVerts, allIndices);
+		indexArray = allIndices.data();
+	}
+
+	// Pack the vertices first if requested (the full size vertices
+	// are still what gets cached, so packing can be toggled freely)
+	std::vector<PackedVertex> packedVerts;
+	const void* vertexData = vertArray;
+	vertexStride = sizeof(Vertex);
+	if (packed)
+	{
+		packedVerts.resize(numVerts);
+		VertexPacking::Pack(vertArray, numVerts, packedVerts.data(), positionScale, positionOffset);
+		vertexData = packedVerts.data();
+		vertexStride = sizeof(PackedVertex);
+	}
 
 	// Create the vertex buffer
 	D3D11_BUFFER_DESC vbd;
 	vbd.Usage = D3D11_USAGE_IMMUTABLE;
-	vbd.ByteWidth = sizeof(Vertex) * numVerts; // Number of vertices
+	vbd.ByteWidth = vertexStride * numVerts; // Number of vertices
 	vbd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
 	vbd.CPUAccessFlags = 0;
 	vbd.MiscFlags = 0;
 	vbd.StructureByteStride = 0;
 	D3D11_SUBRESOURCE_DATA initialVertexData;
-	initialVertexData.pSysMem = vertArray;
+	initialVertexData.pSysMem = vertexData;
 	device->CreateBuffer(&vbd, &initialVertexData, vb.GetAddressOf());
 
 	// Create the index buffer
 	D3D11_BUFFER_DESC ibd;
 	ibd.Usage = D3D11_USAGE_IMMUTABLE;
-	ibd.ByteWidth = sizeof(unsigned int) * numIndices; // Number of indices
+	ibd.ByteWidth = sizeof(unsigned int) * (lods.back().IndexStart + lods.back().IndexCount); // Number of indices (in all LODs)
 	ibd.BindFlags = D3D11_BIND_INDEX_BUFFER;
 	ibd.CPUAccessFlags = 0;
 	ibd.MiscFlags = 0;
@@ -226,35 +170,251 @@ void Mesh::CreateBuffers(Vertex* vertArray, int numVerts, unsigned int* indexArr
 	initialIndexData.pSysMem = indexArray;
 	device->CreateBuffer(&ibd, &initialIndexData, ib.GetAddressOf());
 
+	if (flags & MeshFlags_BuildPositionStream)
+		CreatePositionBuffers(vertArray, packed ? packedVerts.data() : 0, numVerts, indexArray, ibd.ByteWidth / sizeof(unsigned int), device);
+
 	// Save the indices
 	this->numIndices = numIndices;
+
+	memorySize = vbd.ByteWidth + ibd.ByteWidth +
+		(positionCount > 0 ? positionCount * sizeof(XMFLOAT3) + ibd.ByteWidth : 0) +
+		cpuVertices.size() * sizeof(Vertex) +
+		cpuIndices.size() * sizeof(unsigned int) +
+		meshlets.size() * sizeof(Meshlet) +
+		bvh.GetMemorySize();
+}
+
+
+// --------------------------------------------------------
+// Welds the positions (every LOD's indices included) into
+// a second pair of buffers, so depth only passes fetch a
+// quarter of the data for fewer vertices
+// --------------------------------------------------------
+void Mesh::CreatePositionBuffers(const Vertex* vertArray, const PackedVertex* packedVerts, int numVerts, const unsigned int* indexArray, int totalIndices, Microsoft::WRL::ComPtr<ID3D11Device> device)
+{
+	std::vector<XMFLOAT3> positions(numVerts);
+	for (int i = 0; i < numVerts; i++)
+		positions[i] = packedVerts ? VertexPacking::Unpack(packedVerts[i], positionScale, positionOffset).Position : vertArray[i].Position;
+
+	std::vector<XMFLOAT3> uniquePositions(numVerts);
+	std::vector<unsigned int> positionIndices(totalIndices);
+	positionCount = (int)MeshOptimizer::WeldPositions(positions.data(), numVerts, indexArray, totalIndices, uniquePositions.data(), positionIndices.data());
+	if (positionCount == 0)
+		return;
+
+	D3D11_BUFFER_DESC vbd;
+	vbd.Usage = D3D11_USAGE_IMMUTABLE;
+	vbd.ByteWidth = sizeof(XMFLOAT3) * positionCount;
+	vbd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+	vbd.CPUAccessFlags = 0;
+	vbd.MiscFlags = 0;
+	vbd.StructureByteStride = 0;
+	D3D11_SUBRESOURCE_DATA initialVertexData;
+	initialVertexData.pSysMem = uniquePositions.data();
+	device->CreateBuffer(&vbd, &initialVertexData, positionVB.GetAddressOf());
+
+	D3D11_BUFFER_DESC ibd;
+	ibd.Usage = D3D11_USAGE_IMMUTABLE;
+	ibd.ByteWidth = sizeof(unsigned int) * totalIndices;
+	ibd.BindFlags = D3D11_BIND_INDEX_BUFFER;
+	ibd.CPUAccessFlags = 0;
+	ibd.MiscFlags = 0;
+	ibd.StructureByteStride = 0;
+	D3D11_SUBRESOURCE_DATA initialIndexData;
+	initialIndexData.pSysMem = positionIndices.data();
+	device->CreateBuffer(&ibd, &initialIndexData, positionIB.GetAddressOf());
 }
 
 
 // Calculates the tangents of the vertices in a mesh
 // Code originally adapted from: http://www.terathon.com/code/tangent.html
-// Updated version now found here: http://foundationsofgameenginedev.com/FGED2-sample.pdf
-//  - See listing 7.4 in section 7.5 (page 9 of the PDF)
-void Mesh::CalculateTangents(Vertex* verts, int numVerts, unsigned int* indices, int numIndices)
+//
+// Triangle tangents are found four at a time.  In parallel,
+// the work is split into fixed size ranges of triangles, then
+// of vertices: each triangle range finds its tangents and
+// lists which vertex ranges its triangles touch, then each
+// vertex range adds up its tangents by going through those
+// lists in order.  That's the same order of additions as
+// walking the triangles one at a time, so the results never
+// depend on the number of threads.
+void Mesh::CalculateTangents(Vertex* verts, int numVerts, unsigned int* indices, int numIndices, bool multithreaded)
 {
-	// Reset tangents
-	for (int i = 0; i < numVerts; i++)
+	int numTris = numIndices / 3;
+	int triRanges = (numTris + TangentsPerJob - 1) / TangentsPerJob;
+	int vertRanges = (numVerts + TangentsPerJob - 1) / TangentsPerJob;
+	JobSystem& jobs = JobSystem::GetInstance();
+
+	// Ensure all of the tangents are orthogonal to the normals
+	auto orthogonalize = [&](unsigned int first, unsigned int last)
+	{
+		for (unsigned int i = first; i < last; i++)
+		{
+			// Grab the two vectors
+			XMVECTOR normal = XMLoadFloat3(&verts[i].Normal);
+			XMVECTOR tangent = XMLoadFloat3(&verts[i].Tangent);
+
+			// Use Gram-Schmidt orthogonalize
+			tangent = XMVector3Normalize(
+				tangent - normal * XMVector3Dot(normal, tangent));
+
+			// Store the tangent
+			XMStoreFloat3(&verts[i].Tangent, tangent);
+		}
+	};
+
+	// With nothing to split up, each range of triangle tangents is
+	// added straight into the vertices while still in the cache
+	if (!multithreaded || jobs.GetThreadCount() == 1 || triRanges <= 1)
+	{
+		for (int i = 0; i < numVerts; i++)
+			verts[i].Tangent = XMFLOAT3(0, 0, 0);
+
+		std::unique_ptr<XMFLOAT3[]> triTangents(new XMFLOAT3[(std::min)(numTris, TangentsPerJob)]);
+		for (int first = 0; first < numTris; first += TangentsPerJob)
+		{
+			int count = (std::min)(TangentsPerJob, numTris - first);
+			CalculateTriangleTangents(verts, indices + first * 3, 0, count, triTangents.get());
+
+			// Adjust tangents of each vert of each triangle
+			for (int t = 0; t < count; t++)
+			{
+				const XMFLOAT3& tangent = triTangents[t];
+				for (int c = 0; c < 3; c++)
+				{
+					Vertex* v = &verts[indices[(first + t) * 3 + c]];
+					v->Tangent.x += tangent.x;
+					v->Tangent.y += tangent.y;
+					v->Tangent.z += tangent.z;
+				}
+			}
+		}
+
+		orthogonalize(0, numVerts);
+		return;
+	}
+
+	// Tangent of every triangle, plus each triangle range's list of
+	// triangles per vertex range (mostly just one or two vertex
+	// ranges, as optimized meshes use vertices in order)
+	std::unique_ptr<XMFLOAT3[]> triTangents(new XMFLOAT3[numTris]);
+	std::vector<std::vector<int>> rangeTris((size_t)triRanges * vertRanges);
+	jobs.ParallelFor((unsigned int)triRanges, [&](unsigned int range)
+	{
+		int first = range * TangentsPerJob;
+		int count = (std::min)(TangentsPerJob, numTris - first);
+		CalculateTriangleTangents(verts, indices, first, count, triTangents.get());
+
+		std::vector<int>* lists = &rangeTris[(size_t)range * vertRanges];
+		for (int t = first; t < first + count; t++)
+		{
+			unsigned int r0 = indices[t * 3] / TangentsPerJob;
+			unsigned int r1 = indices[t * 3 + 1] / TangentsPerJob;
+			unsigned int r2 = indices[t * 3 + 2] / TangentsPerJob;
+			lists[r0].push_back(t);
+			if (r1 != r0) lists[r1].push_back(t);
+			if (r2 != r0 && r2 != r1) lists[r2].push_back(t);
+		}
+	});
+
+	// Sum and orthogonalize each range of vertices
+	jobs.ParallelFor((unsigned int)vertRanges, [&](unsigned int range)
 	{
-		verts[i].Tangent = XMFLOAT3(0, 0, 0);
+		unsigned int first = range * TangentsPerJob;
+		unsigned int last = (std::min)(first + TangentsPerJob, (unsigned int)numVerts);
+
+		for (unsigned int i = first; i < last; i++)
+			verts[i].Tangent = XMFLOAT3(0, 0, 0);
+
+		for (int tr = 0; tr < triRanges; tr++)
+		{
+			for (int t : rangeTris[(size_t)tr * vertRanges + range])
+			{
+				const XMFLOAT3& tangent = triTangents[t];
+				for (int c = 0; c < 3; c++)
+				{
+					unsigned int v = indices[t * 3 + c];
+					if (v < first || v >= last)
+						continue;
+
+					verts[v].Tangent.x += tangent.x;
+					verts[v].Tangent.y += tangent.y;
+					verts[v].Tangent.z += tangent.z;
+				}
+			}
+		}
+
+		orthogonalize(first, last);
+	});
+}
+
+// --------------------------------------------------------
+// Finds the (unnormalized) tangent of a range of triangles,
+// gathering four at a time into SSE registers, one for each
+// component across the four triangles.  Triangles with
+// degenerate uv's get a zero tangent, as theirs would be
+// infinite, and would ruin every vertex they share with
+// neighbors.
+// --------------------------------------------------------
+void Mesh::CalculateTriangleTangents(const Vertex* verts, const unsigned int* indices, int firstTriangle, int triangleCount, XMFLOAT3* triangleTangents)
+{
+	int t = firstTriangle;
+	int end = firstTriangle + triangleCount;
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.0f);
+
+	for (; t + 4 <= end; t += 4)
+	{
+		const Vertex* v1[4];
+		const Vertex* v2[4];
+		const Vertex* v3[4];
+		for (int j = 0; j < 4; j++)
+		{
+			v1[j] = &verts[indices[(t + j) * 3]];
+			v2[j] = &verts[indices[(t + j) * 3 + 1]];
+			v3[j] = &verts[indices[(t + j) * 3 + 2]];
+		}
+
+#define GATHER(v, member) _mm_setr_ps(v[0]->member, v[1]->member, v[2]->member, v[3]->member)
+		__m128 px = GATHER(v1, Position.x), py = GATHER(v1, Position.y), pz = GATHER(v1, Position.z);
+		__m128 pu = GATHER(v1, UV.x), pv = GATHER(v1, UV.y);
+
+		// Vectors relative to the first vertex's position and uv
+		__m128 x1 = _mm_sub_ps(GATHER(v2, Position.x), px);
+		__m128 y1 = _mm_sub_ps(GATHER(v2, Position.y), py);
+		__m128 z1 = _mm_sub_ps(GATHER(v2, Position.z), pz);
+		__m128 x2 = _mm_sub_ps(GATHER(v3, Position.x), px);
+		__m128 y2 = _mm_sub_ps(GATHER(v3, Position.y), py);
+		__m128 z2 = _mm_sub_ps(GATHER(v3, Position.z), pz);
+		__m128 s1 = _mm_sub_ps(GATHER(v2, UV.x), pu);
+		__m128 t1 = _mm_sub_ps(GATHER(v2, UV.y), pv);
+		__m128 s2 = _mm_sub_ps(GATHER(v3, UV.x), pu);
+		__m128 t2 = _mm_sub_ps(GATHER(v3, UV.y), pv);
+#undef GATHER
+
+		__m128 det = _mm_sub_ps(_mm_mul_ps(s1, t2), _mm_mul_ps(s2, t1));
+		__m128 degenerate = _mm_cmpeq_ps(det, zero);
+		__m128 r = _mm_div_ps(one, det);
+
+		__m128 tx = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(t2, x1), _mm_mul_ps(t1, x2)), r);
+		__m128 ty = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(t2, y1), _mm_mul_ps(t1, y2)), r);
+		__m128 tz = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(t2, z1), _mm_mul_ps(t1, z2)), r);
+
+		// Back to one XMFLOAT3 per triangle
+		float x[4], y[4], z[4];
+		_mm_storeu_ps(x, _mm_andnot_ps(degenerate, tx));
+		_mm_storeu_ps(y, _mm_andnot_ps(degenerate, ty));
+		_mm_storeu_ps(z, _mm_andnot_ps(degenerate, tz));
+		for (int j = 0; j < 4; j++)
+			triangleTangents[t + j] = XMFLOAT3(x[j], y[j], z[j]);
 	}
 
-	// Calculate tangents one whole triangle at a time
-	for (int i = 0; i < numIndices;)
+	// Any last few one at a time
+	for (; t < end; t++)
 	{
-		// Grab indices and vertices of first triangle
-		unsigned int i1 = indices[i++];
-		unsigned int i2 = indices[i++];
-		unsigned int i3 = indices[i++];
-		Vertex* v1 = &verts[i1];
-		Vertex* v2 = &verts[i2];
-		Vertex* v3 = &verts[i3];
-
-		// Calculate vectors relative to triangle positions
+		const Vertex* v1 = &verts[indices[t * 3]];
+		const Vertex* v2 = &verts[indices[t * 3 + 1]];
+		const Vertex* v3 = &verts[indices[t * 3 + 2]];
+
 		float x1 = v2->Position.x - v1->Position.x;
 		float y1 = v2->Position.y - v1->Position.y;
 		float z1 = v2->Position.z - v1->Position.z;
@@ -263,61 +423,171 @@ void Mesh::CalculateTangents(Vertex* verts, int numVerts, unsigned int* indices,
 		float y2 = v3->Position.y - v1->Position.y;
 		float z2 = v3->Position.z - v1->Position.z;
 
-		// Do the same for vectors relative to triangle uv's
 		float s1 = v2->UV.x - v1->UV.x;
 		float t1 = v2->UV.y - v1->UV.y;
 
 		float s2 = v3->UV.x - v1->UV.x;
 		float t2 = v3->UV.y - v1->UV.y;
 
-		// Create vectors for tangent calculation
-		float r = 1.0f / (s1 * t2 - s2 * t1);
-		
-		float tx = (t2 * x1 - t1 * x2) * r;
-		float ty = (t2 * y1 - t1 * y2) * r;
-		float tz = (t2 * z1 - t1 * z2) * r;
-
-		// Adjust tangents of each vert of the triangle
-		v1->Tangent.x += tx; 
-		v1->Tangent.y += ty; 
-		v1->Tangent.z += tz;
-
-		v2->Tangent.x += tx; 
-		v2->Tangent.y += ty; 
-		v2->Tangent.z += tz;
-
-		v3->Tangent.x += tx; 
-		v3->Tangent.y += ty; 
-		v3->Tangent.z += tz;
+		float det = s1 * t2 - s2 * t1;
+		if (det == 0.0f)
+		{
+			triangleTangents[t] = XMFLOAT3(0, 0, 0);
+			continue;
+		}
+		float r = 1.0f / det;
+
+		triangleTangents[t] = XMFLOAT3(
+			(t2 * x1 - t1 * x2) * r,
+			(t2 * y1 - t1 * y2) * r,
+			(t2 * z1 - t1 * z2) * r);
 	}
+}
 
-	// Ensure all of the tangents are orthogonal to the normals
-	for (int i = 0; i < numVerts; i++)
+
+
+
+// --------------------------------------------------------
+// Simplifies the full detail mesh to each target error in
+// turn, appending the new indices for each one that has
+// noticeably fewer triangles than the last
+// --------------------------------------------------------
+void Mesh::BuildLods(const Vertex* vertArray, int numVerts, std::vector<unsigned int>& indices)
+{
+	size_t fullCount = lods[0].IndexCount;
+	float extent = MeshSimplifier::GetExtent(vertArray, numVerts);
+	std::vector<unsigned int> simplified(fullCount);
+
+	for (int i = 0; i < MaxLods - 1; i++)
 	{
-		// Grab the two vectors
-		XMVECTOR normal = XMLoadFloat3(&verts[i].Normal);
-		XMVECTOR tangent = XMLoadFloat3(&verts[i].Tangent);
-
-		// Use Gram-Schmidt orthogonalize
-		tangent = XMVector3Normalize(
-			tangent - normal * XMVector3Dot(normal, tangent));
-		
-		// Store the tangent
-		XMStoreFloat3(&verts[i].Tangent, tangent);
+		// Each level aims for at most half the triangles of the last
+		size_t target = (fullCount >> (i + 1)) / 3 * 3;
+		float error = 0.0f;
+		size_t count = MeshSimplifier::Simplify(&simplified[0], &indices[0], fullCount, vertArray, numVerts, target, LodTargetErrors[i], &error);
+		if (count == 0 || count > lods.back().IndexCount * 9 / 10)
+			continue;
+
+		MeshOptimizer::OptimizeVertexCache(&simplified[0], count, numVerts);
+
+		MeshLod lod = {};
+		lod.IndexStart = (unsigned int)indices.size();
+		lod.IndexCount = (unsigned int)count;
+		lod.Error = error * extent;
+		indices.insert(indices.end(), simplified.begin(), simplified.begin() + count);
+		lods.push_back(lod);
 	}
 }
 
 
+float Mesh::GetLodScreenError(int lod, float distance, float worldScale, float projectionYScale, float screenHeight)
+{
+	// Perspective projection of the error at that distance, in pixels
+	distance = (std::max)(distance, 0.0001f);
+	return lods[lod].Error * worldScale / distance * projectionYScale * screenHeight * 0.5f;
+}
+
+int Mesh::SelectLod(float distance, float worldScale, float projectionYScale, float screenHeight, float maxPixelError)
+{
+	for (int i = (int)lods.size() - 1; i > 0; i--)
+	{
+		if (GetLodScreenError(i, distance, worldScale, projectionYScale, screenHeight) <= maxPixelError)
+			return i;
+	}
+	return 0;
+}
 
 
-void Mesh::SetBuffersAndDraw(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context)
+void Mesh::SetBuffers(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context)
 {
 	// Set buffers in the input assembler
-	UINT stride = sizeof(Vertex);
+	UINT stride = vertexStride;
 	UINT offset = 0;
 	context->IASetVertexBuffers(0, 1, vb.GetAddressOf(), &stride, &offset);
 	context->IASetIndexBuffer(ib.Get(), DXGI_FORMAT_R32_UINT, 0);
+}
+
+void Mesh::SetBuffersAndDraw(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, int lod)
+{
+	SetBuffers(context);
+
+	// Draw this mesh (or one of its LODs)
+	const MeshLod& range = lods[lod];
+	context->DrawIndexed(range.IndexCount, range.IndexStart, 0);
+}
+
+void Mesh::SetPositionBuffers(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context)
+{
+	UINT stride = sizeof(XMFLOAT3);
+	UINT offset = 0;
+	context->IASetVertexBuffers(0, 1, positionVB.GetAddressOf(), &stride, &offset);
+	context->IASetIndexBuffer(positionIB.Get(), DXGI_FORMAT_R32_UINT, 0);
+}
+
+void Mesh::SetPositionBuffersAndDraw(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, int lod)
+{
+	if (!HasPositionStream())
+		return;
+
+	SetPositionBuffers(context);
+	const MeshLod& range = lods[lod];
+	context->DrawIndexed(range.IndexCount, range.IndexStart, 0);
+}
+
+int Mesh::SetBuffersAndDrawVisible(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, const MeshletCullInfo& cull)
+{
+	if (meshlets.empty())
+	{
+		SetBuffersAndDraw(context);
+		return numIndices / 3;
+	}
+
+	SetBuffers(context);
+	return DrawVisible(context, cull);
+}
+
+int Mesh::SetPositionBuffersAndDrawVisible(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, const MeshletCullInfo& cull)
+{
+	if (!HasPositionStream())
+		return 0;
+
+	if (meshlets.empty())
+	{
+		SetPositionBuffersAndDraw(context);
+		return numIndices / 3;
+	}
+
+	// The position indices are in the same order, so the
+	// meshlets' ranges still apply
+	SetPositionBuffers(context);
+	return DrawVisible(context, cull);
+}
+
+int Mesh::DrawVisible(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, const MeshletCullInfo& cull)
+{
+	// Meshlets are contiguous in the index buffer, so runs of
+	// visible ones are drawn together with a single call
+	unsigned int runStart = 0;
+	unsigned int runCount = 0;
+	int trianglesDrawn = 0;
+	for (auto& m : meshlets)
+	{
+		if (Meshlets::Test(m, cull) != MeshletVisibility_Visible)
+			continue;
+
+		if (runCount > 0 && runStart + runCount != m.IndexStart)
+		{
+			context->DrawIndexed(runCount, runStart, 0);
+			runCount = 0;
+		}
+		if (runCount == 0)
+			runStart = m.IndexStart;
+
+		runCount += m.TriangleCount * 3;
+		trianglesDrawn += m.TriangleCount;
+	}
+
+	if (runCount > 0)
+		context->DrawIndexed(runCount, runStart, 0);
 
-	// Draw this mesh
-	context->DrawIndexed(this->numIndices, 0, 0);
+	return trianglesDrawn;
 }
@@ -2,30 +2,146 @@
 
 #include <d3d11.h>
 #include <wrl/client.h>
+#include <vector>
 
 #include "Vertex.h"
+#include "Meshlets.h"
+#include "Bounds.h"
+#include "MeshBvh.h"
 
+// Optional processing when creating a mesh
+enum MeshFlags
+{
+	MeshFlags_None = 0,
+	MeshFlags_PackVertices = 1,	// Vertex buffer holds PackedVertex structs (needs the packed vertex shader)
+	MeshFlags_BuildMeshlets = 2,	// Splits the mesh into meshlets for culling
+	MeshFlags_BuildLods = 4,		// Generates simplified levels of detail
+	MeshFlags_KeepCpuData = 8,		// Keeps the vertices and indices in memory, with a BVH for ray casts
+	MeshFlags_KeepTangents = 16,	// Vertices already have tangents (see MeshGenerator), so they aren't recalculated
+	MeshFlags_BuildPositionStream = 32	// Adds a welded, position only vertex buffer (and index buffer) for depth only passes
+};
+
+// A level of detail: a range of the mesh's index buffer, which
+// uses the same vertex buffer as the full detail mesh
+struct MeshLod
+{
+	unsigned int IndexStart;
+	unsigned int IndexCount;
+	float Error;	// Furthest any surface moved, in model space units
+};
 
 class Mesh
 {
 public:
-	Mesh(Vertex* vertArray, int numVerts, unsigned int* indexArray, int numIndices, Microsoft::WRL::ComPtr<ID3D11Device> device);
-	Mesh(const char* objFile, Microsoft::WRL::ComPtr<ID3D11Device> device);
+	// Flags are any combination of MeshFlags
+	Mesh(Vertex* vertArray, int numVerts, unsigned int* indexArray, int numIndices, Microsoft::WRL::ComPtr<ID3D11Device> device, unsigned int flags = MeshFlags_None);
+	// Loads an .obj or a .glb file
+	Mesh(const char* meshFile, Microsoft::WRL::ComPtr<ID3D11Device> device, unsigned int flags = MeshFlags_None);
 	~Mesh(void);
 
 	Microsoft::WRL::ComPtr<ID3D11Buffer> GetVertexBuffer() { return vb; }
 	Microsoft::WRL::ComPtr<ID3D11Buffer> GetIndexBuffer() { return ib; }
 	int GetIndexCount() { return numIndices; }
 
-	void SetBuffersAndDraw(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context);
+	// Bytes held by this mesh's buffers, plus any copies of its data
+	// kept in memory (see MeshFlags_KeepCpuData)
+	size_t GetMemorySize() { return memorySize; }
+
+	// Packed positions are decoded as offset + unorm * scale
+	bool HasPackedVertices() { return packed; }
+	DirectX::XMFLOAT3 GetPositionScale() { return positionScale; }
+	DirectX::XMFLOAT3 GetPositionOffset() { return positionOffset; }
+
+	// Model space bounds of all of the vertices
+	const AxisAlignedBox& GetBoundingBox() { return boundingBox; }
+	const BoundingSphere& GetBoundingSphere() { return boundingSphere; }
+
+	// Only available with MeshFlags_KeepCpuData (the indices are the
+	// full detail triangles, in the same order as the index buffer)
+	bool HasCpuData() { return !cpuIndices.empty(); }
+	const std::vector<Vertex>& GetCpuVertices() { return cpuVertices; }
+	const std::vector<unsigned int>& GetCpuIndices() { return cpuIndices; }
+	const MeshBvh& GetBvh() { return bvh; }
+
+	// Closest hit along a model space ray (always false without a BVH)
+	bool Raycast(DirectX::XMFLOAT3 origin, DirectX::XMFLOAT3 direction, float maxDistance, RayHit& hit) { return bvh.Raycast(origin, direction, maxDistance, hit); }
+
+	bool HasMeshlets() { return !meshlets.empty(); }
+	const std::vector<Meshlet>& GetMeshlets() { return meshlets; }
+
+	// Level 0 is always the full detail mesh
+	int GetLodCount() { return (int)lods.size(); }
+	const MeshLod& GetLod(int lod) { return lods[lod]; }
+
+	// How far (in pixels) a level's error could appear on screen, and the
+	// lowest detail level that stays within the given limit, for a mesh
+	// drawn at the given distance and scale (projectionYScale is the
+	// projection matrix's _22 element)
+	float GetLodScreenError(int lod, float distance, float worldScale, float projectionYScale, float screenHeight);
+	int SelectLod(float distance, float worldScale, float projectionYScale, float screenHeight, float maxPixelError = 1.0f);
+
+	void SetBuffersAndDraw(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, int lod = 0);
+
+	// Draws only the meshlets that pass culling (or everything, if this
+	// mesh has no meshlets) and returns how many triangles were drawn
+	int SetBuffersAndDrawVisible(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, const MeshletCullInfo& cull);
+
+	// The same draws using just positions (12 bytes a vertex, with
+	// duplicates merged), for depth only passes.  Only available with
+	// MeshFlags_BuildPositionStream.  Packed meshes get their decoded
+	// positions, so depths match the full vertex stream closely.
+	bool HasPositionStream() { return positionVB.Get() != 0; }
+	void SetPositionBuffersAndDraw(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, int lod = 0);
+	int SetPositionBuffersAndDrawVisible(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, const MeshletCullInfo& cull);
+	int GetPositionCount() { return positionCount; }
+
+	// Results are bit-for-bit the same whether or not multithreaded
+	static void CalculateTangents(Vertex* verts, int numVerts, unsigned int* indices, int numIndices, bool multithreaded = true);
 
 private:
 	Microsoft::WRL::ComPtr<ID3D11Buffer> vb;
 	Microsoft::WRL::ComPtr<ID3D11Buffer> ib;
 	int numIndices;
 
-	void CreateBuffers(Vertex* vertArray, int numVerts, unsigned int* indexArray, int numIndices, Microsoft::WRL::ComPtr<ID3D11Device> device);
-	void CalculateTangents(Vertex* verts, int numVerts, unsigned int* indices, int numIndices);
+	// Position only stream, with indices laid out like ib's
+	Microsoft::WRL::ComPtr<ID3D11Buffer> positionVB;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> positionIB;
+	int positionCount;
+
+	size_t memorySize;
+
+	bool packed;
+	unsigned int vertexStride;
+	DirectX::XMFLOAT3 positionScale;
+	DirectX::XMFLOAT3 positionOffset;
+
+	unsigned int flags;
+	AxisAlignedBox boundingBox;
+	BoundingSphere boundingSphere;
+	std::vector<Meshlet> meshlets;
+	std::vector<MeshLod> lods;
+
+	std::vector<Vertex> cpuVertices;
+	std::vector<unsigned int> cpuIndices;
+	MeshBvh bvh;
+
+	// Levels of detail generated, including the full detail level, and
+	// the error each simplified level may reach (relative to mesh size)
+	static const int MaxLods = 5;
+	static const float LodTargetErrors[MaxLods - 1];
+
+	// Triangles (or vertices) handled by each tangent job
+	static const int TangentsPerJob = 64 * 1024;
+
+	static void CalculateTriangleTangents(const Vertex* verts, const unsigned int* indices, int firstTriangle, int triangleCount, DirectX::XMFLOAT3* triangleTangents);
+
+	void BuildLods(const Vertex* vertArray, int numVerts, std::vector<unsigned int>& indices);
+
+	void SetBuffers(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context);
+	void SetPositionBuffers(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context);
+	int DrawVisible(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, const MeshletCullInfo& cull);
+	void CreatePositionBuffers(const Vertex* vertArray, const PackedVertex* packedVerts, int numVerts, const unsigned int* indexArray, int totalIndices, Microsoft::WRL::ComPtr<ID3D11Device> device);
+	void CreateBuffers(const Vertex* vertArray, int numVerts, const unsigned int* indexArray, int numIndices, Microsoft::WRL::ComPtr<ID3D11Device> device);
 
 };
 
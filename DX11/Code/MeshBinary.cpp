@@ -0,0 +1,302 @@
+#include "MeshBinary.h"
+#include "MeshCodec.h"
+
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+
+using namespace DirectX;
+
+// Arrays in the file start on 16 byte boundaries
+static unsigned long long AlignUp(unsigned long long value)
+{
+	return (value + 15) & ~15ull;
+}
+
+MeshBinary::MeshBinary(const char* binFile) :
+	file(binFile),
+	header(0),
+	loaded(false)
+{
+	if (!file.IsOpen() || file.GetSize() < sizeof(MeshBinaryHeader))
+		return;
+
+	// Reject anything written by a different version of the importer,
+	// or with a different vertex layout than we're compiled with
+	const MeshBinaryHeader* h = (const MeshBinaryHeader*)file.GetData();
+	if (memcmp(h->Magic, "MBIN", 4) != 0 ||
+		h->Version != FormatVersion ||
+		h->VertexStride != sizeof(Vertex) ||
+		(h->Flags & ~MeshBinaryFlags_Compressed) != 0 ||
+		h->VertexCount == 0 ||
+		h->IndexCount == 0)
+		return;
+
+	// Uncompressed arrays must be exactly the right size
+	if (!(h->Flags & MeshBinaryFlags_Compressed) &&
+		(h->VertexBytes != (unsigned long long)h->VertexCount * sizeof(Vertex) ||
+		h->IndexBytes != (unsigned long long)h->IndexCount * sizeof(unsigned int)))
+		return;
+
+	// Make sure both arrays actually fit in the file, in case it was truncated
+	unsigned long long size = file.GetSize();
+	if (h->VertexOffset < sizeof(MeshBinaryHeader) || h->VertexOffset > size || h->VertexBytes > size - h->VertexOffset ||
+		h->IndexOffset < sizeof(MeshBinaryHeader) || h->IndexOffset > size || h->IndexBytes > size - h->IndexOffset)
+		return;
+
+	header = h;
+}
+
+bool MeshBinary::MatchesSource(const char* sourceFile)
+{
+	if (!header)
+		return false;
+
+	unsigned long long size = 0;
+	unsigned long long writeTime = 0;
+	if (!GetFileInfo(sourceFile, size, writeTime) || size != header->SourceSize)
+		return false;
+
+	// Same size and time is good enough - this avoids reading the source at all
+	if (writeTime == header->SourceWriteTime)
+		return true;
+
+	// The file has been touched, but may not have changed
+	MappedFile source(sourceFile);
+	return source.IsOpen() && HashBytes(source.GetData(), source.GetSize()) == header->SourceHash;
+}
+
+bool MeshBinary::Load()
+{
+	if (!header)
+		return false;
+	if (loaded)
+		return true;
+
+	const unsigned char* data = (const unsigned char*)file.GetData();
+	const unsigned int* indices = (const unsigned int*)(data + header->IndexOffset);
+	bool ok = true;
+	if (IsCompressed())
+	{
+		decompressedVertices.resize(header->VertexCount);
+		decompressedIndices.resize(header->IndexCount);
+		ok =
+			MeshCodec::DecodeVertices(&decompressedVertices[0], header->VertexCount, sizeof(Vertex), data + header->VertexOffset, (size_t)header->VertexBytes) &&
+			MeshCodec::DecodeIndices(&decompressedIndices[0], header->IndexCount, data + header->IndexOffset, (size_t)header->IndexBytes);
+		indices = &decompressedIndices[0];
+	}
+
+	// Any index past the end of the vertices means the data is bad,
+	// whether it came out of the decoder or straight from the file
+	for (unsigned int i = 0; ok && i < header->IndexCount; i++)
+		ok = indices[i] < header->VertexCount;
+	return loaded = ok;
+}
+
+const Vertex* MeshBinary::GetVertices()
+{
+	if (!loaded)
+		return 0;
+	if (IsCompressed())
+		return &decompressedVertices[0];
+	return (const Vertex*)(file.GetData() + header->VertexOffset);
+}
+
+const unsigned int* MeshBinary::GetIndices()
+{
+	if (!loaded)
+		return 0;
+	if (IsCompressed())
+		return &decompressedIndices[0];
+	return (const unsigned int*)(file.GetData() + header->IndexOffset);
+}
+
+
+// --------------------------------------------------------
+// Cache files live next to their source, with the
+// extension swapped out: sphere.obj -> sphere.meshbin
+// --------------------------------------------------------
+std::string MeshBinary::PathFor(const char* sourceFile)
+{
+	std::string path = sourceFile;
+	size_t dot = path.find_last_of('.');
+	size_t slash = path.find_last_of("\\/");
+	if (dot != std::string::npos && (slash == std::string::npos || dot > slash))
+		path.erase(dot);
+	return path + ".meshbin";
+}
+
+
+// --------------------------------------------------------
+// Writes a cache file for the given (already processed)
+// mesh data, optionally compressed.  The file is written
+// under a temporary name and then moved into place, so a
+// crash part way through never leaves a half-written cache
+// behind.
+// --------------------------------------------------------
+bool MeshBinary::Write(
+	const char* binFile,
+	const char* sourceFile,
+	const Vertex* vertices,
+	int numVerts,
+	const unsigned int* indices,
+	int numIndices,
+	bool compress)
+{
+	if (numVerts <= 0 || numIndices <= 0)
+		return false;
+
+	MeshBinaryHeader header = {};
+	memcpy(header.Magic, "MBIN", 4);
+	header.Version = FormatVersion;
+	header.VertexStride = sizeof(Vertex);
+	header.VertexCount = (unsigned int)numVerts;
+	header.IndexCount = (unsigned int)numIndices;
+
+	// The arrays, as they'll appear in the file
+	std::vector<unsigned char> encodedVertices;
+	std::vector<unsigned char> encodedIndices;
+	const void* vertexData = vertices;
+	const void* indexData = indices;
+	header.VertexBytes = sizeof(Vertex) * numVerts;
+	header.IndexBytes = sizeof(unsigned int) * numIndices;
+	if (compress && MeshCodec::EncodeVertices(vertices, numVerts, sizeof(Vertex), encodedVertices))
+	{
+		MeshCodec::EncodeIndices(indices, numIndices, encodedIndices);
+		header.Flags |= MeshBinaryFlags_Compressed;
+		vertexData = &encodedVertices[0];
+		indexData = &encodedIndices[0];
+		header.VertexBytes = encodedVertices.size();
+		header.IndexBytes = encodedIndices.size();
+	}
+	header.VertexOffset = AlignUp(sizeof(MeshBinaryHeader));
+	header.IndexOffset = AlignUp(header.VertexOffset + header.VertexBytes);
+
+	// Identify the source
+	if (!GetFileInfo(sourceFile, header.SourceSize, header.SourceWriteTime))
+		return false;
+	{
+		MappedFile source(sourceFile);
+		if (!source.IsOpen())
+			return false;
+		header.SourceHash = HashBytes(source.GetData(), source.GetSize());
+	}
+
+	// Bounds of the whole mesh
+	header.BoundsMin = vertices[0].Position;
+	header.BoundsMax = vertices[0].Position;
+	for (int i = 1; i < numVerts; i++)
+	{
+		const XMFLOAT3& p = vertices[i].Position;
+		header.BoundsMin = XMFLOAT3((std::min)(header.BoundsMin.x, p.x), (std::min)(header.BoundsMin.y, p.y), (std::min)(header.BoundsMin.z, p.z));
+		header.BoundsMax = XMFLOAT3((std::max)(header.BoundsMax.x, p.x), (std::max)(header.BoundsMax.y, p.y), (std::max)(header.BoundsMax.z, p.z));
+	}
+
+	// Meshes are imported on worker threads (and maybe by other
+	// processes), so each writer gets its own temp file and only
+	// complete files are ever moved into place
+	std::string tempFile = std::string(binFile) + "." +
+		std::to_string(GetCurrentProcessId()) + "." +
+		std::to_string(GetCurrentThreadId()) + ".tmp";
+	FILE* out = 0;
+	if (fopen_s(&out, tempFile.c_str(), "wb") != 0 || !out)
+		return false;
+
+	// Header, then each array at its offset (padding with zeros)
+	static const char padding[16] = {};
+	size_t vertexPadding = (size_t)(header.VertexOffset - sizeof(header));
+	size_t indexPadding = (size_t)(header.IndexOffset - header.VertexOffset - header.VertexBytes);
+	bool ok =
+		fwrite(&header, sizeof(header), 1, out) == 1 &&
+		fwrite(padding, 1, vertexPadding, out) == vertexPadding &&
+		fwrite(vertexData, 1, (size_t)header.VertexBytes, out) == header.VertexBytes &&
+		fwrite(padding, 1, indexPadding, out) == indexPadding &&
+		fwrite(indexData, 1, (size_t)header.IndexBytes, out) == header.IndexBytes;
+	ok = (fclose(out) == 0) && ok;
+
+	if (!ok || !MoveFileExA(tempFile.c_str(), binFile, MOVEFILE_REPLACE_EXISTING))
+	{
+		remove(tempFile.c_str());
+		return false;
+	}
+	return true;
+}
+
+
+// --------------------------------------------------------
+// 64-bit hash of a block of memory
+//
+// Four independent multiply-rotate lanes of 8 bytes each,
+// so throughput is limited by memory rather than by the
+// latency of a single dependency chain.  This only needs
+// to detect changed files, not resist attacks.
+// --------------------------------------------------------
+static inline unsigned long long Rotl64(unsigned long long x, int r)
+{
+	return (x << r) | (x >> (64 - r));
+}
+
+static inline unsigned long long HashRound(unsigned long long acc, unsigned long long input)
+{
+	acc += input * 0xC2B2AE3D27D4EB4Full;
+	return Rotl64(acc, 31) * 0x9E3779B185EBCA87ull;
+}
+
+unsigned long long MeshBinary::HashBytes(const void* data, size_t size)
+{
+	const unsigned char* p = (const unsigned char*)data;
+	const unsigned char* end = p + size;
+
+	unsigned long long lanes[4] =
+	{
+		0x9E3779B185EBCA87ull + 0xC2B2AE3D27D4EB4Full,
+		0xC2B2AE3D27D4EB4Full,
+		0,
+		0x61C8864E7A143579ull
+	};
+
+	// Bulk of the data, 32 bytes at a time
+	while (end - p >= 32)
+	{
+		for (int i = 0; i < 4; i++)
+		{
+			unsigned long long word;
+			memcpy(&word, p + i * 8, 8);
+			lanes[i] = HashRound(lanes[i], word);
+		}
+		p += 32;
+	}
+
+	unsigned long long hash = Rotl64(lanes[0], 1) + Rotl64(lanes[1], 7) + Rotl64(lanes[2], 12) + Rotl64(lanes[3], 18);
+	hash += size;
+
+	// Remaining bytes
+	while (end - p >= 8)
+	{
+		unsigned long long word;
+		memcpy(&word, p, 8);
+		hash = HashRound(hash, word);
+		p += 8;
+	}
+	while (p < end)
+		hash = HashRound(hash, *p++);
+
+	// Final avalanche
+	hash ^= hash >> 33;
+	hash *= 0xC2B2AE3D27D4EB4Full;
+	hash ^= hash >> 29;
+	hash *= 0x165667B19E3779F9ull;
+	hash ^= hash >> 32;
+	return hash;
+}
+
+bool MeshBinary::GetFileInfo(const char* path, unsigned long long& size, unsigned long long& writeTime)
+{
+	WIN32_FILE_ATTRIBUTE_DATA info;
+	if (!GetFileAttributesExA(path, GetFileExInfoStandard, &info))
+		return false;
+
+	size = ((unsigned long long)info.nFileSizeHigh << 32) | info.nFileSizeLow;
+	writeTime = ((unsigned long long)info.ftLastWriteTime.dwHighDateTime << 32) | info.ftLastWriteTime.dwLowDateTime;
+	return true;
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "MappedFile.h"
+#include "Vertex.h"
+
+// --------------------------------------------------------
+// Header at the start of every .meshbin file
+//
+// The vertex and index arrays follow the header, each one
+// starting on a 16 byte boundary so they can be used in
+// place, straight out of a memory mapped view - unless
+// they're compressed, in which case they hold MeshCodec
+// streams that are decoded on load.
+// --------------------------------------------------------
+enum MeshBinaryFlags
+{
+	MeshBinaryFlags_Compressed = 1
+};
+
+struct MeshBinaryHeader
+{
+	char Magic[4];					// "MBIN"
+	unsigned int Version;			// Must match MeshBinary::FormatVersion
+	unsigned int VertexStride;		// Must match sizeof(Vertex)
+	unsigned int Flags;				// MeshBinaryFlags
+
+	// What this file was built from
+	unsigned long long SourceSize;
+	unsigned long long SourceWriteTime;
+	unsigned long long SourceHash;
+
+	// Mesh data
+	unsigned int VertexCount;
+	unsigned int IndexCount;
+	unsigned long long VertexOffset;
+	unsigned long long VertexBytes;	// Size in the file (compressed or not)
+	unsigned long long IndexOffset;
+	unsigned long long IndexBytes;
+	DirectX::XMFLOAT3 BoundsMin;
+	DirectX::XMFLOAT3 BoundsMax;
+};
+
+// --------------------------------------------------------
+// Binary cache of a fully processed mesh (final vertices
+// including tangents, plus indices and bounds), written
+// next to the source file the first time it is imported.
+//
+// A cache is used only if it was built from the current
+// source file.  The size and last write time are checked
+// first; if the time differs (say, after a fresh checkout)
+// the source's contents are hashed and compared instead,
+// and the cache is still used if they match.
+// --------------------------------------------------------
+class MeshBinary
+{
+public:
+	// Bump this whenever the format or the import processing changes
+	static const unsigned int FormatVersion = 4;
+
+	// Maps a cache file and validates its header
+	MeshBinary(const char* binFile);
+
+	bool IsValid() { return header != 0; }
+	bool IsCompressed() { return header && (header->Flags & MeshBinaryFlags_Compressed); }
+	bool MatchesSource(const char* sourceFile);
+
+	// Makes the vertices and indices available, decompressing
+	// them if necessary.  Fails if the compressed data is corrupt,
+	// or if any index is past the end of the vertices.
+	bool Load();
+
+	// Pointers into the mapped file itself (or the decompressed
+	// copies) - only valid after Load(), while this object lives
+	const Vertex* GetVertices();
+	const unsigned int* GetIndices();
+	int GetVertexCount() { return header ? (int)header->VertexCount : 0; }
+	int GetIndexCount() { return header ? (int)header->IndexCount : 0; }
+	DirectX::XMFLOAT3 GetBoundsMin() { return header->BoundsMin; }
+	DirectX::XMFLOAT3 GetBoundsMax() { return header->BoundsMax; }
+
+	// Creating cache files.  Compressed files are much smaller, and
+	// reading and decoding one is faster than reading the raw data
+	// from all but the fastest drives (see Benchmarks::MeshCompression).
+	static std::string PathFor(const char* sourceFile);
+	static bool Write(
+		const char* binFile,
+		const char* sourceFile,
+		const Vertex* vertices,
+		int numVerts,
+		const unsigned int* indices,
+		int numIndices,
+		bool compress = true);
+
+	// Hash used to identify source file contents
+	static unsigned long long HashBytes(const void* data, size_t size);
+
+private:
+	MappedFile file;
+	const MeshBinaryHeader* header;
+	bool loaded;
+
+	// Only used for compressed files
+	std::vector<Vertex> decompressedVertices;
+	std::vector<unsigned int> decompressedIndices;
+
+	static bool GetFileInfo(const char* path, unsigned long long& size, unsigned long long& writeTime);
+};
+
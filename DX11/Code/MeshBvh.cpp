@@ -0,0 +1,489 @@
+#include "MeshBvh.h"
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#include <emmintrin.h>
+
+using namespace DirectX;
+
+// Half the surface area of a box, which is all the SAH needs
+static float HalfArea(FXMVECTOR boxMin, FXMVECTOR boxMax)
+{
+	XMFLOAT3 size;
+	XMStoreFloat3(&size, XMVectorMax(boxMax - boxMin, XMVectorZero()));
+	return size.x * size.y + size.y * size.z + size.z * size.x;
+}
+
+// Entry and exit of a ray through a box (slab test), returning
+// whether it enters before maxDistance and exits after the origin
+static bool RayBox(const BvhNode& node, const float* origin, const float* invDirection, float maxDistance)
+{
+	float tx1 = (node.Min.x - origin[0]) * invDirection[0];
+	float tx2 = (node.Max.x - origin[0]) * invDirection[0];
+	float ty1 = (node.Min.y - origin[1]) * invDirection[1];
+	float ty2 = (node.Max.y - origin[1]) * invDirection[1];
+	float tz1 = (node.Min.z - origin[2]) * invDirection[2];
+	float tz2 = (node.Max.z - origin[2]) * invDirection[2];
+
+	float tNear = (std::max)((std::max)((std::min)(tx1, tx2), (std::min)(ty1, ty2)), (std::min)(tz1, tz2));
+	float tFar = (std::min)((std::min)((std::max)(tx1, tx2), (std::max)(ty1, ty2)), (std::max)(tz1, tz2));
+	return tFar >= (std::max)(tNear, 0.0f) && tNear < maxDistance;
+}
+
+
+MeshBvh::MeshBvh() :
+	depth(0)
+{
+}
+
+
+// --------------------------------------------------------
+// Builds the tree from scratch.  Each triangle's bounds and
+// centroid are found first (in parallel), then nodes are
+// split from the root down, partitioning the triangle list
+// in place so every node's triangles stay contiguous.
+// --------------------------------------------------------
+void MeshBvh::Build(const Vertex* vertices, size_t vertexCount, const unsigned int* indices, size_t indexCount, bool multithreaded)
+{
+	nodes.clear();
+	triangles.clear();
+	triangleIds.clear();
+	depth = 0;
+
+	unsigned int triCount = (unsigned int)(indexCount / 3);
+	if (triCount == 0)
+		return;
+
+	// Bounds and centroids
+	const unsigned int trisPerJob = 64 * 1024;
+	std::vector<BuildTriangle> buildTris(triCount);
+	unsigned int jobCount = multithreaded ? (triCount + trisPerJob - 1) / trisPerJob : 1;
+	JobSystem::GetInstance().ParallelFor(jobCount, [&](unsigned int job)
+	{
+		unsigned int first = multithreaded ? job * trisPerJob : 0;
+		unsigned int last = multithreaded ? (std::min)(first + trisPerJob, triCount) : triCount;
+		for (unsigned int t = first; t < last; t++)
+		{
+			XMVECTOR p0 = XMLoadFloat3(&vertices[indices[t * 3]].Position);
+			XMVECTOR p1 = XMLoadFloat3(&vertices[indices[t * 3 + 1]].Position);
+			XMVECTOR p2 = XMLoadFloat3(&vertices[indices[t * 3 + 2]].Position);
+			XMVECTOR triMin = XMVectorMin(p0, XMVectorMin(p1, p2));
+			XMVECTOR triMax = XMVectorMax(p0, XMVectorMax(p1, p2));
+			XMStoreFloat3(&buildTris[t].Min, triMin);
+			XMStoreFloat3(&buildTris[t].Max, triMax);
+			XMStoreFloat3(&buildTris[t].Centroid, (triMin + triMax) * 0.5f);
+		}
+	});
+
+	triangleIds.resize(triCount);
+	for (unsigned int t = 0; t < triCount; t++)
+		triangleIds[t] = t;
+
+	// A binary tree with at least one triangle per leaf has fewer
+	// than twice as many nodes as triangles
+	nodes.resize(triCount * 2);
+	std::atomic<unsigned int> nodeCount(1);
+	BuildNode(0, 0, triCount, 0, buildTris, nodeCount, multithreaded);
+	nodes.resize(nodeCount);
+
+	// Store the triangles in leaf order, ready for intersection tests
+	triangles.resize(triCount);
+	for (unsigned int i = 0; i < triCount; i++)
+	{
+		unsigned int t = triangleIds[i];
+		XMVECTOR p0 = XMLoadFloat3(&vertices[indices[t * 3]].Position);
+		XMVECTOR p1 = XMLoadFloat3(&vertices[indices[t * 3 + 1]].Position);
+		XMVECTOR p2 = XMLoadFloat3(&vertices[indices[t * 3 + 2]].Position);
+		XMStoreFloat3(&triangles[i].V0, p0);
+		XMStoreFloat3(&triangles[i].Edge1, p1 - p0);
+		XMStoreFloat3(&triangles[i].Edge2, p2 - p0);
+	}
+
+	// Depth of the finished tree
+	std::vector<std::pair<unsigned int, unsigned int>> stack(1, { 0u, 1u });
+	while (!stack.empty())
+	{
+		auto entry = stack.back();
+		stack.pop_back();
+		depth = (std::max)(depth, entry.second);
+
+		const BvhNode& node = nodes[entry.first];
+		if (node.TriangleCount == 0)
+		{
+			stack.push_back({ node.Index, entry.second + 1 });
+			stack.push_back({ node.Index + 1, entry.second + 1 });
+		}
+	}
+}
+
+
+// --------------------------------------------------------
+// Sets up a node for the given range of triangleIds, and
+// either makes it a leaf or splits it where the SAH says is
+// cheapest: each axis's centroid range is divided into bins,
+// and the bin boundaries are all tried as split points.
+// --------------------------------------------------------
+void MeshBvh::BuildNode(unsigned int nodeIndex, unsigned int first, unsigned int count, unsigned int nodeDepth, const std::vector<BuildTriangle>& buildTris, std::atomic<unsigned int>& nodeCount, bool multithreaded)
+{
+	BvhNode& node = nodes[nodeIndex];
+
+	// Bounds of the triangles, and of their centroids
+	XMVECTOR boundsMin = XMVectorReplicate(FLT_MAX);
+	XMVECTOR boundsMax = XMVectorReplicate(-FLT_MAX);
+	XMVECTOR centroidMin = boundsMin;
+	XMVECTOR centroidMax = boundsMax;
+	for (unsigned int i = first; i < first + count; i++)
+	{
+		const BuildTriangle& tri = buildTris[triangleIds[i]];
+		XMVECTOR centroid = XMLoadFloat3(&tri.Centroid);
+		boundsMin = XMVectorMin(boundsMin, XMLoadFloat3(&tri.Min));
+		boundsMax = XMVectorMax(boundsMax, XMLoadFloat3(&tri.Max));
+		centroidMin = XMVectorMin(centroidMin, centroid);
+		centroidMax = XMVectorMax(centroidMax, centroid);
+	}
+	XMStoreFloat3(&node.Min, boundsMin);
+	XMStoreFloat3(&node.Max, boundsMax);
+
+	node.Index = first;
+	node.TriangleCount = count;
+	if (count == 1 || nodeDepth + 1 >= MaxDepth)
+		return;
+
+	// Find the cheapest split over all three axes
+	XMFLOAT3 cMin, cExtent;
+	XMStoreFloat3(&cMin, centroidMin);
+	XMStoreFloat3(&cExtent, centroidMax - centroidMin);
+	const float* cMinAxis = &cMin.x;
+	const float* cExtentAxis = &cExtent.x;
+
+	// Bin the triangles along all three axes in one pass
+	unsigned int binCounts[3][BinCount] = {};
+	XMVECTOR binMin[3][BinCount];
+	XMVECTOR binMax[3][BinCount];
+	for (int axis = 0; axis < 3; axis++)
+	{
+		for (int b = 0; b < BinCount; b++)
+		{
+			binMin[axis][b] = XMVectorReplicate(FLT_MAX);
+			binMax[axis][b] = XMVectorReplicate(-FLT_MAX);
+		}
+	}
+
+	float scale[3];
+	for (int axis = 0; axis < 3; axis++)
+		scale[axis] = cExtentAxis[axis] > 0.0f ? BinCount / cExtentAxis[axis] : 0.0f;
+
+	for (unsigned int i = first; i < first + count; i++)
+	{
+		const BuildTriangle& tri = buildTris[triangleIds[i]];
+		XMVECTOR triMin = XMLoadFloat3(&tri.Min);
+		XMVECTOR triMax = XMLoadFloat3(&tri.Max);
+		const float* centroid = &tri.Centroid.x;
+		for (int axis = 0; axis < 3; axis++)
+		{
+			int b = (std::min)((int)((centroid[axis] - cMinAxis[axis]) * scale[axis]), BinCount - 1);
+			binCounts[axis][b]++;
+			binMin[axis][b] = XMVectorMin(binMin[axis][b], triMin);
+			binMax[axis][b] = XMVectorMax(binMax[axis][b], triMax);
+		}
+	}
+
+	float bestCost = FLT_MAX;
+	int bestAxis = -1;
+	int bestSplit = 0;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		if (cExtentAxis[axis] <= 0.0f)
+			continue;
+
+		// Sweep from the right to get the cost of everything past each
+		// boundary, then from the left to add the rest
+		float rightCost[BinCount];
+		XMVECTOR sweepMin = XMVectorReplicate(FLT_MAX);
+		XMVECTOR sweepMax = XMVectorReplicate(-FLT_MAX);
+		unsigned int sweepCount = 0;
+		for (int b = BinCount - 1; b > 0; b--)
+		{
+			sweepMin = XMVectorMin(sweepMin, binMin[axis][b]);
+			sweepMax = XMVectorMax(sweepMax, binMax[axis][b]);
+			sweepCount += binCounts[axis][b];
+			rightCost[b] = sweepCount > 0 ? sweepCount * HalfArea(sweepMin, sweepMax) : -1.0f;
+		}
+
+		sweepMin = XMVectorReplicate(FLT_MAX);
+		sweepMax = XMVectorReplicate(-FLT_MAX);
+		sweepCount = 0;
+		for (int b = 0; b < BinCount - 1; b++)
+		{
+			sweepMin = XMVectorMin(sweepMin, binMin[axis][b]);
+			sweepMax = XMVectorMax(sweepMax, binMax[axis][b]);
+			sweepCount += binCounts[axis][b];
+			if (sweepCount == 0 || rightCost[b + 1] < 0.0f)
+				continue;
+
+			float cost = sweepCount * HalfArea(sweepMin, sweepMax) + rightCost[b + 1];
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				bestAxis = axis;
+				bestSplit = b + 1;
+			}
+		}
+	}
+
+	// Splitting costs one box test (relative to a triangle test) on top
+	// of the children's costs, so small nodes may be better as leaves
+	float area = HalfArea(boundsMin, boundsMax);
+	if (count <= MaxLeafTriangles && (bestAxis < 0 || area + bestCost >= area * count))
+		return;
+
+	// Partition the triangles, or just halve them if their centroids
+	// are all in the same place
+	unsigned int mid = first + count / 2;
+	if (bestAxis >= 0)
+	{
+		float axisScale = scale[bestAxis];
+		float axisMin = cMinAxis[bestAxis];
+		unsigned int* split = std::partition(&triangleIds[first], &triangleIds[first] + count, [&](unsigned int t)
+		{
+			int b = (std::min)((int)(((&buildTris[t].Centroid.x)[bestAxis] - axisMin) * axisScale), BinCount - 1);
+			return b < bestSplit;
+		});
+		mid = (unsigned int)(split - &triangleIds[0]);
+	}
+
+	// Children go next to each other
+	unsigned int left = nodeCount.fetch_add(2);
+	node.Index = left;
+	node.TriangleCount = 0;
+
+	unsigned int childFirst[2] = { first, mid };
+	unsigned int childCount[2] = { mid - first, first + count - mid };
+	if (multithreaded && count >= ParallelBuildTriangles)
+	{
+		JobSystem::GetInstance().ParallelFor(2, [&](unsigned int c)
+		{
+			BuildNode(left + c, childFirst[c], childCount[c], nodeDepth + 1, buildTris, nodeCount, multithreaded);
+		});
+	}
+	else
+	{
+		BuildNode(left, childFirst[0], childCount[0], nodeDepth + 1, buildTris, nodeCount, multithreaded);
+		BuildNode(left + 1, childFirst[1], childCount[1], nodeDepth + 1, buildTris, nodeCount, multithreaded);
+	}
+}
+
+
+// --------------------------------------------------------
+// Walks the tree front to back (the child whose center is
+// further along the ray goes on the stack), shrinking the
+// search distance with each hit so far away nodes are
+// skipped
+// --------------------------------------------------------
+bool MeshBvh::Raycast(XMFLOAT3 origin, XMFLOAT3 direction, float maxDistance, RayHit& hit) const
+{
+	if (nodes.empty())
+		return false;
+
+	const float o[3] = { origin.x, origin.y, origin.z };
+	const float d[3] = { direction.x, direction.y, direction.z };
+	const float inv[3] = { 1.0f / d[0], 1.0f / d[1], 1.0f / d[2] };
+
+	unsigned int stack[MaxDepth + 1];
+	int stackSize = 0;
+	stack[stackSize++] = 0;
+
+	float closest = maxDistance;
+	bool found = false;
+	while (stackSize > 0)
+	{
+		const BvhNode& node = nodes[stack[--stackSize]];
+		if (!RayBox(node, o, inv, closest))
+			continue;
+
+		if (node.TriangleCount > 0)
+		{
+			// Moller-Trumbore ray/triangle test, from either side
+			for (unsigned int i = node.Index; i < node.Index + node.TriangleCount; i++)
+			{
+				const BvhTriangle& tri = triangles[i];
+				const float* e1 = &tri.Edge1.x;
+				const float* e2 = &tri.Edge2.x;
+
+				float p[3] = { d[1] * e2[2] - d[2] * e2[1], d[2] * e2[0] - d[0] * e2[2], d[0] * e2[1] - d[1] * e2[0] };
+				float det = e1[0] * p[0] + e1[1] * p[1] + e1[2] * p[2];
+				if (det == 0.0f)
+					continue;
+				float invDet = 1.0f / det;
+
+				float s[3] = { o[0] - tri.V0.x, o[1] - tri.V0.y, o[2] - tri.V0.z };
+				float u = (s[0] * p[0] + s[1] * p[1] + s[2] * p[2]) * invDet;
+				if (u < 0.0f || u > 1.0f)
+					continue;
+
+				float q[3] = { s[1] * e1[2] - s[2] * e1[1], s[2] * e1[0] - s[0] * e1[2], s[0] * e1[1] - s[1] * e1[0] };
+				float v = (d[0] * q[0] + d[1] * q[1] + d[2] * q[2]) * invDet;
+				if (v < 0.0f || u + v > 1.0f)
+					continue;
+
+				float t = (e2[0] * q[0] + e2[1] * q[1] + e2[2] * q[2]) * invDet;
+				if (t <= 0.0f || t >= closest)
+					continue;
+
+				closest = t;
+				hit.Distance = t;
+				hit.Triangle = triangleIds[i];
+				hit.U = u;
+				hit.V = v;
+				found = true;
+			}
+			continue;
+		}
+
+		// Nearer child on top of the stack
+		const BvhNode& left = nodes[node.Index];
+		const BvhNode& right = nodes[node.Index + 1];
+		float leftAlong = (left.Min.x + left.Max.x) * d[0] + (left.Min.y + left.Max.y) * d[1] + (left.Min.z + left.Max.z) * d[2];
+		float rightAlong = (right.Min.x + right.Max.x) * d[0] + (right.Min.y + right.Max.y) * d[1] + (right.Min.z + right.Max.z) * d[2];
+		bool leftFirst = leftAlong <= rightAlong;
+		stack[stackSize++] = leftFirst ? node.Index + 1 : node.Index;
+		stack[stackSize++] = leftFirst ? node.Index : node.Index + 1;
+	}
+
+	return found;
+}
+
+
+// --------------------------------------------------------
+// Same as Raycast(), but with the four rays in SSE registers
+// (one per component, across the rays).  A node is visited
+// if any of the rays that are still searching hit it, and
+// each triangle is tested against all four at once.
+// --------------------------------------------------------
+int MeshBvh::Raycast4(const XMFLOAT3 origins[4], const XMFLOAT3 directions[4], float maxDistance, RayHit hits[4]) const
+{
+	if (nodes.empty())
+		return 0;
+
+#define LOAD4(array, member) _mm_setr_ps(array[0].member, array[1].member, array[2].member, array[3].member)
+	const __m128 ox = LOAD4(origins, x), oy = LOAD4(origins, y), oz = LOAD4(origins, z);
+	const __m128 dx = LOAD4(directions, x), dy = LOAD4(directions, y), dz = LOAD4(directions, z);
+#undef LOAD4
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 ix = _mm_div_ps(one, dx), iy = _mm_div_ps(one, dy), iz = _mm_div_ps(one, dz);
+
+	// Closest hit of each ray so far
+	__m128 closest = _mm_set1_ps(maxDistance);
+	__m128 hitU = zero, hitV = zero;
+	__m128i hitTriangle = _mm_setzero_si128();
+	__m128 anyHit = zero;
+
+	// Front to back order is picked with the rays' average direction
+	XMFLOAT3 sumDirection(
+		directions[0].x + directions[1].x + directions[2].x + directions[3].x,
+		directions[0].y + directions[1].y + directions[2].y + directions[3].y,
+		directions[0].z + directions[1].z + directions[2].z + directions[3].z);
+
+	unsigned int stack[MaxDepth + 1];
+	int stackSize = 0;
+	stack[stackSize++] = 0;
+
+	while (stackSize > 0)
+	{
+		const BvhNode& node = nodes[stack[--stackSize]];
+
+		// Slab test for all four rays
+		__m128 tx1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.Min.x), ox), ix);
+		__m128 tx2 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.Max.x), ox), ix);
+		__m128 ty1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.Min.y), oy), iy);
+		__m128 ty2 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.Max.y), oy), iy);
+		__m128 tz1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.Min.z), oz), iz);
+		__m128 tz2 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.Max.z), oz), iz);
+		__m128 tNear = _mm_max_ps(_mm_max_ps(_mm_min_ps(tx1, tx2), _mm_min_ps(ty1, ty2)), _mm_min_ps(tz1, tz2));
+		__m128 tFar = _mm_min_ps(_mm_min_ps(_mm_max_ps(tx1, tx2), _mm_max_ps(ty1, ty2)), _mm_max_ps(tz1, tz2));
+		__m128 boxHit = _mm_and_ps(_mm_cmpge_ps(tFar, _mm_max_ps(tNear, zero)), _mm_cmplt_ps(tNear, closest));
+		if (_mm_movemask_ps(boxHit) == 0)
+			continue;
+
+		if (node.TriangleCount > 0)
+		{
+			for (unsigned int i = node.Index; i < node.Index + node.TriangleCount; i++)
+			{
+				const BvhTriangle& tri = triangles[i];
+				__m128 e1x = _mm_set1_ps(tri.Edge1.x), e1y = _mm_set1_ps(tri.Edge1.y), e1z = _mm_set1_ps(tri.Edge1.z);
+				__m128 e2x = _mm_set1_ps(tri.Edge2.x), e2y = _mm_set1_ps(tri.Edge2.y), e2z = _mm_set1_ps(tri.Edge2.z);
+
+				__m128 px = _mm_sub_ps(_mm_mul_ps(dy, e2z), _mm_mul_ps(dz, e2y));
+				__m128 py = _mm_sub_ps(_mm_mul_ps(dz, e2x), _mm_mul_ps(dx, e2z));
+				__m128 pz = _mm_sub_ps(_mm_mul_ps(dx, e2y), _mm_mul_ps(dy, e2x));
+				__m128 det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, px), _mm_mul_ps(e1y, py)), _mm_mul_ps(e1z, pz));
+				__m128 invDet = _mm_div_ps(one, det);
+
+				__m128 sx = _mm_sub_ps(ox, _mm_set1_ps(tri.V0.x));
+				__m128 sy = _mm_sub_ps(oy, _mm_set1_ps(tri.V0.y));
+				__m128 sz = _mm_sub_ps(oz, _mm_set1_ps(tri.V0.z));
+				__m128 u = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(sx, px), _mm_mul_ps(sy, py)), _mm_mul_ps(sz, pz)), invDet);
+
+				__m128 qx = _mm_sub_ps(_mm_mul_ps(sy, e1z), _mm_mul_ps(sz, e1y));
+				__m128 qy = _mm_sub_ps(_mm_mul_ps(sz, e1x), _mm_mul_ps(sx, e1z));
+				__m128 qz = _mm_sub_ps(_mm_mul_ps(sx, e1y), _mm_mul_ps(sy, e1x));
+				__m128 v = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, qx), _mm_mul_ps(dy, qy)), _mm_mul_ps(dz, qz)), invDet);
+				__m128 t = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)), _mm_mul_ps(e2z, qz)), invDet);
+
+				// Comparisons with NaN (from a zero determinant) fail, but
+				// the determinant is checked as well to be safe
+				__m128 mask = _mm_cmpneq_ps(det, zero);
+				mask = _mm_and_ps(mask, _mm_cmpge_ps(u, zero));
+				mask = _mm_and_ps(mask, _mm_cmpge_ps(v, zero));
+				mask = _mm_and_ps(mask, _mm_cmple_ps(_mm_add_ps(u, v), one));
+				mask = _mm_and_ps(mask, _mm_cmpgt_ps(t, zero));
+				mask = _mm_and_ps(mask, _mm_cmplt_ps(t, closest));
+				if (_mm_movemask_ps(mask) == 0)
+					continue;
+
+				// Keep this hit for the rays it's closest for
+				closest = _mm_or_ps(_mm_and_ps(mask, t), _mm_andnot_ps(mask, closest));
+				hitU = _mm_or_ps(_mm_and_ps(mask, u), _mm_andnot_ps(mask, hitU));
+				hitV = _mm_or_ps(_mm_and_ps(mask, v), _mm_andnot_ps(mask, hitV));
+				__m128i maski = _mm_castps_si128(mask);
+				hitTriangle = _mm_or_si128(_mm_and_si128(maski, _mm_set1_epi32((int)triangleIds[i])), _mm_andnot_si128(maski, hitTriangle));
+				anyHit = _mm_or_ps(anyHit, mask);
+			}
+			continue;
+		}
+
+		// Nearer child on top of the stack
+		const BvhNode& left = nodes[node.Index];
+		const BvhNode& right = nodes[node.Index + 1];
+		float leftAlong = (left.Min.x + left.Max.x) * sumDirection.x + (left.Min.y + left.Max.y) * sumDirection.y + (left.Min.z + left.Max.z) * sumDirection.z;
+		float rightAlong = (right.Min.x + right.Max.x) * sumDirection.x + (right.Min.y + right.Max.y) * sumDirection.y + (right.Min.z + right.Max.z) * sumDirection.z;
+		bool leftFirst = leftAlong <= rightAlong;
+		stack[stackSize++] = leftFirst ? node.Index + 1 : node.Index;
+		stack[stackSize++] = leftFirst ? node.Index : node.Index + 1;
+	}
+
+	// Back to one hit per ray
+	float distances[4], us[4], vs[4];
+	unsigned int ids[4];
+	_mm_storeu_ps(distances, closest);
+	_mm_storeu_ps(us, hitU);
+	_mm_storeu_ps(vs, hitV);
+	_mm_storeu_si128((__m128i*)ids, hitTriangle);
+
+	int hitMask = _mm_movemask_ps(anyHit);
+	for (int r = 0; r < 4; r++)
+	{
+		if (hitMask & (1 << r))
+		{
+			hits[r].Distance = distances[r];
+			hits[r].Triangle = ids[r];
+			hits[r].U = us[r];
+			hits[r].V = vs[r];
+		}
+	}
+	return hitMask;
+}
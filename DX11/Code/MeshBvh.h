@@ -0,0 +1,93 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <atomic>
+#include <vector>
+
+#include "Vertex.h"
+
+// --------------------------------------------------------
+// A node of a MeshBvh, packed into 32 bytes.  Inner nodes'
+// two children are next to each other, starting at Index,
+// and leaves hold TriangleCount triangles starting at Index.
+// --------------------------------------------------------
+struct BvhNode
+{
+	DirectX::XMFLOAT3 Min;
+	unsigned int Index;
+	DirectX::XMFLOAT3 Max;
+	unsigned int TriangleCount;	// 0 for inner nodes
+};
+
+struct RayHit
+{
+	float Distance;			// Along the ray, in multiples of its direction
+	unsigned int Triangle;	// Which triangle of the mesh's index list
+	float U;				// Barycentric weights of the triangle's
+	float V;				//  second and third vertices at the hit
+};
+
+// --------------------------------------------------------
+// Bounding volume hierarchy over a mesh's triangles, for
+// ray casts on the CPU (picking, line of sight, etc.)
+//
+// Built top down with a binned surface area heuristic
+// (Wald, "On fast Construction of SAH-based Bounding Volume
+// Hierarchies"), with large subtrees built in parallel.
+// Triangles hit from either side count.
+// --------------------------------------------------------
+class MeshBvh
+{
+public:
+	MeshBvh();
+
+	void Build(const Vertex* vertices, size_t vertexCount, const unsigned int* indices, size_t indexCount, bool multithreaded = true);
+
+	// Finds the closest hit within maxDistance, if any
+	bool Raycast(DirectX::XMFLOAT3 origin, DirectX::XMFLOAT3 direction, float maxDistance, RayHit& hit) const;
+
+	// Traces four rays at once with SSE (fastest when they're close
+	// together, like neighboring pixels), returning a bit per ray
+	// that hit something
+	int Raycast4(const DirectX::XMFLOAT3 origins[4], const DirectX::XMFLOAT3 directions[4], float maxDistance, RayHit hits[4]) const;
+
+	bool IsEmpty() const { return nodes.empty(); }
+	size_t GetNodeCount() const { return nodes.size(); }
+	unsigned int GetDepth() const { return depth; }
+	size_t GetMemorySize() const { return nodes.size() * sizeof(BvhNode) + triangles.size() * sizeof(BvhTriangle) + triangleIds.size() * sizeof(unsigned int); }
+
+	static const unsigned int MaxLeafTriangles = 4;
+
+private:
+	// Triangles in leaf order, as one corner and the edges to the
+	// other two (what the intersection test wants)
+	struct BvhTriangle
+	{
+		DirectX::XMFLOAT3 V0;
+		DirectX::XMFLOAT3 Edge1;
+		DirectX::XMFLOAT3 Edge2;
+	};
+
+	// Per triangle data used while building
+	struct BuildTriangle
+	{
+		DirectX::XMFLOAT3 Min;
+		DirectX::XMFLOAT3 Max;
+		DirectX::XMFLOAT3 Centroid;
+	};
+
+	static const int BinCount = 16;
+
+	// Deeper nodes become leaves regardless, to bound the traversal stack
+	static const unsigned int MaxDepth = 64;
+
+	// Subtrees with at least this many triangles are built in parallel
+	static const unsigned int ParallelBuildTriangles = 16 * 1024;
+
+	std::vector<BvhNode> nodes;
+	std::vector<BvhTriangle> triangles;
+	std::vector<unsigned int> triangleIds;
+	unsigned int depth;
+
+	void BuildNode(unsigned int nodeIndex, unsigned int first, unsigned int count, unsigned int nodeDepth, const std::vector<BuildTriangle>& buildTris, std::atomic<unsigned int>& nodeCount, bool multithreaded);
+};
@@ -0,0 +1,306 @@
+#include "MeshCodec.h"
+
+#include <cstring>
+
+#include <emmintrin.h>
+
+// Bytes of packed data for each group bit width code (0, 2, 4 or 8 bits per delta)
+static const size_t GroupBytes[4] = { 0, 4, 8, 16 };
+
+// Small signed deltas become small unsigned values: 0, -1, 1, -2, 2...
+static inline unsigned char ZigZag8(unsigned char delta)
+{
+	unsigned char sign = (delta & 0x80) ? 0xFF : 0;
+	return (unsigned char)((delta << 1) ^ sign);
+}
+
+static inline unsigned int ZigZag32(int value)
+{
+	return ((unsigned int)value << 1) ^ (unsigned int)(value >> 31);
+}
+
+static inline int UnZigZag32(unsigned int value)
+{
+	return (int)(value >> 1) ^ -(int)(value & 1);
+}
+
+
+// --------------------------------------------------------
+// Vertex encoding
+// --------------------------------------------------------
+
+// Packs one plane's worth of deltas (padded to a whole number of groups)
+static void EncodePlane(const unsigned char* deltas, size_t groups, std::vector<unsigned char>& output)
+{
+	// Two bits of header per group, four groups per byte
+	size_t headerStart = output.size();
+	output.resize(headerStart + (groups + 3) / 4, 0);
+
+	for (size_t g = 0; g < groups; g++)
+	{
+		const unsigned char* values = deltas + g * MeshCodec::GroupSize;
+
+		unsigned char largest = 0;
+		for (size_t i = 0; i < MeshCodec::GroupSize; i++)
+			largest |= values[i];
+		unsigned int code = largest == 0 ? 0 : largest < 4 ? 1 : largest < 16 ? 2 : 3;
+		output[headerStart + g / 4] |= (unsigned char)(code << ((g % 4) * 2));
+
+		switch (code)
+		{
+		case 1:
+			for (size_t j = 0; j < 4; j++)
+				output.push_back((unsigned char)(values[j * 4] | (values[j * 4 + 1] << 2) | (values[j * 4 + 2] << 4) | (values[j * 4 + 3] << 6)));
+			break;
+		case 2:
+			for (size_t j = 0; j < 8; j++)
+				output.push_back((unsigned char)(values[j * 2] | (values[j * 2 + 1] << 4)));
+			break;
+		case 3:
+			output.insert(output.end(), values, values + MeshCodec::GroupSize);
+			break;
+		}
+	}
+}
+
+bool MeshCodec::EncodeVertices(const void* vertices, size_t count, size_t stride, std::vector<unsigned char>& output)
+{
+	if (stride == 0 || stride > MaxStride)
+		return false;
+
+	const unsigned char* bytes = (const unsigned char*)vertices;
+
+	// Each plane deltas against the previous vertex, starting from zero
+	std::vector<unsigned char> previous(stride, 0);
+	unsigned char deltas[BlockVertices];
+
+	for (size_t blockStart = 0; blockStart < count; blockStart += BlockVertices)
+	{
+		size_t blockCount = (count - blockStart < BlockVertices) ? count - blockStart : BlockVertices;
+		size_t groups = (blockCount + GroupSize - 1) / GroupSize;
+
+		for (size_t k = 0; k < stride; k++)
+		{
+			// Padding deltas are zero, so padded values repeat the last real one
+			memset(deltas, 0, sizeof(deltas));
+			for (size_t i = 0; i < blockCount; i++)
+			{
+				unsigned char value = bytes[(blockStart + i) * stride + k];
+				deltas[i] = ZigZag8((unsigned char)(value - previous[k]));
+				previous[k] = value;
+			}
+
+			EncodePlane(deltas, groups, output);
+		}
+	}
+
+	return true;
+}
+
+
+// --------------------------------------------------------
+// Vertex decoding
+// --------------------------------------------------------
+
+// Expands one group of packed deltas to 16 bytes
+static inline __m128i UnpackGroup(unsigned int code, const unsigned char* data)
+{
+	switch (code)
+	{
+	case 1:
+	{
+		// Byte j holds deltas 4j..4j+3, two bits each
+		int word;
+		memcpy(&word, data, 4);
+		__m128i v = _mm_cvtsi32_si128(word);
+		__m128i mask = _mm_set1_epi8(3);
+		__m128i v0 = _mm_and_si128(v, mask);
+		__m128i v1 = _mm_and_si128(_mm_srli_epi16(v, 2), mask);
+		__m128i v2 = _mm_and_si128(_mm_srli_epi16(v, 4), mask);
+		__m128i v3 = _mm_and_si128(_mm_srli_epi16(v, 6), mask);
+		return _mm_unpacklo_epi16(_mm_unpacklo_epi8(v0, v1), _mm_unpacklo_epi8(v2, v3));
+	}
+	case 2:
+	{
+		// Byte j holds deltas 2j and 2j+1, four bits each
+		__m128i v = _mm_loadl_epi64((const __m128i*)data);
+		__m128i mask = _mm_set1_epi8(15);
+		return _mm_unpacklo_epi8(_mm_and_si128(v, mask), _mm_and_si128(_mm_srli_epi16(v, 4), mask));
+	}
+	case 3:
+		return _mm_loadu_si128((const __m128i*)data);
+	default:
+		return _mm_setzero_si128();
+	}
+}
+
+// Turns 16 zigzagged deltas back into values, continuing on from "previous"
+// (which holds the last value so far in every byte, and is updated)
+static inline __m128i ReconstructGroup(__m128i deltas, __m128i& previous)
+{
+	// Undo the zigzag: (z >> 1) ^ -(z & 1)
+	__m128i half = _mm_and_si128(_mm_srli_epi16(deltas, 1), _mm_set1_epi8(0x7F));
+	__m128i sign = _mm_sub_epi8(_mm_setzero_si128(), _mm_and_si128(deltas, _mm_set1_epi8(1)));
+	__m128i x = _mm_xor_si128(half, sign);
+
+	// Running sum across the 16 bytes in four steps
+	x = _mm_add_epi8(x, _mm_slli_si128(x, 1));
+	x = _mm_add_epi8(x, _mm_slli_si128(x, 2));
+	x = _mm_add_epi8(x, _mm_slli_si128(x, 4));
+	x = _mm_add_epi8(x, _mm_slli_si128(x, 8));
+	x = _mm_add_epi8(x, previous);
+
+	// Broadcast the last value for the next group
+	__m128i last = _mm_srli_si128(x, 15);
+	last = _mm_unpacklo_epi8(last, last);
+	last = _mm_unpacklo_epi16(last, last);
+	previous = _mm_shuffle_epi32(last, 0);
+	return x;
+}
+
+// Writes decoded planes back out as whole vertices
+static void InterleavePlanes(const unsigned char* planes, size_t count, size_t stride, unsigned char* output)
+{
+	// Four planes and sixteen vertices at a time, transposed
+	// in registers into sixteen 4-byte pieces of vertices
+	size_t fullGroups = count / MeshCodec::GroupSize * MeshCodec::GroupSize;
+	size_t k = 0;
+	for (; k + 4 <= stride; k += 4)
+	{
+		const unsigned char* plane = planes + k * MeshCodec::BlockVertices;
+		for (size_t i = 0; i < fullGroups; i += MeshCodec::GroupSize)
+		{
+			__m128i a = _mm_loadu_si128((const __m128i*)(plane + i));
+			__m128i b = _mm_loadu_si128((const __m128i*)(plane + MeshCodec::BlockVertices + i));
+			__m128i c = _mm_loadu_si128((const __m128i*)(plane + MeshCodec::BlockVertices * 2 + i));
+			__m128i d = _mm_loadu_si128((const __m128i*)(plane + MeshCodec::BlockVertices * 3 + i));
+			__m128i abLow = _mm_unpacklo_epi8(a, b);
+			__m128i abHigh = _mm_unpackhi_epi8(a, b);
+			__m128i cdLow = _mm_unpacklo_epi8(c, d);
+			__m128i cdHigh = _mm_unpackhi_epi8(c, d);
+
+			unsigned int pieces[16];
+			_mm_storeu_si128((__m128i*)&pieces[0], _mm_unpacklo_epi16(abLow, cdLow));
+			_mm_storeu_si128((__m128i*)&pieces[4], _mm_unpackhi_epi16(abLow, cdLow));
+			_mm_storeu_si128((__m128i*)&pieces[8], _mm_unpacklo_epi16(abHigh, cdHigh));
+			_mm_storeu_si128((__m128i*)&pieces[12], _mm_unpackhi_epi16(abHigh, cdHigh));
+
+			unsigned char* vertex = output + i * stride + k;
+			for (size_t j = 0; j < MeshCodec::GroupSize; j++)
+				memcpy(vertex + j * stride, &pieces[j], 4);
+		}
+
+		// Leftover vertices
+		for (size_t i = fullGroups; i < count; i++)
+			for (size_t p = 0; p < 4; p++)
+				output[i * stride + k + p] = plane[p * MeshCodec::BlockVertices + i];
+	}
+
+	// Leftover planes, if the stride isn't a multiple of four
+	for (; k < stride; k++)
+		for (size_t i = 0; i < count; i++)
+			output[i * stride + k] = planes[k * MeshCodec::BlockVertices + i];
+}
+
+bool MeshCodec::DecodeVertices(void* vertices, size_t count, size_t stride, const unsigned char* data, size_t size)
+{
+	unsigned char* output = (unsigned char*)vertices;
+	const unsigned char* end = data + size;
+
+	if (stride == 0 || stride > MaxStride)
+		return false;
+
+	// Planes are decoded side by side, then interleaved into vertices
+	// (on the stack, as small meshes would otherwise be dominated by
+	// allocating these)
+	__m128i previous[MaxStride];
+	for (size_t k = 0; k < stride; k++)
+		previous[k] = _mm_setzero_si128();
+	unsigned char planes[MaxStride * BlockVertices];
+
+	for (size_t blockStart = 0; blockStart < count; blockStart += BlockVertices)
+	{
+		size_t blockCount = (count - blockStart < BlockVertices) ? count - blockStart : BlockVertices;
+		size_t groups = (blockCount + GroupSize - 1) / GroupSize;
+		size_t headerBytes = (groups + 3) / 4;
+
+		for (size_t k = 0; k < stride; k++)
+		{
+			if ((size_t)(end - data) < headerBytes)
+				return false;
+			const unsigned char* header = data;
+			data += headerBytes;
+
+			unsigned char* plane = &planes[k * BlockVertices];
+			for (size_t g = 0; g < groups; g++)
+			{
+				unsigned int code = (header[g / 4] >> ((g % 4) * 2)) & 3;
+				if ((size_t)(end - data) < GroupBytes[code])
+					return false;
+
+				__m128i values = ReconstructGroup(UnpackGroup(code, data), previous[k]);
+				_mm_storeu_si128((__m128i*)(plane + g * GroupSize), values);
+				data += GroupBytes[code];
+			}
+		}
+
+		InterleavePlanes(planes, blockCount, stride, output + blockStart * stride);
+	}
+
+	// Everything should have been used up exactly
+	return data == end;
+}
+
+
+// --------------------------------------------------------
+// Index encoding and decoding
+// --------------------------------------------------------
+void MeshCodec::EncodeIndices(const unsigned int* indices, size_t count, std::vector<unsigned char>& output)
+{
+	unsigned int previous = 0;
+	for (size_t i = 0; i < count; i++)
+	{
+		// Seven bits at a time, high bit set on all but the last byte
+		unsigned int value = ZigZag32((int)(indices[i] - previous));
+		while (value >= 0x80)
+		{
+			output.push_back((unsigned char)(value | 0x80));
+			value >>= 7;
+		}
+		output.push_back((unsigned char)value);
+		previous = indices[i];
+	}
+}
+
+bool MeshCodec::DecodeIndices(unsigned int* indices, size_t count, const unsigned char* data, size_t size)
+{
+	const unsigned char* end = data + size;
+	unsigned int previous = 0;
+
+	for (size_t i = 0; i < count; i++)
+	{
+		if (data == end)
+			return false;
+
+		// Most deltas fit in a single byte
+		unsigned int value = *data++;
+		if (value >= 0x80)
+		{
+			value &= 0x7F;
+			for (int shift = 7; ; shift += 7)
+			{
+				if (data == end || shift > 28)
+					return false;
+				unsigned int byte = *data++;
+				value |= (byte & 0x7F) << shift;
+				if (byte < 0x80)
+					break;
+			}
+		}
+
+		previous += (unsigned int)UnZigZag32(value);
+		indices[i] = previous;
+	}
+
+	return data == end;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <vector>
+
+// --------------------------------------------------------
+// Lossless compression for vertex and index buffers
+//
+// Vertices are handled as raw bytes, in blocks of up to
+// BlockVertices vertices.  Within a block, byte k of every
+// vertex forms a "byte plane", which is delta coded against
+// the previous vertex.  Neighboring vertices tend to be
+// similar, so most deltas are small - sign and exponent
+// bytes are nearly always zero.  Each plane is then bit
+// packed in groups of 16 deltas, with every group stored
+// at 0, 2, 4 or 8 bits per delta (whichever is smallest).
+//
+// Indices are delta coded against the previous index and
+// written as variable length integers, so a well ordered
+// index buffer takes about one byte per index.
+//
+// Decoding uses SSE2 and only touches each byte a couple
+// of times, so it runs well above 1 GB/s on a single core.
+// --------------------------------------------------------
+class MeshCodec
+{
+public:
+	// Vertices per block.  Must be a multiple of GroupSize.
+	static const size_t BlockVertices = 256;
+
+	// Deltas that share a bit width
+	static const size_t GroupSize = 16;
+
+	// Largest vertex supported, in bytes
+	static const size_t MaxStride = 64;
+
+	// Appends the encoded data to the output (vertices fail if the stride is too large)
+	static bool EncodeVertices(const void* vertices, size_t count, size_t stride, std::vector<unsigned char>& output);
+	static void EncodeIndices(const unsigned int* indices, size_t count, std::vector<unsigned char>& output);
+
+	// Each returns false if the data is corrupt or doesn't match the given count/stride
+	static bool DecodeVertices(void* vertices, size_t count, size_t stride, const unsigned char* data, size_t size);
+	static bool DecodeIndices(unsigned int* indices, size_t count, const unsigned char* data, size_t size);
+};
+
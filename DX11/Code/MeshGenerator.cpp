@@ -0,0 +1,241 @@
+#include "MeshGenerator.h"
+#include "MeshOptimizer.h"
+
+#include <cmath>
+
+using namespace DirectX;
+
+// --------------------------------------------------------
+// Adds a (columns + 1) x (rows + 1) grid of vertices, with U
+// across the columns and V down the rows, and two triangles
+// per cell.  The surface function fills in each vertex's
+// position, normal and tangent from its UV, and must go in
+// the direction of the normal when crossing +U with +V.
+//
+// A row that's collapsed to a single point (a pole or an
+// apex) only gets the cells' non-degenerate triangles.
+// --------------------------------------------------------
+template<typename Surface>
+static void AddGrid(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices, int columns, int rows, bool pointAtTop, bool pointAtBottom, Surface surface)
+{
+	unsigned int first = (unsigned int)vertices.size();
+	for (int row = 0; row <= rows; row++)
+	{
+		for (int col = 0; col <= columns; col++)
+		{
+			Vertex v = {};
+			v.UV = XMFLOAT2((float)col / columns, (float)row / rows);
+			surface(v.UV.x, v.UV.y, v);
+			vertices.push_back(v);
+		}
+	}
+
+	for (int row = 0; row < rows; row++)
+	{
+		for (int col = 0; col < columns; col++)
+		{
+			unsigned int a = first + row * (columns + 1) + col;
+			unsigned int b = a + 1;
+			unsigned int c = a + columns + 1;
+			unsigned int d = c + 1;
+
+			if (!pointAtTop || row > 0)
+			{
+				indices.push_back(a);
+				indices.push_back(b);
+				indices.push_back(c);
+			}
+			if (!pointAtBottom || row < rows - 1)
+			{
+				indices.push_back(b);
+				indices.push_back(d);
+				indices.push_back(c);
+			}
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Adds a flat disc facing up or down at the given height, as
+// a fan around a center vertex, with the texture laid over
+// it from above (or below)
+// --------------------------------------------------------
+static void AddCap(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices, float y, float radius, int slices, bool facingUp)
+{
+	float normalY = facingUp ? 1.0f : -1.0f;
+	unsigned int center = (unsigned int)vertices.size();
+	for (int i = -1; i < slices; i++)
+	{
+		// The first vertex is the center
+		float x = 0.0f;
+		float z = 0.0f;
+		if (i >= 0)
+		{
+			float angle = XM_2PI * i / slices;
+			x = cosf(angle) * radius;
+			z = sinf(angle) * radius;
+		}
+
+		Vertex v = {};
+		v.Position = XMFLOAT3(x, y, z);
+		v.UV = XMFLOAT2(0.5f + x / (2.0f * radius), 0.5f - normalY * z / (2.0f * radius));
+		v.Normal = XMFLOAT3(0, normalY, 0);
+		v.Tangent = XMFLOAT3(1, 0, 0);
+		vertices.push_back(v);
+	}
+
+	// Clockwise when seen from the side the cap faces
+	for (int i = 0; i < slices; i++)
+	{
+		unsigned int current = center + 1 + i;
+		unsigned int next = center + 1 + (i + 1) % slices;
+		indices.push_back(center);
+		indices.push_back(facingUp ? next : current);
+		indices.push_back(facingUp ? current : next);
+	}
+}
+
+
+// --------------------------------------------------------
+// Puts the triangles and vertices in the same GPU friendly
+// order the OBJ loader does (see MeshOptimizer)
+// --------------------------------------------------------
+static void Optimize(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices)
+{
+	MeshOptimizer::OptimizeVertexCache(&indices[0], indices.size(), vertices.size());
+	MeshOptimizer::OptimizeOverdraw(&indices[0], indices.size(), &vertices[0], vertices.size());
+	vertices.resize(MeshOptimizer::OptimizeVertexFetch(&vertices[0], vertices.size(), &indices[0], indices.size()));
+}
+
+
+void MeshGenerator::Sphere(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices, float radius, int slices, int stacks)
+{
+	vertices.clear();
+	indices.clear();
+	vertices.reserve((slices + 1) * (stacks + 1));
+	indices.reserve(slices * (stacks - 1) * 6);
+
+	// V goes from the top pole to the bottom one
+	AddGrid(vertices, indices, slices, stacks, true, true, [&](float u, float v, Vertex& vert)
+	{
+		float theta = XM_2PI * u;
+		float phi = XM_PI * v;
+		XMFLOAT3 normal(sinf(phi) * cosf(theta), cosf(phi), sinf(phi) * sinf(theta));
+		vert.Position = XMFLOAT3(normal.x * radius, normal.y * radius, normal.z * radius);
+		vert.Normal = normal;
+		vert.Tangent = XMFLOAT3(-sinf(theta), 0, cosf(theta));
+	});
+
+	Optimize(vertices, indices);
+}
+
+
+void MeshGenerator::Cube(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices, float size, int divisions)
+{
+	vertices.clear();
+	indices.clear();
+	vertices.reserve(6 * (divisions + 1) * (divisions + 1));
+	indices.reserve(6 * divisions * divisions * 6);
+
+	// Each face's normal and U direction (V runs down the sides,
+	// and toward the viewer on the top and bottom)
+	static const XMFLOAT3 faces[6][2] =
+	{
+		{ XMFLOAT3(+1, 0, 0), XMFLOAT3(0, 0, +1) },
+		{ XMFLOAT3(-1, 0, 0), XMFLOAT3(0, 0, -1) },
+		{ XMFLOAT3(0, +1, 0), XMFLOAT3(+1, 0, 0) },
+		{ XMFLOAT3(0, -1, 0), XMFLOAT3(+1, 0, 0) },
+		{ XMFLOAT3(0, 0, +1), XMFLOAT3(-1, 0, 0) },
+		{ XMFLOAT3(0, 0, -1), XMFLOAT3(+1, 0, 0) },
+	};
+
+	float half = size * 0.5f;
+	for (int f = 0; f < 6; f++)
+	{
+		XMVECTOR normal = XMLoadFloat3(&faces[f][0]);
+		XMVECTOR tangent = XMLoadFloat3(&faces[f][1]);
+		XMVECTOR down = XMVector3Cross(normal, tangent);
+		AddGrid(vertices, indices, divisions, divisions, false, false, [&](float u, float v, Vertex& vert)
+		{
+			XMStoreFloat3(&vert.Position, (normal + tangent * (u * 2.0f - 1.0f) + down * (v * 2.0f - 1.0f)) * half);
+			vert.Normal = faces[f][0];
+			vert.Tangent = faces[f][1];
+		});
+	}
+
+	Optimize(vertices, indices);
+}
+
+
+void MeshGenerator::Cylinder(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices, float radius, float height, int slices, int stacks)
+{
+	vertices.clear();
+	indices.clear();
+	vertices.reserve((slices + 1) * (stacks + 1) + 2 * (slices + 1));
+	indices.reserve(slices * stacks * 6 + 2 * slices * 3);
+
+	// Sides, from the top down
+	float half = height * 0.5f;
+	AddGrid(vertices, indices, slices, stacks, false, false, [&](float u, float v, Vertex& vert)
+	{
+		float theta = XM_2PI * u;
+		vert.Position = XMFLOAT3(cosf(theta) * radius, half - v * height, sinf(theta) * radius);
+		vert.Normal = XMFLOAT3(cosf(theta), 0, sinf(theta));
+		vert.Tangent = XMFLOAT3(-sinf(theta), 0, cosf(theta));
+	});
+
+	AddCap(vertices, indices, half, radius, slices, true);
+	AddCap(vertices, indices, -half, radius, slices, false);
+
+	Optimize(vertices, indices);
+}
+
+
+void MeshGenerator::Cone(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices, float radius, float height, int slices)
+{
+	vertices.clear();
+	indices.clear();
+	vertices.reserve(2 * (slices + 1) + slices + 1);
+	indices.reserve(slices * 3 + slices * 3);
+
+	// Sides, from the point down.  The normals all lean up by the
+	// same amount, and each copy of the point gets the normal from
+	// the middle of its one triangle.
+	float half = height * 0.5f;
+	float slope = sqrtf(radius * radius + height * height);
+	AddGrid(vertices, indices, slices, 1, true, false, [&](float u, float v, Vertex& vert)
+	{
+		float theta = XM_2PI * u;
+		float normalTheta = v == 0.0f ? theta - XM_PI / slices : theta;
+		vert.Position = XMFLOAT3(cosf(theta) * radius * v, half - v * height, sinf(theta) * radius * v);
+		vert.Normal = XMFLOAT3(cosf(normalTheta) * height / slope, radius / slope, sinf(normalTheta) * height / slope);
+		vert.Tangent = XMFLOAT3(-sinf(normalTheta), 0, cosf(normalTheta));
+	});
+
+	AddCap(vertices, indices, -half, radius, slices, false);
+
+	Optimize(vertices, indices);
+}
+
+
+void MeshGenerator::Torus(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices, float majorRadius, float minorRadius, int rings, int sides)
+{
+	vertices.clear();
+	indices.clear();
+	vertices.reserve((rings + 1) * (sides + 1));
+	indices.reserve(rings * sides * 6);
+
+	// U goes around the ring and V around the tube (starting on the
+	// outside and heading down, so the faces point outward)
+	AddGrid(vertices, indices, rings, sides, false, false, [&](float u, float v, Vertex& vert)
+	{
+		float theta = XM_2PI * u;
+		float phi = -XM_2PI * v;
+		float distance = majorRadius + cosf(phi) * minorRadius;
+		vert.Position = XMFLOAT3(cosf(theta) * distance, sinf(phi) * minorRadius, sinf(theta) * distance);
+		vert.Normal = XMFLOAT3(cosf(phi) * cosf(theta), sinf(phi), cosf(phi) * sinf(theta));
+		vert.Tangent = XMFLOAT3(-sinf(theta), 0, cosf(theta));
+	});
+
+	Optimize(vertices, indices);
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <vector>
+
+#include "Vertex.h"
+
+// --------------------------------------------------------
+// Builds basic shapes in memory, with any level of detail
+//
+// The output matches what the OBJ loader gives for the
+// models in Assets/Models: left-handed, clockwise front
+// faces, V running down the texture, tangents pointing
+// along +U, and triangles and vertices already reordered by
+// MeshOptimizer.  Tangents come from the shape's equations,
+// so there's no need for Mesh::CalculateTangents() (create
+// the Mesh with MeshFlags_KeepTangents).
+//
+// Each function replaces the contents of the two vectors.
+// Default arguments give (about) the same size and detail
+// as the corresponding OBJ file.
+// --------------------------------------------------------
+class MeshGenerator
+{
+public:
+	// Poles are on the Y axis
+	static void Sphere(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices, float radius = 1.0f, int slices = 32, int stacks = 16);
+
+	// Each face is split into divisions x divisions quads
+	static void Cube(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices, float size = 1.0f, int divisions = 1);
+
+	// Centered on the origin, along the Y axis, with both ends capped
+	static void Cylinder(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices, float radius = 0.5f, float height = 1.0f, int slices = 20, int stacks = 1);
+
+	// Centered on the origin, with its point at +Y and its base capped
+	static void Cone(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices, float radius = 0.5f, float height = 1.0f, int slices = 20);
+
+	// Lying in the XZ plane - rings go around the Y axis, and sides
+	// around the tube
+	static void Torus(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices, float majorRadius = 0.5f, float minorRadius = 0.2f, int rings = 20, int sides = 20);
+};
@@ -0,0 +1,90 @@
+#include "MeshLoader.h"
+#include "JobSystem.h"
+#include "MeshGenerator.h"
+
+
+MeshLoader::MeshLoader(Microsoft::WRL::ComPtr<ID3D11Device> device, std::shared_ptr<AssetCache> assets) :
+	assets(assets),
+	completed(std::make_shared<CompletionQueue>()),
+	pending(0)
+{
+	std::vector<Vertex> verts;
+	std::vector<unsigned int> indices;
+	MeshGenerator::Cube(verts, indices);
+	placeholder = std::make_shared<Mesh>(&verts[0], (int)verts.size(), &indices[0], (int)indices.size(), device, MeshFlags_KeepTangents);
+}
+
+std::shared_ptr<Mesh> MeshLoader::Load(const std::string& meshFile, unsigned int flags, const std::function<void(std::shared_ptr<Mesh>)>& onLoaded)
+{
+	// Missing or broken files come back null
+	std::shared_ptr<AssetCache> loadAssets = assets;
+	return Load([meshFile, flags, loadAssets]() { return loadAssets->GetMesh(meshFile, flags); }, onLoaded);
+}
+
+std::shared_ptr<Mesh> MeshLoader::Load(const std::function<std::shared_ptr<Mesh>()>& load, const std::function<void(std::shared_ptr<Mesh>)>& onLoaded)
+{
+	pending++;
+
+	std::shared_ptr<CompletionQueue> queue = completed;
+	JobSystem::GetInstance().RunInBackground([queue, load, onLoaded]()
+	{
+		CompletedLoad* done = new CompletedLoad();
+		done->Loaded = load();
+		done->OnLoaded = onLoaded;
+		queue->Push(done);
+	});
+	return placeholder;
+}
+
+int MeshLoader::Update()
+{
+	// Reverse the list so callbacks run oldest first
+	CompletedLoad* newest = completed->TakeAll();
+	CompletedLoad* oldest = 0;
+	while (newest)
+	{
+		CompletedLoad* next = newest->Next;
+		newest->Next = oldest;
+		oldest = newest;
+		newest = next;
+	}
+
+	int count = 0;
+	while (oldest)
+	{
+		CompletedLoad* next = oldest->Next;
+		pending--;
+		if (oldest->Loaded)
+		{
+			oldest->OnLoaded(oldest->Loaded);
+			count++;
+		}
+		delete oldest;
+		oldest = next;
+	}
+	return count;
+}
+
+
+MeshLoader::CompletionQueue::~CompletionQueue()
+{
+	CompletedLoad* load = TakeAll();
+	while (load)
+	{
+		CompletedLoad* next = load->Next;
+		delete load;
+		load = next;
+	}
+}
+
+void MeshLoader::CompletionQueue::Push(CompletedLoad* load)
+{
+	// Release so the load's contents are visible to whoever takes it
+	load->Next = Head.load(std::memory_order_relaxed);
+	while (!Head.compare_exchange_weak(load->Next, load, std::memory_order_release, std::memory_order_relaxed));
+}
+
+MeshLoader::CompletedLoad* MeshLoader::CompletionQueue::TakeAll()
+{
+	return Head.exchange(0, std::memory_order_acquire);
+}
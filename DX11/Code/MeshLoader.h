@@ -0,0 +1,69 @@
+#pragma once
+
+#include <d3d11.h>
+#include <wrl/client.h>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "AssetCache.h"
+#include "Mesh.h"
+
+// --------------------------------------------------------
+// Loads meshes on background threads, so the main thread
+// never waits on parsing or tangent generation
+//
+// Load() returns a placeholder (a small cube) right away.
+// Each finished mesh goes onto a lock-free queue, and the
+// main loop's Update() hands it to its callback - so meshes
+// only ever change between frames.
+// --------------------------------------------------------
+class MeshLoader
+{
+public:
+	MeshLoader(Microsoft::WRL::ComPtr<ID3D11Device> device, std::shared_ptr<AssetCache> assets);
+
+	// Starts loading a mesh file (see Mesh for the flags) through the
+	// asset cache and returns the placeholder.  The callback runs during
+	// a later Update(), and not at all if the file couldn't be loaded.
+	std::shared_ptr<Mesh> Load(const std::string& meshFile, unsigned int flags, const std::function<void(std::shared_ptr<Mesh>)>& onLoaded);
+
+	// Same, for any other way of making a mesh (which returns null
+	// when it fails)
+	std::shared_ptr<Mesh> Load(const std::function<std::shared_ptr<Mesh>()>& load, const std::function<void(std::shared_ptr<Mesh>)>& onLoaded);
+
+	// Runs the callbacks for every load that's finished since the last
+	// call, in the order they finished.  Returns how many ran.
+	int Update();
+
+	std::shared_ptr<Mesh> GetPlaceholder() { return placeholder; }
+	int GetPendingCount() { return pending; }
+
+private:
+	struct CompletedLoad
+	{
+		std::shared_ptr<Mesh> Loaded;		// Null if it failed
+		std::function<void(std::shared_ptr<Mesh>)> OnLoaded;
+		CompletedLoad* Next;
+	};
+
+	// Finished loads, newest first.  Workers push onto the front, and
+	// Update() takes the whole list at once, so neither ever blocks.
+	// This is shared with the jobs, so it's fine for them to outlive
+	// the loader (their callbacks just never run).
+	struct CompletionQueue
+	{
+		std::atomic<CompletedLoad*> Head;
+
+		CompletionQueue() : Head(0) { }
+		~CompletionQueue();
+		void Push(CompletedLoad* load);
+		CompletedLoad* TakeAll();
+	};
+
+	std::shared_ptr<AssetCache> assets;
+	std::shared_ptr<Mesh> placeholder;
+	std::shared_ptr<CompletionQueue> completed;
+	int pending;	// Only touched on the main thread
+};
@@ -0,0 +1,640 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+using namespace DirectX;
+
+// --------------------------------------------------------
+// Forsyth's scoring constants, from the original article
+// --------------------------------------------------------
+static const float CacheDecayPower = 1.5f;
+static const float LastTriScore = 0.75f;
+static const float ValenceBoostScale = 2.0f;
+static const float ValenceBoostPower = 0.5f;
+
+// Valences above this all score the same (the boost is tiny by then)
+static const unsigned int MaxValence = 32;
+
+
+// --------------------------------------------------------
+// Forsyth vertex cache optimization
+//
+// Triangles are added one at a time, always picking the
+// one whose vertices score highest.  Vertices score well
+// if they're near the front of a simulated LRU cache, and
+// if they have few triangles left (so they're finished off
+// rather than left hanging).  Only triangles that touch
+// the cache can change score, so each step only looks at
+// those - hence "linear speed".
+// --------------------------------------------------------
+void MeshOptimizer::OptimizeVertexCache(unsigned int* indices, size_t indexCount, size_t vertexCount)
+{
+	size_t triCount = indexCount / 3;
+	if (triCount == 0 || vertexCount == 0)
+		return;
+
+	// Score lookup tables
+	float cacheScores[ForsythCacheSize + 3];
+	for (unsigned int i = 0; i < ForsythCacheSize + 3; i++)
+	{
+		if (i < 3)
+			cacheScores[i] = LastTriScore;
+		else if (i < ForsythCacheSize)
+			cacheScores[i] = powf(1.0f - (float)(i - 3) / (ForsythCacheSize - 3), CacheDecayPower);
+		else
+			cacheScores[i] = 0.0f;	// Only there during the update below
+	}
+	float valenceScores[MaxValence + 1];
+	valenceScores[0] = 0.0f;
+	for (unsigned int i = 1; i <= MaxValence; i++)
+		valenceScores[i] = ValenceBoostScale * powf((float)i, -ValenceBoostPower);
+
+	// Triangles that use each vertex, in one flat array
+	std::vector<unsigned int> triOffsets(vertexCount + 1, 0);
+	for (size_t i = 0; i < triCount * 3; i++)
+		triOffsets[indices[i] + 1]++;
+	for (size_t v = 0; v < vertexCount; v++)
+		triOffsets[v + 1] += triOffsets[v];
+
+	std::vector<unsigned int> remaining(vertexCount);	// Triangles not yet added, per vertex
+	std::vector<unsigned int> vertexTris(triCount * 3);
+	for (size_t v = 0; v < vertexCount; v++)
+		remaining[v] = triOffsets[v + 1] - triOffsets[v];
+	{
+		std::vector<unsigned int> fill(triOffsets.begin(), triOffsets.end() - 1);
+		for (size_t t = 0; t < triCount; t++)
+			for (int c = 0; c < 3; c++)
+				vertexTris[fill[indices[t * 3 + c]]++] = (unsigned int)t;
+	}
+
+	// Per vertex cache position (-1 if not cached) and score
+	std::vector<int> cachePosition(vertexCount, -1);
+	std::vector<float> vertexScores(vertexCount);
+	auto scoreVertex = [&](unsigned int v)
+	{
+		if (remaining[v] == 0)
+			return -1.0f;
+		float score = cachePosition[v] >= 0 ? cacheScores[cachePosition[v]] : 0.0f;
+		return score + valenceScores[remaining[v] < MaxValence ? remaining[v] : MaxValence];
+	};
+	for (size_t v = 0; v < vertexCount; v++)
+		vertexScores[v] = scoreVertex((unsigned int)v);
+
+	std::vector<float> triScores(triCount);
+	std::vector<bool> triAdded(triCount, false);
+	for (size_t t = 0; t < triCount; t++)
+		triScores[t] = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+
+	// The simulated cache, with room for a new triangle to push in
+	unsigned int cache[ForsythCacheSize + 3];
+	unsigned int newCache[ForsythCacheSize + 3];
+	unsigned int cacheCount = 0;
+
+	std::vector<unsigned int> output(triCount * 3);
+	size_t nextUnadded = 0;	// Where to look when nothing in the cache has triangles left
+	size_t bestTri = 0;
+
+	// Start with the best triangle overall
+	for (size_t t = 1; t < triCount; t++)
+		if (triScores[t] > triScores[bestTri])
+			bestTri = t;
+
+	for (size_t outTri = 0; outTri < triCount; outTri++)
+	{
+		// Nothing good in the cache?  Take the next triangle in the original order
+		if (bestTri == (size_t)-1)
+		{
+			while (triAdded[nextUnadded])
+				nextUnadded++;
+			bestTri = nextUnadded;
+		}
+
+		// Add it
+		const unsigned int* tri = &indices[bestTri * 3];
+		output[outTri * 3 + 0] = tri[0];
+		output[outTri * 3 + 1] = tri[1];
+		output[outTri * 3 + 2] = tri[2];
+		triAdded[bestTri] = true;
+
+		// Remove the triangle from each of its vertices' lists
+		for (int c = 0; c < 3; c++)
+		{
+			unsigned int v = tri[c];
+			unsigned int* list = &vertexTris[triOffsets[v]];
+			for (unsigned int i = 0; i < remaining[v]; i++)
+			{
+				if (list[i] == bestTri)
+				{
+					list[i] = list[remaining[v] - 1];
+					remaining[v]--;
+					break;
+				}
+			}
+		}
+
+		// Its vertices move to the front of the cache, everything else moves back
+		unsigned int newCount = 0;
+		for (int c = 0; c < 3; c++)
+		{
+			// Degenerate triangles can name the same vertex twice
+			bool duplicate = false;
+			for (unsigned int i = 0; i < newCount; i++)
+				duplicate |= newCache[i] == tri[c];
+			if (!duplicate)
+				newCache[newCount++] = tri[c];
+		}
+		for (unsigned int i = 0; i < cacheCount; i++)
+		{
+			unsigned int v = cache[i];
+			if (v != tri[0] && v != tri[1] && v != tri[2])
+				newCache[newCount++] = v;
+		}
+
+		// Anything pushed out of the cache loses its cache score
+		for (unsigned int i = ForsythCacheSize; i < newCount; i++)
+		{
+			cachePosition[newCache[i]] = -1;
+			vertexScores[newCache[i]] = scoreVertex(newCache[i]);
+		}
+		cacheCount = newCount < ForsythCacheSize ? newCount : ForsythCacheSize;
+		memcpy(cache, newCache, sizeof(unsigned int) * cacheCount);
+
+		// Rescore the cached vertices, then the triangles that use them
+		for (unsigned int i = 0; i < cacheCount; i++)
+		{
+			cachePosition[cache[i]] = (int)i;
+			vertexScores[cache[i]] = scoreVertex(cache[i]);
+		}
+
+		bestTri = (size_t)-1;
+		float bestScore = -1.0f;
+		for (unsigned int i = 0; i < cacheCount; i++)
+		{
+			unsigned int v = cache[i];
+			const unsigned int* list = &vertexTris[triOffsets[v]];
+			for (unsigned int j = 0; j < remaining[v]; j++)
+			{
+				unsigned int t = list[j];
+				float score =
+					vertexScores[indices[t * 3]] +
+					vertexScores[indices[t * 3 + 1]] +
+					vertexScores[indices[t * 3 + 2]];
+				triScores[t] = score;
+				if (score > bestScore)
+				{
+					bestScore = score;
+					bestTri = t;
+				}
+			}
+		}
+	}
+
+	memcpy(indices, &output[0], sizeof(unsigned int) * triCount * 3);
+}
+
+
+// --------------------------------------------------------
+// Overdraw optimization
+//
+// Based on "Fast Triangle Reordering for Vertex Locality
+// and Reduced Overdraw" (Sander, Nehab & Barczak, 2007).
+// The cache optimized order is cut into clusters, then
+// the clusters are sorted so that the ones facing away
+// from the mesh's center, and furthest from it, come
+// first.  Those tend to hide the rest from most views.
+// --------------------------------------------------------
+
+// Simulates a FIFO cache for one triangle, returning its misses
+static unsigned int UpdateFIFOCache(const unsigned int* tri, std::vector<unsigned int>& loadedAt, unsigned int& time, unsigned int cacheSize)
+{
+	unsigned int misses = 0;
+	for (int c = 0; c < 3; c++)
+	{
+		unsigned int v = tri[c];
+		if (loadedAt[v] == 0 || time + 1 - loadedAt[v] > cacheSize)
+		{
+			loadedAt[v] = ++time;
+			misses++;
+		}
+	}
+	return misses;
+}
+
+// Empties the cache above without touching every vertex: anything
+// loaded before now will look like it was evicted long ago
+static inline void FlushFIFOCache(unsigned int& time, unsigned int cacheSize)
+{
+	time += cacheSize;
+}
+
+void MeshOptimizer::OptimizeOverdraw(unsigned int* indices, size_t indexCount, const Vertex* vertices, size_t vertexCount, float threshold)
+{
+	size_t triCount = indexCount / 3;
+	if (triCount < 2)
+		return;
+
+	// Hard boundaries: triangles that miss on all three vertices
+	// start a new cluster, as the cache has nothing to lose there
+	std::vector<size_t> hard;
+	{
+		std::vector<unsigned int> loadedAt(vertexCount, 0);
+		unsigned int time = 0;
+		for (size_t t = 0; t < triCount; t++)
+			if (UpdateFIFOCache(&indices[t * 3], loadedAt, time, OverdrawCacheSize) == 3 || t == 0)
+				hard.push_back(t);
+	}
+	hard.push_back(triCount);
+
+	// Soft boundaries: within each hard cluster, cut whenever the
+	// part since the last cut is already about as cache friendly
+	// as the whole hard cluster (starting over with an empty cache)
+	std::vector<size_t> clusters;
+	std::vector<unsigned int> loadedAt(vertexCount, 0);
+	unsigned int time = 0;
+	for (size_t h = 0; h + 1 < hard.size(); h++)
+	{
+		size_t start = hard[h];
+		size_t end = hard[h + 1];
+
+		FlushFIFOCache(time, OverdrawCacheSize);
+		unsigned int hardMisses = 0;
+		for (size_t t = start; t < end; t++)
+			hardMisses += UpdateFIFOCache(&indices[t * 3], loadedAt, time, OverdrawCacheSize);
+		float hardACMR = (float)hardMisses / (end - start);
+
+		FlushFIFOCache(time, OverdrawCacheSize);
+		clusters.push_back(start);
+		size_t clusterStart = start;
+		unsigned int clusterMisses = 0;
+		for (size_t t = start; t < end; t++)
+		{
+			clusterMisses += UpdateFIFOCache(&indices[t * 3], loadedAt, time, OverdrawCacheSize);
+			if (t + 1 < end && (float)clusterMisses / (t + 1 - clusterStart) <= threshold * hardACMR)
+			{
+				clusters.push_back(t + 1);
+				clusterStart = t + 1;
+				clusterMisses = 0;
+				FlushFIFOCache(time, OverdrawCacheSize);
+			}
+		}
+	}
+	clusters.push_back(triCount);
+	size_t clusterCount = clusters.size() - 1;
+
+	// Area weighted centroid of the whole mesh
+	XMVECTOR meshCentroid = XMVectorZero();
+	float meshArea = 0.0f;
+	std::vector<XMFLOAT3> clusterCentroids(clusterCount);
+	std::vector<XMFLOAT3> clusterNormals(clusterCount);
+	for (size_t c = 0; c < clusterCount; c++)
+	{
+		XMVECTOR centroid = XMVectorZero();
+		XMVECTOR normal = XMVectorZero();
+		float area = 0.0f;
+		for (size_t t = clusters[c]; t < clusters[c + 1]; t++)
+		{
+			XMVECTOR p0 = XMLoadFloat3(&vertices[indices[t * 3]].Position);
+			XMVECTOR p1 = XMLoadFloat3(&vertices[indices[t * 3 + 1]].Position);
+			XMVECTOR p2 = XMLoadFloat3(&vertices[indices[t * 3 + 2]].Position);
+
+			// The cross product's length is twice the area, and its
+			// direction is the normal, so summing them area weights it
+			XMVECTOR cross = XMVector3Cross(p1 - p0, p2 - p0);
+			float triArea = XMVectorGetX(XMVector3Length(cross));
+			centroid += (p0 + p1 + p2) * (triArea / 3.0f);
+			normal += cross;
+			area += triArea;
+		}
+
+		meshCentroid += centroid;
+		meshArea += area;
+		XMStoreFloat3(&clusterCentroids[c], area > 0.0f ? centroid / area : centroid);
+		XMStoreFloat3(&clusterNormals[c], XMVector3Normalize(normal));
+	}
+	if (meshArea > 0.0f)
+		meshCentroid /= meshArea;
+
+	// Sort key: how far "out" each cluster is, along its own normal.
+	// (With clockwise winding in a left handed space, the cross
+	// products above point out of the front faces.)
+	std::vector<float> keys(clusterCount);
+	std::vector<size_t> order(clusterCount);
+	for (size_t c = 0; c < clusterCount; c++)
+	{
+		XMVECTOR offset = XMLoadFloat3(&clusterCentroids[c]) - meshCentroid;
+		keys[c] = XMVectorGetX(XMVector3Dot(offset, XMLoadFloat3(&clusterNormals[c])));
+		order[c] = c;
+	}
+	std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return keys[a] > keys[b]; });
+
+	std::vector<unsigned int> output;
+	output.reserve(triCount * 3);
+	for (size_t c : order)
+		output.insert(output.end(), indices + clusters[c] * 3, indices + clusters[c + 1] * 3);
+	memcpy(indices, &output[0], sizeof(unsigned int) * triCount * 3);
+}
+
+
+// --------------------------------------------------------
+// Vertex fetch optimization
+// --------------------------------------------------------
+size_t MeshOptimizer::OptimizeVertexFetch(Vertex* vertices, size_t vertexCount, unsigned int* indices, size_t indexCount)
+{
+	// New index for each vertex, in order of first use
+	const unsigned int unused = 0xFFFFFFFF;
+	std::vector<unsigned int> remap(vertexCount, unused);
+	unsigned int nextVertex = 0;
+	for (size_t i = 0; i < indexCount; i++)
+	{
+		unsigned int& newIndex = remap[indices[i]];
+		if (newIndex == unused)
+			newIndex = nextVertex++;
+		indices[i] = newIndex;
+	}
+
+	std::vector<Vertex> reordered(nextVertex);
+	for (size_t v = 0; v < vertexCount; v++)
+		if (remap[v] != unused)
+			reordered[remap[v]] = vertices[v];
+	if (nextVertex > 0)
+		memcpy(vertices, &reordered[0], sizeof(Vertex) * nextVertex);
+	return nextVertex;
+}
+
+
+// --------------------------------------------------------
+// Welds positions with an open addressing hash table of
+// unique positions, kept at most half full (the same
+// approach as ObjParser::WeldCorners)
+// --------------------------------------------------------
+size_t MeshOptimizer::WeldPositions(const XMFLOAT3* positions, size_t vertexCount, const unsigned int* indices, size_t indexCount, XMFLOAT3* uniquePositions, unsigned int* positionIndices)
+{
+	const unsigned int unused = 0xFFFFFFFF;
+
+	size_t tableSize = 1;
+	while (tableSize < vertexCount * 2)
+		tableSize <<= 1;
+	std::vector<unsigned int> table(tableSize, unused);
+	size_t mask = tableSize - 1;
+
+	// Each vertex is only looked up the first time it's used
+	std::vector<unsigned int> remap(vertexCount, unused);
+	unsigned int uniqueCount = 0;
+	for (size_t i = 0; i < indexCount; i++)
+	{
+		unsigned int& newIndex = remap[indices[i]];
+		if (newIndex == unused)
+		{
+			const XMFLOAT3& p = positions[indices[i]];
+			unsigned int bits[3];
+			memcpy(bits, &p, sizeof(bits));
+
+			unsigned int h = bits[0] * 0x8DA6B343u;
+			h = (h ^ (h >> 15)) + bits[1] * 0xD8163841u;
+			h = (h ^ (h >> 15)) + bits[2] * 0xCB1AB31Fu;
+			h ^= h >> 16;
+
+			size_t slot = h & mask;
+			while (true)
+			{
+				unsigned int existing = table[slot];
+				if (existing == unused)
+				{
+					table[slot] = uniqueCount;
+					uniquePositions[uniqueCount] = p;
+					newIndex = uniqueCount++;
+					break;
+				}
+				if (memcmp(&uniquePositions[existing], &p, sizeof(XMFLOAT3)) == 0)
+				{
+					newIndex = existing;
+					break;
+				}
+				slot = (slot + 1) & mask;
+			}
+		}
+		positionIndices[i] = newIndex;
+	}
+	return uniqueCount;
+}
+
+
+// --------------------------------------------------------
+// Cache simulation
+// --------------------------------------------------------
+VertexCacheStats MeshOptimizer::MakeStats(unsigned int transformed, const unsigned int* indices, size_t indexCount, size_t vertexCount)
+{
+	// ATVR is relative to the vertices actually referenced
+	std::vector<bool> used(vertexCount, false);
+	size_t uniqueCount = 0;
+	for (size_t i = 0; i < indexCount; i++)
+	{
+		if (!used[indices[i]])
+		{
+			used[indices[i]] = true;
+			uniqueCount++;
+		}
+	}
+
+	VertexCacheStats stats = {};
+	stats.VerticesTransformed = transformed;
+	stats.ACMR = indexCount >= 3 ? (float)transformed / (indexCount / 3) : 0.0f;
+	stats.ATVR = uniqueCount > 0 ? (float)transformed / uniqueCount : 0.0f;
+	return stats;
+}
+
+VertexCacheStats MeshOptimizer::AnalyzeVertexCacheFIFO(const unsigned int* indices, size_t indexCount, size_t vertexCount, unsigned int cacheSize)
+{
+	// A vertex is in the cache if fewer than cacheSize
+	// misses have happened since it was last loaded
+	std::vector<unsigned int> loadedAt(vertexCount, 0);
+	unsigned int misses = 0;
+	for (size_t i = 0; i < indexCount; i++)
+	{
+		unsigned int v = indices[i];
+		if (loadedAt[v] == 0 || misses + 1 - loadedAt[v] > cacheSize)
+		{
+			misses++;
+			loadedAt[v] = misses;
+		}
+	}
+
+	return MakeStats(misses, indices, indexCount, vertexCount);
+}
+
+VertexCacheStats MeshOptimizer::AnalyzeVertexCacheLRU(const unsigned int* indices, size_t indexCount, size_t vertexCount, unsigned int cacheSize)
+{
+	// Small enough that a linear search is the fastest option
+	std::vector<unsigned int> cache;
+	cache.reserve(cacheSize + 1);
+	unsigned int misses = 0;
+	for (size_t i = 0; i < indexCount; i++)
+	{
+		unsigned int v = indices[i];
+		size_t position = 0;
+		while (position < cache.size() && cache[position] != v)
+			position++;
+
+		if (position == cache.size())
+		{
+			misses++;
+			cache.insert(cache.begin(), v);
+			if (cache.size() > cacheSize)
+				cache.pop_back();
+		}
+		else
+		{
+			cache.erase(cache.begin() + position);
+			cache.insert(cache.begin(), v);
+		}
+	}
+
+	return MakeStats(misses, indices, indexCount, vertexCount);
+}
+
+
+// --------------------------------------------------------
+// Vertex fetch analysis, with a direct mapped cache
+// --------------------------------------------------------
+VertexFetchStats MeshOptimizer::AnalyzeVertexFetch(const unsigned int* indices, size_t indexCount, size_t vertexCount, size_t vertexSize)
+{
+	VertexFetchStats stats = {};
+
+	std::vector<bool> used(vertexCount, false);
+	size_t uniqueCount = 0;
+
+	// Which line each cache slot holds, offset by one so zero means empty
+	std::vector<size_t> slots(FetchCacheLines, 0);
+	for (size_t i = 0; i < indexCount; i++)
+	{
+		unsigned int v = indices[i];
+		if (!used[v])
+		{
+			used[v] = true;
+			uniqueCount++;
+		}
+
+		// A vertex can straddle two lines
+		size_t firstLine = v * vertexSize / FetchCacheLineSize;
+		size_t lastLine = ((v + 1) * vertexSize - 1) / FetchCacheLineSize;
+		for (size_t line = firstLine; line <= lastLine; line++)
+		{
+			size_t& slot = slots[line % FetchCacheLines];
+			if (slot != line + 1)
+			{
+				slot = line + 1;
+				stats.BytesFetched += FetchCacheLineSize;
+			}
+		}
+	}
+
+	stats.Overfetch = uniqueCount > 0 ? (float)stats.BytesFetched / (uniqueCount * vertexSize) : 0.0f;
+	return stats;
+}
+
+// --------------------------------------------------------
+// Overdraw analysis
+// --------------------------------------------------------
+
+// Draws one triangle (already in pixel coordinates, with depth in z),
+// counting the pixels that pass the depth test
+static unsigned long long RasterizeTriangle(const XMFLOAT3& a, const XMFLOAT3& b, const XMFLOAT3& c, float* depth, unsigned int size)
+{
+	// Our front faces wind clockwise on screen, which with y pointing
+	// up gives a negative signed area.  Skip back faces, just like
+	// the default rasterizer state does.
+	float area = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+	if (area >= 0.0f)
+		return 0;
+
+	int minX = (std::max)(0, (int)floorf((std::min)((std::min)(a.x, b.x), c.x)));
+	int maxX = (std::min)((int)size - 1, (int)ceilf((std::max)((std::max)(a.x, b.x), c.x)));
+	int minY = (std::max)(0, (int)floorf((std::min)((std::min)(a.y, b.y), c.y)));
+	int maxY = (std::min)((int)size - 1, (int)ceilf((std::max)((std::max)(a.y, b.y), c.y)));
+
+	// Edge functions, sampled at pixel centers
+	unsigned long long shaded = 0;
+	float invArea = 1.0f / area;
+	for (int y = minY; y <= maxY; y++)
+	{
+		for (int x = minX; x <= maxX; x++)
+		{
+			float px = x + 0.5f;
+			float py = y + 0.5f;
+			float w0 = (c.x - b.x) * (py - b.y) - (c.y - b.y) * (px - b.x);
+			float w1 = (a.x - c.x) * (py - c.y) - (a.y - c.y) * (px - c.x);
+			float w2 = (b.x - a.x) * (py - a.y) - (b.y - a.y) * (px - a.x);
+			if (w0 > 0.0f || w1 > 0.0f || w2 > 0.0f)
+				continue;
+
+			float z = (w0 * a.z + w1 * b.z + w2 * c.z) * invArea;
+			float& stored = depth[y * size + x];
+			if (z < stored)
+			{
+				stored = z;
+				shaded++;
+			}
+		}
+	}
+	return shaded;
+}
+
+OverdrawStats MeshOptimizer::AnalyzeOverdraw(const unsigned int* indices, size_t indexCount, const Vertex* vertices, size_t vertexCount, unsigned int directions)
+{
+	OverdrawStats stats = {};
+	if (indexCount < 3 || vertexCount == 0)
+		return stats;
+
+	// Bounding sphere (roughly), so every view fits the whole mesh
+	XMVECTOR boundsMin = XMLoadFloat3(&vertices[0].Position);
+	XMVECTOR boundsMax = boundsMin;
+	for (size_t v = 1; v < vertexCount; v++)
+	{
+		XMVECTOR p = XMLoadFloat3(&vertices[v].Position);
+		boundsMin = XMVectorMin(boundsMin, p);
+		boundsMax = XMVectorMax(boundsMax, p);
+	}
+	XMVECTOR center = (boundsMin + boundsMax) * 0.5f;
+	float radius = XMVectorGetX(XMVector3Length(boundsMax - center));
+	if (radius <= 0.0f)
+		return stats;
+	float scale = OverdrawResolution * 0.5f / radius;
+
+	std::vector<float> depth(OverdrawResolution * OverdrawResolution);
+	std::vector<XMFLOAT3> projected(vertexCount);
+	for (unsigned int d = 0; d < directions; d++)
+	{
+		// Directions spread evenly over a sphere (a Fibonacci lattice)
+		float y = 1.0f - (d + 0.5f) * 2.0f / directions;
+		float ring = sqrtf(1.0f - y * y);
+		float angle = d * 2.39996323f;
+		XMVECTOR forward = XMVectorSet(cosf(angle) * ring, y, sinf(angle) * ring, 0.0f);
+
+		// Orthographic camera looking along that direction
+		XMVECTOR upHint = fabsf(y) > 0.99f ? XMVectorSet(1, 0, 0, 0) : XMVectorSet(0, 1, 0, 0);
+		XMVECTOR right = XMVector3Normalize(XMVector3Cross(upHint, forward));
+		XMVECTOR up = XMVector3Cross(forward, right);
+		for (size_t v = 0; v < vertexCount; v++)
+		{
+			XMVECTOR p = XMLoadFloat3(&vertices[v].Position) - center;
+			projected[v] = XMFLOAT3(
+				(XMVectorGetX(XMVector3Dot(p, right)) * scale) + OverdrawResolution * 0.5f,
+				(XMVectorGetX(XMVector3Dot(p, up)) * scale) + OverdrawResolution * 0.5f,
+				XMVectorGetX(XMVector3Dot(p, forward)));
+		}
+
+		std::fill(depth.begin(), depth.end(), FLT_MAX);
+		for (size_t i = 0; i + 2 < indexCount; i += 3)
+			stats.PixelsShaded += RasterizeTriangle(projected[indices[i]], projected[indices[i + 1]], projected[indices[i + 2]], &depth[0], OverdrawResolution);
+
+		for (float z : depth)
+			if (z != FLT_MAX)
+				stats.PixelsCovered++;
+	}
+
+	stats.Overdraw = stats.PixelsCovered > 0 ? (float)stats.PixelsShaded / stats.PixelsCovered : 0.0f;
+	return stats;
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <vector>
+
+#include "Vertex.h"
+
+// --------------------------------------------------------
+// Results of simulating a post-transform vertex cache
+//
+// ACMR: vertices transformed per triangle (lower is better,
+//       0.5 is the ideal for a large regular grid, 3 is
+//       the worst case)
+// ATVR: vertices transformed per unique vertex (1.0 is
+//       the ideal - every vertex shaded exactly once)
+// --------------------------------------------------------
+struct VertexCacheStats
+{
+	unsigned int VerticesTransformed;
+	float ACMR;
+	float ATVR;
+};
+
+// --------------------------------------------------------
+// Results of simulating vertex fetches through a small
+// cache of 64 byte lines
+//
+// Overfetch is bytes fetched / bytes of vertices used, so
+// 1.0 means every vertex was read from memory just once.
+// --------------------------------------------------------
+struct VertexFetchStats
+{
+	unsigned long long BytesFetched;
+	float Overfetch;
+};
+
+// --------------------------------------------------------
+// Results of rasterizing a mesh from many directions
+//
+// Overdraw is pixels shaded / pixels covered, assuming an
+// early depth test, so 1.0 means nothing was ever shaded
+// only to be covered up later.
+// --------------------------------------------------------
+struct OverdrawStats
+{
+	unsigned long long PixelsCovered;
+	unsigned long long PixelsShaded;
+	float Overdraw;
+};
+
+// --------------------------------------------------------
+// Index and vertex buffer optimizations, run when meshes
+// are imported
+//
+// All functions work on triangle lists, three indices per
+// triangle, with every index less than vertexCount.
+// --------------------------------------------------------
+class MeshOptimizer
+{
+public:
+	// Reorders triangles to make the best use of the GPU's
+	// post-transform vertex cache, using Tom Forsyth's
+	// "Linear-Speed Vertex Cache Optimisation" greedy method
+	static void OptimizeVertexCache(unsigned int* indices, size_t indexCount, size_t vertexCount);
+
+	// Reorders clusters of triangles so those most likely to occlude
+	// the rest (facing outward, far from the center) are drawn first.
+	// Run this after OptimizeVertexCache: clusters are split wherever
+	// that order has a cache miss streak, or where cutting only costs
+	// up to "threshold" times the cache efficiency.
+	static void OptimizeOverdraw(unsigned int* indices, size_t indexCount, const Vertex* vertices, size_t vertexCount, float threshold = 1.05f);
+
+	// Reorders vertices into the order they're first used, updating the
+	// indices to match, so the GPU reads the vertex buffer sequentially.
+	// Unused vertices are dropped; returns the new vertex count.
+	static size_t OptimizeVertexFetch(Vertex* vertices, size_t vertexCount, unsigned int* indices, size_t indexCount);
+
+	// Builds a position only copy of a mesh for depth passes.  Vertices
+	// with identical positions (bit for bit) are merged, as they only
+	// differed in attributes a depth pass doesn't read.  Positions come
+	// out in order of first use, and unused ones are dropped, so both
+	// outputs need room for (at most) the same counts as the inputs.
+	// Returns the number of unique positions.
+	static size_t WeldPositions(const DirectX::XMFLOAT3* positions, size_t vertexCount, const unsigned int* indices, size_t indexCount, DirectX::XMFLOAT3* uniquePositions, unsigned int* positionIndices);
+
+	// Measures how well a given cache would do with an index buffer.
+	// FIFO models most current hardware; LRU is what Forsyth targets.
+	static VertexCacheStats AnalyzeVertexCacheFIFO(const unsigned int* indices, size_t indexCount, size_t vertexCount, unsigned int cacheSize);
+	static VertexCacheStats AnalyzeVertexCacheLRU(const unsigned int* indices, size_t indexCount, size_t vertexCount, unsigned int cacheSize);
+
+	// Measures memory traffic from reading vertices in index order
+	static VertexFetchStats AnalyzeVertexFetch(const unsigned int* indices, size_t indexCount, size_t vertexCount, size_t vertexSize);
+
+	// Software rasterizes the mesh (with back face culling and an early
+	// depth test) from evenly spread directions around it and totals
+	// up how many pixels were shaded compared to how many are covered
+	static OverdrawStats AnalyzeOverdraw(const unsigned int* indices, size_t indexCount, const Vertex* vertices, size_t vertexCount, unsigned int directions = 32);
+
+private:
+	// Size of the LRU cache the optimizer models
+	static const unsigned int ForsythCacheSize = 32;
+
+	// Cache size used to find cluster boundaries for overdraw sorting
+	static const unsigned int OverdrawCacheSize = 16;
+
+	// Resolution of the overdraw analysis render target
+	static const unsigned int OverdrawResolution = 256;
+
+	// Cache modeled by the vertex fetch analysis
+	static const unsigned int FetchCacheLineSize = 64;
+	static const unsigned int FetchCacheLines = 256;
+
+	static VertexCacheStats MakeStats(unsigned int transformed, const unsigned int* indices, size_t indexCount, size_t vertexCount);
+};
+
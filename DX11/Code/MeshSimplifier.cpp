@@ -0,0 +1,583 @@
+#include "MeshSimplifier.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+using namespace DirectX;
+
+// How each vertex may collapse
+enum VertexKind
+{
+	VertexKind_Manifold,	// Anywhere
+	VertexKind_Border,		// Only along its open edge
+	VertexKind_Seam,		// Only along its seam, along with its twin
+	VertexKind_Locked		// Never
+};
+
+// A symmetric 4x4 matrix (the sum of squared distances to a set
+// of planes), plus the total weight of the planes
+struct Quadric
+{
+	double a00, a11, a22, a10, a20, a21;
+	double b0, b1, b2;
+	double c;
+	double w;
+};
+
+struct Collapse
+{
+	unsigned int From;
+	unsigned int To;
+	float Error;
+};
+
+static void QuadricFromPlane(Quadric& q, double a, double b, double c, double d, double weight)
+{
+	q.a00 = a * a * weight;
+	q.a11 = b * b * weight;
+	q.a22 = c * c * weight;
+	q.a10 = a * b * weight;
+	q.a20 = a * c * weight;
+	q.a21 = b * c * weight;
+	q.b0 = a * d * weight;
+	q.b1 = b * d * weight;
+	q.b2 = c * d * weight;
+	q.c = d * d * weight;
+	q.w = weight;
+}
+
+static void QuadricAdd(Quadric& q, const Quadric& r)
+{
+	q.a00 += r.a00;
+	q.a11 += r.a11;
+	q.a22 += r.a22;
+	q.a10 += r.a10;
+	q.a20 += r.a20;
+	q.a21 += r.a21;
+	q.b0 += r.b0;
+	q.b1 += r.b1;
+	q.b2 += r.b2;
+	q.c += r.c;
+	q.w += r.w;
+}
+
+// Weighted average squared distance from a point to the quadric's planes
+static double QuadricError(const Quadric& q, const double* p)
+{
+	double rx = q.a00 * p[0] + q.a10 * p[1] + q.a20 * p[2] + q.b0 * 2;
+	double ry = q.a10 * p[0] + q.a11 * p[1] + q.a21 * p[2] + q.b1 * 2;
+	double rz = q.a20 * p[0] + q.a21 * p[1] + q.a22 * p[2] + q.b2 * 2;
+	double error = rx * p[0] + ry * p[1] + rz * p[2] + q.c;
+	return q.w > 0.0 ? fabs(error) / q.w : 0.0;
+}
+
+static inline void Subtract(const double* a, const double* b, double* out)
+{
+	out[0] = a[0] - b[0];
+	out[1] = a[1] - b[1];
+	out[2] = a[2] - b[2];
+}
+
+static inline void Cross(const double* a, const double* b, double* out)
+{
+	out[0] = a[1] * b[2] - a[2] * b[1];
+	out[1] = a[2] * b[0] - a[0] * b[2];
+	out[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+static inline double Dot(const double* a, const double* b)
+{
+	return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+static inline unsigned long long EdgeKey(unsigned int a, unsigned int b)
+{
+	return ((unsigned long long)a << 32) | b;
+}
+
+struct TriangleHash
+{
+	size_t operator()(const std::pair<unsigned long long, unsigned int>& t) const
+	{
+		return std::hash<unsigned long long>()(t.first) ^ ((size_t)t.second * 2654435761u);
+	}
+};
+
+// Finds vertices that are exact copies of an earlier vertex, as far
+// as seams are concerned (files often repeat normals per face, so the
+// parser keeps vertices that only differ in which normal they index)
+static void BuildDuplicates(const Vertex* vertices, size_t vertexCount, std::vector<unsigned int>& original)
+{
+	struct Attributes
+	{
+		XMFLOAT3 Position;
+		XMFLOAT3 Normal;
+		XMFLOAT2 UV;
+	};
+	struct AttributeHash
+	{
+		size_t operator()(const Attributes& a) const
+		{
+			unsigned int bits[8];
+			memcpy(bits, &a, sizeof(bits));
+			size_t hash = 2166136261u;
+			for (int i = 0; i < 8; i++)
+				hash = (hash ^ bits[i]) * 16777619u;
+			return hash;
+		}
+	};
+	struct AttributeEqual
+	{
+		bool operator()(const Attributes& a, const Attributes& b) const { return memcmp(&a, &b, sizeof(a)) == 0; }
+	};
+
+	std::unordered_map<Attributes, unsigned int, AttributeHash, AttributeEqual> firstWith;
+	firstWith.reserve(vertexCount);
+
+	original.resize(vertexCount);
+	for (unsigned int v = 0; v < vertexCount; v++)
+	{
+		Attributes a = { vertices[v].Position, vertices[v].Normal, vertices[v].UV };
+		original[v] = firstWith.insert({ a, v }).first->second;
+	}
+}
+
+// Groups vertices with identical positions - remap[v] is the first
+// vertex at v's position, and wedge[v] the next one (in a loop).
+// Duplicates are left out, as they're never used.
+static void BuildPositionGroups(const Vertex* vertices, size_t vertexCount, const std::vector<unsigned int>& original, std::vector<unsigned int>& remap, std::vector<unsigned int>& wedge)
+{
+	struct PositionHash
+	{
+		size_t operator()(const XMFLOAT3& p) const
+		{
+			unsigned int bits[3];
+			memcpy(bits, &p, sizeof(bits));
+			return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+		}
+	};
+	struct PositionEqual
+	{
+		bool operator()(const XMFLOAT3& a, const XMFLOAT3& b) const { return memcmp(&a, &b, sizeof(a)) == 0; }
+	};
+
+	std::unordered_map<XMFLOAT3, unsigned int, PositionHash, PositionEqual> firstAt;
+	firstAt.reserve(vertexCount);
+
+	remap.resize(vertexCount);
+	wedge.resize(vertexCount);
+	for (unsigned int v = 0; v < vertexCount; v++)
+	{
+		remap[v] = v;
+		wedge[v] = v;
+		if (original[v] != v)
+			continue;
+
+		auto result = firstAt.insert({ vertices[v].Position, v });
+		unsigned int first = result.first->second;
+		remap[v] = first;
+
+		// Splice into the first vertex's loop
+		if (first != v)
+		{
+			wedge[v] = wedge[first];
+			wedge[first] = v;
+		}
+	}
+}
+
+
+// Drops any triangle that uses the same vertices, in the same
+// winding, as an earlier one
+static void RemoveRepeatedTriangles(std::vector<unsigned int>& indices)
+{
+	std::unordered_set<std::pair<unsigned long long, unsigned int>, TriangleHash> seen;
+	seen.reserve(indices.size() / 3);
+
+	size_t write = 0;
+	for (size_t i = 0; i + 2 < indices.size(); i += 3)
+	{
+		unsigned int a = indices[i], b = indices[i + 1], c = indices[i + 2];
+
+		// Rotate the smallest index to the front, keeping the winding
+		if (b < a && b < c) { unsigned int t = a; a = b; b = c; c = t; }
+		else if (c < a && c < b) { unsigned int t = c; c = b; b = a; a = t; }
+
+		if (!seen.insert({ EdgeKey(a, b), c }).second)
+			continue;
+
+		indices[write++] = indices[i];
+		indices[write++] = indices[i + 1];
+		indices[write++] = indices[i + 2];
+	}
+	indices.resize(write);
+}
+
+
+// --------------------------------------------------------
+// Runs passes of edge collapses, cheapest first, until the
+// target count or error is reached
+// --------------------------------------------------------
+size_t MeshSimplifier::Simplify(unsigned int* destination, const unsigned int* indices, size_t indexCount, const Vertex* vertices, size_t vertexCount, size_t targetIndexCount, float targetError, float* resultError)
+{
+	std::vector<unsigned int> result(indices, indices + indexCount);
+	if (resultError)
+		*resultError = 0.0f;
+
+	// Work in a unit cube, in double precision, so errors are relative
+	float extent = GetExtent(vertices, vertexCount);
+	float scale = extent > 0.0f ? 1.0f / extent : 0.0f;
+	XMFLOAT3 boundsMin = vertexCount > 0 ? vertices[0].Position : XMFLOAT3(0, 0, 0);
+	for (size_t v = 1; v < vertexCount; v++)
+	{
+		boundsMin.x = (std::min)(boundsMin.x, vertices[v].Position.x);
+		boundsMin.y = (std::min)(boundsMin.y, vertices[v].Position.y);
+		boundsMin.z = (std::min)(boundsMin.z, vertices[v].Position.z);
+	}
+	std::vector<double> positions(vertexCount * 3);
+	for (size_t v = 0; v < vertexCount; v++)
+	{
+		positions[v * 3 + 0] = (vertices[v].Position.x - boundsMin.x) * (double)scale;
+		positions[v * 3 + 1] = (vertices[v].Position.y - boundsMin.y) * (double)scale;
+		positions[v * 3 + 2] = (vertices[v].Position.z - boundsMin.z) * (double)scale;
+	}
+
+	// Duplicate vertices are swapped for their originals, so they
+	// don't look like seams
+	std::vector<unsigned int> original, remap, wedge;
+	BuildDuplicates(vertices, vertexCount, original);
+	for (size_t i = 0; i < indexCount; i++)
+		result[i] = original[result[i]];
+	BuildPositionGroups(vertices, vertexCount, original, remap, wedge);
+
+	// That can reveal repeated triangles (some files hold two copies of
+	// the same surface), which would hide every edge's real neighbors
+	RemoveRepeatedTriangles(result);
+	indexCount = result.size();
+
+	// Open edges are those without a matching edge the other way
+	// around, found both for the actual vertices (borders and seams)
+	// and for their positions (just borders)
+	std::unordered_set<unsigned long long> edges, positionEdges;
+	edges.reserve(indexCount);
+	positionEdges.reserve(indexCount);
+	for (size_t i = 0; i < indexCount; i++)
+	{
+		unsigned int a = result[i];
+		unsigned int b = result[i % 3 == 2 ? i - 2 : i + 1];
+		edges.insert(EdgeKey(a, b));
+		positionEdges.insert(EdgeKey(remap[a], remap[b]));
+	}
+
+	std::vector<unsigned int> openOut(vertexCount, 0), openIn(vertexCount, 0);
+	std::vector<unsigned int> openOutTo(vertexCount, ~0u), openInFrom(vertexCount, ~0u);
+	std::vector<bool> positionOpen(vertexCount, false);
+	for (size_t i = 0; i < indexCount; i++)
+	{
+		unsigned int a = result[i];
+		unsigned int b = result[i % 3 == 2 ? i - 2 : i + 1];
+		if (edges.find(EdgeKey(b, a)) == edges.end())
+		{
+			openOut[a]++;
+			openIn[b]++;
+			openOutTo[a] = b;
+			openInFrom[b] = a;
+		}
+		if (positionEdges.find(EdgeKey(remap[b], remap[a])) == positionEdges.end())
+			positionOpen[remap[a]] = positionOpen[remap[b]] = true;
+	}
+
+	std::vector<VertexKind> kinds(vertexCount, VertexKind_Locked);
+	for (unsigned int v = 0; v < vertexCount; v++)
+	{
+		unsigned int twin = wedge[v];
+		bool oneOpenEdgeEachWay = openOut[v] == 1 && openIn[v] == 1;
+
+		if (twin == v)
+		{
+			if (openOut[v] == 0 && openIn[v] == 0)
+				kinds[v] = VertexKind_Manifold;
+			else if (oneOpenEdgeEachWay)
+				kinds[v] = VertexKind_Border;
+		}
+		else if (wedge[twin] == v && !positionOpen[remap[v]] &&
+			oneOpenEdgeEachWay && openOut[twin] == 1 && openIn[twin] == 1)
+		{
+			kinds[v] = VertexKind_Seam;
+		}
+	}
+
+	// Each position's quadric: the planes of its triangles, weighted by
+	// area, plus planes perpendicular to any border or seam edges
+	std::vector<Quadric> quadrics(vertexCount);
+	memset(quadrics.data(), 0, quadrics.size() * sizeof(Quadric));
+	for (size_t t = 0; t < indexCount / 3; t++)
+	{
+		const unsigned int* tri = &result[t * 3];
+		const double* p0 = &positions[tri[0] * 3];
+		const double* p1 = &positions[tri[1] * 3];
+		const double* p2 = &positions[tri[2] * 3];
+
+		double e1[3], e2[3], normal[3];
+		Subtract(p1, p0, e1);
+		Subtract(p2, p0, e2);
+		Cross(e1, e2, normal);
+		double length = sqrt(Dot(normal, normal));
+		if (length == 0.0)
+			continue;
+		normal[0] /= length;
+		normal[1] /= length;
+		normal[2] /= length;
+
+		Quadric q;
+		QuadricFromPlane(q, normal[0], normal[1], normal[2], -Dot(normal, p0), length * 0.5);
+		for (int i = 0; i < 3; i++)
+			QuadricAdd(quadrics[remap[tri[i]]], q);
+
+		for (int i = 0; i < 3; i++)
+		{
+			unsigned int a = tri[i];
+			unsigned int b = tri[(i + 1) % 3];
+			if (edges.find(EdgeKey(b, a)) != edges.end())
+				continue;
+
+			const double* pa = &positions[a * 3];
+			const double* pb = &positions[b * 3];
+			double edge[3], edgeNormal[3];
+			Subtract(pb, pa, edge);
+			Cross(edge, normal, edgeNormal);
+			double edgeLength = sqrt(Dot(edgeNormal, edgeNormal));
+			if (edgeLength == 0.0)
+				continue;
+			edgeNormal[0] /= edgeLength;
+			edgeNormal[1] /= edgeLength;
+			edgeNormal[2] /= edgeLength;
+
+			QuadricFromPlane(q, edgeNormal[0], edgeNormal[1], edgeNormal[2], -Dot(edgeNormal, pa), edgeLength * edgeLength * EdgeWeight);
+			QuadricAdd(quadrics[remap[a]], q);
+			QuadricAdd(quadrics[remap[b]], q);
+		}
+	}
+
+	// Can "from" collapse onto "to"?  Also finds the twin collapse for seams.
+	auto isOpenEdge = [&](unsigned int a, unsigned int b)
+	{
+		return openOutTo[a] == b || openInFrom[a] == b;
+	};
+	auto canCollapse = [&](unsigned int from, unsigned int to, unsigned int& twinFrom, unsigned int& twinTo)
+	{
+		twinFrom = twinTo = ~0u;
+		if (remap[from] == remap[to])
+			return false;
+
+		switch (kinds[from])
+		{
+		case VertexKind_Manifold:
+			return true;
+		case VertexKind_Border:
+			return isOpenEdge(from, to);
+		case VertexKind_Seam:
+		{
+			if (!isOpenEdge(from, to))
+				return false;
+
+			// The twin has to have a seam edge to the same position
+			twinFrom = wedge[from];
+			if (openOutTo[twinFrom] != ~0u && remap[openOutTo[twinFrom]] == remap[to])
+				twinTo = openOutTo[twinFrom];
+			else if (openInFrom[twinFrom] != ~0u && remap[openInFrom[twinFrom]] == remap[to])
+				twinTo = openInFrom[twinFrom];
+			return twinTo != ~0u;
+		}
+		default:
+			return false;
+		}
+	};
+
+	// Borders and seams lose a vertex when collapsed along, so the
+	// open edge chain is joined back up around it
+	auto removeFromOpenEdges = [&](unsigned int from, unsigned int to)
+	{
+		if (openOutTo[from] == to)
+		{
+			unsigned int previous = openInFrom[from];
+			openInFrom[to] = previous;
+			if (previous != ~0u)
+				openOutTo[previous] = to;
+		}
+		else if (openInFrom[from] == to)
+		{
+			unsigned int next = openOutTo[from];
+			openOutTo[to] = next;
+			if (next != ~0u)
+				openInFrom[next] = to;
+		}
+	};
+
+	std::vector<unsigned int> collapseRemap(vertexCount);
+	std::vector<bool> collapseLocked(vertexCount);
+	std::vector<unsigned int> adjacencyStart(vertexCount + 1);
+	std::vector<unsigned int> adjacency;
+	std::vector<Collapse> candidates;
+	double maxErrorSq = (double)targetError * targetError;
+	double worstError = 0.0;
+
+	// Would moving "from" to "to" flip any of its (remaining) triangles?
+	auto hasFlips = [&](unsigned int from, unsigned int to)
+	{
+		const double* target = &positions[to * 3];
+		for (unsigned int a = adjacencyStart[from]; a < adjacencyStart[from + 1]; a++)
+		{
+			const unsigned int* tri = &result[adjacency[a] * 3];
+			if (remap[tri[0]] == remap[to] || remap[tri[1]] == remap[to] || remap[tri[2]] == remap[to])
+				continue;
+
+			// Rotate so "from" comes first
+			int k = tri[0] == from ? 0 : (tri[1] == from ? 1 : 2);
+			const double* p0 = &positions[from * 3];
+			const double* p1 = &positions[tri[(k + 1) % 3] * 3];
+			const double* p2 = &positions[tri[(k + 2) % 3] * 3];
+
+			double e1[3], e2[3], before[3], after[3];
+			Subtract(p1, p0, e1);
+			Subtract(p2, p0, e2);
+			Cross(e1, e2, before);
+			Subtract(p1, target, e1);
+			Subtract(p2, target, e2);
+			Cross(e1, e2, after);
+			if (Dot(before, after) <= 0.0)
+				return true;
+		}
+		return false;
+	};
+
+	while (result.size() > targetIndexCount)
+	{
+		size_t triCount = result.size() / 3;
+
+		// Triangles around each vertex
+		std::fill(adjacencyStart.begin(), adjacencyStart.end(), 0);
+		for (unsigned int index : result)
+			adjacencyStart[index + 1]++;
+		for (size_t v = 0; v < vertexCount; v++)
+			adjacencyStart[v + 1] += adjacencyStart[v];
+		adjacency.resize(result.size());
+		std::vector<unsigned int> fill(adjacencyStart.begin(), adjacencyStart.end() - 1);
+		for (size_t i = 0; i < result.size(); i++)
+			adjacency[fill[result[i]]++] = (unsigned int)(i / 3);
+
+		// Cheapest valid direction for every edge
+		candidates.clear();
+		for (size_t t = 0; t < triCount; t++)
+		{
+			for (int i = 0; i < 3; i++)
+			{
+				unsigned int a = result[t * 3 + i];
+				unsigned int b = result[t * 3 + (i + 1) % 3];
+
+				// Interior edges show up in two triangles, so take just one
+				if (a > b && edges.find(EdgeKey(b, a)) != edges.end())
+					continue;
+
+				unsigned int twinFrom, twinTo;
+				double errorAB = canCollapse(a, b, twinFrom, twinTo) ? QuadricError(quadrics[remap[a]], &positions[b * 3]) : -1.0;
+				double errorBA = canCollapse(b, a, twinFrom, twinTo) ? QuadricError(quadrics[remap[b]], &positions[a * 3]) : -1.0;
+				if (errorAB < 0.0 && errorBA < 0.0)
+					continue;
+
+				if (errorBA < 0.0 || (errorAB >= 0.0 && errorAB <= errorBA))
+					candidates.push_back({ a, b, (float)errorAB });
+				else
+					candidates.push_back({ b, a, (float)errorBA });
+			}
+		}
+		std::sort(candidates.begin(), candidates.end(), [](const Collapse& a, const Collapse& b) { return a.Error < b.Error; });
+
+		// Collapse as many as possible, without touching a vertex twice
+		for (unsigned int v = 0; v < vertexCount; v++)
+			collapseRemap[v] = v;
+		std::fill(collapseLocked.begin(), collapseLocked.end(), false);
+
+		size_t trianglesToRemove = (result.size() - targetIndexCount) / 3;
+		size_t trianglesRemoved = 0;
+		size_t collapses = 0;
+		for (const Collapse& c : candidates)
+		{
+			if (c.Error > maxErrorSq || trianglesRemoved >= trianglesToRemove)
+				break;
+			if (collapseLocked[remap[c.From]] || collapseLocked[remap[c.To]])
+				continue;
+
+			unsigned int twinFrom, twinTo;
+			if (!canCollapse(c.From, c.To, twinFrom, twinTo))
+				continue;
+			if (hasFlips(c.From, c.To) || (twinFrom != ~0u && hasFlips(twinFrom, twinTo)))
+				continue;
+
+			collapseRemap[c.From] = c.To;
+			if (twinFrom != ~0u)
+				collapseRemap[twinFrom] = twinTo;
+			if (kinds[c.From] != VertexKind_Manifold)
+				removeFromOpenEdges(c.From, c.To);
+			if (twinFrom != ~0u)
+				removeFromOpenEdges(twinFrom, twinTo);
+			QuadricAdd(quadrics[remap[c.To]], quadrics[remap[c.From]]);
+
+			collapseLocked[remap[c.From]] = true;
+			collapseLocked[remap[c.To]] = true;
+			worstError = (std::max)(worstError, (double)c.Error);
+			collapses++;
+
+			// Interior collapses remove two triangles, others just one
+			trianglesRemoved += kinds[c.From] == VertexKind_Border ? 1 : 2;
+		}
+
+		if (collapses == 0)
+			break;
+
+		// Apply the collapses, dropping triangles that are now degenerate
+		size_t write = 0;
+		for (size_t t = 0; t < triCount; t++)
+		{
+			unsigned int a = collapseRemap[result[t * 3]];
+			unsigned int b = collapseRemap[result[t * 3 + 1]];
+			unsigned int c = collapseRemap[result[t * 3 + 2]];
+			if (a == b || b == c || a == c)
+				continue;
+
+			result[write++] = a;
+			result[write++] = b;
+			result[write++] = c;
+		}
+		result.resize(write);
+	}
+
+	if (resultError)
+		*resultError = (float)sqrt(worstError);
+
+	std::copy(result.begin(), result.end(), destination);
+	return result.size();
+}
+
+float MeshSimplifier::GetExtent(const Vertex* vertices, size_t vertexCount)
+{
+	if (vertexCount == 0)
+		return 0.0f;
+
+	XMVECTOR boundsMin = XMLoadFloat3(&vertices[0].Position);
+	XMVECTOR boundsMax = boundsMin;
+	for (size_t v = 1; v < vertexCount; v++)
+	{
+		XMVECTOR p = XMLoadFloat3(&vertices[v].Position);
+		boundsMin = XMVectorMin(boundsMin, p);
+		boundsMax = XMVectorMax(boundsMax, p);
+	}
+
+	XMFLOAT3 size;
+	XMStoreFloat3(&size, boundsMax - boundsMin);
+	return (std::max)(size.x, (std::max)(size.y, size.z));
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "Vertex.h"
+
+// --------------------------------------------------------
+// Reduces the triangle count of a mesh for LODs, using edge
+// collapses ordered by quadric error (Garland & Heckbert's
+// "Surface Simplification Using Quadric Error Metrics")
+//
+// Collapses only ever move a vertex onto a neighbor, so the
+// simplified index buffer still uses the original vertex
+// buffer, and every LOD can share it.
+//
+// Vertices that share a position but not their UV or normal
+// (texture seams and hard edges) only collapse along their
+// seam, and together, so seams stay intact.  Open borders
+// likewise only collapse along the border.
+// --------------------------------------------------------
+class MeshSimplifier
+{
+public:
+	// Writes at most indexCount indices to destination and returns how
+	// many were written.  Stops at targetIndexCount, or before any
+	// collapse with an error above targetError, which is relative to
+	// the mesh's extent (0.01 = 1% of its largest dimension).  The
+	// largest error actually reached is written to resultError.
+	static size_t Simplify(unsigned int* destination, const unsigned int* indices, size_t indexCount, const Vertex* vertices, size_t vertexCount, size_t targetIndexCount, float targetError, float* resultError = 0);
+
+	// Largest dimension of the vertices' bounding box, which
+	// converts relative errors back into model space units
+	static float GetExtent(const Vertex* vertices, size_t vertexCount);
+
+private:
+	// How strongly seams and borders resist moving, compared to surfaces
+	static const int EdgeWeight = 10;
+};
+
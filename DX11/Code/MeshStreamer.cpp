@@ -0,0 +1,281 @@
+#include "MeshStreamer.h"
+#include "GlbFile.h"
+#include "JobSystem.h"
+#include "MeshBinary.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+
+#include <algorithm>
+#include <cstring>
+
+const float MeshStreamer::StandInMaxError = 0.05f;
+
+
+MeshStreamer::MeshStreamer(std::shared_ptr<AssetCache> assets, size_t budgetBytes) :
+	assets(assets),
+	completed(std::make_shared<CompletedLoads>()),
+	budgetBytes(budgetBytes),
+	frame(1),
+	stats(),
+	totalLoadMs(0.0)
+{
+}
+
+int MeshStreamer::Register(const std::string& meshFile, unsigned int flags, std::shared_ptr<Mesh> standIn)
+{
+	Entry entry;
+	entry.MeshFile = meshFile;
+	entry.Flags = flags;
+	entry.StandIn = standIn;
+	entry.State = MeshState_NotResident;
+	entry.Bytes = EstimateBytes(meshFile);
+	entry.LastUsedFrame = 0;
+	entry.Priority = 0.0f;
+	entry.Waiting = false;
+	entries.push_back(entry);
+	return (int)entries.size() - 1;
+}
+
+void MeshStreamer::Request(int id, float priority)
+{
+	Entry& e = entries[id];
+	e.LastUsedFrame = frame;
+	e.Priority = (std::max)(e.Priority, priority);
+
+	stats.Requests++;
+	if (e.State == MeshState_Resident)
+		stats.Hits++;
+	else if (!e.Waiting)
+	{
+		// Latency is measured from here
+		e.Waiting = true;
+		e.FirstRequested = Clock::now();
+	}
+}
+
+void MeshStreamer::Update()
+{
+	// Swap in whatever finished since last frame
+	std::vector<std::pair<int, std::shared_ptr<Mesh>>> finished;
+	{
+		std::lock_guard<std::mutex> lock(completed->Mutex);
+		finished.swap(completed->Meshes);
+	}
+	for (auto& f : finished)
+	{
+		Entry& e = entries[f.first];
+		if (!f.second)
+		{
+			// Missing or broken file - the stand-in stays
+			e.State = MeshState_Failed;
+			e.Waiting = false;
+			continue;
+		}
+
+		// The real size replaces the estimate it was budgeted with
+		e.Resident = f.second;
+		e.State = MeshState_Resident;
+		e.Bytes = e.Resident->GetMemorySize();
+		stats.ResidentBytes += e.Bytes;
+		stats.Loads++;
+
+		if (e.Waiting)
+		{
+			double ms = std::chrono::duration<double, std::milli>(Clock::now() - e.FirstRequested).count();
+			totalLoadMs += ms;
+			stats.MaxLoadMs = (std::max)(stats.MaxLoadMs, ms);
+			e.Waiting = false;
+		}
+	}
+
+	// New sizes (or a smaller budget) may have gone over
+	MakeRoom(0);
+
+	// Start loading the most important of what's missing, as long as
+	// there's room for it (its estimated size stays reserved by
+	// MakeRoom until the load finishes)
+	std::vector<int> wanted;
+	int inFlight = 0;
+	for (size_t i = 0; i < entries.size(); i++)
+	{
+		if (entries[i].State == MeshState_Loading)
+			inFlight++;
+		else if (entries[i].State == MeshState_NotResident && entries[i].Priority > 0.0f)
+			wanted.push_back((int)i);
+	}
+	std::sort(wanted.begin(), wanted.end(), [&](int a, int b) { return entries[a].Priority > entries[b].Priority; });
+
+	for (int id : wanted)
+	{
+		Entry& e = entries[id];
+		if (inFlight >= MaxLoadsInFlight || !MakeRoom(e.Bytes))
+			break;
+
+		e.State = MeshState_Loading;
+		inFlight++;
+
+		// Everything the job needs is copied into it
+		std::shared_ptr<CompletedLoads> done = completed;
+		std::shared_ptr<AssetCache> loadAssets = assets;
+		std::string meshFile = e.MeshFile;
+		unsigned int flags = e.Flags;
+		JobSystem::GetInstance().RunInBackground([done, loadAssets, meshFile, flags, id]()
+		{
+			std::shared_ptr<Mesh> mesh = loadAssets->GetMesh(meshFile, flags);
+			std::lock_guard<std::mutex> lock(done->Mutex);
+			done->Meshes.push_back(std::make_pair(id, mesh));
+		});
+	}
+
+	// Requests start over each frame
+	for (auto& e : entries)
+		e.Priority = 0.0f;
+	frame++;
+}
+
+std::shared_ptr<Mesh> MeshStreamer::Get(int id)
+{
+	Entry& e = entries[id];
+	return e.State == MeshState_Resident ? e.Resident : e.StandIn;
+}
+
+void MeshStreamer::SetStandIn(int id, std::shared_ptr<Mesh> standIn)
+{
+	entries[id].StandIn = standIn;
+}
+
+bool MeshStreamer::IsResident(int id)
+{
+	return entries[id].State == MeshState_Resident;
+}
+
+MeshStreamingStats MeshStreamer::GetStats()
+{
+	MeshStreamingStats result = stats;
+	result.BudgetBytes = budgetBytes;
+	result.ResidentMeshes = 0;
+	result.LoadingMeshes = 0;
+	for (auto& e : entries)
+	{
+		if (e.State == MeshState_Resident) result.ResidentMeshes++;
+		if (e.State == MeshState_Loading) result.LoadingMeshes++;
+	}
+	result.AverageLoadMs = stats.Loads > 0 ? totalLoadMs / stats.Loads : 0.0;
+	return result;
+}
+
+
+void MeshStreamer::Evict(Entry& entry)
+{
+	// Anything still drawing it keeps it alive until it lets go
+	stats.ResidentBytes -= entry.Bytes;
+	stats.Evictions++;
+	entry.Resident.reset();
+	entry.State = MeshState_NotResident;
+}
+
+// --------------------------------------------------------
+// Evicts the least recently used meshes until the given
+// number of bytes (plus what's already loading) fits in the
+// budget.  Meshes requested this frame are off limits, so
+// this fails if they alone are too much.
+// --------------------------------------------------------
+bool MeshStreamer::MakeRoom(size_t bytes)
+{
+	size_t loadingBytes = 0;
+	for (auto& e : entries)
+	{
+		if (e.State == MeshState_Loading)
+			loadingBytes += e.Bytes;
+	}
+
+	while (stats.ResidentBytes + loadingBytes + bytes > budgetBytes)
+	{
+		Entry* oldest = 0;
+		for (auto& e : entries)
+		{
+			if (e.State == MeshState_Resident && e.LastUsedFrame < frame && (!oldest || e.LastUsedFrame < oldest->LastUsedFrame))
+				oldest = &e;
+		}
+		if (!oldest)
+			return false;
+
+		Evict(*oldest);
+	}
+	return true;
+}
+
+
+// --------------------------------------------------------
+// A guess at a mesh's size before it's loaded, so the load
+// can be budgeted for up front: the binary cache's arrays
+// (uncompressed) if there is one, otherwise the size of the
+// file itself - an OBJ's text is larger than its mesh.
+// --------------------------------------------------------
+size_t MeshStreamer::EstimateBytes(const std::string& meshFile)
+{
+	MeshBinary cache(MeshBinary::PathFor(meshFile.c_str()).c_str());
+	if (cache.IsValid())
+		return (size_t)cache.GetVertexCount() * sizeof(Vertex) + (size_t)cache.GetIndexCount() * sizeof(unsigned int);
+
+	WIN32_FILE_ATTRIBUTE_DATA info;
+	if (!GetFileAttributesExA(meshFile.c_str(), GetFileExInfoStandard, &info))
+		return 0;
+	return (size_t)(((unsigned long long)info.nFileSizeHigh << 32) | info.nFileSizeLow);
+}
+
+
+// --------------------------------------------------------
+// Reads the file's binary cache (making sure there is one)
+// and keeps a simplified copy of it
+// --------------------------------------------------------
+std::shared_ptr<Mesh> MeshStreamer::MakeStandIn(const std::string& meshFile, std::shared_ptr<AssetCache> assets, Microsoft::WRL::ComPtr<ID3D11Device> device, unsigned int flags, int maxTriangles)
+{
+	std::vector<Vertex> vertices;
+	std::vector<unsigned int> indices;
+
+	size_t length = meshFile.size();
+	if (length >= 4 && _stricmp(meshFile.c_str() + length - 4, ".glb") == 0)
+	{
+		GlbFile glb(meshFile.c_str());
+		if (!glb.Load())
+			return 0;
+		vertices.assign(glb.GetVertices(), glb.GetVertices() + glb.GetVertexCount());
+		indices.assign(glb.GetIndices(), glb.GetIndices() + glb.GetIndexCount());
+	}
+	else
+	{
+		std::string binFile = MeshBinary::PathFor(meshFile.c_str());
+		auto readCache = [&]()
+		{
+			MeshBinary cache(binFile.c_str());
+			if (!cache.IsValid() || !cache.MatchesSource(meshFile.c_str()) || !cache.Load())
+				return false;
+			vertices.assign(cache.GetVertices(), cache.GetVertices() + cache.GetVertexCount());
+			indices.assign(cache.GetIndices(), cache.GetIndices() + cache.GetIndexCount());
+			return true;
+		};
+
+		// Without a binary cache, the file is loaded through the asset
+		// cache instead - the same load the streamer uses (or waits on,
+		// if it's already running) - which writes one as it goes.  The
+		// OBJ is never parsed just for this.
+		if (!readCache())
+		{
+			if (!assets->GetMesh(meshFile, flags) || !readCache())
+				return 0;
+		}
+	}
+	if (indices.empty())
+		return 0;
+
+	// Only the vertices the simplified triangles still use are kept
+	std::vector<unsigned int> simplified(indices.size());
+	size_t count = MeshSimplifier::Simplify(&simplified[0], &indices[0], indices.size(), &vertices[0], vertices.size(), (size_t)maxTriangles * 3, StandInMaxError);
+	if (count == 0)
+		return 0;
+
+	MeshOptimizer::OptimizeVertexCache(&simplified[0], count, vertices.size());
+	vertices.resize(MeshOptimizer::OptimizeVertexFetch(&vertices[0], vertices.size(), &simplified[0], count));
+	return std::make_shared<Mesh>(&vertices[0], (int)vertices.size(), &simplified[0], (int)count, device, flags);
+}
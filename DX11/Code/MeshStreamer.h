@@ -0,0 +1,130 @@
+#pragma once
+
+#include <d3d11.h>
+#include <wrl/client.h>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "AssetCache.h"
+#include "Mesh.h"
+
+// --------------------------------------------------------
+// Running totals for a MeshStreamer
+// --------------------------------------------------------
+struct MeshStreamingStats
+{
+	size_t ResidentBytes;
+	size_t BudgetBytes;
+	int ResidentMeshes;
+	int LoadingMeshes;
+	unsigned long long Requests;
+	unsigned long long Hits;		// Requests for meshes that were already resident
+	unsigned long long Loads;
+	unsigned long long Evictions;
+	double AverageLoadMs;			// From first being requested to being resident
+	double MaxLoadMs;
+};
+
+// --------------------------------------------------------
+// Keeps a budget's worth of mesh files in memory, loading
+// them on background threads as they're requested and
+// evicting the least recently used when over the budget
+//
+// Every mesh has a small stand-in (usually a simplified
+// version, see MakeStandIn) that's always resident and is
+// handed out whenever the full mesh isn't.
+//
+// Each frame, Request() the meshes wanted (with a higher
+// priority for closer or visible ones), then Update() to
+// start loads and swap in finished ones, then Get() the
+// mesh to draw.  Meshes requested this frame are never
+// evicted to make room for others.
+// --------------------------------------------------------
+class MeshStreamer
+{
+public:
+	// Meshes are loaded through the asset cache, so anything else
+	// using the same file (and flags) shares the one copy
+	MeshStreamer(std::shared_ptr<AssetCache> assets, size_t budgetBytes);
+
+	// Returns an id for the mesh file, which is loaded with the given
+	// flags (see Mesh) when requested.  Nothing is loaded yet.
+	int Register(const std::string& meshFile, unsigned int flags, std::shared_ptr<Mesh> standIn);
+
+	// Higher priorities load first
+	void Request(int id, float priority);
+
+	// Finishes loads, evicts as needed and starts new loads
+	void Update();
+
+	// The full mesh when resident, otherwise its stand-in
+	std::shared_ptr<Mesh> Get(int id);
+	void SetStandIn(int id, std::shared_ptr<Mesh> standIn);
+	bool IsResident(int id);
+
+	size_t GetBudget() { return budgetBytes; }
+	void SetBudget(size_t bytes) { budgetBytes = bytes; }
+	MeshStreamingStats GetStats();
+
+	// Reads a mesh file and simplifies it down towards the given number
+	// of triangles, stopping early rather than going past StandInMaxError.
+	// Files without a binary cache yet are loaded through the asset cache
+	// (with the flags the streamer loads them with) to make one first.
+	// Returns null if the file can't be read.
+	static std::shared_ptr<Mesh> MakeStandIn(const std::string& meshFile, std::shared_ptr<AssetCache> assets, Microsoft::WRL::ComPtr<ID3D11Device> device, unsigned int flags, int maxTriangles);
+
+private:
+	typedef std::chrono::high_resolution_clock Clock;
+
+	enum MeshState
+	{
+		MeshState_NotResident,
+		MeshState_Loading,
+		MeshState_Resident,
+		MeshState_Failed			// Never retried
+	};
+
+	struct Entry
+	{
+		std::string MeshFile;
+		unsigned int Flags;
+		std::shared_ptr<Mesh> StandIn;
+		std::shared_ptr<Mesh> Resident;
+		MeshState State;
+		size_t Bytes;				// Estimated until the first load
+		unsigned long long LastUsedFrame;
+		float Priority;				// Highest this frame, or 0
+		bool Waiting;				// Requested and not resident yet
+		Clock::time_point FirstRequested;
+	};
+
+	// Loads finish on worker threads, and are handed over here (this is
+	// shared with the jobs, so it's fine for them to outlive the streamer)
+	struct CompletedLoads
+	{
+		std::mutex Mutex;
+		std::vector<std::pair<int, std::shared_ptr<Mesh>>> Meshes;
+	};
+
+	// Loads running at once (each load is parallel internally)
+	static const int MaxLoadsInFlight = 2;
+
+	// How far stand-ins may stray from the full mesh, relative to its size
+	static const float StandInMaxError;
+
+	std::shared_ptr<AssetCache> assets;
+	std::vector<Entry> entries;
+	std::shared_ptr<CompletedLoads> completed;
+	size_t budgetBytes;
+	unsigned long long frame;
+	MeshStreamingStats stats;
+	double totalLoadMs;
+
+	void Evict(Entry& entry);
+	bool MakeRoom(size_t bytes);
+
+	static size_t EstimateBytes(const std::string& meshFile);
+};
@@ -0,0 +1,316 @@
+#include "Meshlets.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace DirectX;
+
+// Normals must all be within about 84 degrees of the axis
+// for a cone to be worth testing (beyond that, a meshlet is
+// nearly always partly visible anyway)
+static const float MinConeDot = 0.1f;
+
+
+// --------------------------------------------------------
+// Grows each meshlet greedily from a seed triangle, always
+// adding the neighboring triangle that needs the fewest new
+// vertices, so meshlets come out compact and well filled.
+// Seeds follow the original triangle order, which keeps
+// the optimized order between meshlets mostly intact.
+// --------------------------------------------------------
+void Meshlets::Build(unsigned int* indices, size_t indexCount, const Vertex* vertices, size_t vertexCount, std::vector<Meshlet>& meshlets)
+{
+	meshlets.clear();
+	size_t triCount = indexCount / 3;
+	if (triCount == 0)
+		return;
+
+	// Triangles using each vertex
+	std::vector<unsigned int> adjacencyStart(vertexCount + 1, 0);
+	for (size_t i = 0; i < indexCount; i++)
+		adjacencyStart[indices[i] + 1]++;
+	for (size_t v = 0; v < vertexCount; v++)
+		adjacencyStart[v + 1] += adjacencyStart[v];
+	std::vector<unsigned int> adjacency(indexCount);
+	std::vector<unsigned int> fill(adjacencyStart.begin(), adjacencyStart.end() - 1);
+	for (size_t i = 0; i < indexCount; i++)
+		adjacency[fill[indices[i]]++] = (unsigned int)(i / 3);
+
+	std::vector<XMFLOAT3> centroids(triCount);
+	for (size_t t = 0; t < triCount; t++)
+	{
+		XMVECTOR p0 = XMLoadFloat3(&vertices[indices[t * 3]].Position);
+		XMVECTOR p1 = XMLoadFloat3(&vertices[indices[t * 3 + 1]].Position);
+		XMVECTOR p2 = XMLoadFloat3(&vertices[indices[t * 3 + 2]].Position);
+		XMStoreFloat3(&centroids[t], (p0 + p1 + p2) / 3.0f);
+	}
+
+	std::vector<bool> emitted(triCount, false);
+
+	// Which meshlet each vertex was last added to
+	std::vector<unsigned int> usedBy(vertexCount, ~0u);
+
+	std::vector<unsigned int> output;
+	output.reserve(indexCount);
+
+	unsigned int meshletVertices[MaxVertices];
+	unsigned int meshletIndex = 0;
+	Meshlet current = {};
+	XMVECTOR positionSum = XMVectorZero();
+	size_t nextSeed = 0;
+
+	// New vertices a triangle would add to the current meshlet
+	auto countNewVertices = [&](unsigned int t)
+	{
+		const unsigned int* tri = &indices[t * 3];
+		return
+			(unsigned int)(usedBy[tri[0]] != meshletIndex) +
+			(unsigned int)(usedBy[tri[1]] != meshletIndex && tri[1] != tri[0]) +
+			(unsigned int)(usedBy[tri[2]] != meshletIndex && tri[2] != tri[0] && tri[2] != tri[1]);
+	};
+
+	auto distanceSq = [&](unsigned int t, XMVECTOR center)
+	{
+		return XMVectorGetX(XMVector3LengthSq(XMLoadFloat3(&centroids[t]) - center));
+	};
+
+	auto finishMeshlet = [&]()
+	{
+		ComputeBounds(current, output.data(), meshletVertices, vertices);
+		meshlets.push_back(current);
+
+		current = {};
+		current.IndexStart = (unsigned int)output.size();
+		positionSum = XMVectorZero();
+		meshletIndex++;
+	};
+
+	for (size_t emittedCount = 0; emittedCount < triCount; emittedCount++)
+	{
+		bool full = current.TriangleCount == MaxTriangles;
+		XMVECTOR center = current.VertexCount > 0 ? positionSum / (float)current.VertexCount : XMVectorZero();
+
+		// Best neighbor: fewest new vertices, then closest to the
+		// meshlet's center (which keeps meshlets round, and so
+		// their bounding spheres and normal cones tight)
+		unsigned int best = ~0u;
+		unsigned int bestAdded = 4;
+		float bestDistance = 0.0f;
+		for (unsigned int v = 0; v < current.VertexCount && !full; v++)
+		{
+			unsigned int vertex = meshletVertices[v];
+			for (unsigned int a = adjacencyStart[vertex]; a < adjacencyStart[vertex + 1]; a++)
+			{
+				unsigned int t = adjacency[a];
+				if (emitted[t])
+					continue;
+
+				unsigned int added = countNewVertices(t);
+				if (added > bestAdded || current.VertexCount + added > MaxVertices)
+					continue;
+
+				float distance = distanceSq(t, center);
+				if (added < bestAdded || distance < bestDistance)
+				{
+					best = t;
+					bestAdded = added;
+					bestDistance = distance;
+				}
+			}
+		}
+
+		// Nothing connected fits, so look at the next few unused triangles
+		// in order for the closest one, starting a new meshlet if needed
+		if (best == ~0u)
+		{
+			while (emitted[nextSeed])
+				nextSeed++;
+
+			if (current.VertexCount > 0)
+			{
+				unsigned int looked = 0;
+				for (size_t t = nextSeed; t < triCount && looked < SeedSearchLimit; t++)
+				{
+					if (emitted[t])
+						continue;
+					looked++;
+
+					float distance = distanceSq((unsigned int)t, center);
+					if (best == ~0u || distance < bestDistance)
+					{
+						best = (unsigned int)t;
+						bestDistance = distance;
+					}
+				}
+			}
+			else
+			{
+				best = (unsigned int)nextSeed;
+			}
+
+			if (full || current.VertexCount + countNewVertices(best) > MaxVertices)
+			{
+				finishMeshlet();
+				best = (unsigned int)nextSeed;
+			}
+		}
+
+		// Add the triangle
+		const unsigned int* tri = &indices[best * 3];
+		for (int i = 0; i < 3; i++)
+		{
+			if (usedBy[tri[i]] != meshletIndex)
+			{
+				usedBy[tri[i]] = meshletIndex;
+				meshletVertices[current.VertexCount++] = tri[i];
+				positionSum += XMLoadFloat3(&vertices[tri[i]].Position);
+			}
+			output.push_back(tri[i]);
+		}
+		emitted[best] = true;
+		current.TriangleCount++;
+	}
+
+	finishMeshlet();
+
+	// Triangles are now grouped by meshlet
+	std::copy(output.begin(), output.end(), indices);
+}
+
+// --------------------------------------------------------
+// Finds a meshlet's bounding sphere and normal cone, using
+// the same approach as meshoptimizer's cluster bounds
+// --------------------------------------------------------
+void Meshlets::ComputeBounds(Meshlet& meshlet, const unsigned int* indices, const unsigned int* meshletVertices, const Vertex* vertices)
+{
+	// Sphere around the center of the vertices' bounding box
+	XMVECTOR boundsMin = XMLoadFloat3(&vertices[meshletVertices[0]].Position);
+	XMVECTOR boundsMax = boundsMin;
+	for (unsigned int i = 1; i < meshlet.VertexCount; i++)
+	{
+		XMVECTOR p = XMLoadFloat3(&vertices[meshletVertices[i]].Position);
+		boundsMin = XMVectorMin(boundsMin, p);
+		boundsMax = XMVectorMax(boundsMax, p);
+	}
+	XMVECTOR center = (boundsMin + boundsMax) * 0.5f;
+
+	float radiusSq = 0.0f;
+	for (unsigned int i = 0; i < meshlet.VertexCount; i++)
+	{
+		XMVECTOR p = XMLoadFloat3(&vertices[meshletVertices[i]].Position);
+		radiusSq = (std::max)(radiusSq, XMVectorGetX(XMVector3LengthSq(p - center)));
+	}
+	XMStoreFloat3(&meshlet.Center, center);
+	meshlet.Radius = sqrtf(radiusSq);
+
+	// Cone axis is the average of the triangles' normals (which
+	// face outward for clockwise winding in this left handed space)
+	const unsigned int* tris = &indices[meshlet.IndexStart];
+	XMVECTOR normalSum = XMVectorZero();
+	for (unsigned int t = 0; t < meshlet.TriangleCount; t++)
+	{
+		XMVECTOR p0 = XMLoadFloat3(&vertices[tris[t * 3]].Position);
+		XMVECTOR p1 = XMLoadFloat3(&vertices[tris[t * 3 + 1]].Position);
+		XMVECTOR p2 = XMLoadFloat3(&vertices[tris[t * 3 + 2]].Position);
+		XMVECTOR normal = XMVector3Cross(p1 - p0, p2 - p0);
+		if (XMVectorGetX(XMVector3LengthSq(normal)) > 0.0f)
+			normalSum += XMVector3Normalize(normal);
+	}
+
+	// No cone at all if the normals cancel out
+	meshlet.ConeAxis = XMFLOAT3(0, 0, 1);
+	meshlet.ConeApex = meshlet.Center;
+	meshlet.ConeCutoff = 2.0f;
+	if (XMVectorGetX(XMVector3LengthSq(normalSum)) == 0.0f)
+		return;
+	XMVECTOR axis = XMVector3Normalize(normalSum);
+
+	// The cone must be wide enough for the furthest normal, and
+	// its apex far enough back to be behind every triangle's plane
+	float minDot = 1.0f;
+	float maxT = 0.0f;
+	for (unsigned int t = 0; t < meshlet.TriangleCount; t++)
+	{
+		XMVECTOR p0 = XMLoadFloat3(&vertices[tris[t * 3]].Position);
+		XMVECTOR p1 = XMLoadFloat3(&vertices[tris[t * 3 + 1]].Position);
+		XMVECTOR p2 = XMLoadFloat3(&vertices[tris[t * 3 + 2]].Position);
+		XMVECTOR normal = XMVector3Cross(p1 - p0, p2 - p0);
+		if (XMVectorGetX(XMVector3LengthSq(normal)) == 0.0f)
+			continue;
+		normal = XMVector3Normalize(normal);
+
+		float axisDot = XMVectorGetX(XMVector3Dot(normal, axis));
+		minDot = (std::min)(minDot, axisDot);
+		if (axisDot > MinConeDot)
+			maxT = (std::max)(maxT, XMVectorGetX(XMVector3Dot(center - p0, normal)) / axisDot);
+	}
+
+	XMStoreFloat3(&meshlet.ConeAxis, axis);
+	if (minDot <= MinConeDot)
+		return;
+
+	XMStoreFloat3(&meshlet.ConeApex, center - axis * maxT);
+	meshlet.ConeCutoff = sqrtf(1.0f - minDot * minDot);
+}
+
+// --------------------------------------------------------
+// Extracts the frustum planes from the combined matrix, so
+// they come out in model space (Gribb & Hartmann's method,
+// with D3D's 0 to 1 depth range)
+// --------------------------------------------------------
+MeshletCullInfo Meshlets::MakeCullInfo(XMFLOAT4X4 world, XMFLOAT4X4 view, XMFLOAT4X4 projection, XMFLOAT3 cameraPosition)
+{
+	XMMATRIX worldMat = XMLoadFloat4x4(&world);
+	XMFLOAT4X4 m;
+	XMStoreFloat4x4(&m, worldMat * XMLoadFloat4x4(&view) * XMLoadFloat4x4(&projection));
+
+	XMVECTOR column0 = XMVectorSet(m._11, m._21, m._31, m._41);
+	XMVECTOR column1 = XMVectorSet(m._12, m._22, m._32, m._42);
+	XMVECTOR column2 = XMVectorSet(m._13, m._23, m._33, m._43);
+	XMVECTOR column3 = XMVectorSet(m._14, m._24, m._34, m._44);
+	XMVECTOR planes[6] =
+	{
+		column3 + column0,	// Left
+		column3 - column0,	// Right
+		column3 + column1,	// Bottom
+		column3 - column1,	// Top
+		column2,			// Near
+		column3 - column2	// Far
+	};
+
+	MeshletCullInfo cull;
+	for (int i = 0; i < 6; i++)
+	{
+		// Normalize so plane distances are in model space units
+		XMVECTOR length = XMVector3Length(planes[i]);
+		XMStoreFloat4(&cull.FrustumPlanes[i], planes[i] / XMVectorGetX(length));
+	}
+
+	XMMATRIX invWorld = XMMatrixInverse(0, worldMat);
+	XMStoreFloat3(&cull.CameraPosition, XMVector3TransformCoord(XMLoadFloat3(&cameraPosition), invWorld));
+	return cull;
+}
+
+MeshletVisibility Meshlets::Test(const Meshlet& meshlet, const MeshletCullInfo& cull)
+{
+	// Entirely outside any plane?
+	const XMFLOAT3& c = meshlet.Center;
+	for (int i = 0; i < 6; i++)
+	{
+		const XMFLOAT4& p = cull.FrustumPlanes[i];
+		if (p.x * c.x + p.y * c.y + p.z * c.z + p.w < -meshlet.Radius)
+			return MeshletVisibility_OutsideFrustum;
+	}
+
+	// Viewing direction inside the back facing cone?
+	XMFLOAT3 view(
+		meshlet.ConeApex.x - cull.CameraPosition.x,
+		meshlet.ConeApex.y - cull.CameraPosition.y,
+		meshlet.ConeApex.z - cull.CameraPosition.z);
+	float along = view.x * meshlet.ConeAxis.x + view.y * meshlet.ConeAxis.y + view.z * meshlet.ConeAxis.z;
+	float distance = sqrtf(view.x * view.x + view.y * view.y + view.z * view.z);
+	if (along > meshlet.ConeCutoff * distance)
+		return MeshletVisibility_BackFacing;
+
+	return MeshletVisibility_Visible;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <vector>
+
+#include "Vertex.h"
+
+// --------------------------------------------------------
+// A small cluster of a mesh's triangles, contiguous in its
+// index buffer, with bounds for culling it as a whole
+//
+// The normal cone holds every triangle's normal: a viewer
+// inside the cone behind the apex (looking down the axis)
+// sees only back faces.  A cutoff above 1 means the normals
+// are too spread out for the cluster to ever be culled.
+// --------------------------------------------------------
+struct Meshlet
+{
+	unsigned int IndexStart;	// First index in the mesh's index buffer
+	unsigned int TriangleCount;
+	unsigned int VertexCount;	// Unique vertices used
+	float Radius;
+	DirectX::XMFLOAT3 Center;
+	float ConeCutoff;			// Sine of the cone's half angle
+	DirectX::XMFLOAT3 ConeAxis;
+	DirectX::XMFLOAT3 ConeApex;
+};
+
+// --------------------------------------------------------
+// Everything needed to cull an object's meshlets, already
+// transformed into the object's model space
+// --------------------------------------------------------
+struct MeshletCullInfo
+{
+	DirectX::XMFLOAT4 FrustumPlanes[6];	// Normals point inward
+	DirectX::XMFLOAT3 CameraPosition;
+};
+
+enum MeshletVisibility
+{
+	MeshletVisibility_Visible,
+	MeshletVisibility_OutsideFrustum,
+	MeshletVisibility_BackFacing
+};
+
+// --------------------------------------------------------
+// Splits meshes into meshlets, and culls them on the CPU
+// --------------------------------------------------------
+class Meshlets
+{
+public:
+	// Limits per meshlet (matching common mesh shader limits,
+	// so the same clusters could later feed a GPU culling pass)
+	static const unsigned int MaxVertices = 64;
+	static const unsigned int MaxTriangles = 124;
+
+	// Splits a triangle list into meshlets, reordering the triangles
+	// so each meshlet's are contiguous.  Run this after MeshOptimizer's
+	// reordering, as new meshlets are started in that order.
+	static void Build(unsigned int* indices, size_t indexCount, const Vertex* vertices, size_t vertexCount, std::vector<Meshlet>& meshlets);
+
+	// Brings the camera's frustum and position into an object's model space
+	static MeshletCullInfo MakeCullInfo(DirectX::XMFLOAT4X4 world, DirectX::XMFLOAT4X4 view, DirectX::XMFLOAT4X4 projection, DirectX::XMFLOAT3 cameraPosition);
+
+	static MeshletVisibility Test(const Meshlet& meshlet, const MeshletCullInfo& cull);
+
+private:
+	// Unconnected triangles considered when a meshlet runs out of neighbors
+	static const unsigned int SeedSearchLimit = 128;
+
+	static void ComputeBounds(Meshlet& meshlet, const unsigned int* indices, const unsigned int* meshletVertices, const Vertex* vertices);
+};
+
@@ -0,0 +1,550 @@
+#include "ObjParser.h"
+#include "MappedFile.h"
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <climits>
+
+#include <emmintrin.h>
+#include <intrin.h>
+
+using namespace DirectX;
+
+// Powers of ten that are exactly representable as doubles
+static const double ExactPowersOfTen[] =
+{
+	1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+	1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+	1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+// Far past float's range either way, so clamping the exponent
+// to it still gives infinity or zero, and can't overflow an int
+static const int MaxExponent = 400;
+
+// Helpers for walking through a line
+static inline bool IsDigit(char c) { return c >= '0' && c <= '9'; }
+static inline bool IsSpace(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+static inline const char* SkipSpaces(const char* p, const char* end)
+{
+	while (p < end && IsSpace(*p)) p++;
+	return p;
+}
+
+static inline const char* SkipToken(const char* p, const char* end)
+{
+	while (p < end && !IsSpace(*p)) p++;
+	return p;
+}
+
+// Converts a (possibly negative) OBJ index into a 1-based absolute index,
+// given how many elements of that type have been read so far
+static inline unsigned int ResolveIndex(int index, size_t count)
+{
+	if (index > 0) return (unsigned int)index;
+	if (index < 0) return (unsigned int)((int)count + index + 1);
+	return 0;
+}
+
+
+// --------------------------------------------------------
+// Everything parsed from one newline-aligned piece of a file
+//
+// Face indices are stored as absolute, 1-based indices.
+// Relative (negative) ones can only be resolved against
+// what this chunk has seen, so they're recorded in the
+// fixup list and offset once the earlier chunks' counts
+// are known.  Unsigned wrap-around makes this work even
+// when a reference reaches back into a previous chunk.
+// --------------------------------------------------------
+struct ObjChunk
+{
+	std::vector<XMFLOAT3> Positions;
+	std::vector<XMFLOAT2> UVs;
+	std::vector<XMFLOAT3> Normals;
+	std::vector<ObjCorner> Corners;		// Three per triangle
+
+	struct Fixup
+	{
+		size_t Corner;
+		bool Position;
+		bool UV;
+		bool Normal;
+	};
+	std::vector<Fixup> Fixups;
+};
+
+// Parses every line in [begin, end), which must start at the beginning of a line
+static void ParseChunk(const char* begin, const char* end, ObjChunk& chunk)
+{
+	std::vector<ObjCorner> face;	// Corners of the current face
+	std::vector<bool> faceRelative;	// Which of those need fixing up (3 per corner)
+
+	// Rough guess at element counts to avoid most reallocations
+	// (a typical line in an OBJ is around 30 bytes)
+	size_t size = end - begin;
+	chunk.Positions.reserve(size / 128);
+	chunk.UVs.reserve(size / 128);
+	chunk.Normals.reserve(size / 128);
+	chunk.Corners.reserve(size / 64);
+
+	const char* line = begin;
+	while (line < end)
+	{
+		// Find this line's bounds, and skip any leading whitespace
+		const char* lineEnd = ObjParser::FindLineEnd(line, end);
+		const char* p = SkipSpaces(line, lineEnd);
+		line = lineEnd + 1;
+
+		// Need at least two characters to identify anything useful
+		if (lineEnd - p < 2)
+			continue;
+
+		if (p[0] == 'v' && p[1] == 'n')
+		{
+			XMFLOAT3 norm = XMFLOAT3(0, 0, 0);
+			p = ObjParser::ParseFloat(SkipSpaces(p + 2, lineEnd), lineEnd, norm.x);
+			p = ObjParser::ParseFloat(SkipSpaces(p, lineEnd), lineEnd, norm.y);
+			p = ObjParser::ParseFloat(SkipSpaces(p, lineEnd), lineEnd, norm.z);
+			chunk.Normals.push_back(norm);
+		}
+		else if (p[0] == 'v' && p[1] == 't')
+		{
+			XMFLOAT2 uv = XMFLOAT2(0, 0);
+			p = ObjParser::ParseFloat(SkipSpaces(p + 2, lineEnd), lineEnd, uv.x);
+			p = ObjParser::ParseFloat(SkipSpaces(p, lineEnd), lineEnd, uv.y);
+			chunk.UVs.push_back(uv);
+		}
+		else if (p[0] == 'v' && IsSpace(p[1]))
+		{
+			XMFLOAT3 pos = XMFLOAT3(0, 0, 0);
+			p = ObjParser::ParseFloat(SkipSpaces(p + 1, lineEnd), lineEnd, pos.x);
+			p = ObjParser::ParseFloat(SkipSpaces(p, lineEnd), lineEnd, pos.y);
+			p = ObjParser::ParseFloat(SkipSpaces(p, lineEnd), lineEnd, pos.z);
+			chunk.Positions.push_back(pos);
+		}
+		else if (p[0] == 'f' && IsSpace(p[1]))
+		{
+			// Read every corner on the line: v, v/vt, v//vn or v/vt/vn
+			face.clear();
+			faceRelative.clear();
+			p = SkipSpaces(p + 1, lineEnd);
+			while (p < lineEnd)
+			{
+				int v = 0, vt = 0, vn = 0;
+				const char* next = ObjParser::ParseInt(p, lineEnd, v);
+				if (next == p)
+					break;
+				p = next;
+
+				if (p < lineEnd && *p == '/')
+				{
+					p++;
+					if (p < lineEnd && *p != '/')
+						p = ObjParser::ParseInt(p, lineEnd, vt);
+					if (p < lineEnd && *p == '/')
+						p = ObjParser::ParseInt(p + 1, lineEnd, vn);
+				}
+
+				ObjCorner corner;
+				corner.Position = ResolveIndex(v, chunk.Positions.size());
+				corner.UV = ResolveIndex(vt, chunk.UVs.size());
+				corner.Normal = ResolveIndex(vn, chunk.Normals.size());
+				face.push_back(corner);
+				faceRelative.push_back(v < 0);
+				faceRelative.push_back(vt < 0);
+				faceRelative.push_back(vn < 0);
+
+				p = SkipSpaces(SkipToken(p, lineEnd), lineEnd);
+			}
+
+			// Fan triangulate, flipping the winding order as we go
+			// (the original loader's quad handling is the 4-corner case of this)
+			for (size_t i = 2; i < face.size(); i++)
+			{
+				size_t tri[3] = { 0, i, i - 1 };
+				for (size_t c : tri)
+				{
+					if (faceRelative[c * 3] || faceRelative[c * 3 + 1] || faceRelative[c * 3 + 2])
+					{
+						ObjChunk::Fixup fix;
+						fix.Corner = chunk.Corners.size();
+						fix.Position = faceRelative[c * 3];
+						fix.UV = faceRelative[c * 3 + 1];
+						fix.Normal = faceRelative[c * 3 + 2];
+						chunk.Fixups.push_back(fix);
+					}
+					chunk.Corners.push_back(face[c]);
+				}
+			}
+		}
+	}
+}
+
+
+bool ObjParser::ParseFile(const char* objFile, ObjMeshData& output, bool multithreaded, bool weldVertices)
+{
+	// Map the whole file - no reads, no copies
+	MappedFile file(objFile);
+	if (!file.IsOpen())
+		return false;
+
+	return ParseMemory(file.GetData(), file.GetSize(), output, multithreaded, weldVertices);
+}
+
+bool ObjParser::ParseMemory(const char* data, size_t size, ObjMeshData& output, bool multithreaded, bool weldVertices)
+{
+	JobSystem& jobs = JobSystem::GetInstance();
+
+	// Decide on a chunk count - a few per thread helps balance the
+	// load, since some chunks might be all faces and others all positions
+	size_t chunkCount = 1;
+	if (multithreaded)
+	{
+		chunkCount = (std::min)((size_t)jobs.GetThreadCount() * 4, size / MinChunkBytes);
+		chunkCount = (std::max)(chunkCount, (size_t)1);
+	}
+
+	// Split the file into chunks, moving each split point forward
+	// to just past the next newline so no line is cut in half
+	std::vector<const char*> bounds;
+	const char* end = data + size;
+	bounds.push_back(data);
+	for (size_t i = 1; i < chunkCount; i++)
+	{
+		const char* split = (std::max)(data + size * i / chunkCount, bounds.back());
+		split = FindLineEnd(split, end);
+		bounds.push_back(split < end ? split + 1 : end);
+	}
+	bounds.push_back(end);
+
+	// Parse each chunk independently
+	std::vector<ObjChunk> chunks(chunkCount);
+	jobs.ParallelFor((unsigned int)chunkCount, [&](unsigned int i)
+	{
+		ParseChunk(bounds[i], bounds[i + 1], chunks[i]);
+	});
+
+	// Work out where each chunk's data lands in the final arrays
+	std::vector<size_t> positionStart(chunkCount + 1, 0);
+	std::vector<size_t> uvStart(chunkCount + 1, 0);
+	std::vector<size_t> normalStart(chunkCount + 1, 0);
+	std::vector<size_t> cornerStart(chunkCount + 1, 0);
+	for (size_t i = 0; i < chunkCount; i++)
+	{
+		positionStart[i + 1] = positionStart[i] + chunks[i].Positions.size();
+		uvStart[i + 1] = uvStart[i] + chunks[i].UVs.size();
+		normalStart[i + 1] = normalStart[i] + chunks[i].Normals.size();
+		cornerStart[i + 1] = cornerStart[i] + chunks[i].Corners.size();
+	}
+
+	// Anything to actually make a mesh from?
+	if (cornerStart[chunkCount] == 0)
+		return false;
+
+	// Stitch the chunks together, fixing up any relative face
+	// references now that we know how much came before each chunk
+	std::vector<XMFLOAT3> positions(positionStart[chunkCount]);
+	std::vector<XMFLOAT2> uvs(uvStart[chunkCount]);
+	std::vector<XMFLOAT3> normals(normalStart[chunkCount]);
+	std::vector<ObjCorner> corners(cornerStart[chunkCount]);
+	jobs.ParallelFor((unsigned int)chunkCount, [&](unsigned int i)
+	{
+		ObjChunk& chunk = chunks[i];
+		std::copy(chunk.Positions.begin(), chunk.Positions.end(), positions.begin() + positionStart[i]);
+		std::copy(chunk.UVs.begin(), chunk.UVs.end(), uvs.begin() + uvStart[i]);
+		std::copy(chunk.Normals.begin(), chunk.Normals.end(), normals.begin() + normalStart[i]);
+
+		for (auto& fix : chunk.Fixups)
+		{
+			ObjCorner& c = chunk.Corners[fix.Corner];
+			if (fix.Position) c.Position += (unsigned int)positionStart[i];
+			if (fix.UV) c.UV += (unsigned int)uvStart[i];
+			if (fix.Normal) c.Normal += (unsigned int)normalStart[i];
+		}
+		std::copy(chunk.Corners.begin(), chunk.Corners.end(), corners.begin() + cornerStart[i]);
+
+		// Free this chunk's memory as early as possible
+		chunk = ObjChunk();
+	});
+
+	// Either share vertices between corners that reference the same
+	// data, or give every corner its own vertex (indices 0 to N-1)
+	if (weldVertices)
+	{
+		std::vector<ObjCorner> uniqueCorners;
+		WeldCorners(corners, uniqueCorners, output.Indices);
+		corners.swap(uniqueCorners);
+	}
+	else
+	{
+		output.Indices.resize(corners.size());
+		for (size_t i = 0; i < corners.size(); i++)
+			output.Indices[i] = (unsigned int)i;
+	}
+
+	// Build the final vertices, in parallel ranges of corners
+	const size_t cornersPerJob = 64 * 1024;
+	size_t jobCount = multithreaded ? (corners.size() + cornersPerJob - 1) / cornersPerJob : 1;
+	output.Vertices.resize(corners.size());
+	jobs.ParallelFor((unsigned int)jobCount, [&](unsigned int i)
+	{
+		size_t first = i * cornersPerJob;
+		size_t count = multithreaded ? (std::min)(cornersPerJob, corners.size() - first) : corners.size();
+		AssembleVertices(positions, uvs, normals, corners, first, count, output.Vertices);
+	});
+
+	return true;
+}
+
+
+// --------------------------------------------------------
+// Finds the unique (position, uv, normal) index triples in
+// the corner list, in order of first use, and builds an
+// index buffer referencing them.
+//
+// Uses an open addressing hash table of vertex indices that
+// is kept at most half full, so probe sequences stay short.
+// --------------------------------------------------------
+void ObjParser::WeldCorners(
+	const std::vector<ObjCorner>& corners,
+	std::vector<ObjCorner>& uniqueCorners,
+	std::vector<unsigned int>& indices)
+{
+	const unsigned int EmptySlot = 0xFFFFFFFF;
+
+	// Table size: next power of two at least twice the corner count
+	size_t tableSize = 1;
+	while (tableSize < corners.size() * 2)
+		tableSize <<= 1;
+	std::vector<unsigned int> table(tableSize, EmptySlot);
+	size_t mask = tableSize - 1;
+
+	uniqueCorners.clear();
+	uniqueCorners.reserve(corners.size() / 3);
+	indices.resize(corners.size());
+
+	for (size_t i = 0; i < corners.size(); i++)
+	{
+		const ObjCorner& c = corners[i];
+
+		// Hash the three indices together
+		unsigned int h = c.Position * 0x8DA6B343u;
+		h = (h ^ (h >> 15)) + c.UV * 0xD8163841u;
+		h = (h ^ (h >> 15)) + c.Normal * 0xCB1AB31Fu;
+		h ^= h >> 16;
+
+		// Probe until we find this triple or an empty slot
+		size_t slot = h & mask;
+		while (true)
+		{
+			unsigned int vertIndex = table[slot];
+			if (vertIndex == EmptySlot)
+			{
+				// First time we've seen it - make a new vertex
+				vertIndex = (unsigned int)uniqueCorners.size();
+				table[slot] = vertIndex;
+				uniqueCorners.push_back(c);
+				indices[i] = vertIndex;
+				break;
+			}
+
+			const ObjCorner& existing = uniqueCorners[vertIndex];
+			if (existing.Position == c.Position && existing.UV == c.UV && existing.Normal == c.Normal)
+			{
+				indices[i] = vertIndex;
+				break;
+			}
+
+			slot = (slot + 1) & mask;
+		}
+	}
+}
+
+
+// --------------------------------------------------------
+// Turns a range of the corner list into final vertices
+// (the output array must already be sized)
+//
+// The model is most likely in a right-handed space, especially
+// if it came from Maya.  We want a left-handed space for DirectX,
+// so we invert the Z position and normal Z (the winding order was
+// already flipped during triangulation).  We also flip the V
+// coordinate since DirectX defines (0,0) as the top left of the
+// texture, and many 3D modeling packages use the bottom left.
+// --------------------------------------------------------
+void ObjParser::AssembleVertices(
+	const std::vector<XMFLOAT3>& positions,
+	const std::vector<XMFLOAT2>& uvs,
+	const std::vector<XMFLOAT3>& normals,
+	const std::vector<ObjCorner>& corners,
+	size_t first,
+	size_t count,
+	std::vector<Vertex>& vertices)
+{
+	for (size_t i = first; i < first + count; i++)
+	{
+		const ObjCorner& c = corners[i];
+
+		// Out of range (or missing) references just become zeros
+		Vertex v = {};
+		if (c.Position - 1 < positions.size()) v.Position = positions[c.Position - 1];
+		if (c.UV - 1 < uvs.size()) v.UV = uvs[c.UV - 1];
+		if (c.Normal - 1 < normals.size()) v.Normal = normals[c.Normal - 1];
+
+		v.UV.y = 1.0f - v.UV.y;
+		v.Position.z *= -1.0f;
+		v.Normal.z *= -1.0f;
+
+		vertices[i] = v;
+	}
+}
+
+
+// --------------------------------------------------------
+// Parses a decimal float, with optional sign, fraction and
+// exponent.  Up to 19 significant digits are accumulated
+// as an integer and scaled once by an exact power of ten,
+// which gives correctly rounded results for the kinds of
+// numbers found in real OBJ files.
+// --------------------------------------------------------
+const char* ObjParser::ParseFloat(const char* p, const char* end, float& value)
+{
+	const char* start = p;
+
+	// Sign
+	bool negative = false;
+	if (p < end && (*p == '-' || *p == '+'))
+	{
+		negative = (*p == '-');
+		p++;
+	}
+
+	unsigned long long mantissa = 0;
+	int exponent = 0;
+	int significantDigits = 0;
+	bool anyDigits = false;
+
+	// Integer part
+	for (; p < end && IsDigit(*p); p++)
+	{
+		anyDigits = true;
+		if (significantDigits < 19)
+		{
+			mantissa = mantissa * 10 + (*p - '0');
+			if (mantissa != 0) significantDigits++;
+		}
+		else if (exponent < MaxExponent)
+		{
+			exponent++; // Too many digits, just track the magnitude
+		}
+	}
+
+	// Fractional part
+	if (p < end && *p == '.')
+	{
+		for (p++; p < end && IsDigit(*p); p++)
+		{
+			anyDigits = true;
+			if (significantDigits < 19)
+			{
+				mantissa = mantissa * 10 + (*p - '0');
+				if (mantissa != 0) significantDigits++;
+				exponent--;
+			}
+		}
+	}
+
+	if (!anyDigits)
+		return start;
+
+	// Exponent, saturating rather than overflowing
+	if (p < end && (*p == 'e' || *p == 'E'))
+	{
+		const char* q = p + 1;
+		bool expNegative = false;
+		if (q < end && (*q == '-' || *q == '+'))
+		{
+			expNegative = (*q == '-');
+			q++;
+		}
+
+		if (q < end && IsDigit(*q))
+		{
+			int exp = 0;
+			for (; q < end && IsDigit(*q); q++)
+				exp = (std::min)(exp * 10 + (*q - '0'), MaxExponent);
+			exponent += expNegative ? -exp : exp;
+			p = q;
+		}
+	}
+	exponent = (std::max)(-MaxExponent, (std::min)(exponent, MaxExponent));
+
+	// Scale by the power of ten, in as few (exact) steps as possible
+	double result = (double)mantissa;
+	while (exponent > 22) { result *= 1e22; exponent -= 22; }
+	while (exponent < -22) { result /= 1e22; exponent += 22; }
+	if (exponent >= 0)
+		result *= ExactPowersOfTen[exponent];
+	else
+		result /= ExactPowersOfTen[-exponent];
+
+	value = (float)(negative ? -result : result);
+	return p;
+}
+
+const char* ObjParser::ParseInt(const char* p, const char* end, int& value)
+{
+	const char* start = p;
+
+	bool negative = false;
+	if (p < end && (*p == '-' || *p == '+'))
+	{
+		negative = (*p == '-');
+		p++;
+	}
+
+	if (p >= end || !IsDigit(*p))
+		return start;
+
+	int result = 0;
+	for (; p < end && IsDigit(*p); p++)
+	{
+		// Anything past INT_MAX can't be a valid index either
+		int digit = *p - '0';
+		if (result > (INT_MAX - digit) / 10)
+			return start;
+		result = result * 10 + digit;
+	}
+
+	value = negative ? -result : result;
+	return p;
+}
+
+
+// --------------------------------------------------------
+// Finds the end of the current line by comparing 16 bytes
+// at a time against '\n' and using the resulting bit mask
+// to locate the first match
+// --------------------------------------------------------
+const char* ObjParser::FindLineEnd(const char* p, const char* end)
+{
+	const __m128i newline = _mm_set1_epi8('\n');
+	while (end - p >= 16)
+	{
+		__m128i chunk = _mm_loadu_si128((const __m128i*)p);
+		unsigned long mask = (unsigned long)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, newline));
+		if (mask)
+		{
+			unsigned long firstBit;
+			_BitScanForward(&firstBit, mask);
+			return p + firstBit;
+		}
+		p += 16;
+	}
+
+	// Finish up the last few bytes
+	while (p < end && *p != '\n') p++;
+	return p;
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <vector>
+
+#include "Vertex.h"
+
+// --------------------------------------------------------
+// The result of parsing an OBJ file: a triangle list that
+// can be handed straight to Mesh::CreateBuffers()
+// --------------------------------------------------------
+struct ObjMeshData
+{
+	std::vector<Vertex> Vertices;
+	std::vector<unsigned int> Indices;
+};
+
+// --------------------------------------------------------
+// One corner of a face, as 1-based indices into the
+// position, uv and normal lists.  Zero means "not present".
+// --------------------------------------------------------
+struct ObjCorner
+{
+	unsigned int Position;
+	unsigned int UV;
+	unsigned int Normal;
+};
+
+// --------------------------------------------------------
+// Fast OBJ parser
+//
+// - The file is memory mapped rather than streamed
+// - Line ends are found 16 bytes at a time with SSE2
+// - Numbers are parsed by hand, so there's no locale
+//   lookup or format string interpretation per value
+// - Lines can be any length and faces can have any number
+//   of corners (they're fan triangulated)
+// - Large files are split into newline-aligned chunks that
+//   are parsed in parallel, then stitched back together.
+//   Relative (negative) face indices are resolved against
+//   each chunk and fixed up once every chunk's counts are
+//   known, so the output is identical to a serial parse.
+// - Corners that share the same position/uv/normal indices
+//   are welded into a single vertex, giving a properly
+//   indexed mesh rather than one vertex per corner
+//
+// Vertices are converted to a left-handed space with flipped
+// V coordinates and winding order, just like the original
+// getline/sscanf_s loader.  Without welding, the output is
+// the same as that loader's: one vertex per face corner.
+// --------------------------------------------------------
+class ObjParser
+{
+public:
+	static bool ParseFile(const char* objFile, ObjMeshData& output, bool multithreaded = true, bool weldVertices = true);
+	static bool ParseMemory(const char* data, size_t size, ObjMeshData& output, bool multithreaded = true, bool weldVertices = true);
+
+	// Locale-free number parsing helpers.  Each returns a pointer
+	// just past the number, or the original pointer on failure
+	// (including integers too big for an int).  Float exponents
+	// out of range saturate to infinity or zero.
+	static const char* ParseFloat(const char* p, const char* end, float& value);
+	static const char* ParseInt(const char* p, const char* end, int& value);
+
+	// Finds the next '\n' at or after p (or end if there is none)
+	static const char* FindLineEnd(const char* p, const char* end);
+
+private:
+	// Smallest amount of text worth handing to its own thread
+	static const size_t MinChunkBytes = 1024 * 1024;
+
+	static void AssembleVertices(
+		const std::vector<DirectX::XMFLOAT3>& positions,
+		const std::vector<DirectX::XMFLOAT2>& uvs,
+		const std::vector<DirectX::XMFLOAT3>& normals,
+		const std::vector<ObjCorner>& corners,
+		size_t first,
+		size_t count,
+		std::vector<Vertex>& vertices);
+
+	static void WeldCorners(
+		const std::vector<ObjCorner>& corners,
+		std::vector<ObjCorner>& uniqueCorners,
+		std::vector<unsigned int>& indices);
+};
+
@@ -4,7 +4,8 @@
 // How many lights could we handle?
 #define MAX_LIGHTS 128
 
-// Data that can change per material
+// Data that can change per material (must match
+// MaterialConstants in Material.h)
 cbuffer perMaterial : register(b0)
 {
 	// Surface color
@@ -6,6 +6,7 @@
 #include "Imgui/imgui_impl_win32.h"
 
 #include <DirectXMath.h>
+#include <algorithm>
 
 using namespace DirectX;
 
@@ -28,7 +29,8 @@ Renderer::Renderer(Microsoft::WRL::ComPtr<ID3D11Device> _device, Microsoft::WRL:
 	std::shared_ptr<SimplePixelShader> _ssaoCombinePS,
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> _randomSRV,
 	Microsoft::WRL::ComPtr<ID3D11SamplerState> _basicSamplerOptions,
-	Microsoft::WRL::ComPtr<ID3D11SamplerState> _clampSamplerOptions)
+	Microsoft::WRL::ComPtr<ID3D11SamplerState> _clampSamplerOptions,
+	std::shared_ptr<SimpleVertexShader> _depthVS)
 	:
 	device(_device),
 	context(_context),
@@ -47,13 +49,17 @@ Renderer::Renderer(Microsoft::WRL::ComPtr<ID3D11Device> _device, Microsoft::WRL:
 	arial(_arial),
 	spriteBatch(_spriteBatch),
 	drawDebugPointLights(false),
+	selectedEntity(-1),
 	fullscreenVS(_fullscreenVS),
 	ssaoPS(_ssaoPS),
 	ssaoBlurPS(_ssaoBlurPS),
 	ssaoCombinePS(_ssaoCombinePS),
 	randomSRV(_randomSRV),
 	basicSamplerOptions(_basicSamplerOptions),
-	clampSamplerOptions(_clampSamplerOptions)
+	clampSamplerOptions(_clampSamplerOptions),
+	depthVS(_depthVS),
+	depthPrePassEnabled(true),
+	constantUploadBytes(0)
 {
 	// Validate active light count
 	activeLightCount = min(activeLightCount, MAX_LIGHTS);
@@ -84,6 +90,24 @@ Renderer::Renderer(Microsoft::WRL::ComPtr<ID3D11Device> _device, Microsoft::WRL:
 	ssaoRadius = 1.0f;
 	ssaoSamples = 64;
 	ssaoOutputOnly = 0;
+
+	// The depth pre-pass is pushed back slightly, since its vertex
+	// shader isn't guaranteed to give bit-identical depths (packed
+	// meshes are even decoded differently), so the main pass's
+	// surfaces still pass a less-or-equal test against it
+	D3D11_RASTERIZER_DESC rastDesc = {};
+	rastDesc.CullMode = D3D11_CULL_BACK;
+	rastDesc.FillMode = D3D11_FILL_SOLID;
+	rastDesc.DepthClipEnable = true;
+	rastDesc.DepthBias = 16;
+	rastDesc.SlopeScaledDepthBias = 1.0f;
+	device->CreateRasterizerState(&rastDesc, depthPrePassRasterState.GetAddressOf());
+
+	D3D11_DEPTH_STENCIL_DESC depthDesc = {};
+	depthDesc.DepthEnable = true;
+	depthDesc.DepthFunc = D3D11_COMPARISON_LESS_EQUAL;
+	depthDesc.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ALL;
+	device->CreateDepthStencilState(&depthDesc, lessEqualDepthState.GetAddressOf());
 }
 
 void Renderer::PreResize()
@@ -120,6 +144,7 @@ void Renderer::Render(std::shared_ptr<Camera> camera)
 {
 	// update what's stored in the Renderer
 	this->camera = camera;
+	ConstantBufferSlot::ResetUploadedBytes();
 
 	// Background color for clearing
 	const float color[4] = { 0, 0, 0, 1 };
@@ -140,6 +165,23 @@ void Renderer::Render(std::shared_ptr<Camera> camera)
 	const float depth[4] = { 1,0,0,0 };
 	context->ClearRenderTargetView(renderTargetRTVs[SCENE_DEPTHS].Get(), depth);
 
+	// Frustum for culling anything already in world space
+	XMFLOAT4X4 identity;
+	XMStoreFloat4x4(&identity, XMMatrixIdentity());
+	MeshletCullInfo cull = Meshlets::MakeCullInfo(
+		identity,
+		camera->GetView(),
+		camera->GetProjection(),
+		camera->GetTransform()->GetPosition());
+
+	// Lay down depth first, using just positions, so the main pass
+	// only shades the closest surface at each pixel
+	if (depthPrePassEnabled)
+	{
+		DrawDepthPrePass(cull);
+		context->OMSetDepthStencilState(lessEqualDepthState.Get(), 0);
+	}
+
 	const int numTargets = 4;
 	ID3D11RenderTargetView* targets[numTargets] = {};
 	targets[0] = renderTargetRTVs[RenderTargetType::SCENE_COLORS_NO_AMBIENT].Get();
@@ -148,25 +190,54 @@ void Renderer::Render(std::shared_ptr<Camera> camera)
 	targets[3] = renderTargetRTVs[RenderTargetType::SCENE_DEPTHS].Get();
 	context->OMSetRenderTargets(numTargets, targets, depthBufferDSV.Get());
 
-	// Draw all of the entities
+	// Set the "per frame" data, once for each shader used this frame.
+	// Per object and per material data lives in their own buffers.
+	std::vector<ISimpleShader*> preparedShaders;
+	auto setPerFrameData = [&](std::shared_ptr<Material> material)
+	{
+		std::shared_ptr<SimplePixelShader> ps = material->GetPixelShader();
+		if (std::find(preparedShaders.begin(), preparedShaders.end(), ps.get()) == preparedShaders.end())
+		{
+			ps->SetData("lights", (void*)(&lights[0]), sizeof(Light) * activeLightCount);
+			ps->SetInt("lightCount", activeLightCount);
+			ps->SetFloat3("cameraPosition", camera->GetTransform()->GetPosition());
+			ps->SetInt("SpecIBLTotalMipLevels", sky->GetNumIBLMipLevels());
+			ps->CopyBufferData("perFrame");
+			preparedShaders.push_back(ps.get());
+		}
+
+		for (std::shared_ptr<SimpleVertexShader> vs : { material->GetVertexShader(), material->GetPackedVertexShader() })
+		{
+			if (!vs || std::find(preparedShaders.begin(), preparedShaders.end(), vs.get()) != preparedShaders.end())
+				continue;
+
+			vs->SetMatrix4x4("view", camera->GetView());
+			vs->SetMatrix4x4("projection", camera->GetProjection());
+			vs->CopyBufferData("perFrame");
+			preparedShaders.push_back(vs.get());
+		}
+	};
+
+	// Draw all of the entities (static ones are part of a batch)
 	for (auto& e : entities)
 	{
-		// Set the "per frame" data
-		// Note that this should literally be set once PER FRAME, before
-		// the draw loop, but we're currently setting it per entity since 
-		// we are just using whichever shader the current entity has.  
-		// Inefficient!!!
-		std::shared_ptr<SimplePixelShader> ps = e->GetMaterial()->GetPixelShader();
-		ps->SetData("lights", (void*)(&lights[0]), sizeof(Light) * activeLightCount);
-		ps->SetInt("lightCount", activeLightCount);
-		ps->SetFloat3("cameraPosition", camera->GetTransform()->GetPosition());
-		ps->SetInt("SpecIBLTotalMipLevels", sky->GetNumIBLMipLevels());
-
-		ps->CopyBufferData("perFrame");
-
-		// Draw the entity
-		e->Draw(context, camera);
+		if (e->IsStatic())
+			continue;
+
+		setPerFrameData(e->GetMaterial());
+		e->Draw(context, camera, (float)windowHeight);
+	}
+
+	// Draw the batches of static entities that are in view
+	for (auto& b : staticBatches)
+	{
+		if (!Bounds::InFrustum(b->GetBounds(), cull.FrustumPlanes))
+			continue;
+
+		setPerFrameData(b->GetMaterial());
+		b->Draw(context, camera, cull);
 	}
+	context->OMSetDepthStencilState(0, 0);
 
 	// Draw the light sources
 	DrawPointLights();
@@ -249,6 +320,9 @@ void Renderer::Render(std::shared_ptr<Camera> camera)
 		context->Draw(3, 0);
 	}
 
+	// Only what changed since last frame should have been uploaded
+	constantUploadBytes = ConstantBufferSlot::GetUploadedBytes();
+
 	// Draw some UI
 	DrawUI();
 
@@ -271,6 +345,13 @@ void Renderer::Render(std::shared_ptr<Camera> camera)
 
 unsigned int Renderer::GetActiveLightCount() { return activeLightCount; }
 void Renderer::SetActiveLightCount(unsigned int count) { activeLightCount = min(count, MAX_LIGHTS); }
+int Renderer::GetSelectedEntity() { return selectedEntity; }
+void Renderer::SetSelectedEntity(int index) { selectedEntity = index; }
+bool Renderer::GetDepthPrePassEnabled() { return depthPrePassEnabled; }
+void Renderer::SetDepthPrePassEnabled(bool enabled) { depthPrePassEnabled = enabled; }
+void Renderer::SetStaticBatches(const std::vector<std::shared_ptr<StaticBatch>>& batches) { staticBatches = batches; }
+void Renderer::SetMeshStreamer(std::shared_ptr<MeshStreamer> streamer) { meshStreamer = streamer; }
+void Renderer::SetTransformUpdateStats(std::shared_ptr<TransformUpdateStats> stats) { transformStats = stats; }
 
 
 void Renderer::CreateRenderTarget(
@@ -309,6 +390,37 @@ void Renderer::CreateRenderTarget(
 }
 
 
+// --------------------------------------------------------
+// Draws the depth of every entity (and static batch) with a
+// position stream into the depth buffer, with no render
+// targets or pixel shader
+// --------------------------------------------------------
+void Renderer::DrawDepthPrePass(const MeshletCullInfo& cull)
+{
+	context->OMSetRenderTargets(0, 0, depthBufferDSV.Get());
+	context->RSSetState(depthPrePassRasterState.Get());
+	context->PSSetShader(0, 0, 0);
+
+	depthVS->SetShader();
+	depthVS->SetMatrix4x4("view", camera->GetView());
+	depthVS->SetMatrix4x4("projection", camera->GetProjection());
+	depthVS->CopyBufferData("perFrame");
+
+	for (auto& e : entities)
+	{
+		if (!e->IsStatic())
+			e->DrawDepth(context, camera, depthVS, (float)windowHeight);
+	}
+
+	for (auto& b : staticBatches)
+	{
+		if (Bounds::InFrustum(b->GetBounds(), cull.FrustumPlanes))
+			b->DrawDepth(context, depthVS, cull);
+	}
+
+	context->RSSetState(0);
+}
+
 void Renderer::DrawPointLights()
 {
 	// Turn on these shaders
@@ -318,6 +430,12 @@ void Renderer::DrawPointLights()
 	// Set up vertex shader
 	lightVS->SetMatrix4x4("view", camera->GetView());
 	lightVS->SetMatrix4x4("projection", camera->GetProjection());
+	if (lightMesh->HasPackedVertices())
+	{
+		lightVS->SetFloat3("positionScale", lightMesh->GetPositionScale());
+		lightVS->SetFloat3("positionOffset", lightMesh->GetPositionOffset());
+	}
+	lightVS->CopyBufferData("perFrame");
 
 	for (int i = 0; i < activeLightCount; i++)
 	{
@@ -346,7 +464,7 @@ void Renderer::DrawPointLights()
 		lightVS->SetMatrix4x4("worldInverseTranspose", worldInvTrans);
 
 		// Copy data
-		lightVS->CopyAllBufferData();
+		lightVS->CopyBufferData("perObject");
 
 		if (drawDebugPointLights)
 		{
@@ -376,9 +494,10 @@ void Renderer::DrawUI()
 	arial->DrawString(spriteBatch.get(), L" (Left Shift) Hold to speed up camera", XMVectorSet(10, h + 60, 0, 0));
 	arial->DrawString(spriteBatch.get(), L" (Left Ctrl) Hold to slow down camera", XMVectorSet(10, h + 80, 0, 0));
 	arial->DrawString(spriteBatch.get(), L" (TAB) Randomize lights", XMVectorSet(10, h + 100, 0, 0));
+	arial->DrawString(spriteBatch.get(), L" (B) Run asset benchmarks (console)", XMVectorSet(10, h + 120, 0, 0));
 
 	// Current "scene" info
-	h = 150;
+	h = 170;
 	arial->DrawString(spriteBatch.get(), L"Scene Details:", XMVectorSet(10, h, 0, 0));
 	arial->DrawString(spriteBatch.get(), L" Top: PBR materials", XMVectorSet(10, h + 20, 0, 0));
 	arial->DrawString(spriteBatch.get(), L" Bottom: Non-PBR materials", XMVectorSet(10, h + 40, 0, 0));
@@ -440,6 +559,14 @@ void Renderer::CreateGui()
 	{
 		UICamera();
 	}
+	if (meshStreamer && ImGui::CollapsingHeader("Mesh Streaming"))
+	{
+		UIMeshStreaming();
+	}
+	if (transformStats && ImGui::CollapsingHeader("Transform Updates"))
+	{
+		UITransformUpdates();
+	}
 	if (ImGui::CollapsingHeader("Lights"))
 	{
 		ImGui::Checkbox("Draw Point Lights", &drawDebugPointLights);
@@ -459,9 +586,19 @@ void Renderer::CreateGui()
 	}
 	if (ImGui::CollapsingHeader("Entities"))
 	{
+		// Picked with a right click in the scene
+		if (selectedEntity >= 0)
+			ImGui::Text("Selected: %d (right click to pick)", selectedEntity);
+		else
+			ImGui::Text("Selected: none (right click to pick)");
+
 		for (int i = 0; i < entities.size(); i++)
 		{
+			if (i == selectedEntity)
+				ImGui::PushStyleColor(ImGuiCol_Text, ImVec4(1.0f, 0.8f, 0.2f, 1.0f));
 			UIEntity(*entities[i], i);
+			if (i == selectedEntity)
+				ImGui::PopStyleColor();
 		}
 	}
 	if (ImGui::CollapsingHeader("BRDF Look-Up Texture"))
@@ -548,6 +685,43 @@ void Renderer::UIProgram()
 {
 	ImGuiIO& io = ImGui::GetIO();
 	ImGui::Text("FPS: %.2f \nWidth: %d | Height: %d", io.Framerate, windowWidth, windowHeight);
+	ImGui::Text("Constant Uploads: %llu bytes", constantUploadBytes);
+	ImGui::Checkbox("Depth Pre-pass", &depthPrePassEnabled);
+}
+
+void Renderer::UIMeshStreaming()
+{
+	MeshStreamingStats stats = meshStreamer->GetStats();
+	ImGui::Text("Resident: %.2f / %.2f MB (%d meshes, %d loading)",
+		stats.ResidentBytes / (1024.0f * 1024.0f),
+		stats.BudgetBytes / (1024.0f * 1024.0f),
+		stats.ResidentMeshes,
+		stats.LoadingMeshes);
+	ImGui::Text("Hit Rate: %.1f%% of %llu requests",
+		stats.Requests > 0 ? 100.0 * stats.Hits / stats.Requests : 0.0,
+		stats.Requests);
+	ImGui::Text("Loads: %llu | Evictions: %llu", stats.Loads, stats.Evictions);
+	ImGui::Text("Load Latency: %.2f ms average, %.2f ms max", stats.AverageLoadMs, stats.MaxLoadMs);
+
+	float budgetMB = stats.BudgetBytes / (1024.0f * 1024.0f);
+	if (ImGui::SliderFloat("Budget (MB)", &budgetMB, 0.0f, 256.0f))
+		meshStreamer->SetBudget((size_t)(budgetMB * 1024 * 1024));
+}
+
+void Renderer::UITransformUpdates()
+{
+	TransformUpdateStats& stats = *transformStats;
+	ImGui::Text("Total: %.3f ms", stats.TotalMs);
+	ImGui::Text("Matrices: %d dirty in %d chunks", stats.DirtyTransforms, stats.MatrixChunks);
+	ImGui::Text("Bounds: %d entities in %d chunks", stats.Entities, stats.BoundsChunks);
+
+	for (unsigned int i = 0; i < stats.Threads.size(); i++)
+	{
+		if (i == 0)
+			ImGui::Text("Main thread: %.3f ms, %d chunks", stats.Threads[i].Milliseconds, stats.Threads[i].Chunks);
+		else
+			ImGui::Text("Worker %d: %.3f ms, %d chunks", i, stats.Threads[i].Milliseconds, stats.Threads[i].Chunks);
+	}
 }
 
 void Renderer::UICamera()
@@ -637,12 +811,12 @@ void Renderer::UITransform(Transform& transform, int parentIndex)
 	XMFLOAT3 tRot = transform.GetPitchYawRoll();
 	if (ImGui::InputFloat3(transformRotID.c_str(), &tRot.x))
 	{
-		transform.SetPosition(tRot.x, tRot.y, tRot.z);
+		transform.SetRotation(tRot.x, tRot.y, tRot.z);
 	}
 	XMFLOAT3 tScale = transform.GetScale();
 	if (ImGui::InputFloat3(transformScaleID.c_str(), &tScale.x))
 	{
-		transform.SetPosition(tScale.x, tScale.y, tScale.z);
+		transform.SetScale(tScale.x, tScale.y, tScale.z);
 	}
 }
 
@@ -7,6 +7,8 @@
 
 #include "Sky.h"
 #include "GameEntity.h"
+#include "StaticBatch.h"
+#include "MeshStreamer.h"
 #include "Lights.h"
 #include "SimpleShader.h"
 #include "Imgui/imgui.h"
@@ -37,6 +39,9 @@ private:
 	std::shared_ptr<Sky> sky; // Pointer to the skybox object created in Game
 	std::vector <std::shared_ptr<GameEntity>>& entities; // Reference to the Entity list in Game
 	std::vector<Light>& lights; // Reference to the Light list in Game
+	std::vector<std::shared_ptr<StaticBatch>> staticBatches; // Drawn in place of the static entities
+	std::shared_ptr<MeshStreamer> meshStreamer; // Only for its stats, if set
+	std::shared_ptr<TransformUpdateStats> transformStats; // Filled in by Game each frame, if set
 
 	// Text & ui
 	std::shared_ptr<DirectX::SpriteFont> arial;
@@ -45,6 +50,7 @@ private:
 	// Camera used this frame
 	std::shared_ptr<Camera> camera;
 	bool drawDebugPointLights;
+	int selectedEntity; // Index of the picked entity, or -1
 
 	// These will be loaded along with other assets and
 	// saved to these variables for ease of access
@@ -71,6 +77,15 @@ private:
 	Microsoft::WRL::ComPtr<ID3D11SamplerState> basicSamplerOptions;
 	Microsoft::WRL::ComPtr<ID3D11SamplerState> clampSamplerOptions;
 
+	// Depth pre-pass, using meshes' position streams
+	std::shared_ptr<SimpleVertexShader> depthVS;
+	Microsoft::WRL::ComPtr<ID3D11RasterizerState> depthPrePassRasterState;
+	Microsoft::WRL::ComPtr<ID3D11DepthStencilState> lessEqualDepthState;
+	bool depthPrePassEnabled;
+
+	// Object and material constants sent to the GPU last frame
+	unsigned long long constantUploadBytes;
+
 	void SetSSAOEnabled(bool enabled);
 	bool GetSSAOEnabled();
 
@@ -106,7 +121,8 @@ public:
 			std::shared_ptr<SimplePixelShader> _ssaoCombinePS,
 			Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> _randomSRV,
 			Microsoft::WRL::ComPtr<ID3D11SamplerState> _basicSamplerOptions,
-			Microsoft::WRL::ComPtr<ID3D11SamplerState> _clampSamplerOptions
+			Microsoft::WRL::ComPtr<ID3D11SamplerState> _clampSamplerOptions,
+			std::shared_ptr<SimpleVertexShader> _depthVS
 			);
 
 
@@ -117,6 +133,13 @@ public:
 	void Render(std::shared_ptr<Camera> camera);
 	unsigned int GetActiveLightCount();
 	void SetActiveLightCount(unsigned int count);
+	int GetSelectedEntity();
+	void SetSelectedEntity(int index);
+	bool GetDepthPrePassEnabled();
+	void SetDepthPrePassEnabled(bool enabled);
+	void SetStaticBatches(const std::vector<std::shared_ptr<StaticBatch>>& batches);
+	void SetMeshStreamer(std::shared_ptr<MeshStreamer> streamer);
+	void SetTransformUpdateStats(std::shared_ptr<TransformUpdateStats> stats);
 
 	void CreateRenderTarget(
 		unsigned int width,
@@ -124,12 +147,15 @@ public:
 		Microsoft::WRL::ComPtr<ID3D11RenderTargetView>& rtv,
 		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>& srv,
 		DXGI_FORMAT colorFormat = DXGI_FORMAT_R8G8B8A8_UNORM);	void DrawPointLights();
+	void DrawDepthPrePass(const MeshletCullInfo& cull);
 	void DrawUI();
 	void UpdateImGui(float deltaTime);
 	void CreateGui();
 	void ImageWithHover(ImTextureID user_texture_id, const ImVec2& size);
 	void UIProgram();
 	void UICamera();
+	void UIMeshStreaming();
+	void UITransformUpdates();
 	void UILight(Light& light, int index);
 	void UIEntity(GameEntity& entity, int index);
 	void UITransform(Transform& transform, int parentIndex);
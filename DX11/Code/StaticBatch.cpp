@@ -0,0 +1,158 @@
+#include "StaticBatch.h"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <tuple>
+
+using namespace DirectX;
+
+void StaticBatch::Build(
+	const std::vector<std::shared_ptr<GameEntity>>& entities,
+	float cellSize,
+	Microsoft::WRL::ComPtr<ID3D11Device> device,
+	std::vector<std::shared_ptr<StaticBatch>>& batches,
+	unsigned int flags)
+{
+	batches.clear();
+
+	// Each material gets its own group
+	std::vector<std::shared_ptr<Material>> materials;
+	std::vector<StaticBatchSource> sources;
+	for (auto& e : entities)
+	{
+		if (!e->IsStatic())
+			continue;
+
+		std::shared_ptr<Mesh> mesh = e->GetMesh();
+		if (!mesh->HasCpuData())
+		{
+			e->SetStatic(false);
+			continue;
+		}
+
+		int group = (int)(std::find(materials.begin(), materials.end(), e->GetMaterial()) - materials.begin());
+		if (group == (int)materials.size())
+			materials.push_back(e->GetMaterial());
+
+		StaticBatchSource source;
+		source.Vertices = &mesh->GetCpuVertices()[0];
+		source.VertexCount = (int)mesh->GetCpuVertices().size();
+		source.Indices = &mesh->GetCpuIndices()[0];
+		source.IndexCount = (int)mesh->GetCpuIndices().size();
+		source.World = e->GetTransform()->GetWorldMatrix();
+		source.WorldBounds = e->GetWorldBounds();
+		source.Group = group;
+		sources.push_back(source);
+	}
+
+	std::vector<StaticBatchData> merged;
+	Merge(sources, cellSize, merged);
+
+	for (auto& m : merged)
+	{
+		std::shared_ptr<Mesh> mesh = std::make_shared<Mesh>(
+			&m.Vertices[0], (int)m.Vertices.size(),
+			&m.Indices[0], (int)m.Indices.size(),
+			device,
+			flags | MeshFlags_KeepTangents);
+		batches.push_back(std::make_shared<StaticBatch>(mesh, materials[m.Group], (int)m.Sources.size()));
+	}
+}
+
+
+void StaticBatch::Merge(const std::vector<StaticBatchSource>& sources, float cellSize, std::vector<StaticBatchData>& batches)
+{
+	batches.clear();
+
+	// Find each source's batch, keyed by its group and grid cell
+	std::map<std::tuple<int, int, int, int>, int> cells;
+	for (size_t i = 0; i < sources.size(); i++)
+	{
+		const StaticBatchSource& s = sources[i];
+		std::tuple<int, int, int, int> key(
+			s.Group,
+			(int)floorf(s.WorldBounds.Center.x / cellSize),
+			(int)floorf(s.WorldBounds.Center.y / cellSize),
+			(int)floorf(s.WorldBounds.Center.z / cellSize));
+
+		auto found = cells.find(key);
+		if (found == cells.end())
+		{
+			found = cells.insert(std::make_pair(key, (int)batches.size())).first;
+			batches.push_back(StaticBatchData());
+			batches.back().Group = s.Group;
+		}
+		batches[found->second].Sources.push_back((int)i);
+	}
+
+	// Size each batch up front, then fill it
+	for (auto& b : batches)
+	{
+		size_t vertexCount = 0;
+		size_t indexCount = 0;
+		for (int i : b.Sources)
+		{
+			vertexCount += sources[i].VertexCount;
+			indexCount += sources[i].IndexCount;
+		}
+
+		b.Vertices.reserve(vertexCount);
+		b.Indices.reserve(indexCount);
+		for (int i : b.Sources)
+			AppendTransformed(sources[i], b.Vertices, b.Indices);
+	}
+}
+
+
+void StaticBatch::AppendTransformed(const StaticBatchSource& source, std::vector<Vertex>& vertices, std::vector<unsigned int>& indices)
+{
+	// Same math as the vertex shader, except with a real inverse
+	// transpose for the normals (and an affine matrix, so positions
+	// don't need dividing by w)
+	XMMATRIX world = XMLoadFloat4x4(&source.World);
+	XMMATRIX invTranspose = XMMatrixTranspose(XMMatrixInverse(0, world));
+	bool mirrored = XMVectorGetX(XMMatrixDeterminant(world)) < 0.0f;
+
+	unsigned int first = (unsigned int)vertices.size();
+	for (int i = 0; i < source.VertexCount; i++)
+	{
+		Vertex v = source.Vertices[i];
+		XMStoreFloat3(&v.Position, XMVector3Transform(XMLoadFloat3(&v.Position), world));
+		XMStoreFloat3(&v.Normal, XMVector3Normalize(XMVector3TransformNormal(XMLoadFloat3(&v.Normal), invTranspose)));
+		XMStoreFloat3(&v.Tangent, XMVector3Normalize(XMVector3TransformNormal(XMLoadFloat3(&v.Tangent), world)));
+		vertices.push_back(v);
+	}
+
+	for (int i = 0; i < source.IndexCount; i += 3)
+	{
+		indices.push_back(first + source.Indices[i]);
+		indices.push_back(first + source.Indices[i + (mirrored ? 2 : 1)]);
+		indices.push_back(first + source.Indices[i + (mirrored ? 1 : 2)]);
+	}
+}
+
+
+StaticBatch::StaticBatch(std::shared_ptr<Mesh> mesh, std::shared_ptr<Material> material, int entityCount)
+{
+	this->mesh = mesh;
+	this->material = material;
+	this->entityCount = entityCount;
+}
+
+void StaticBatch::Draw(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, std::shared_ptr<Camera> camera, const MeshletCullInfo& cull)
+{
+	Material::UpdateObjectConstants(context, objectConstants, transform, mesh);
+	material->PrepareMaterial(context, objectConstants, mesh);
+	mesh->SetBuffersAndDrawVisible(context, cull);
+}
+
+void StaticBatch::DrawDepth(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, std::shared_ptr<SimpleVertexShader> depthVS, const MeshletCullInfo& cull)
+{
+	if (!mesh->HasPositionStream())
+		return;
+
+	Material::UpdateObjectConstants(context, objectConstants, transform, mesh);
+	context->VSSetConstantBuffers(1, 1, objectConstants.GetAddressOf());
+	mesh->SetPositionBuffersAndDrawVisible(context, cull);
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <d3d11.h>
+#include <wrl/client.h>
+#include <DirectXMath.h>
+#include <memory>
+#include <vector>
+
+#include "GameEntity.h"
+
+// --------------------------------------------------------
+// One object's geometry to be merged, and where it goes
+// --------------------------------------------------------
+struct StaticBatchSource
+{
+	const Vertex* Vertices;
+	int VertexCount;
+	const unsigned int* Indices;
+	int IndexCount;
+	DirectX::XMFLOAT4X4 World;
+	AxisAlignedBox WorldBounds;	// Picks the cell
+	int Group;					// Only sources in the same group are merged
+};
+
+// --------------------------------------------------------
+// World space geometry from all of the sources in one
+// group and cell
+// --------------------------------------------------------
+struct StaticBatchData
+{
+	int Group;
+	std::vector<int> Sources;	// Indices of the merged sources
+	std::vector<Vertex> Vertices;
+	std::vector<unsigned int> Indices;
+};
+
+// --------------------------------------------------------
+// Static entities that share a material, merged into one
+// mesh so they're drawn with a single draw call
+//
+// Each entity's vertices are transformed into world space
+// ahead of time, so the batch itself is drawn with an
+// identity transform.  Entities are only merged with others
+// in the same cell of a world space grid (by the center of
+// their bounds), which keeps each batch small enough to be
+// frustum culled as a whole, and its meshlets (if any) let
+// it skip the parts that face away.
+// --------------------------------------------------------
+class StaticBatch
+{
+public:
+	// Merges every entity marked static into batches.  Their meshes
+	// need MeshFlags_KeepCpuData - any without are set back to not
+	// static, so they're still drawn on their own.  Flags are for
+	// the merged meshes (tangents are always kept).
+	static void Build(
+		const std::vector<std::shared_ptr<GameEntity>>& entities,
+		float cellSize,
+		Microsoft::WRL::ComPtr<ID3D11Device> device,
+		std::vector<std::shared_ptr<StaticBatch>>& batches,
+		unsigned int flags = MeshFlags_BuildMeshlets | MeshFlags_BuildPositionStream);
+
+	// The CPU side of Build(): groups and transforms the sources
+	static void Merge(const std::vector<StaticBatchSource>& sources, float cellSize, std::vector<StaticBatchData>& batches);
+
+	// Appends a copy of a mesh in world space.  Normals go through the
+	// inverse transpose, and triangles are flipped for mirrored
+	// transforms so they still face the same way.
+	static void AppendTransformed(const StaticBatchSource& source, std::vector<Vertex>& vertices, std::vector<unsigned int>& indices);
+
+	StaticBatch(std::shared_ptr<Mesh> mesh, std::shared_ptr<Material> material, int entityCount);
+
+	std::shared_ptr<Mesh> GetMesh() { return mesh; }
+	std::shared_ptr<Material> GetMaterial() { return material; }
+	int GetEntityCount() { return entityCount; }
+
+	// Already in world space
+	const AxisAlignedBox& GetBounds() { return mesh->GetBoundingBox(); }
+
+	// The cull info must come from an identity world matrix, since the
+	// batch is in world space already
+	void Draw(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, std::shared_ptr<Camera> camera, const MeshletCullInfo& cull);
+
+	// Position stream only, with an already active depth only shader
+	void DrawDepth(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, std::shared_ptr<SimpleVertexShader> depthVS, const MeshletCullInfo& cull);
+
+private:
+	std::shared_ptr<Mesh> mesh;
+	std::shared_ptr<Material> material;
+	Transform transform;	// Always identity
+	int entityCount;
+
+	// Written once, since the transform never changes
+	ConstantBufferSlot objectConstants;
+};
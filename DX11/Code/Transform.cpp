@@ -1,122 +1,193 @@
+
 #include "Transform.h"
 
+#include <algorithm>
+#include <cmath>
+
 using namespace DirectX;
 
 
+// Pitch/yaw/roll (in the order XMQuaternionRotationRollPitchYaw
+// uses) that give the same rotation as the quaternion, though
+// not necessarily the angles it was made from
+static XMFLOAT3 QuaternionToEuler(XMFLOAT4 quaternion)
+{
+	XMFLOAT4X4 r;
+	XMStoreFloat4x4(&r, XMMatrixRotationQuaternion(XMLoadFloat4(&quaternion)));
+	float pitch = asinf((std::max)(-1.0f, (std::min)(1.0f, -r._32)));
+	float yaw = atan2f(r._31, r._33);
+	float roll = atan2f(r._12, r._22);
+	return XMFLOAT3(pitch, yaw, roll);
+}
+
 Transform::Transform()
 {
-	// Start with an identity matrix and basic transform data
-	XMStoreFloat4x4(&worldMatrix, XMMatrixIdentity());
-	XMStoreFloat4x4(&worldInverseTransposeMatrix, XMMatrixIdentity());
+	// Starts with identity data and matrices
+	slot = TransformStore::GetInstance().Allocate();
+}
+
+Transform::Transform(const Transform& other)
+{
+	slot = TransformStore::GetInstance().Allocate();
+	*this = other;
+}
 
-	position = XMFLOAT3(0, 0, 0);
-	pitchYawRoll = XMFLOAT3(0, 0, 0);
-	scale = XMFLOAT3(1, 1, 1);
+Transform& Transform::operator=(const Transform& other)
+{
+	TransformStore& store = TransformStore::GetInstance();
+	for (std::vector<float>* c : { &store.positionX, &store.positionY, &store.positionZ, &store.rotationX, &store.rotationY, &store.rotationZ, &store.rotationW, &store.pitch, &store.yaw, &store.roll, &store.scaleX, &store.scaleY, &store.scaleZ })
+		(*c)[slot] = (*c)[other.slot];
+	store.MarkDirty(slot);
+	return *this;
+}
 
-	// No need to recalc yet
-	matricesDirty = false;
+Transform::~Transform()
+{
+	TransformStore::GetInstance().Free(slot);
 }
 
 void Transform::MoveAbsolute(float x, float y, float z)
 {
-	position.x += x;
-	position.y += y;
-	position.z += z;
-	matricesDirty = true;
+	TransformStore& store = TransformStore::GetInstance();
+	store.positionX[slot] += x;
+	store.positionY[slot] += y;
+	store.positionZ[slot] += z;
+	store.MarkDirty(slot);
 }
 
 void Transform::MoveRelative(float x, float y, float z)
 {
 	// Create a direction vector from the params
-	// and a rotation quaternion
+	// and grab the rotation quaternion
 	XMVECTOR movement = XMVectorSet(x, y, z, 0);
-	XMVECTOR rotQuat = XMQuaternionRotationRollPitchYawFromVector(XMLoadFloat3(&pitchYawRoll));
+	XMFLOAT4 rotation = GetRotation();
+	XMVECTOR rotQuat = XMLoadFloat4(&rotation);
 
 	// Rotate the movement by the quaternion
-	XMVECTOR dir = XMVector3Rotate(movement, rotQuat);
+	XMFLOAT3 dir;
+	XMStoreFloat3(&dir, XMVector3Rotate(movement, rotQuat));
 
 	// Add and store, and invalidate the matrices
-	XMStoreFloat3(&position, XMLoadFloat3(&position) + dir);
-	matricesDirty = true;
+	MoveAbsolute(dir.x, dir.y, dir.z);
 }
 
 void Transform::Rotate(float p, float y, float r)
 {
-	pitchYawRoll.x += p;
-	pitchYawRoll.y += y;
-	pitchYawRoll.z += r;
-	matricesDirty = true;
+	TransformStore& store = TransformStore::GetInstance();
+	store.pitch[slot] += p;
+	store.yaw[slot] += y;
+	store.roll[slot] += r;
+	UpdateRotation();
 }
 
 void Transform::Scale(float x, float y, float z)
 {
-	scale.x *= x;
-	scale.y *= y;
-	scale.z *= z;
-	matricesDirty = true;
+	TransformStore& store = TransformStore::GetInstance();
+	store.scaleX[slot] *= x;
+	store.scaleY[slot] *= y;
+	store.scaleZ[slot] *= z;
+	store.MarkDirty(slot);
 }
 
 void Transform::SetPosition(float x, float y, float z)
 {
-	position.x = x;
-	position.y = y;
-	position.z = z;
-	matricesDirty = true;
+	TransformStore& store = TransformStore::GetInstance();
+	store.positionX[slot] = x;
+	store.positionY[slot] = y;
+	store.positionZ[slot] = z;
+	store.MarkDirty(slot);
 }
 
 void Transform::SetRotation(float p, float y, float r)
 {
-	pitchYawRoll.x = p;
-	pitchYawRoll.y = y;
-	pitchYawRoll.z = r;
-	matricesDirty = true;
+	TransformStore& store = TransformStore::GetInstance();
+	store.pitch[slot] = p;
+	store.yaw[slot] = y;
+	store.roll[slot] = r;
+	UpdateRotation();
+}
+
+void Transform::SetRotation(DirectX::XMFLOAT4 quaternion)
+{
+	// Only unit quaternions are pure rotations
+	XMStoreFloat4(&quaternion, XMQuaternionNormalize(XMLoadFloat4(&quaternion)));
+
+	TransformStore& store = TransformStore::GetInstance();
+	store.rotationX[slot] = quaternion.x;
+	store.rotationY[slot] = quaternion.y;
+	store.rotationZ[slot] = quaternion.z;
+	store.rotationW[slot] = quaternion.w;
+
+	XMFLOAT3 pitchYawRoll = QuaternionToEuler(quaternion);
+	store.pitch[slot] = pitchYawRoll.x;
+	store.yaw[slot] = pitchYawRoll.y;
+	store.roll[slot] = pitchYawRoll.z;
+	store.MarkDirty(slot);
 }
 
 void Transform::SetScale(float x, float y, float z)
 {
-	scale.x = x;
-	scale.y = y;
-	scale.z = z;
-	matricesDirty = true;
+	TransformStore& store = TransformStore::GetInstance();
+	store.scaleX[slot] = x;
+	store.scaleY[slot] = y;
+	store.scaleZ[slot] = z;
+	store.MarkDirty(slot);
 }
 
-DirectX::XMFLOAT3 Transform::GetPosition() { return position; }
+DirectX::XMFLOAT3 Transform::GetPosition()
+{
+	TransformStore& store = TransformStore::GetInstance();
+	return XMFLOAT3(store.positionX[slot], store.positionY[slot], store.positionZ[slot]);
+}
 
-DirectX::XMFLOAT3 Transform::GetPitchYawRoll() { return pitchYawRoll; }
+DirectX::XMFLOAT4 Transform::GetRotation()
+{
+	TransformStore& store = TransformStore::GetInstance();
+	return XMFLOAT4(store.rotationX[slot], store.rotationY[slot], store.rotationZ[slot], store.rotationW[slot]);
+}
+
+DirectX::XMFLOAT3 Transform::GetPitchYawRoll()
+{
+	TransformStore& store = TransformStore::GetInstance();
+	return XMFLOAT3(store.pitch[slot], store.yaw[slot], store.roll[slot]);
+}
 
-DirectX::XMFLOAT3 Transform::GetScale() { return scale; }
+DirectX::XMFLOAT3 Transform::GetScale()
+{
+	TransformStore& store = TransformStore::GetInstance();
+	return XMFLOAT3(store.scaleX[slot], store.scaleY[slot], store.scaleZ[slot]);
+}
 
 
 DirectX::XMFLOAT4X4 Transform::GetWorldMatrix()
 {
-	UpdateMatrices();
-	return worldMatrix;
+	TransformStore& store = TransformStore::GetInstance();
+	store.UpdateMatrices(slot);
+	return store.worldMatrices[slot];
 }
 
 DirectX::XMFLOAT4X4 Transform::GetWorldInverseTransposeMatrix()
 {
-	UpdateMatrices();
-	return worldMatrix;
+	TransformStore& store = TransformStore::GetInstance();
+	store.UpdateMatrices(slot);
+	return store.worldInverseTransposeMatrices[slot];
 }
 
-void Transform::UpdateMatrices()
+unsigned int Transform::GetMatrixVersion()
 {
-	// Are the matrices out of date (dirty)?
-	if (matricesDirty)
-	{
-		// Create the three transformation pieces
-		XMMATRIX trans = XMMatrixTranslationFromVector(XMLoadFloat3(&position));
-		XMMATRIX rot = XMMatrixRotationRollPitchYawFromVector(XMLoadFloat3(&pitchYawRoll));
-		XMMATRIX sc = XMMatrixScalingFromVector(XMLoadFloat3(&scale));
-
-		// Combine and store the world
-		XMMATRIX wm = sc * rot * trans;
-		XMStoreFloat4x4(&worldMatrix, wm);
-
-		// Invert and transpose, too
-		XMStoreFloat4x4(&worldInverseTransposeMatrix, XMMatrixInverse(0, XMMatrixTranspose(wm)));
+	TransformStore& store = TransformStore::GetInstance();
+	store.UpdateMatrices(slot);
+	return store.versions[slot];
+}
 
-		// All set
-		matricesDirty = false;
-	}
+void Transform::UpdateRotation()
+{
+	TransformStore& store = TransformStore::GetInstance();
+	XMFLOAT4 rotation;
+	XMStoreFloat4(&rotation, XMQuaternionRotationRollPitchYaw(store.pitch[slot], store.yaw[slot], store.roll[slot]));
+	store.rotationX[slot] = rotation.x;
+	store.rotationY[slot] = rotation.y;
+	store.rotationZ[slot] = rotation.z;
+	store.rotationW[slot] = rotation.w;
+	store.MarkDirty(slot);
 }
@@ -2,10 +2,19 @@
 
 #include <DirectXMath.h>
 
+#include "TransformStore.h"
+
+// --------------------------------------------------------
+// A handle to one slot of the TransformStore, which holds
+// the actual data (copies get their own slot)
+// --------------------------------------------------------
 class Transform
 {
 public:
 	Transform();
+	Transform(const Transform& other);
+	Transform& operator=(const Transform& other);
+	~Transform();
 
 	void MoveAbsolute(float x, float y, float z);
 	void MoveRelative(float x, float y, float z);
@@ -14,26 +23,26 @@ public:
 
 	void SetPosition(float x, float y, float z);
 	void SetRotation(float p, float y, float r);
+	void SetRotation(DirectX::XMFLOAT4 quaternion);
 	void SetScale(float x, float y, float z);
 
+	// Rotation is stored as a quaternion.  The pitch/yaw/roll
+	// version is for editing, and is whatever the rotation was
+	// last set (or rotated) to, or else angles that match it.
 	DirectX::XMFLOAT3 GetPosition();
+	DirectX::XMFLOAT4 GetRotation();
 	DirectX::XMFLOAT3 GetPitchYawRoll();
 	DirectX::XMFLOAT3 GetScale();
 	DirectX::XMFLOAT4X4 GetWorldMatrix();
 	DirectX::XMFLOAT4X4 GetWorldInverseTransposeMatrix();
 
+	// Changes every time the matrices are recalculated, so anything
+	// derived from them can tell when it's out of date
+	unsigned int GetMatrixVersion();
+
 private:
-	// Raw transformation data
-	DirectX::XMFLOAT3 position;
-	DirectX::XMFLOAT3 pitchYawRoll;
-	DirectX::XMFLOAT3 scale;
-
-	// World matrix and inverse transpose of the world matrix
-	bool matricesDirty;
-	DirectX::XMFLOAT4X4 worldMatrix;
-	DirectX::XMFLOAT4X4 worldInverseTransposeMatrix;
-
-	// Helper to update both matrices if necessary
-	void UpdateMatrices();
-};
+	unsigned int slot;
 
+	// Rebuilds the quaternion from the pitch/yaw/roll
+	void UpdateRotation();
+};
@@ -0,0 +1,222 @@
+#include "TransformStore.h"
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+
+using namespace DirectX;
+
+// Singleton requirement
+TransformStore* TransformStore::instance;
+
+
+// Loads four slots' worth of one component
+static XMVECTOR LoadGroup(const std::vector<float>& component, unsigned int firstSlot)
+{
+	return XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&component[firstSlot]));
+}
+
+// Takes one row of four matrices, with each vector holding one element
+// from all four, and stores the row of each matrix that's in the mask
+static void StoreRow(XMFLOAT4X4* matrices, int row, unsigned int slotMask, FXMVECTOR x, FXMVECTOR y, FXMVECTOR z, GXMVECTOR w)
+{
+	XMMATRIX rows = XMMatrixTranspose(XMMATRIX(x, y, z, w));
+	for (int i = 0; i < 4; i++)
+	{
+		if (slotMask & (1 << i))
+			XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(matrices[i].m[row]), rows.r[i]);
+	}
+}
+
+
+TransformStore::TransformStore()
+{
+}
+
+unsigned int TransformStore::Allocate()
+{
+	if (freeSlots.empty())
+	{
+		// Add a whole word of slots, handing out the lowest first
+		unsigned int first = (unsigned int)versions.size();
+		unsigned int count = first + SlotsPerWord;
+		for (std::vector<float>* c : { &positionX, &positionY, &positionZ, &rotationX, &rotationY, &rotationZ, &rotationW, &pitch, &yaw, &roll, &scaleX, &scaleY, &scaleZ })
+			c->resize(count);
+		worldMatrices.resize(count);
+		worldInverseTransposeMatrices.resize(count);
+		versions.resize(count, 0);
+		dirty.push_back(0);
+
+		for (unsigned int slot = count; slot > first; slot--)
+		{
+			ResetSlot(slot - 1);
+			freeSlots.push_back(slot - 1);
+		}
+	}
+
+	unsigned int slot = freeSlots.back();
+	freeSlots.pop_back();
+	ResetSlot(slot);
+	return slot;
+}
+
+void TransformStore::Free(unsigned int slot)
+{
+	ResetSlot(slot);
+	freeSlots.push_back(slot);
+}
+
+void TransformStore::ResetSlot(unsigned int slot)
+{
+	positionX[slot] = positionY[slot] = positionZ[slot] = 0.0f;
+	rotationX[slot] = rotationY[slot] = rotationZ[slot] = 0.0f;
+	rotationW[slot] = 1.0f;
+	pitch[slot] = yaw[slot] = roll[slot] = 0.0f;
+	scaleX[slot] = scaleY[slot] = scaleZ[slot] = 1.0f;
+
+	XMStoreFloat4x4(&worldMatrices[slot], XMMatrixIdentity());
+	XMStoreFloat4x4(&worldInverseTransposeMatrices[slot], XMMatrixIdentity());
+
+	// Anything derived from the slot's last user is now out of date
+	versions[slot]++;
+	dirty[slot / SlotsPerWord] &= ~(1ull << (slot % SlotsPerWord));
+}
+
+
+unsigned int TransformStore::UpdateMatrices(TransformUpdateStats* stats)
+{
+	// Only chunks with something dirty are worth a job
+	std::vector<unsigned int> chunks;
+	for (unsigned int word = 0; word < dirty.size(); word += WordsPerChunk)
+	{
+		unsigned int end = (std::min)(word + WordsPerChunk, (unsigned int)dirty.size());
+		for (unsigned int w = word; w < end; w++)
+		{
+			if (dirty[w])
+			{
+				chunks.push_back(word / WordsPerChunk);
+				break;
+			}
+		}
+	}
+
+	std::atomic<unsigned int> updated(0);
+	JobSystem::GetInstance().ParallelFor((unsigned int)chunks.size(), [&](unsigned int i)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+		updated += UpdateChunk(chunks[i]);
+
+		if (stats)
+		{
+			// Nobody else writes this thread's entries
+			unsigned int thread = JobSystem::GetThreadIndex();
+			auto end = std::chrono::high_resolution_clock::now();
+			stats->Threads[thread].Milliseconds += std::chrono::duration<double, std::milli>(end - start).count();
+			stats->Threads[thread].Chunks++;
+		}
+	});
+
+	if (stats)
+	{
+		stats->DirtyTransforms = updated;
+		stats->MatrixChunks = (unsigned int)chunks.size();
+	}
+	return updated;
+}
+
+unsigned int TransformStore::UpdateChunk(unsigned int chunk)
+{
+	unsigned int updated = 0;
+	unsigned int first = chunk * WordsPerChunk;
+	unsigned int end = (std::min)(first + WordsPerChunk, (unsigned int)dirty.size());
+	for (unsigned int word = first; word < end; word++)
+	{
+		unsigned long long bits = dirty[word];
+		if (!bits)
+			continue;
+
+		for (unsigned int group = 0; group < SlotsPerWord; group += 4)
+		{
+			unsigned int slotMask = (unsigned int)(bits >> group) & 0xF;
+			if (slotMask)
+				UpdateGroup(word * SlotsPerWord + group, slotMask);
+		}
+
+		dirty[word] = 0;
+		while (bits)
+		{
+			bits &= bits - 1;
+			updated++;
+		}
+	}
+	return updated;
+}
+
+void TransformStore::UpdateMatrices(unsigned int slot)
+{
+	unsigned long long bit = 1ull << (slot % SlotsPerWord);
+	unsigned long long& word = dirty[slot / SlotsPerWord];
+	if (word & bit)
+	{
+		UpdateGroup(slot & ~3u, 1 << (slot & 3));
+		word &= ~bit;
+	}
+}
+
+void TransformStore::UpdateGroup(unsigned int firstSlot, unsigned int slotMask)
+{
+	XMVECTOR qx = LoadGroup(rotationX, firstSlot);
+	XMVECTOR qy = LoadGroup(rotationY, firstSlot);
+	XMVECTOR qz = LoadGroup(rotationZ, firstSlot);
+	XMVECTOR qw = LoadGroup(rotationW, firstSlot);
+
+	// Rotation rows, as in XMMatrixRotationQuaternion
+	XMVECTOR one = XMVectorSplatOne();
+	XMVECTOR x2 = qx + qx, y2 = qy + qy, z2 = qz + qz;
+	XMVECTOR xx = qx * x2, yy = qy * y2, zz = qz * z2;
+	XMVECTOR xy = qx * y2, xz = qx * z2, yz = qy * z2;
+	XMVECTOR wx = qw * x2, wy = qw * y2, wz = qw * z2;
+	XMVECTOR r00 = one - yy - zz;
+	XMVECTOR r01 = xy + wz;
+	XMVECTOR r02 = xz - wy;
+	XMVECTOR r10 = xy - wz;
+	XMVECTOR r11 = one - xx - zz;
+	XMVECTOR r12 = yz + wx;
+	XMVECTOR r20 = xz + wy;
+	XMVECTOR r21 = yz - wx;
+	XMVECTOR r22 = one - xx - yy;
+
+	XMVECTOR sx = LoadGroup(scaleX, firstSlot);
+	XMVECTOR sy = LoadGroup(scaleY, firstSlot);
+	XMVECTOR sz = LoadGroup(scaleZ, firstSlot);
+	XMVECTOR px = LoadGroup(positionX, firstSlot);
+	XMVECTOR py = LoadGroup(positionY, firstSlot);
+	XMVECTOR pz = LoadGroup(positionZ, firstSlot);
+	XMVECTOR zero = XMVectorZero();
+
+	// World is scale * rotation * translation
+	XMFLOAT4X4* world = &worldMatrices[firstSlot];
+	StoreRow(world, 0, slotMask, r00 * sx, r01 * sx, r02 * sx, zero);
+	StoreRow(world, 1, slotMask, r10 * sy, r11 * sy, r12 * sy, zero);
+	StoreRow(world, 2, slotMask, r20 * sz, r21 * sz, r22 * sz, zero);
+	StoreRow(world, 3, slotMask, px, py, pz, one);
+
+	// The rotation's inverse is its transpose, so the inverse transpose
+	// of the upper 3x3 is just each rotation row divided by its scale,
+	// and the translation ends up in the last column
+	XMVECTOR ix = XMVectorReciprocal(sx);
+	XMVECTOR iy = XMVectorReciprocal(sy);
+	XMVECTOR iz = XMVectorReciprocal(sz);
+	XMFLOAT4X4* invTrans = &worldInverseTransposeMatrices[firstSlot];
+	StoreRow(invTrans, 0, slotMask, r00 * ix, r01 * ix, r02 * ix, -(px * r00 + py * r01 + pz * r02) * ix);
+	StoreRow(invTrans, 1, slotMask, r10 * iy, r11 * iy, r12 * iy, -(px * r10 + py * r11 + pz * r12) * iy);
+	StoreRow(invTrans, 2, slotMask, r20 * iz, r21 * iz, r22 * iz, -(px * r20 + py * r21 + pz * r22) * iz);
+	StoreRow(invTrans, 3, slotMask, zero, zero, zero, one);
+
+	for (int i = 0; i < 4; i++)
+	{
+		if (slotMask & (1 << i))
+			versions[firstSlot + i]++;
+	}
+}
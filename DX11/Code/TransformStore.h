@@ -0,0 +1,126 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <vector>
+
+// --------------------------------------------------------
+// One thread's share of a parallel transform update.  Each
+// is padded out to two cache lines, so however the storage
+// they're in happens to be aligned, no two threads' counters
+// ever share a line.
+// --------------------------------------------------------
+struct TransformUpdateThreadStats
+{
+	double Milliseconds;
+	unsigned int Chunks;
+	char Padding[128 - sizeof(double) - sizeof(unsigned int)];
+};
+
+// --------------------------------------------------------
+// How the last parallel transform update went, for the
+// debug UI.  The per thread entries are indexed by
+// JobSystem::GetThreadIndex().
+// --------------------------------------------------------
+struct TransformUpdateStats
+{
+	unsigned int DirtyTransforms;
+	unsigned int MatrixChunks;
+	unsigned int Entities;
+	unsigned int BoundsChunks;
+	double TotalMs;
+
+	std::vector<TransformUpdateThreadStats> Threads;
+};
+
+// --------------------------------------------------------
+// Holds the data for every Transform in structure of arrays
+// form, so matrices can be rebuilt four at a time
+//
+// Setting any component marks that slot dirty.  Once per
+// frame (before drawing), UpdateMatrices() rebuilds every
+// dirty world and inverse transpose matrix in one sweep,
+// split into chunks for the job system.  Matrices asked for
+// before then are rebuilt on the spot.
+//
+// Slots are only handed out and freed on the main thread.
+// --------------------------------------------------------
+class TransformStore
+{
+#pragma region Singleton
+public:
+	// Gets the one and only instance of this class
+	static TransformStore& GetInstance()
+	{
+		if (!instance)
+		{
+			instance = new TransformStore();
+		}
+
+		return *instance;
+	}
+
+	// Remove these functions (C++ 11 version)
+	TransformStore(TransformStore const&) = delete;
+	void operator=(TransformStore const&) = delete;
+
+private:
+	static TransformStore* instance;
+	TransformStore();
+#pragma endregion
+
+public:
+	// A slot with identity transform data, reusing freed ones first
+	unsigned int Allocate();
+	void Free(unsigned int slot);
+
+	// Rebuilds every dirty slot's matrices across the job system's
+	// threads, returning how many there were.  Each thread's time and
+	// chunk count is added to the stats, if given (which need an entry
+	// per thread already).
+	unsigned int UpdateMatrices(TransformUpdateStats* stats = 0);
+
+	// Rebuilds just this slot's matrices, if they're dirty
+	void UpdateMatrices(unsigned int slot);
+
+	unsigned int GetSlotCount() { return (unsigned int)versions.size(); }
+	unsigned int GetFreeSlotCount() { return (unsigned int)freeSlots.size(); }
+
+private:
+	friend class Transform;
+
+	// Slots are added a whole dirty word at a time, which
+	// also keeps every group of four complete
+	static const unsigned int SlotsPerWord = 64;
+
+	// Each job sweeps a cache line's worth of dirty words.  The arrays
+	// are only as aligned as std::vector makes them, so neighbouring
+	// chunks can still share the one cache line at each boundary (of
+	// bits or of matrices), but never more than that
+	static const unsigned int WordsPerChunk = 64 / sizeof(unsigned long long);
+
+	// Raw transformation data, one entry per slot.  Rotations are
+	// quaternions, and the pitch/yaw/roll they were last set from
+	// (or that match them) is only kept for editing.
+	std::vector<float> positionX, positionY, positionZ;
+	std::vector<float> rotationX, rotationY, rotationZ, rotationW;
+	std::vector<float> pitch, yaw, roll;
+	std::vector<float> scaleX, scaleY, scaleZ;
+
+	// Results of the last rebuild
+	std::vector<DirectX::XMFLOAT4X4> worldMatrices;
+	std::vector<DirectX::XMFLOAT4X4> worldInverseTransposeMatrices;
+	std::vector<unsigned int> versions;
+
+	std::vector<unsigned long long> dirty;		// One bit per slot
+	std::vector<unsigned int> freeSlots;
+
+	void MarkDirty(unsigned int slot) { dirty[slot / SlotsPerWord] |= 1ull << (slot % SlotsPerWord); }
+	void ResetSlot(unsigned int slot);
+
+	// Rebuilds the dirty slots covered by one chunk of dirty words
+	unsigned int UpdateChunk(unsigned int chunk);
+
+	// Rebuilds the matrices of the given slots (a bit for each)
+	// among the four starting at firstSlot
+	void UpdateGroup(unsigned int firstSlot, unsigned int slotMask);
+};
@@ -13,4 +13,17 @@ struct Vertex
 	DirectX::XMFLOAT2 UV;			// Texture mapping
 	DirectX::XMFLOAT3 Normal;		// Lighting
 	DirectX::XMFLOAT3 Tangent;		// Normal mapping
-};
\ No newline at end of file
+};
+// --------------------------------------------------------
+// A compact, quantized version of Vertex (16 bytes vs. 44)
+//
+// See VertexPacking for the encoding, and VertexShader.hlsl
+// (with PACKED_VERTICES defined) for the decoding.
+// --------------------------------------------------------
+struct PackedVertex
+{
+	unsigned short Position[3];		// Unorm, across the mesh's bounds
+	unsigned short TangentAngle;	// Unorm, angle of the tangent around the normal
+	unsigned short UV[2];			// Half floats
+	short Normal[2];				// Snorm, octahedral encoding
+};
@@ -0,0 +1,224 @@
+#include "VertexPacking.h"
+
+#include <algorithm>
+#include <cmath>
+#include <DirectXPackedVector.h>
+
+using namespace DirectX;
+using namespace DirectX::PackedVector;
+
+static const float TwoPi = 6.28318530718f;
+
+static inline float SignNotZero(float value)
+{
+	return value >= 0.0f ? 1.0f : -1.0f;
+}
+
+static inline float Dot(XMFLOAT3 a, XMFLOAT3 b)
+{
+	return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+// Angle between two directions, in degrees (either may be unnormalized)
+static float AngleBetween(XMFLOAT3 a, XMFLOAT3 b)
+{
+	float lengths = sqrtf(Dot(a, a) * Dot(b, b));
+	if (lengths == 0.0f)
+		return 0.0f;
+
+	float cosine = Dot(a, b) / lengths;
+	cosine = cosine > 1.0f ? 1.0f : (cosine < -1.0f ? -1.0f : cosine);
+	return XMConvertToDegrees(acosf(cosine));
+}
+
+// Rounds a value in [0, 1] to a 16 bit unorm
+static inline unsigned short QuantizeUnorm(float value)
+{
+	value = value > 1.0f ? 1.0f : (value < 0.0f ? 0.0f : value);
+	return (unsigned short)(value * 65535.0f + 0.5f);
+}
+
+// Rounds a value in [-1, 1] to a 16 bit snorm
+static inline short QuantizeSnorm(float value)
+{
+	value = value > 1.0f ? 1.0f : (value < -1.0f ? -1.0f : value);
+	return (short)floorf(value * 32767.0f + 0.5f);
+}
+
+
+// --------------------------------------------------------
+// Packs an array of vertices, returning the scale and
+// offset needed to decode their positions
+// --------------------------------------------------------
+void VertexPacking::Pack(const Vertex* vertices, size_t count, PackedVertex* packed, XMFLOAT3& positionScale, XMFLOAT3& positionOffset)
+{
+	positionScale = XMFLOAT3(0, 0, 0);
+	positionOffset = XMFLOAT3(0, 0, 0);
+	if (count == 0)
+		return;
+
+	// Positions are stored relative to the bounds
+	XMFLOAT3 min = vertices[0].Position;
+	XMFLOAT3 max = vertices[0].Position;
+	for (size_t i = 1; i < count; i++)
+	{
+		const XMFLOAT3& p = vertices[i].Position;
+		min = XMFLOAT3((std::min)(min.x, p.x), (std::min)(min.y, p.y), (std::min)(min.z, p.z));
+		max = XMFLOAT3((std::max)(max.x, p.x), (std::max)(max.y, p.y), (std::max)(max.z, p.z));
+	}
+	positionOffset = min;
+	positionScale = XMFLOAT3(max.x - min.x, max.y - min.y, max.z - min.z);
+
+	for (size_t i = 0; i < count; i++)
+	{
+		const Vertex& v = vertices[i];
+		PackedVertex& p = packed[i];
+
+		// A flat axis (zero scale) just stays at the offset
+		p.Position[0] = positionScale.x > 0.0f ? QuantizeUnorm((v.Position.x - min.x) / positionScale.x) : 0;
+		p.Position[1] = positionScale.y > 0.0f ? QuantizeUnorm((v.Position.y - min.y) / positionScale.y) : 0;
+		p.Position[2] = positionScale.z > 0.0f ? QuantizeUnorm((v.Position.z - min.z) / positionScale.z) : 0;
+
+		p.UV[0] = XMConvertFloatToHalf(v.UV.x);
+		p.UV[1] = XMConvertFloatToHalf(v.UV.y);
+
+		EncodeOctahedral(v.Normal, p.Normal);
+
+		// The tangent's angle is measured against the normal the
+		// shader will actually see, not the original one
+		XMFLOAT3 b1, b2;
+		BuildBasis(DecodeOctahedral(p.Normal), b1, b2);
+		float angle = atan2f(Dot(v.Tangent, b2), Dot(v.Tangent, b1));
+		if (angle < 0.0f)
+			angle += TwoPi;
+
+		// The angle wraps around, so 65536 steps cover the full circle
+		p.TangentAngle = (unsigned short)((unsigned int)(angle / TwoPi * 65536.0f + 0.5f) & 0xFFFF);
+	}
+}
+
+// --------------------------------------------------------
+// Unpacks a single vertex, exactly as the shader does
+// --------------------------------------------------------
+Vertex VertexPacking::Unpack(const PackedVertex& packed, XMFLOAT3 positionScale, XMFLOAT3 positionOffset)
+{
+	Vertex v = {};
+	v.Position.x = positionOffset.x + packed.Position[0] / 65535.0f * positionScale.x;
+	v.Position.y = positionOffset.y + packed.Position[1] / 65535.0f * positionScale.y;
+	v.Position.z = positionOffset.z + packed.Position[2] / 65535.0f * positionScale.z;
+
+	v.UV.x = XMConvertHalfToFloat(packed.UV[0]);
+	v.UV.y = XMConvertHalfToFloat(packed.UV[1]);
+
+	v.Normal = DecodeOctahedral(packed.Normal);
+
+	XMFLOAT3 b1, b2;
+	BuildBasis(v.Normal, b1, b2);
+	float angle = packed.TangentAngle * (TwoPi / 65536.0f);
+	float c = cosf(angle);
+	float s = sinf(angle);
+	v.Tangent = XMFLOAT3(c * b1.x + s * b2.x, c * b1.y + s * b2.y, c * b1.z + s * b2.z);
+	return v;
+}
+
+// --------------------------------------------------------
+// Decodes every packed vertex and totals up the error
+// --------------------------------------------------------
+VertexPackingError VertexPacking::MeasureError(const Vertex* vertices, const PackedVertex* packed, size_t count, XMFLOAT3 positionScale, XMFLOAT3 positionOffset)
+{
+	VertexPackingError error = {};
+	if (count == 0)
+		return error;
+
+	double position = 0, uv = 0, normal = 0, tangent = 0;
+	for (size_t i = 0; i < count; i++)
+	{
+		const Vertex& original = vertices[i];
+		Vertex unpacked = Unpack(packed[i], positionScale, positionOffset);
+
+		XMFLOAT3 d(unpacked.Position.x - original.Position.x, unpacked.Position.y - original.Position.y, unpacked.Position.z - original.Position.z);
+		float positionError = sqrtf(Dot(d, d));
+		float uvError = (std::max)(fabsf(unpacked.UV.x - original.UV.x), fabsf(unpacked.UV.y - original.UV.y));
+		float normalError = AngleBetween(unpacked.Normal, original.Normal);
+
+		// Only the part of the tangent perpendicular to the normal
+		// survives packing, so that's what it's compared against
+		XMFLOAT3 t = original.Tangent;
+		float along = Dot(t, unpacked.Normal);
+		t = XMFLOAT3(t.x - unpacked.Normal.x * along, t.y - unpacked.Normal.y * along, t.z - unpacked.Normal.z * along);
+		float tangentError = AngleBetween(unpacked.Tangent, t);
+
+		error.MaxPosition = (std::max)(error.MaxPosition, positionError);
+		error.MaxUV = (std::max)(error.MaxUV, uvError);
+		error.MaxNormalDegrees = (std::max)(error.MaxNormalDegrees, normalError);
+		error.MaxTangentDegrees = (std::max)(error.MaxTangentDegrees, tangentError);
+		position += positionError;
+		uv += uvError;
+		normal += normalError;
+		tangent += tangentError;
+	}
+
+	error.AvgPosition = (float)(position / count);
+	error.AvgUV = (float)(uv / count);
+	error.AvgNormalDegrees = (float)(normal / count);
+	error.AvgTangentDegrees = (float)(tangent / count);
+	return error;
+}
+
+
+// --------------------------------------------------------
+// Octahedral normal encoding - see "A Survey of Efficient
+// Representations for Independent Unit Vectors" (Cigolle
+// et al. 2014)
+// --------------------------------------------------------
+void VertexPacking::EncodeOctahedral(XMFLOAT3 normal, short encoded[2])
+{
+	float length = fabsf(normal.x) + fabsf(normal.y) + fabsf(normal.z);
+	if (length == 0.0f)
+	{
+		encoded[0] = encoded[1] = 0;
+		return;
+	}
+
+	// Project onto the octahedron, folding the bottom half over the top
+	float x = normal.x / length;
+	float y = normal.y / length;
+	if (normal.z < 0.0f)
+	{
+		float foldedX = (1.0f - fabsf(y)) * SignNotZero(x);
+		float foldedY = (1.0f - fabsf(x)) * SignNotZero(y);
+		x = foldedX;
+		y = foldedY;
+	}
+
+	encoded[0] = QuantizeSnorm(x);
+	encoded[1] = QuantizeSnorm(y);
+}
+
+XMFLOAT3 VertexPacking::DecodeOctahedral(const short encoded[2])
+{
+	float x = (std::max)(encoded[0] / 32767.0f, -1.0f);
+	float y = (std::max)(encoded[1] / 32767.0f, -1.0f);
+	float z = 1.0f - fabsf(x) - fabsf(y);
+
+	// Unfold the bottom half
+	float t = z < 0.0f ? -z : 0.0f;
+	x += x >= 0.0f ? -t : t;
+	y += y >= 0.0f ? -t : t;
+
+	float length = sqrtf(x * x + y * y + z * z);
+	return XMFLOAT3(x / length, y / length, z / length);
+}
+
+// --------------------------------------------------------
+// Branchless orthonormal basis from "Building an Orthonormal
+// Basis, Revisited" (Duff et al. 2017)
+// --------------------------------------------------------
+void VertexPacking::BuildBasis(XMFLOAT3 normal, XMFLOAT3& b1, XMFLOAT3& b2)
+{
+	float sign = SignNotZero(normal.z);
+	float a = -1.0f / (sign + normal.z);
+	float b = normal.x * normal.y * a;
+	b1 = XMFLOAT3(1.0f + sign * normal.x * normal.x * a, sign * b, -sign * normal.x);
+	b2 = XMFLOAT3(b, sign + normal.y * normal.y * a, -normal.y);
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <DirectXMath.h>
+
+#include "Vertex.h"
+
+// --------------------------------------------------------
+// How far packed vertices are from the originals
+//
+// Positions are in model space units, UVs in texture
+// coordinates and directions in degrees.
+// --------------------------------------------------------
+struct VertexPackingError
+{
+	float MaxPosition;
+	float AvgPosition;
+	float MaxUV;
+	float AvgUV;
+	float MaxNormalDegrees;
+	float AvgNormalDegrees;
+	float MaxTangentDegrees;
+	float AvgTangentDegrees;
+};
+
+// --------------------------------------------------------
+// Converts between Vertex (44 bytes) and PackedVertex (16)
+//
+// Positions are 16 bit unorms spanning the mesh's bounds,
+// so the shader needs a scale and offset to decode them.
+// Normals use an octahedral encoding: the unit sphere is
+// projected onto an octahedron and unfolded into a square.
+// Tangents are always perpendicular to the normal, so all
+// that's stored is their angle around it, relative to a
+// basis built from the (decoded) normal.
+//
+// Unpack() mirrors the decoding in VertexPacking.hlsli.
+// --------------------------------------------------------
+class VertexPacking
+{
+public:
+	static void Pack(const Vertex* vertices, size_t count, PackedVertex* packed, DirectX::XMFLOAT3& positionScale, DirectX::XMFLOAT3& positionOffset);
+	static Vertex Unpack(const PackedVertex& packed, DirectX::XMFLOAT3 positionScale, DirectX::XMFLOAT3 positionOffset);
+
+	// Compares packed vertices to their originals
+	static VertexPackingError MeasureError(const Vertex* vertices, const PackedVertex* packed, size_t count, DirectX::XMFLOAT3 positionScale, DirectX::XMFLOAT3 positionOffset);
+
+private:
+	static void EncodeOctahedral(DirectX::XMFLOAT3 normal, short encoded[2]);
+	static DirectX::XMFLOAT3 DecodeOctahedral(const short encoded[2]);
+
+	// Two unit vectors perpendicular to the normal (and each other)
+	static void BuildBasis(DirectX::XMFLOAT3 normal, DirectX::XMFLOAT3& b1, DirectX::XMFLOAT3& b2);
+};
+
@@ -0,0 +1,73 @@
+// Include guard
+#ifndef _VERTEX_PACKING_HLSL
+#define _VERTEX_PACKING_HLSL
+
+// Decoding for the PackedVertex format (see VertexPacking.h)
+//
+// The whole 16 byte vertex comes in as a single uint4:
+//  x: position x (low 16 bits), position y (high)
+//  y: position z (low), tangent angle (high)
+//  z: uv as two halfs
+//  w: octahedral normal as two snorms
+
+// Tangent angles use all 65536 steps for one full turn
+static const float PACKED_TANGENT_ANGLE_STEP = 6.28318530718f / 65536.0f;
+
+struct UnpackedVertex
+{
+	float3 position;
+	float2 uv;
+	float3 normal;
+	float3 tangent;
+};
+
+// Sign extends two 16 bit snorms and converts them to [-1, 1]
+float2 UnpackSnorm16x2(uint packed)
+{
+	int2 values = int2(asint(packed << 16), asint(packed)) >> 16;
+	return max(float2(values) / 32767.0f, -1.0f);
+}
+
+float3 DecodeOctahedral(float2 encoded)
+{
+	float3 n = float3(encoded, 1.0f - abs(encoded.x) - abs(encoded.y));
+
+	// Unfold the bottom half
+	float t = saturate(-n.z);
+	n.xy += (n.xy >= 0.0f) ? -t : t;
+	return normalize(n);
+}
+
+// Two unit vectors perpendicular to the normal - must
+// match VertexPacking::BuildBasis() on the C++ side
+void BuildBasis(float3 n, out float3 b1, out float3 b2)
+{
+	float s = n.z >= 0.0f ? 1.0f : -1.0f;
+	float a = -1.0f / (s + n.z);
+	float b = n.x * n.y * a;
+	b1 = float3(1.0f + s * n.x * n.x * a, s * b, -s * n.x);
+	b2 = float3(b, s + n.y * n.y * a, -n.y);
+}
+
+UnpackedVertex UnpackVertex(uint4 packed, float3 positionScale, float3 positionOffset)
+{
+	UnpackedVertex v;
+
+	float3 position = float3(packed.x & 0xFFFF, packed.x >> 16, packed.y & 0xFFFF) / 65535.0f;
+	v.position = positionOffset + position * positionScale;
+
+	v.uv = f16tof32(uint2(packed.z & 0xFFFF, packed.z >> 16));
+
+	v.normal = DecodeOctahedral(UnpackSnorm16x2(packed.w));
+
+	// Tangent is stored as an angle around the normal
+	float3 b1, b2;
+	BuildBasis(v.normal, b1, b2);
+	float s, c;
+	sincos((packed.y >> 16) * PACKED_TANGENT_ANGLE_STEP, s, c);
+	v.tangent = c * b1 + s * b2;
+
+	return v;
+}
+
+#endif
@@ -1,14 +1,36 @@
 
-// Constant Buffer for external (C++) data
-cbuffer externalData : register(b0)
+// PACKED_VERTICES is defined by VertexShaderPacked.hlsl, which
+// compiles this same shader for meshes using PackedVertex
+#ifdef PACKED_VERTICES
+#include "VertexPacking.hlsli"
+#endif
+
+// Data that only changes once per frame
+cbuffer perFrame : register(b0)
 {
-	matrix world;
-	matrix worldInverseTranspose;
 	matrix view;
 	matrix projection;
 };
 
+// Each object's own data, which stays on the GPU between
+// frames (must match ObjectConstants in Material.h)
+cbuffer perObject : register(b1)
+{
+	matrix world;
+	matrix worldInverseTranspose;
+#ifdef PACKED_VERTICES
+	float3 positionScale;	// Mesh bounds, for decoding positions
+	float3 positionOffset;
+#endif
+};
+
 // Struct representing a single vertex worth of data
+#ifdef PACKED_VERTICES
+struct VertexShaderInput
+{
+	uint4 packedData	: PACKED;
+};
+#else
 struct VertexShaderInput
 {
 	float3 position		: POSITION;
@@ -16,6 +38,7 @@ struct VertexShaderInput
 	float3 normal		: NORMAL;
 	float3 tangent		: TANGENT;
 };
+#endif
 
 // Out of the vertex shader (and eventually input to the PS)
 struct VertexToPixel
@@ -30,8 +53,14 @@ struct VertexToPixel
 // --------------------------------------------------------
 // The entry point (main method) for our vertex shader
 // --------------------------------------------------------
-VertexToPixel main(VertexShaderInput input)
+VertexToPixel main(VertexShaderInput vertexInput)
 {
+#ifdef PACKED_VERTICES
+	UnpackedVertex input = UnpackVertex(vertexInput.packedData, positionScale, positionOffset);
+#else
+	VertexShaderInput input = vertexInput;
+#endif
+
 	// Set up output
 	VertexToPixel output;
 
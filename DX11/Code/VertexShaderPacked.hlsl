@@ -0,0 +1,4 @@
+// The standard vertex shader, compiled for meshes using
+// PackedVertex instead of Vertex (see Mesh.h)
+#define PACKED_VERTICES
+#include "VertexShader.hlsl"
@@ -0,0 +1,256 @@
+#include "Benchmarks.h"
+#include "Transform.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+using namespace DirectX;
+
+// Helper for timing a piece of code, in milliseconds
+template<typename Func>
+static double TimeMilliseconds(Func func)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+	func();
+	auto end = std::chrono::high_resolution_clock::now();
+	return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+
+// --------------------------------------------------------
+// The original Transform hierarchy, kept as the baseline
+// for comparison: a vector of child pointers, recursive
+// dirty marking and each world matrix pulling its parent's
+// --------------------------------------------------------
+struct LegacyNode
+{
+	XMFLOAT3 Position;
+	XMFLOAT3 PitchYawRoll;
+	XMFLOAT3 Scale;
+	LegacyNode* Parent;
+	std::vector<LegacyNode*> Children;
+	bool Dirty;
+	XMFLOAT4X4 World;
+	XMFLOAT4X4 WorldInverseTranspose;
+};
+
+static void LegacyMarkChildrenDirty(LegacyNode* node)
+{
+	for (auto c : node->Children)
+	{
+		c->Dirty = true;
+		LegacyMarkChildrenDirty(c);
+	}
+}
+
+static XMFLOAT4X4 LegacyGetWorldMatrix(LegacyNode* node)
+{
+	if (node->Dirty)
+	{
+		XMMATRIX wm =
+			XMMatrixScalingFromVector(XMLoadFloat3(&node->Scale)) *
+			XMMatrixRotationRollPitchYawFromVector(XMLoadFloat3(&node->PitchYawRoll)) *
+			XMMatrixTranslationFromVector(XMLoadFloat3(&node->Position));
+		if (node->Parent)
+		{
+			XMFLOAT4X4 parentWorld = LegacyGetWorldMatrix(node->Parent);
+			wm *= XMLoadFloat4x4(&parentWorld);
+		}
+		XMStoreFloat4x4(&node->World, wm);
+		XMStoreFloat4x4(&node->WorldInverseTranspose, XMMatrixInverse(0, XMMatrixTranspose(wm)));
+		node->Dirty = false;
+	}
+	return node->World;
+}
+
+static void LegacySetParent(LegacyNode* node, LegacyNode* parent)
+{
+	for (LegacyNode* n = parent; n; n = n->Parent)
+		if (n == node)
+			return;
+
+	if (node->Parent)
+	{
+		std::vector<LegacyNode*>& siblings = node->Parent->Children;
+		siblings.erase(std::find(siblings.begin(), siblings.end(), node));
+	}
+	if (parent)
+		parent->Children.push_back(node);
+	node->Parent = parent;
+
+	node->Dirty = true;
+	LegacyMarkChildrenDirty(node);
+}
+
+
+void Benchmarks::HierarchyUpdates()
+{
+	const int nodeCount = 100000;
+	const int reparentCount = 10000;
+
+	// Groups of nodes under one root, either all direct children
+	// of the root or one long chain, or else a random tree
+	struct Scene
+	{
+		const char* Name;
+		int GroupSize;		// 0 for a random tree
+		bool Chain;
+	};
+	Scene scenes[] = {
+		{ "wide", 100, false },
+		{ "rigs", 64, true },
+		{ "random tree", 0, false }
+	};
+
+	printf("\n=== Transform hierarchy (%d nodes, %d reparented) ===\n", nodeCount, reparentCount);
+	printf("%-16s %9s %14s %14s %14s %14s %14s %14s %s\n", "Scene", "Max depth", "Legacy all", "Flat all", "Legacy 1%", "Flat 1%", "Legacy rep.", "Flat rep.", "Output");
+
+	TransformHierarchy& hierarchy = TransformHierarchy::GetInstance();
+	for (Scene& scene : scenes)
+	{
+		// Parents always come before their children at first
+		srand(1234);
+		auto unit = []() { return rand() / (float)RAND_MAX; };
+		std::vector<int> parents(nodeCount, -1);
+		std::vector<int> depths(nodeCount, 0);
+		std::vector<int> childCounts(nodeCount, 0);
+		int maxDepth = 0;
+		for (int i = 1; i < nodeCount; i++)
+		{
+			if (scene.GroupSize == 0)
+				parents[i] = rand() % (i + 1) - 1;
+			else if (i % scene.GroupSize != 0)
+				parents[i] = scene.Chain ? i - 1 : i - i % scene.GroupSize;
+
+			if (parents[i] >= 0)
+			{
+				depths[i] = depths[parents[i]] + 1;
+				childCounts[parents[i]]++;
+				maxDepth = (std::max)(maxDepth, depths[i]);
+			}
+		}
+
+		// Drop any nodes left over from the last scene first
+		hierarchy.UpdateMatrices();
+
+		std::unique_ptr<LegacyNode[]> legacy(new LegacyNode[nodeCount]);
+		std::vector<Transform> flat(nodeCount);
+		for (int i = 0; i < nodeCount; i++)
+		{
+			XMFLOAT3 position(unit() * 4.0f - 2.0f, unit() * 4.0f - 2.0f, unit() * 4.0f - 2.0f);
+			XMFLOAT3 rotation(unit() * 0.2f, unit() * 0.2f, unit() * 0.2f);
+			XMFLOAT3 scale(0.9f + unit() * 0.2f, 0.9f + unit() * 0.2f, 0.9f + unit() * 0.2f);
+
+			LegacyNode& n = legacy[i];
+			n.Position = position;
+			n.PitchYawRoll = rotation;
+			n.Scale = scale;
+			n.Parent = 0;
+			n.Dirty = true;
+			if (parents[i] >= 0)
+				LegacySetParent(&n, &legacy[parents[i]]);
+
+			flat[i].SetPosition(position);
+			flat[i].SetRotation(rotation);
+			flat[i].SetScale(scale);
+			if (parents[i] >= 0)
+				flat[parents[i]].AddChild(&flat[i], false);
+		}
+
+		// Everything dirty, then the same 1% of roots moved
+		auto legacyUpdate = [&]() { for (int i = 0; i < nodeCount; i++) LegacyGetWorldMatrix(&legacy[i]); };
+		double legacyAllMs = TimeMilliseconds(legacyUpdate);
+		double flatAllMs = TimeMilliseconds([&]() { hierarchy.UpdateMatrices(); });
+
+		std::vector<int> roots;
+		for (int i = 0; i < nodeCount; i++)
+			if (parents[i] < 0 && rand() % 100 == 0)
+				roots.push_back(i);
+		double legacyFewMs = TimeMilliseconds([&]()
+		{
+			for (int r : roots)
+			{
+				legacy[r].Position.y += 1.0f;
+				legacy[r].Dirty = true;
+				LegacyMarkChildrenDirty(&legacy[r]);
+			}
+			legacyUpdate();
+		});
+		double flatFewMs = TimeMilliseconds([&]()
+		{
+			for (int r : roots)
+				flat[r].MoveAbsolute(0, 1.0f, 0);
+			hierarchy.UpdateMatrices();
+		});
+
+		// Random leaves get random new parents (or none), most of them
+		// later in the order.  Only moving leaves, and never deeper than
+		// one past the deepest to start with, keeps the baseline's
+		// recursion in check.
+		std::vector<std::pair<int, int>> moves(reparentCount);
+		for (auto& m : moves)
+		{
+			do { m.first = rand() % nodeCount; } while (childCounts[m.first] > 0);
+			if (rand() % 10 == 0)
+				m.second = -1;
+			else
+				do { m.second = rand() % nodeCount; } while (m.second == m.first || depths[m.second] > maxDepth);
+
+			if (parents[m.first] >= 0)
+				childCounts[parents[m.first]]--;
+			if (m.second >= 0)
+				childCounts[m.second]++;
+			parents[m.first] = m.second;
+			depths[m.first] = m.second >= 0 ? depths[m.second] + 1 : 0;
+		}
+		double legacyReparentMs = TimeMilliseconds([&]()
+		{
+			for (auto& m : moves)
+				LegacySetParent(&legacy[m.first], m.second >= 0 ? &legacy[m.second] : 0);
+			legacyUpdate();
+		});
+		double flatReparentMs = TimeMilliseconds([&]()
+		{
+			for (auto& m : moves)
+			{
+				// Without keeping the node where it was, like the baseline
+				Transform* node = &flat[m.first];
+				if (node->GetParent())
+					node->GetParent()->RemoveChild(node, false);
+				if (m.second >= 0)
+					flat[m.second].AddChild(node, false);
+			}
+			hierarchy.UpdateMatrices();
+		});
+
+		// Same hierarchy and same matrices?
+		bool sameTree = true;
+		float maxError = 0.0f;
+		for (int i = 0; i < nodeCount; i++)
+		{
+			Transform* parent = flat[i].GetParent();
+			sameTree &= legacy[i].Parent ? parent == &flat[legacy[i].Parent - &legacy[0]] : parent == 0;
+
+			XMFLOAT4X4 w = flat[i].GetWorldMatrix();
+			for (int r = 0; r < 4; r++)
+				for (int c = 0; c < 4; c++)
+					maxError = (std::max)(maxError, fabsf(w.m[r][c] - legacy[i].World.m[r][c]) / (std::max)(1.0f, fabsf(legacy[i].World.m[r][c])));
+		}
+
+		printf("%-16s %9d %11.2f ms %11.2f ms %11.2f ms %11.2f ms %11.2f ms %11.2f ms %s\n",
+			scene.Name,
+			maxDepth,
+			legacyAllMs,
+			flatAllMs,
+			legacyFewMs,
+			flatFewMs,
+			legacyReparentMs,
+			flatReparentMs,
+			!sameTree ? "TREE MISMATCH" : maxError < 1e-3f ? "match" : "MISMATCH");
+	}
+}
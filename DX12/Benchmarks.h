@@ -0,0 +1,18 @@
+#pragma once
+
+// --------------------------------------------------------
+// CPU-side performance checks
+//
+// Each one prints its results to the console, so these
+// are best run from a Release build (see Game::Update
+// for the key that triggers them).
+// --------------------------------------------------------
+class Benchmarks
+{
+public:
+	// Compares the original pointer-based transform hierarchy against
+	// TransformHierarchy's single pass on several 100k node scenes:
+	// updating everything, updating after a few roots move, and
+	// reparenting, checking that both end up with the same matrices
+	static void HierarchyUpdates();
+};
@@ -6,6 +6,7 @@
 #include "Material.h"
 #include "GameEntity.h"
 #include "BufferStructs.h"
+#include "Benchmarks.h"
 
 // Needed for a helper function to read compiled shader files from the hard drive
 #pragma comment(lib, "d3dcompiler.lib")
@@ -384,6 +385,17 @@ void Game::Update(float deltaTime, float totalTime)
 	}
 
 	camera->Update(deltaTime);
+
+	// Rebuild the matrices of everything that moved, parents first
+	TransformHierarchy::GetInstance().UpdateMatrices();
+
+	// Run the CPU benchmarks (results go to the console)
+	if (Input::GetInstance().KeyPress('B'))
+	{
+		if (!GetConsoleWindow())
+			CreateConsoleWindow(500, 120, 32, 120);
+		Benchmarks::HierarchyUpdates();
+	}
 }
 
 // --------------------------------------------------------
@@ -452,7 +464,7 @@ void Game::Draw(float deltaTime, float totalTime)
 			vsData.world = e->GetTransform()->GetWorldMatrix();
 			vsData.view = camera->GetView();
 			vsData.projection = camera->GetProjection();
-			vsData.worldInverseTranspose = camera->GetTransform()->GetWorldInverseTransposeMatrix();
+			vsData.worldInverseTranspose = e->GetTransform()->GetWorldInverseTransposeMatrix();
 
 			// Send it to the const buffer heap & grab gpuHandle
 			D3D12_GPU_DESCRIPTOR_HANDLE cbHandleVS = dx12Helper.FillNextConstantBufferAndGetGPUDescriptorHandle((void*)(&vsData), sizeof(VertexShaderExternalData));
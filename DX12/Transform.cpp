@@ -5,6 +5,7 @@ using namespace DirectX;
 
 Transform::Transform() :
 	position(0, 0, 0),
+	rotation(0, 0, 0, 1),
 	pitchYawRoll(0, 0, 0),
 	scale(1, 1, 1),
 	up(0, 1, 0),
@@ -12,11 +13,40 @@ Transform::Transform() :
 	forward(0, 0, 1),
 	matricesDirty(false),
 	vectorsDirty(false),
-	parent(0)
+	parent(0),
+	indexInParent(0)
 {
 	// Start with an identity matrix and basic transform data
-	XMStoreFloat4x4(&worldMatrix, XMMatrixIdentity());
-	XMStoreFloat4x4(&worldInverseTransposeMatrix, XMMatrixIdentity());
+	node = TransformHierarchy::GetInstance().Add(this);
+}
+
+Transform::Transform(const Transform& other) :
+	Transform()
+{
+	*this = other;
+}
+
+Transform& Transform::operator=(const Transform& other)
+{
+	position = other.position;
+	rotation = other.rotation;
+	pitchYawRoll = other.pitchYawRoll;
+	scale = other.scale;
+	MarkMatricesDirty();
+	vectorsDirty = true;
+	return *this;
+}
+
+Transform::~Transform()
+{
+	// Leave the children where they are, as roots
+	while (!children.empty())
+		RemoveChild(children.back());
+
+	if (parent)
+		parent->RemoveChild(this, false);
+
+	TransformHierarchy::GetInstance().Remove(node);
 }
 
 void Transform::MoveAbsolute(float x, float y, float z)
@@ -24,7 +54,7 @@ void Transform::MoveAbsolute(float x, float y, float z)
 	position.x += x;
 	position.y += y;
 	position.z += z;
-	matricesDirty = true;
+	MarkMatricesDirty();
 }
 
 void Transform::MoveAbsolute(DirectX::XMFLOAT3 offset)
@@ -32,22 +62,22 @@ void Transform::MoveAbsolute(DirectX::XMFLOAT3 offset)
 	position.x += offset.x;
 	position.y += offset.y;
 	position.z += offset.z;
-	matricesDirty = true;
+	MarkMatricesDirty();
 }
 
 void Transform::MoveRelative(float x, float y, float z)
 {
 	// Create a direction vector from the params
-	// and a rotation quaternion
+	// and grab the rotation quaternion
 	XMVECTOR movement = XMVectorSet(x, y, z, 0);
-	XMVECTOR rotQuat = XMQuaternionRotationRollPitchYawFromVector(XMLoadFloat3(&pitchYawRoll));
+	XMVECTOR rotQuat = XMLoadFloat4(&rotation);
 
 	// Rotate the movement by the quaternion
 	XMVECTOR dir = XMVector3Rotate(movement, rotQuat);
 
 	// Add and store, and invalidate the matrices
 	XMStoreFloat3(&position, XMLoadFloat3(&position) + dir);
-	matricesDirty = true;
+	MarkMatricesDirty();
 }
 
 void Transform::MoveRelative(DirectX::XMFLOAT3 offset)
@@ -61,8 +91,7 @@ void Transform::Rotate(float p, float y, float r)
 	pitchYawRoll.x += p;
 	pitchYawRoll.y += y;
 	pitchYawRoll.z += r;
-	matricesDirty = true;
-	vectorsDirty = true;
+	UpdateRotation();
 }
 
 void Transform::Rotate(DirectX::XMFLOAT3 pitchYawRoll)
@@ -70,8 +99,7 @@ void Transform::Rotate(DirectX::XMFLOAT3 pitchYawRoll)
 	this->pitchYawRoll.x += pitchYawRoll.x;
 	this->pitchYawRoll.y += pitchYawRoll.y;
 	this->pitchYawRoll.z += pitchYawRoll.z;
-	matricesDirty = true;
-	vectorsDirty = true;
+	UpdateRotation();
 }
 
 void Transform::Scale(float uniformScale)
@@ -79,7 +107,7 @@ void Transform::Scale(float uniformScale)
 	scale.x *= uniformScale;
 	scale.y *= uniformScale;
 	scale.z *= uniformScale;
-	matricesDirty = true;
+	MarkMatricesDirty();
 }
 
 void Transform::Scale(float x, float y, float z)
@@ -87,7 +115,7 @@ void Transform::Scale(float x, float y, float z)
 	scale.x *= x;
 	scale.y *= y;
 	scale.z *= z;
-	matricesDirty = true;
+	MarkMatricesDirty();
 }
 
 void Transform::Scale(DirectX::XMFLOAT3 scale)
@@ -95,7 +123,7 @@ void Transform::Scale(DirectX::XMFLOAT3 scale)
 	this->scale.x *= scale.x;
 	this->scale.y *= scale.y;
 	this->scale.z *= scale.z;
-	matricesDirty = true;
+	MarkMatricesDirty();
 }
 
 void Transform::SetPosition(float x, float y, float z)
@@ -103,13 +131,13 @@ void Transform::SetPosition(float x, float y, float z)
 	position.x = x;
 	position.y = y;
 	position.z = z;
-	matricesDirty = true;
+	MarkMatricesDirty();
 }
 
 void Transform::SetPosition(DirectX::XMFLOAT3 position)
 {
 	this->position = position;
-	matricesDirty = true;
+	MarkMatricesDirty();
 }
 
 void Transform::SetRotation(float p, float y, float r)
@@ -117,14 +145,21 @@ void Transform::SetRotation(float p, float y, float r)
 	pitchYawRoll.x = p;
 	pitchYawRoll.y = y;
 	pitchYawRoll.z = r;
-	matricesDirty = true;
-	vectorsDirty = true;
+	UpdateRotation();
 }
 
 void Transform::SetRotation(DirectX::XMFLOAT3 pitchYawRoll)
 {
 	this->pitchYawRoll = pitchYawRoll;
-	matricesDirty = true;
+	UpdateRotation();
+}
+
+void Transform::SetRotation(DirectX::XMFLOAT4 quaternion)
+{
+	// Only unit quaternions are pure rotations
+	XMStoreFloat4(&rotation, XMQuaternionNormalize(XMLoadFloat4(&quaternion)));
+	pitchYawRoll = QuaternionToEuler(rotation);
+	MarkMatricesDirty();
 	vectorsDirty = true;
 }
 
@@ -133,7 +168,7 @@ void Transform::SetScale(float uniformScale)
 	scale.x = uniformScale;
 	scale.y = uniformScale;
 	scale.z = uniformScale;
-	matricesDirty = true;
+	MarkMatricesDirty();
 }
 
 void Transform::SetScale(float x, float y, float z)
@@ -141,13 +176,13 @@ void Transform::SetScale(float x, float y, float z)
 	scale.x = x;
 	scale.y = y;
 	scale.z = z;
-	matricesDirty = true;
+	MarkMatricesDirty();
 }
 
 void Transform::SetScale(DirectX::XMFLOAT3 scale)
 {
 	this->scale = scale;
-	matricesDirty = true;
+	MarkMatricesDirty();
 }
 
 void Transform::SetTransformsFromMatrix(DirectX::XMFLOAT4X4 worldMatrix)
@@ -158,17 +193,16 @@ void Transform::SetTransformsFromMatrix(DirectX::XMFLOAT4X4 worldMatrix)
 	XMVECTOR localScale;
 	XMMatrixDecompose(&localScale, &localRotQuat, &localPos, XMLoadFloat4x4(&worldMatrix));
 
-	// Get the euler angles from the quaternion and store as our 
-	XMFLOAT4 quat;
-	XMStoreFloat4(&quat, localRotQuat);
-	pitchYawRoll = QuaternionToEuler(quat);
+	// Keep the quaternion, and euler angles for editing
+	XMStoreFloat4(&rotation, localRotQuat);
+	pitchYawRoll = QuaternionToEuler(rotation);
 
 	// Overwrite the child's other transform data
 	XMStoreFloat3(&position, localPos);
 	XMStoreFloat3(&scale, localScale);
 
 	// Things have changed
-	matricesDirty = true;
+	MarkMatricesDirty();
 	vectorsDirty = true;
 }
 
@@ -181,6 +215,15 @@ void Transform::AddChild(Transform* child, bool makeChildRelative)
 	if (IndexOfChild(child) >= 0)
 		return;
 
+	// Can't be our own ancestor
+	for (Transform* t = this; t; t = t->parent)
+		if (t == child)
+			return;
+
+	// Only one parent at a time
+	if (child->parent)
+		child->parent->RemoveChild(child);
+
 	// Do we need to adjust the child's transform
 	// so that it stays in place?
 	if (makeChildRelative)
@@ -205,12 +248,14 @@ void Transform::AddChild(Transform* child, bool makeChildRelative)
 	}
 
 	// Reciprocal set!
+	child->indexInParent = (unsigned int)children.size();
 	children.push_back(child);
 	child->parent = this;
+	TransformHierarchy::GetInstance().SetParent(child->node, node);
 
-	// This child transform is now out of date
-	child->matricesDirty = true;
-	child->MarkChildTransformsDirty();
+	// This child transform is now out of date (its own
+	// children will notice once its matrices change)
+	child->MarkMatricesDirty();
 }
 
 void Transform::RemoveChild(Transform* child, bool applyParentTransform)
@@ -218,29 +263,28 @@ void Transform::RemoveChild(Transform* child, bool applyParentTransform)
 	// Verify valid pointer
 	if (!child) return;
 
-	// Find the child
-	auto it = std::find(children.begin(), children.end(), child);
-	if (it == children.end())
+	// Is it actually our child?
+	int index = IndexOfChild(child);
+	if (index < 0)
 		return;
 
 	// Before actually un-parenting, are we applying the parent's transform?
 	if (applyParentTransform)
 	{
-		// Grab the child's transform and matrix
-		Transform* child = *it;
-		XMFLOAT4X4 childWorld = child->GetWorldMatrix();
-
 		// Set the child's transform data using its final matrix
+		XMFLOAT4X4 childWorld = child->GetWorldMatrix();
 		child->SetTransformsFromMatrix(childWorld);
 	}
 
-	// Reciprocal removal
-	children.erase(it);
+	// Reciprocal removal, moving the last child into its place
+	children[index] = children.back();
+	children[index]->indexInParent = index;
+	children.pop_back();
 	child->parent = 0;
+	TransformHierarchy::GetInstance().SetParent(child->node, -1);
 
 	// This child transform is now out of date
-	child->matricesDirty = true;
-	child->MarkChildTransformsDirty();
+	child->MarkMatricesDirty();
 }
 
 void Transform::SetParent(Transform* newParent, bool makeChildRelative)
@@ -273,15 +317,10 @@ Transform* Transform::GetChild(unsigned int index)
 int Transform::IndexOfChild(Transform* child)
 {
 	// Verify pointer
-	if (!child) return -1;
-
-	// Search
-	for (unsigned int i = 0; i < children.size(); i++)
-		if (children[i] == child)
-			return (int)i;
+	if (!child || child->parent != this) return -1;
 
-	// Not found
-	return -1;
+	// Children know where they are
+	return (int)child->indexInParent;
 }
 
 unsigned int Transform::GetChildCount()
@@ -290,6 +329,7 @@ unsigned int Transform::GetChildCount()
 }
 
 DirectX::XMFLOAT3 Transform::GetPosition() { return position; }
+DirectX::XMFLOAT4 Transform::GetRotation() { return rotation; }
 DirectX::XMFLOAT3 Transform::GetPitchYawRoll() { return pitchYawRoll; }
 DirectX::XMFLOAT3 Transform::GetScale() { return scale; }
 
@@ -314,43 +354,30 @@ DirectX::XMFLOAT3 Transform::GetForward()
 
 DirectX::XMFLOAT4X4 Transform::GetWorldMatrix()
 {
-	UpdateMatrices();
-	return worldMatrix;
+	TransformHierarchy& hierarchy = TransformHierarchy::GetInstance();
+	hierarchy.UpdateNode(node);
+	return hierarchy.worldMatrices[node];
 }
 
 DirectX::XMFLOAT4X4 Transform::GetWorldInverseTransposeMatrix()
 {
-	UpdateMatrices();
-	return worldMatrix;
+	TransformHierarchy& hierarchy = TransformHierarchy::GetInstance();
+	hierarchy.UpdateNode(node);
+	return hierarchy.worldInverseTransposeMatrices[node];
 }
 
-void Transform::UpdateMatrices()
+void Transform::MarkMatricesDirty()
 {
-	// Anything to update?
-	if (!matricesDirty)
-		return;
-
-	// Create the three transformation pieces
-	XMMATRIX trans = XMMatrixTranslationFromVector(XMLoadFloat3(&position));
-	XMMATRIX rot = XMMatrixRotationRollPitchYawFromVector(XMLoadFloat3(&pitchYawRoll));
-	XMMATRIX sc = XMMatrixScalingFromVector(XMLoadFloat3(&scale));
-
-	// Combine and store the world
-	XMMATRIX wm = sc * rot * trans;
-
-	// Is there a parent?
-	if (parent)
-	{
-		XMFLOAT4X4 parentWorld = parent->GetWorldMatrix();
-		wm *= XMLoadFloat4x4(&parentWorld);
-	}
-
-	// Store both versions
-	XMStoreFloat4x4(&worldMatrix, wm);
-	XMStoreFloat4x4(&worldInverseTransposeMatrix, XMMatrixInverse(0, XMMatrixTranspose(wm)));
+	matricesDirty = true;
+	TransformHierarchy::GetInstance().anyDirty = true;
+}
 
-	// Matrices are up to date
-	matricesDirty = false;
+void Transform::UpdateRotation()
+{
+	// The quaternion follows the euler angles
+	XMStoreFloat4(&rotation, XMQuaternionRotationRollPitchYawFromVector(XMLoadFloat3(&pitchYawRoll)));
+	MarkMatricesDirty();
+	vectorsDirty = true;
 }
 
 void Transform::UpdateVectors()
@@ -360,7 +387,7 @@ void Transform::UpdateVectors()
 		return;
 
 	// Update all three vectors
-	XMVECTOR rotationQuat = XMQuaternionRotationRollPitchYawFromVector(XMLoadFloat3(&pitchYawRoll));
+	XMVECTOR rotationQuat = XMLoadFloat4(&rotation);
 	XMStoreFloat3(&up, XMVector3Rotate(XMVectorSet(0, 1, 0, 0), rotationQuat));
 	XMStoreFloat3(&right, XMVector3Rotate(XMVectorSet(1, 0, 0, 0), rotationQuat));
 	XMStoreFloat3(&forward, XMVector3Rotate(XMVectorSet(0, 0, 1, 0), rotationQuat));
@@ -369,16 +396,6 @@ void Transform::UpdateVectors()
 	vectorsDirty = false;
 }
 
-void Transform::MarkChildTransformsDirty()
-{
-	// Recursively set children as dirty, too
-	for (auto c : children)
-	{
-		c->matricesDirty = true;
-		c->MarkChildTransformsDirty();
-	}
-}
-
 DirectX::XMFLOAT3 Transform::QuaternionToEuler(DirectX::XMFLOAT4 quaternion)
 {
 	// Convert quaternion to euler angles
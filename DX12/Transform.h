@@ -3,10 +3,15 @@
 #include <DirectXMath.h>
 #include <vector>
 
+#include "TransformHierarchy.h"
+
 class Transform
 {
 public:
 	Transform();
+	Transform(const Transform& other);	// Copies the transform data, but not the hierarchy
+	Transform& operator=(const Transform& other);
+	~Transform();
 
 	// Transformers
 	void MoveAbsolute(float x, float y, float z);
@@ -24,6 +29,7 @@ public:
 	void SetPosition(DirectX::XMFLOAT3 position);
 	void SetRotation(float p, float y, float r);
 	void SetRotation(DirectX::XMFLOAT3 pitchYawRoll);
+	void SetRotation(DirectX::XMFLOAT4 quaternion);
 	void SetScale(float uniformScale);
 	void SetScale(float x, float y, float z);
 	void SetScale(DirectX::XMFLOAT3 scale);
@@ -39,8 +45,11 @@ public:
 	int IndexOfChild(Transform* child);
 	unsigned int GetChildCount();
 
-	// Getters
+	// Getters (rotation is stored as a quaternion - the pitch/yaw/roll
+	// version is for editing, and is whatever the rotation was last set
+	// or rotated to, or else angles that match it)
 	DirectX::XMFLOAT3 GetPosition();
+	DirectX::XMFLOAT4 GetRotation();
 	DirectX::XMFLOAT3 GetPitchYawRoll();
 	DirectX::XMFLOAT3 GetScale();
 
@@ -54,12 +63,18 @@ public:
 	DirectX::XMFLOAT4X4 GetWorldInverseTransposeMatrix();
 
 private:
-	// Hierarchy
+	friend class TransformHierarchy;
+
+	// Hierarchy (children are in no particular order, as
+	// removing one moves the last child into its place)
 	Transform* parent;
 	std::vector<Transform*> children;
+	unsigned int indexInParent;
+	int node;	// In the TransformHierarchy
 
 	// Raw transformation data
 	DirectX::XMFLOAT3 position;
+	DirectX::XMFLOAT4 rotation;
 	DirectX::XMFLOAT3 pitchYawRoll;
 	DirectX::XMFLOAT3 scale;
 
@@ -69,15 +84,12 @@ private:
 	DirectX::XMFLOAT3 right;
 	DirectX::XMFLOAT3 forward;
 
-	// World matrix and inverse transpose of the world matrix
+	// The matrices themselves live in the TransformHierarchy
 	bool matricesDirty;
-	DirectX::XMFLOAT4X4 worldMatrix;
-	DirectX::XMFLOAT4X4 worldInverseTransposeMatrix;
 
-	// Helper to update both matrices if necessary
-	void UpdateMatrices();
+	void MarkMatricesDirty();
+	void UpdateRotation();
 	void UpdateVectors();
-	void MarkChildTransformsDirty();
 
 	// Helpers for conversion
 	DirectX::XMFLOAT3 QuaternionToEuler(DirectX::XMFLOAT4 quaternion);
@@ -0,0 +1,218 @@
+#include "TransformHierarchy.h"
+#include "Transform.h"
+
+using namespace DirectX;
+
+
+// for Singleton
+TransformHierarchy* TransformHierarchy::instance;
+
+
+unsigned int TransformHierarchy::UpdateMatrices()
+{
+	if (emptyCount > transforms.size() / 2)
+		Reorder();
+
+	// Parents always come first, so they're already up to date
+	unsigned int rebuilt = 0;
+	for (int i = 0; i < (int)transforms.size(); i++)
+	{
+		if (transforms[i] && IsOutOfDate(i))
+		{
+			Rebuild(i);
+			rebuilt++;
+		}
+	}
+
+	anyDirty = false;
+	return rebuilt;
+}
+
+int TransformHierarchy::Add(Transform* transform)
+{
+	XMFLOAT4X4 identity;
+	XMStoreFloat4x4(&identity, XMMatrixIdentity());
+
+	transforms.push_back(transform);
+	parents.push_back(-1);
+	versions.push_back(0);
+	parentVersions.push_back(0);
+	worldMatrices.push_back(identity);
+	worldInverseTransposeMatrices.push_back(identity);
+	return (int)transforms.size() - 1;
+}
+
+void TransformHierarchy::Remove(int node)
+{
+	// Dropped at the next reorder
+	transforms[node] = 0;
+	parents[node] = -1;
+	emptyCount++;
+}
+
+void TransformHierarchy::SetParent(int node, int parent)
+{
+	// The node's descendants all come after it already,
+	// so only a later parent breaks the order
+	parents[node] = parent;
+	if (parent > node)
+		MoveToEnd(node);
+}
+
+void TransformHierarchy::MoveToEnd(int node)
+{
+	// Each node is moved before its children are looked at,
+	// so their parent's new index is always known
+	std::vector<Transform*> queue(1, transforms[node]);
+	for (size_t q = 0; q < queue.size(); q++)
+	{
+		Transform* t = queue[q];
+		int from = t->node;
+		int to = (int)transforms.size();
+
+		transforms.push_back(t);
+		parents.push_back(t->parent ? t->parent->node : -1);
+		versions.push_back(versions[from]);
+		parentVersions.push_back(parentVersions[from]);
+		worldMatrices.push_back(worldMatrices[from]);
+		worldInverseTransposeMatrices.push_back(worldInverseTransposeMatrices[from]);
+
+		transforms[from] = 0;
+		parents[from] = -1;
+		emptyCount++;
+		t->node = to;
+
+		queue.insert(queue.end(), t->children.begin(), t->children.end());
+	}
+}
+
+void TransformHierarchy::UpdateNode(int node)
+{
+	if (!anyDirty)
+		return;
+
+	// Walk up to the root, then back down
+	scratch.clear();
+	for (int n = node; n >= 0; n = parents[n])
+		scratch.push_back(n);
+
+	for (size_t i = scratch.size(); i-- > 0;)
+	{
+		if (IsOutOfDate(scratch[i]))
+			Rebuild(scratch[i]);
+	}
+}
+
+bool TransformHierarchy::IsOutOfDate(int node)
+{
+	int parent = parents[node];
+	return transforms[node]->matricesDirty || (parent >= 0 && parentVersions[node] != versions[parent]);
+}
+
+void TransformHierarchy::Rebuild(int node)
+{
+	Transform* t = transforms[node];
+
+	// Create the three transformation pieces
+	XMVECTOR position = XMLoadFloat3(&t->position);
+	XMVECTOR scale = XMLoadFloat3(&t->scale);
+	XMMATRIX rot = XMMatrixRotationQuaternion(XMLoadFloat4(&t->rotation));
+
+	// The inverse is just each piece undone in reverse (the rotation's
+	// inverse being its transpose), so no general inverse is needed
+	XMMATRIX wm = XMMatrixScalingFromVector(scale) * rot * XMMatrixTranslationFromVector(position);
+	XMMATRIX inv = XMMatrixTranslationFromVector(-position) * XMMatrixTranspose(rot) * XMMatrixScalingFromVector(XMVectorReciprocal(scale));
+	XMMATRIX invTrans = XMMatrixTranspose(inv);
+
+	// Combine with the parent's (already up to date) matrices, as the
+	// inverse transpose of a product is the product of inverse transposes
+	int parent = parents[node];
+	if (parent >= 0)
+	{
+		wm *= XMLoadFloat4x4(&worldMatrices[parent]);
+		invTrans *= XMLoadFloat4x4(&worldInverseTransposeMatrices[parent]);
+		parentVersions[node] = versions[parent];
+	}
+
+	// Store both versions
+	XMStoreFloat4x4(&worldMatrices[node], wm);
+	XMStoreFloat4x4(&worldInverseTransposeMatrices[node], invTrans);
+
+	// Children can tell they're out of date now
+	versions[node]++;
+	t->matricesDirty = false;
+}
+
+void TransformHierarchy::Reorder()
+{
+	const int count = (int)transforms.size();
+
+	// Depth of every node (-1 until known), filling in
+	// each path up to the first node that's known
+	std::vector<int>& depths = scratch;
+	depths.assign(count, -1);
+	std::vector<int> path;
+	int maxDepth = 0;
+	for (int i = 0; i < count; i++)
+	{
+		if (!transforms[i] || depths[i] >= 0)
+			continue;
+
+		int n = i;
+		path.clear();
+		while (n >= 0 && depths[n] < 0)
+		{
+			path.push_back(n);
+			n = parents[n];
+		}
+
+		int depth = n >= 0 ? depths[n] + 1 : 0;
+		for (size_t p = path.size(); p-- > 0; depth++)
+			depths[path[p]] = depth;
+		maxDepth = depth - 1 > maxDepth ? depth - 1 : maxDepth;
+	}
+
+	// Counting sort by depth, keeping the current order within each level
+	std::vector<int> levelStarts(maxDepth + 2, 0);
+	for (int i = 0; i < count; i++)
+		if (transforms[i])
+			levelStarts[depths[i] + 1]++;
+	for (int d = 1; d <= maxDepth + 1; d++)
+		levelStarts[d] += levelStarts[d - 1];
+
+	std::vector<int> newIndices(count, -1);
+	for (int i = 0; i < count; i++)
+		if (transforms[i])
+			newIndices[i] = levelStarts[depths[i]]++;
+
+	// Move everything over
+	int liveCount = levelStarts[maxDepth];
+	std::vector<Transform*> newTransforms(liveCount);
+	std::vector<int> newParents(liveCount);
+	std::vector<unsigned int> newVersions(liveCount);
+	std::vector<unsigned int> newParentVersions(liveCount);
+	std::vector<XMFLOAT4X4> newWorlds(liveCount);
+	std::vector<XMFLOAT4X4> newWorldInvTrans(liveCount);
+	for (int i = 0; i < count; i++)
+	{
+		int n = newIndices[i];
+		if (n < 0)
+			continue;
+
+		newTransforms[n] = transforms[i];
+		newParents[n] = parents[i] >= 0 ? newIndices[parents[i]] : -1;
+		newVersions[n] = versions[i];
+		newParentVersions[n] = parentVersions[i];
+		newWorlds[n] = worldMatrices[i];
+		newWorldInvTrans[n] = worldInverseTransposeMatrices[i];
+		transforms[i]->node = n;
+	}
+
+	transforms.swap(newTransforms);
+	parents.swap(newParents);
+	versions.swap(newVersions);
+	parentVersions.swap(newParentVersions);
+	worldMatrices.swap(newWorlds);
+	worldInverseTransposeMatrices.swap(newWorldInvTrans);
+	emptyCount = 0;
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <vector>
+
+class Transform;
+
+// --------------------------------------------------------
+// Every Transform's place in the hierarchy, as flat arrays
+// of nodes where each parent comes before its children
+//
+// Each node keeps the index of its parent, and the version
+// of the parent's world matrix it was last built from, so
+// one front-to-back pass rebuilds everything that's out of
+// date with every parent already done.
+//
+// Reparenting only breaks that order when the new parent
+// comes later, and then just the node and its descendants
+// move to the end.  Their old entries (and those of removed
+// transforms) are left empty until half of them are, when
+// everything is put back into breadth first order.
+// --------------------------------------------------------
+class TransformHierarchy
+{
+#pragma region Singleton
+public:
+	// Gets the one and only instance of this class
+	static TransformHierarchy& GetInstance()
+	{
+		if (!instance)
+			instance = new TransformHierarchy();
+		return *instance;
+	}
+
+	// Remove these funtions (C++11 version)
+	TransformHierarchy(TransformHierarchy const&) = delete;
+	void operator=(TransformHierarchy const&) = delete;
+
+private:
+	static TransformHierarchy* instance;
+	TransformHierarchy() :
+		emptyCount(0),
+		anyDirty(false)
+	{ };
+#pragma endregion
+
+public:
+	~TransformHierarchy() {};
+
+	// Rebuilds the world matrix of every transform that changed, or
+	// whose parent's changed, and returns how many were rebuilt
+	unsigned int UpdateMatrices();
+
+	unsigned int GetNodeCount() { return (unsigned int)transforms.size(); }
+
+private:
+	friend class Transform;
+
+	// One entry per node, in order
+	std::vector<Transform*> transforms;		// Null once removed
+	std::vector<int> parents;				// -1 for roots
+	std::vector<unsigned int> versions;		// Changes whenever the world matrix does
+	std::vector<unsigned int> parentVersions;
+	std::vector<DirectX::XMFLOAT4X4> worldMatrices;
+	std::vector<DirectX::XMFLOAT4X4> worldInverseTransposeMatrices;
+
+	// Entries left behind by moved or removed nodes
+	unsigned int emptyCount;
+
+	// Set when any transform changes, until the next full update
+	bool anyDirty;
+
+	// Reused by UpdateNode() and Reorder()
+	std::vector<int> scratch;
+
+	// New nodes start out as roots
+	int Add(Transform* transform);
+	void Remove(int node);
+	void SetParent(int node, int parent);
+
+	// Moves the node and its descendants to the end, breadth first
+	void MoveToEnd(int node);
+
+	// Brings one node (and its ancestors) up to date
+	void UpdateNode(int node);
+	bool IsOutOfDate(int node);
+	void Rebuild(int node);
+
+	// Sorts the nodes breadth first and drops the empty entries
+	void Reorder();
+};
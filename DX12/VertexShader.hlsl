@@ -38,8 +38,8 @@ VertexToPixel main(VertexShaderInput input)
 	output.screenPosition = mul(wvp, float4(input.localPosition, 1.0f));
 
 	// Make sure the lighting vectors are in world space
-	output.normal = normalize(mul((float3x3) world, input.normal));
-	output.tangent = normalize(mul((float3x3) worldInverseTranspose, input.tangent));
+	output.normal = normalize(mul((float3x3) worldInverseTranspose, input.normal));
+	output.tangent = normalize(mul((float3x3) world, input.tangent)); // Tangent doesn't need inverse transpose!
 
 	// Calc vertex world pos
 	output.worldPos = mul(world, float4(input.localPosition, 1.0f)).xyz;